@@ -0,0 +1,60 @@
+#include "cachecounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+CacheMissCounter::CacheMissCounter()
+{
+    // The generic cache miss event is the last level cache on the usual CPUs. Only user space is counted, which is
+    // all that an unprivileged process is allowed to see.
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    m_descriptor = static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+    if (m_descriptor >= 0)
+    {
+        close(m_descriptor);
+    }
+}
+
+uint64_t CacheMissCounter::read() const
+{
+    uint64_t count = 0;
+    if ((m_descriptor < 0) || (::read(m_descriptor, &count, sizeof(count)) != sizeof(count)))
+    {
+        return 0;
+    }
+    return count;
+}
+
+#else
+
+CacheMissCounter::CacheMissCounter()
+{
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+}
+
+uint64_t CacheMissCounter::read() const
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CACHECOUNTERS_H
+#define CACHECOUNTERS_H
+
+#include <cstdint>
+
+/// Counts the last level cache misses of the calling thread with the hardware performance counters. This needs
+/// Linux with kernel.perf_event_paranoid at most 2 and a CPU whose counters the OS exposes, which many virtual
+/// machines don't; elsewhere the counter is simply not available.
+class CacheMissCounter
+{
+public:
+    /// Open the counter and start counting.
+    CacheMissCounter();
+    ~CacheMissCounter();
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    /// Returns true if the misses are counted.
+    bool available() const { return m_descriptor >= 0; }
+
+    /// Returns the number of misses since the counter was opened, or 0 if it is not available.
+    uint64_t read() const;
+
+private:
+    int m_descriptor = -1;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "generators.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+GeneratedGraph GenerateUniformGraph(size_t vertexCount, size_t edgeCount, uint32_t seed)
+{
+    GeneratedGraph graph;
+    graph.vertex_count = vertexCount;
+    graph.edges.reserve(edgeCount);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+        static_cast<std::mt19937::result_type>(vertexCount));
+    for (size_t i = 0; i < edgeCount; ++i)
+    {
+        VertexId from = dist(rng);
+        VertexId to = dist(rng);
+        if (from != to)
+        {
+            graph.edges.emplace_back(from, to);
+        }
+    }
+    return graph;
+}
+
+GeneratedGraph GenerateRmatGraph(unsigned scale, size_t edgeFactor, uint32_t seed)
+{
+    // Probabilities of the top-left, top-right and bottom-left quadrants; bottom-right gets the rest.
+    const double A = 0.57;
+    const double B = 0.19;
+    const double C = 0.19;
+
+    GeneratedGraph graph;
+    graph.vertex_count = size_t(1) << scale;
+    const size_t edge_count = graph.vertex_count * edgeFactor;
+    graph.edges.reserve(edge_count);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    std::vector<VertexId> permutation(graph.vertex_count);
+    std::iota(permutation.begin(), permutation.end(), VertexId(1));
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        // Each level picks one quadrant of the adjacency matrix, which sets one bit of each end of the edge.
+        size_t from = 0;
+        size_t to = 0;
+        for (unsigned level = 0; level < scale; ++level)
+        {
+            const double p = dist(rng);
+            const size_t from_bit = (p >= A + B) ? 1 : 0;
+            const size_t to_bit = (((p >= A) && (p < A + B)) || (p >= A + B + C)) ? 1 : 0;
+            from = (from << 1) | from_bit;
+            to = (to << 1) | to_bit;
+        }
+        if (from != to)
+        {
+            graph.edges.emplace_back(permutation[from], permutation[to]);
+        }
+    }
+    return graph;
+}
+
+GeneratedGraph GenerateGridGraph(size_t width, size_t height)
+{
+    GeneratedGraph graph;
+    graph.vertex_count = width * height;
+    graph.edges.reserve(4 * graph.vertex_count);
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            const VertexId vertex = (y * width) + x + 1;
+            if (x + 1 < width)
+            {
+                graph.edges.emplace_back(vertex, vertex + 1);
+                graph.edges.emplace_back(vertex + 1, vertex);
+            }
+            if (y + 1 < height)
+            {
+                graph.edges.emplace_back(vertex, vertex + width);
+                graph.edges.emplace_back(vertex + width, vertex);
+            }
+        }
+    }
+    return graph;
+}
+
+std::vector<VertexId> PickVertices(size_t vertexCount, double probability, uint32_t seed)
+{
+    std::vector<VertexId> vertices;
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution picked(probability);
+    for (VertexId vertex = 1; vertex <= vertexCount; ++vertex)
+    {
+        if (picked(rng))
+        {
+            vertices.push_back(vertex);
+        }
+    }
+    return vertices;
+}
@@ -0,0 +1,32 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include "../src/types.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// The vertices and edges of a generated graph. The vertex IDs go from 1 to vertex_count.
+struct GeneratedGraph
+{
+    size_t vertex_count = 0;
+    std::vector<std::pair<VertexId, VertexId>> edges;
+};
+
+/// Random graph where both ends of every edge are drawn uniformly, as in the original performance tests. Self loops
+/// are dropped, so there can be slightly fewer edges than asked for.
+GeneratedGraph GenerateUniformGraph(size_t vertexCount, size_t edgeCount, uint32_t seed);
+
+/// R-MAT graph with 2^scale vertices and edgeFactor edges per vertex, using the Graph500 probabilities. The degrees
+/// follow a power law: a few hubs have most of the edges and many vertices have none. The vertex IDs are shuffled so
+/// that the hubs are not all at the start.
+GeneratedGraph GenerateRmatGraph(unsigned scale, size_t edgeFactor, uint32_t seed);
+
+/// Road-like graph: a width x height grid where each vertex has an edge in both directions to its four neighbours.
+/// The degree is low and the diameter large, the opposite of the two random graphs.
+GeneratedGraph GenerateGridGraph(size_t width, size_t height);
+
+/// Returns a random subset of the vertices, each vertex being picked with the given probability, sorted by ID.
+std::vector<VertexId> PickVertices(size_t vertexCount, double probability, uint32_t seed);
+
+#endif
@@ -0,0 +1,1111 @@
+#include "cachecounters.h"
+#include "generators.h"
+#include "processmemory.h"
+#include "../src/durablegraphstore.h"
+#include "../src/graphstore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark of shortestPath on generated graphs.
+// Each scenario generates a graph, builds a frozen GraphStore from it and gives three labels to a random 100%, 50% and
+// 10% of the vertices. For each label it times queries between random vertices that have the label, one at a time on
+// the calling thread for the latency percentiles, then as one batch on a thread pool for the throughput.
+//
+// Usage: graphstore_benchmark [--json <path>] [--filter <text>] [--queries <count>] [--threads <count>]
+//                             [--algorithm auto|bidirectional|astar|alt|parallel|dijkstra] [--landmarks <count>]
+//                             [--weights <max>] [--real-weights] [--metrics] [--reachability] [--distance-index]
+//                             [--reorder bfs|rcm|degree] [--compressed] [--compact] [--heap-nodes] [--churn <rounds>]
+//                             [--matrix <count>] [--subscriptions <count>] [--max-expanded <count>]
+//                             [--timeout-us <us>] [--scaling] [--wal <path>] [--large]
+// --json writes the results as JSON to the file, or to the standard output if the path is "-".
+// --filter only runs the scenarios whose name contains the text. The peak RSS is the peak of the whole process, so run
+// one scenario per process to get the peak of each.
+// --metrics records the queries in the global metrics, to measure what that costs, and prints them at the end in the
+// Prometheus format.
+// --landmarks builds landmark tables with that many landmarks for --algorithm alt, which is included in the build
+// time.
+// --weights gives each edge a random integer weight from 1 to max, for --algorithm dijkstra, which is included in
+// the build time. --real-weights makes them real numbers from 0 to max instead.
+// --reachability builds a reachability index for each label, which is included in the build time.
+// --distance-index builds a distance index for each label, which is included in the build time. It needs memory that
+// grows faster than the graph, so it is meant for the smaller scenarios.
+// --reorder renumbers the vertices in memory in that order before the store is frozen, which is included in the build
+// time. The queries use the IDs of the generated graph either way. Compare a run with and without it on the same
+// scenario; where the hardware counters are available, the single queries also report the last level cache misses
+// they cause.
+// --compressed keeps the edges in a CompressedAdjacency instead of a CSR copy. Each scenario reports the bytes per edge
+// of the forward adjacency either way; compare the latencies of a run with and without it, and with --reorder, which
+// makes the neighbours of a vertex closer and so compresses better.
+// --compact freezes the edges into a CSR copy with 32-bit IDs instead of 64-bit ones, see
+// AdjacencyStorage::CompactSets. Compare the bytes per edge and the latencies of a run with and without it. The first
+// label, which every vertex has, is searched without label checks either way.
+// --heap-nodes allocates the nodes of the sets of neighbours from the global heap instead of the pool of the store.
+// Compare the build time, the time to destroy the store and the churn of a run with and without it.
+// --churn runs that many rounds of deletions once the queries are done: each round deletes 5% of the vertices, picked
+// at random, then creates as many vertices and gives them as many random edges as were deleted. The scenario reports
+// the time the rounds took and the memory of the store and of the process after them.
+// --matrix times distanceMatrix from count random vertices to count others through the first label, on the calling
+// thread, against a shortestPath query per pair for a sample of the pairs, and shortestPaths from one of the vertices
+// to all the others.
+// --subscriptions subscribes to the paths between count random pairs of vertices through the second label, then times
+// a stream of mutations around them, edges created and deleted and the label added and removed, with the subscriptions
+// kept up to date, against polling: a shortestPath query per pair, as often as there are mutations.
+// --max-expanded stops each query once it has expanded that many vertices, batches included, and --timeout-us each
+// single query once it has run that many microseconds. Each label reports how many single queries were truncated;
+// compare the tail latencies of a run with and without the limits.
+// --scaling times the first label once more for each number of worker threads from 1, doubling up to --threads: the
+// queries as one batch, each query on one worker, and the single queries with the parallel BFS, each query on all of
+// them.
+// --wal times the ingest of the graph, labels included, through a DurableGraphStore whose checkpoint is at that path,
+// then opening the store again from the log alone and from a checkpoint. The ingest is timed with a sync per record on
+// the first edges and with group commit on the whole graph. The files are removed afterwards. The store is built
+// before the one that is queried, so it is not part of the build time but may be part of the peak RSS.
+// --large adds scenarios with millions of vertices.
+
+namespace
+{
+    struct Options
+    {
+        std::string json_path;
+        std::string filter;
+        size_t query_count = 1000;
+        size_t thread_count = 0;
+        SearchAlgorithm algorithm = SearchAlgorithm::Auto;
+        bool metrics = false;
+        bool reachability = false;
+        bool distance_index = false;
+        size_t landmark_count = 0;
+        double max_weight = 0;
+        bool real_weights = false;
+        bool reorder = false;
+        VertexOrder order = VertexOrder::Bfs;
+        bool compressed = false;
+        bool compact = false;
+        bool heap_nodes = false;
+        size_t churn_rounds = 0;
+        size_t matrix_size = 0;
+        size_t subscription_count = 0;
+        uint64_t max_expanded = UINT64_MAX;
+        uint64_t timeout_us = 0;
+        bool scaling = false;
+        std::string wal_path;
+        bool large = false;
+    };
+
+    struct Scenario
+    {
+        std::string name;
+        std::string generator;
+        bool large;
+        std::function<GeneratedGraph()> generate;
+    };
+
+    struct LabelResult
+    {
+        std::string label;
+        double selectivity = 0;
+        size_t labelled_vertices = 0;
+        size_t query_count = 0;
+        size_t found_count = 0;
+        // The queries that --max-expanded or --timeout-us stopped.
+        size_t truncated_count = 0;
+        double mean_us = 0;
+        double p50_us = 0;
+        double p95_us = 0;
+        double p99_us = 0;
+        double max_us = 0;
+        double throughput_qps = 0;
+        double batch_throughput_qps = 0;
+        // Negative when the hardware counters are not available.
+        double llc_misses_per_query = -1;
+    };
+
+    struct ScalingResult
+    {
+        size_t worker_count = 0;
+        double batch_throughput_qps = 0;
+        double parallel_bfs_mean_us = 0;
+    };
+
+    struct ScenarioResult
+    {
+        std::string name;
+        std::string generator;
+        size_t vertex_count = 0;
+        size_t edge_count = 0;
+        double generate_ms = 0;
+        double build_ms = 0;
+        double destroy_ms = 0;
+        size_t resident_bytes = 0;
+        size_t peak_resident_bytes = 0;
+        double adjacency_bytes_per_edge = 0;
+        // GraphStore::memoryUsage() once built.
+        size_t store_bytes = 0;
+        double churn_ms = 0;
+        // After the churn, if any.
+        size_t churn_resident_bytes = 0;
+        size_t churn_store_bytes = 0;
+        size_t churn_adjacency_free_bytes = 0;
+        // Pairs of vertices per second of distanceMatrix, of shortestPaths from one vertex and of single queries.
+        double matrix_pairs_per_s = 0;
+        double one_to_many_pairs_per_s = 0;
+        double single_pairs_per_s = 0;
+        // Mutations per second with the subscriptions kept up to date, polls of all the pairs per second, and the
+        // number of times a path changed.
+        double subscription_mutations_per_s = 0;
+        double polls_per_s = 0;
+        size_t subscription_notifications = 0;
+        // The ingest through the log, with a sync per record and with group commit, and the time it takes to open the
+        // store from the log alone and from a checkpoint.
+        size_t wal_record_count = 0;
+        size_t wal_sync_count = 0;
+        double wal_synced_records_per_s = 0;
+        double wal_grouped_records_per_s = 0;
+        double wal_replay_ms = 0;
+        double wal_checkpoint_open_ms = 0;
+        std::vector<ScalingResult> scaling;
+        std::vector<LabelResult> labels;
+    };
+
+    const double Selectivities[] = { 1.0, 0.5, 0.1 };
+
+    std::vector<Scenario> CreateScenarios()
+    {
+        std::vector<Scenario> scenarios;
+        // The sizes of the original performance tests.
+        scenarios.push_back(Scenario{"uniform-10k-10k", "uniform", false,
+            [] { return GenerateUniformGraph(10000, 10000, 0); }});
+        scenarios.push_back(Scenario{"uniform-100k-100k", "uniform", false,
+            [] { return GenerateUniformGraph(100000, 100000, 0); }});
+        scenarios.push_back(Scenario{"uniform-100k-150k", "uniform", false,
+            [] { return GenerateUniformGraph(100000, 150000, 0); }});
+        scenarios.push_back(Scenario{"uniform-1m-1.5m", "uniform", false,
+            [] { return GenerateUniformGraph(1000000, 1500000, 0); }});
+        scenarios.push_back(Scenario{"rmat-17-8", "rmat", false, [] { return GenerateRmatGraph(17, 8, 0); }});
+        scenarios.push_back(Scenario{"grid-316x316", "grid", false, [] { return GenerateGridGraph(316, 316); }});
+        scenarios.push_back(Scenario{"uniform-1m-10m", "uniform", true,
+            [] { return GenerateUniformGraph(1000000, 10000000, 0); }});
+        scenarios.push_back(Scenario{"rmat-20-16", "rmat", true, [] { return GenerateRmatGraph(20, 16, 0); }});
+        scenarios.push_back(Scenario{"grid-1000x1000", "grid", true, [] { return GenerateGridGraph(1000, 1000); }});
+        return scenarios;
+    }
+
+    double Milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    double Microseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    // Nearest-rank percentile of sorted values.
+    double Percentile(const std::vector<double>& sorted, double percent)
+    {
+        size_t rank = static_cast<size_t>((percent / 100.0) * static_cast<double>(sorted.size()) + 0.5);
+        rank = std::min(std::max(rank, size_t(1)), sorted.size());
+        return sorted[rank - 1];
+    }
+
+    LabelResult RunQueries(const GraphStore& graph, const std::string& label, const std::vector<VertexId>& vertices,
+        const Options& options, ThreadPool& pool)
+    {
+        LabelResult result;
+        result.label = label;
+        result.labelled_vertices = vertices.size();
+        if (vertices.empty())
+        {
+            return result;
+        }
+
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<size_t> dist(0, vertices.size() - 1);
+        std::vector<PathQuery> queries;
+        for (size_t i = 0; i < options.query_count; ++i)
+        {
+            queries.push_back(PathQuery{vertices[dist(rng)], vertices[dist(rng)], label});
+        }
+
+        // The single queries only get the pool when the parallel BFS is asked for, so that the latencies of the other
+        // algorithms are those of one thread whatever the size of the graph.
+        QueryOptions query_options;
+        query_options.algorithm = options.algorithm;
+        query_options.pool = (options.algorithm == SearchAlgorithm::ParallelBfs) ? &pool : nullptr;
+        query_options.max_expanded = options.max_expanded;
+        QueryOutcome outcome = QueryOutcome::Exact;
+        query_options.outcome = &outcome;
+
+        // Warm up the context so that the measures don't include its first allocation.
+        QueryContext context;
+        std::vector<VertexId> path;
+        graph.shortestPath(queries[0].from, queries[0].to, label, query_options, context, path);
+
+        std::vector<double> latencies;
+        latencies.reserve(queries.size());
+        const CacheMissCounter cache_misses;
+        const uint64_t first_misses = cache_misses.read();
+        const auto start = std::chrono::steady_clock::now();
+        for (const PathQuery& query : queries)
+        {
+            const auto t1 = std::chrono::steady_clock::now();
+            if (options.timeout_us > 0)
+            {
+                query_options.deadline = t1 + std::chrono::microseconds(options.timeout_us);
+            }
+            if (graph.shortestPath(query.from, query.to, label, query_options, context, path))
+            {
+                ++result.found_count;
+            }
+            result.truncated_count += (outcome != QueryOutcome::Exact) ? 1 : 0;
+            const auto t2 = std::chrono::steady_clock::now();
+            latencies.push_back(Microseconds(t2 - t1));
+        }
+        const auto total = std::chrono::steady_clock::now() - start;
+        if (cache_misses.available())
+        {
+            result.llc_misses_per_query = static_cast<double>(cache_misses.read() - first_misses) /
+                static_cast<double>(queries.size());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0;
+        for (double latency : latencies)
+        {
+            sum += latency;
+        }
+        result.query_count = queries.size();
+        result.mean_us = sum / static_cast<double>(latencies.size());
+        result.p50_us = Percentile(latencies, 50);
+        result.p95_us = Percentile(latencies, 95);
+        result.p99_us = Percentile(latencies, 99);
+        result.max_us = latencies.back();
+        result.throughput_qps = static_cast<double>(queries.size()) / (Milliseconds(total) / 1000.0);
+
+        // The batch runs each query on a single worker, so the searches themselves don't use the pool.
+        QueryOptions batch_options;
+        batch_options.algorithm = (options.algorithm == SearchAlgorithm::ParallelBfs) ? SearchAlgorithm::Auto :
+            options.algorithm;
+        batch_options.max_expanded = options.max_expanded;
+        graph.shortestPaths(queries, pool, batch_options);
+        const auto batch_start = std::chrono::steady_clock::now();
+        graph.shortestPaths(queries, pool, batch_options);
+        const auto batch_total = std::chrono::steady_clock::now() - batch_start;
+        result.batch_throughput_qps = static_cast<double>(queries.size()) / (Milliseconds(batch_total) / 1000.0);
+        return result;
+    }
+
+    // Times the queries of a label for each number of worker threads as --scaling describes.
+    void RunScaling(const GraphStore& graph, const std::string& label, const std::vector<VertexId>& vertices,
+        const Options& options, ScenarioResult& result)
+    {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<size_t> dist(0, vertices.size() - 1);
+        std::vector<PathQuery> queries;
+        for (size_t i = 0; i < options.query_count; ++i)
+        {
+            queries.push_back(PathQuery{vertices[dist(rng)], vertices[dist(rng)], label});
+        }
+        // Each parallel BFS uses every worker, so a few queries are enough.
+        const size_t single_count = std::min(queries.size(), size_t(100));
+
+        size_t max_workers = options.thread_count;
+        if (max_workers == 0)
+        {
+            max_workers = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        for (size_t workers = 1; workers <= max_workers; workers *= 2)
+        {
+            ThreadPool pool(workers);
+            ScalingResult scaling;
+            scaling.worker_count = pool.workerCount();
+
+            QueryOptions batch_options;
+            batch_options.max_expanded = options.max_expanded;
+            // Warm up the per-thread search state so that the measure doesn't include its first allocation.
+            graph.shortestPaths(queries, pool, batch_options);
+            const auto t1 = std::chrono::steady_clock::now();
+            graph.shortestPaths(queries, pool, batch_options);
+            const auto t2 = std::chrono::steady_clock::now();
+            scaling.batch_throughput_qps = static_cast<double>(queries.size()) / (Milliseconds(t2 - t1) / 1000.0);
+
+            QueryOptions single_options;
+            single_options.algorithm = SearchAlgorithm::ParallelBfs;
+            single_options.pool = &pool;
+            single_options.max_expanded = options.max_expanded;
+            QueryContext context;
+            std::vector<VertexId> path;
+            graph.shortestPath(queries[0].from, queries[0].to, label, single_options, context, path);
+            const auto t3 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < single_count; ++i)
+            {
+                graph.shortestPath(queries[i].from, queries[i].to, label, single_options, context, path);
+            }
+            const auto t4 = std::chrono::steady_clock::now();
+            scaling.parallel_bfs_mean_us = Microseconds(t4 - t3) / static_cast<double>(single_count);
+            result.scaling.push_back(scaling);
+        }
+    }
+
+    // Times the ingest and the recovery of a graph through the write-ahead log as --wal describes.
+    void RunWal(const GeneratedGraph& generated, const std::string& label, const std::vector<VertexId>& vertices,
+        const std::string& path, ScenarioResult& result)
+    {
+        const std::string log_path = path + ".wal";
+        const std::string new_path = path + ".new";
+        auto remove_files = [&]
+        {
+            std::remove(path.c_str());
+            std::remove(log_path.c_str());
+            std::remove(new_path.c_str());
+        };
+        remove_files();
+
+        // One sync per record, for comparison, on a few records only.
+        {
+            WalOptions wal_options;
+            wal_options.group_size = 1;
+            DurableGraphStore durable(path, wal_options);
+            durable.createVertices(generated.vertex_count);
+            const size_t record_count = std::min(generated.edges.size(), size_t(1000));
+            const auto t1 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < record_count; ++i)
+            {
+                durable.createEdge(generated.edges[i].first, generated.edges[i].second);
+            }
+            const auto t2 = std::chrono::steady_clock::now();
+            result.wal_synced_records_per_s = static_cast<double>(record_count) / (Milliseconds(t2 - t1) / 1000.0);
+        }
+        remove_files();
+
+        {
+            DurableGraphStore durable(path, WalOptions());
+            const auto t1 = std::chrono::steady_clock::now();
+            durable.createVertices(generated.vertex_count);
+            for (VertexId vertex : vertices)
+            {
+                durable.addLabel(vertex, label);
+            }
+            for (const std::pair<VertexId, VertexId>& edge : generated.edges)
+            {
+                durable.createEdge(edge.first, edge.second);
+            }
+            durable.commit();
+            const auto t2 = std::chrono::steady_clock::now();
+            result.wal_record_count = durable.log().recordCount();
+            result.wal_sync_count = durable.log().syncCount();
+            result.wal_grouped_records_per_s = static_cast<double>(result.wal_record_count) /
+                (Milliseconds(t2 - t1) / 1000.0);
+        }
+        {
+            const auto t1 = std::chrono::steady_clock::now();
+            DurableGraphStore durable(path, WalOptions());
+            result.wal_replay_ms = Milliseconds(std::chrono::steady_clock::now() - t1);
+            durable.checkpoint();
+        }
+        {
+            const auto t1 = std::chrono::steady_clock::now();
+            DurableGraphStore durable(path, WalOptions());
+            result.wal_checkpoint_open_ms = Milliseconds(std::chrono::steady_clock::now() - t1);
+        }
+        remove_files();
+    }
+
+    // Times the queries between many vertices as --matrix describes.
+    void RunMatrix(const GraphStore& graph, const std::string& label, const std::vector<VertexId>& vertices,
+        size_t size, ScenarioResult& result)
+    {
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<size_t> dist(0, vertices.size() - 1);
+        std::vector<VertexId> sources;
+        std::vector<VertexId> targets;
+        for (size_t i = 0; i < size; ++i)
+        {
+            sources.push_back(vertices[dist(rng)]);
+            targets.push_back(vertices[dist(rng)]);
+        }
+        const double pair_count = static_cast<double>(size * size);
+
+        const auto t1 = std::chrono::steady_clock::now();
+        graph.distanceMatrix(sources, targets, label, nullptr);
+        const auto t2 = std::chrono::steady_clock::now();
+        result.matrix_pairs_per_s = pair_count / (Milliseconds(t2 - t1) / 1000.0);
+
+        const size_t one_to_many_count = std::min(size, size_t(10));
+        for (size_t i = 0; i < one_to_many_count; ++i)
+        {
+            graph.shortestPaths(sources[i], targets, label);
+        }
+        const auto t3 = std::chrono::steady_clock::now();
+        result.one_to_many_pairs_per_s = static_cast<double>(one_to_many_count * size) /
+            (Milliseconds(t3 - t2) / 1000.0);
+
+        const size_t single_count = std::min(size * size, size_t(1000));
+        for (size_t i = 0; i < single_count; ++i)
+        {
+            graph.shortestPath(sources[i % size], targets[(i / size) % size], label);
+        }
+        const auto t4 = std::chrono::steady_clock::now();
+        result.single_pairs_per_s = static_cast<double>(single_count) / (Milliseconds(t4 - t3) / 1000.0);
+    }
+
+    // Times the subscriptions as --subscriptions describes.
+    void RunSubscriptions(GraphStore& graph, const std::string& label, const std::vector<VertexId>& vertices,
+        size_t vertexCount, size_t count, ScenarioResult& result)
+    {
+        std::mt19937 rng(6);
+        std::uniform_int_distribution<size_t> random_labelled(0, vertices.size() - 1);
+        std::uniform_int_distribution<VertexId> random_vertex(1, static_cast<VertexId>(vertexCount));
+        std::vector<std::pair<VertexId, VertexId>> pairs;
+        for (size_t i = 0; i < count; ++i)
+        {
+            pairs.emplace_back(vertices[random_labelled(rng)], vertices[random_labelled(rng)]);
+        }
+        std::vector<SubscriptionId> subscriptions;
+        for (const std::pair<VertexId, VertexId>& pair : pairs)
+        {
+            subscriptions.push_back(graph.subscribe(pair.first, pair.second, label,
+                [&result](SubscriptionId, const std::vector<VertexId>&) { ++result.subscription_notifications; }));
+        }
+
+        // The edges created are deleted again later in the stream, and the label removed from a vertex is given back.
+        const size_t mutation_count = 2000;
+        std::vector<std::pair<VertexId, VertexId>> created;
+        std::vector<VertexId> unlabelled;
+        const auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < mutation_count; ++i)
+        {
+            switch (i % 4)
+            {
+            case 0:
+                created.emplace_back(random_vertex(rng), random_vertex(rng));
+                graph.createEdge(created.back().first, created.back().second);
+                break;
+            case 1:
+                unlabelled.push_back(vertices[random_labelled(rng)]);
+                graph.removeLabel(unlabelled.back(), label);
+                break;
+            case 2:
+                graph.deleteEdge(created[created.size() / 2].first, created[created.size() / 2].second);
+                break;
+            default:
+                graph.addLabel(unlabelled[unlabelled.size() / 2], label);
+                break;
+            }
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        result.subscription_mutations_per_s = mutation_count / (Milliseconds(t2 - t1) / 1000.0);
+        for (SubscriptionId subscription : subscriptions)
+        {
+            graph.unsubscribe(subscription);
+        }
+
+        const size_t poll_count = 20;
+        const auto t3 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < poll_count; ++i)
+        {
+            for (const std::pair<VertexId, VertexId>& pair : pairs)
+            {
+                graph.shortestPath(pair.first, pair.second, label);
+            }
+        }
+        result.polls_per_s = poll_count / (Milliseconds(std::chrono::steady_clock::now() - t3) / 1000.0);
+    }
+
+    // Deletes and recreates vertices as --churn describes, keeping the number of vertices and edges.
+    void Churn(GraphStore& graph, size_t vertexCount, size_t rounds)
+    {
+        std::mt19937 rng(4);
+        std::uniform_int_distribution<VertexId> random_vertex(1, static_cast<VertexId>(vertexCount));
+        const size_t deletions = std::max(vertexCount / 20, size_t(1));
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            const size_t edge_count = graph.edgeCount();
+            for (size_t i = 0; i < deletions; ++i)
+            {
+                VertexId vertex = random_vertex(rng);
+                while (!graph.containsVertex(vertex))
+                {
+                    vertex = random_vertex(rng);
+                }
+                graph.deleteVertex(vertex);
+            }
+            std::vector<VertexId> created;
+            for (size_t i = 0; i < deletions; ++i)
+            {
+                created.push_back(graph.createVertex());
+            }
+            std::uniform_int_distribution<size_t> random_created(0, created.size() - 1);
+            while (graph.edgeCount() < edge_count)
+            {
+                // Half of the edges start from a new vertex and half end at one, as the deleted edges did.
+                const VertexId vertex = created[random_created(rng)];
+                if (graph.edgeCount() % 2 == 0)
+                {
+                    graph.createEdge(vertex, random_vertex(rng));
+                }
+                else
+                {
+                    graph.createEdge(random_vertex(rng), vertex);
+                }
+            }
+        }
+    }
+
+    ScenarioResult RunScenario(const Scenario& scenario, const Options& options, ThreadPool& pool)
+    {
+        ScenarioResult result;
+        result.name = scenario.name;
+        result.generator = scenario.generator;
+
+        const auto t1 = std::chrono::steady_clock::now();
+        GeneratedGraph generated = scenario.generate();
+        std::vector<std::vector<VertexId>> labelled;
+        std::vector<std::string> labels;
+        for (double selectivity : Selectivities)
+        {
+            labelled.push_back(PickVertices(generated.vertex_count, selectivity, 2));
+            labels.push_back("selectivity " + std::to_string(static_cast<int>(selectivity * 100)) + "%");
+        }
+        result.generate_ms = Milliseconds(std::chrono::steady_clock::now() - t1);
+
+        if (!options.wal_path.empty())
+        {
+            RunWal(generated, labels[0], labelled[0], options.wal_path, result);
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+
+        // On the heap, to time its destruction.
+        const AdjacencyStorage storage = options.compressed ? AdjacencyStorage::Compressed :
+            options.compact ? AdjacencyStorage::CompactSets : AdjacencyStorage::Sets;
+        std::unique_ptr<GraphStore> store(new GraphStore(storage, !options.heap_nodes));
+        GraphStore& graph = *store;
+        graph.createVertices(generated.vertex_count);
+        graph.createEdges(generated.edges, &pool);
+        if (options.max_weight > 0)
+        {
+            std::mt19937 rng(3);
+            std::uniform_real_distribution<double> real_weight(0, options.max_weight);
+            std::uniform_int_distribution<uint32_t> integer_weight(1, static_cast<uint32_t>(options.max_weight));
+            for (const std::pair<VertexId, VertexId>& edge : generated.edges)
+            {
+                const double weight = options.real_weights ? real_weight(rng) : integer_weight(rng);
+                graph.createEdge(edge.first, edge.second, static_cast<EdgeWeight>(weight));
+            }
+        }
+        for (size_t i = 0; i < labelled.size(); ++i)
+        {
+            graph.addLabelToVertices(labels[i], labelled[i]);
+            if (options.reachability)
+            {
+                graph.indexReachability(labels[i]);
+            }
+            if (options.distance_index)
+            {
+                graph.indexDistances(labels[i], &pool);
+            }
+        }
+        if (options.reorder)
+        {
+            graph.reorder(options.order);
+        }
+        graph.freeze();
+        if (options.landmark_count > 0)
+        {
+            LandmarkOptions landmark_options;
+            landmark_options.count = options.landmark_count;
+            landmark_options.pool = &pool;
+            graph.buildLandmarks(landmark_options);
+        }
+        const auto t3 = std::chrono::steady_clock::now();
+
+        // Only the store is left in memory when the resident size is measured.
+        std::vector<std::pair<VertexId, VertexId>>().swap(generated.edges);
+        result.vertex_count = generated.vertex_count;
+        result.edge_count = graph.edgeCount();
+        const size_t adjacency_bytes = options.compressed ? graph.compressedSnapshot()->memoryUsage() :
+            options.compact ? graph.compactSnapshot()->memoryUsage() : graph.snapshot()->memoryUsage();
+        result.adjacency_bytes_per_edge = static_cast<double>(adjacency_bytes) / std::max(result.edge_count, size_t(1));
+        result.build_ms = Milliseconds(t3 - t2);
+        result.resident_bytes = CurrentResidentBytes();
+        result.store_bytes = graph.memoryUsage().total();
+
+        for (size_t i = 0; i < labels.size(); ++i)
+        {
+            LabelResult label_result = RunQueries(graph, labels[i], labelled[i], options, pool);
+            label_result.selectivity = Selectivities[i];
+            result.labels.push_back(label_result);
+        }
+        result.peak_resident_bytes = PeakResidentBytes();
+
+        if (options.scaling)
+        {
+            RunScaling(graph, labels[0], labelled[0], options, result);
+        }
+        if (options.matrix_size > 0)
+        {
+            RunMatrix(graph, labels[0], labelled[0], options.matrix_size, result);
+        }
+        if (options.subscription_count > 0)
+        {
+            RunSubscriptions(graph, labels[1], labelled[1], generated.vertex_count, options.subscription_count,
+                result);
+        }
+        if (options.churn_rounds > 0)
+        {
+            const auto t4 = std::chrono::steady_clock::now();
+            Churn(graph, generated.vertex_count, options.churn_rounds);
+            result.churn_ms = Milliseconds(std::chrono::steady_clock::now() - t4);
+            const GraphMemoryUsage usage = graph.memoryUsage();
+            result.churn_resident_bytes = CurrentResidentBytes();
+            result.churn_store_bytes = usage.total();
+            result.churn_adjacency_free_bytes = usage.adjacency_free;
+        }
+
+        const auto t5 = std::chrono::steady_clock::now();
+        store.reset();
+        result.destroy_ms = Milliseconds(std::chrono::steady_clock::now() - t5);
+        return result;
+    }
+
+    std::string JsonString(const std::string& value)
+    {
+        std::string quoted = "\"";
+        for (char c : value)
+        {
+            if ((c == '"') || (c == '\\'))
+            {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    const char* AlgorithmName(SearchAlgorithm algorithm)
+    {
+        switch (algorithm)
+        {
+        case SearchAlgorithm::BidirectionalBfs:
+            return "bidirectional";
+        case SearchAlgorithm::AStar:
+            return "astar";
+        case SearchAlgorithm::Alt:
+            return "alt";
+        case SearchAlgorithm::ParallelBfs:
+            return "parallel";
+        case SearchAlgorithm::Dijkstra:
+            return "dijkstra";
+        default:
+            return "auto";
+        }
+    }
+
+    const char* OrderName(const Options& options)
+    {
+        if (!options.reorder)
+        {
+            return "none";
+        }
+        switch (options.order)
+        {
+        case VertexOrder::ReverseCuthillMcKee:
+            return "rcm";
+        case VertexOrder::Degree:
+            return "degree";
+        default:
+            return "bfs";
+        }
+    }
+
+    void WriteJson(std::ostream& out, const std::vector<ScenarioResult>& results, const Options& options,
+        size_t workerCount)
+    {
+        out << "{\n";
+        out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "  \"worker_threads\": " << workerCount << ",\n";
+        out << "  \"algorithm\": " << JsonString(AlgorithmName(options.algorithm)) << ",\n";
+        out << "  \"metrics\": " << (options.metrics ? "true" : "false") << ",\n";
+        out << "  \"reachability\": " << (options.reachability ? "true" : "false") << ",\n";
+        out << "  \"distance_index\": " << (options.distance_index ? "true" : "false") << ",\n";
+        out << "  \"landmarks\": " << options.landmark_count << ",\n";
+        out << "  \"max_weight\": " << options.max_weight << ",\n";
+        out << "  \"real_weights\": " << (options.real_weights ? "true" : "false") << ",\n";
+        out << "  \"reorder\": " << JsonString(OrderName(options)) << ",\n";
+        out << "  \"compressed\": " << (options.compressed ? "true" : "false") << ",\n";
+        out << "  \"compact\": " << (options.compact ? "true" : "false") << ",\n";
+        out << "  \"heap_nodes\": " << (options.heap_nodes ? "true" : "false") << ",\n";
+        out << "  \"churn_rounds\": " << options.churn_rounds << ",\n";
+        out << "  \"matrix_size\": " << options.matrix_size << ",\n";
+        out << "  \"subscriptions\": " << options.subscription_count << ",\n";
+        out << "  \"max_expanded\": ";
+        if (options.max_expanded == UINT64_MAX)
+        {
+            out << "null,\n";
+        }
+        else
+        {
+            out << options.max_expanded << ",\n";
+        }
+        out << "  \"timeout_us\": " << options.timeout_us << ",\n";
+        out << "  \"scaling\": " << (options.scaling ? "true" : "false") << ",\n";
+        out << "  \"wal\": " << (options.wal_path.empty() ? "false" : "true") << ",\n";
+        out << "  \"scenarios\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const ScenarioResult& result = results[i];
+            out << ((i == 0) ? "\n" : ",\n");
+            out << "    {\n";
+            out << "      \"name\": " << JsonString(result.name) << ",\n";
+            out << "      \"generator\": " << JsonString(result.generator) << ",\n";
+            out << "      \"vertices\": " << result.vertex_count << ",\n";
+            out << "      \"edges\": " << result.edge_count << ",\n";
+            out << "      \"generate_ms\": " << result.generate_ms << ",\n";
+            out << "      \"build_ms\": " << result.build_ms << ",\n";
+            out << "      \"destroy_ms\": " << result.destroy_ms << ",\n";
+            out << "      \"resident_bytes\": " << result.resident_bytes << ",\n";
+            out << "      \"peak_resident_bytes\": " << result.peak_resident_bytes << ",\n";
+            out << "      \"adjacency_bytes_per_edge\": " << result.adjacency_bytes_per_edge << ",\n";
+            out << "      \"store_bytes\": " << result.store_bytes << ",\n";
+            if (options.matrix_size > 0)
+            {
+                out << "      \"matrix_pairs_per_s\": " << result.matrix_pairs_per_s << ",\n";
+                out << "      \"one_to_many_pairs_per_s\": " << result.one_to_many_pairs_per_s << ",\n";
+                out << "      \"single_pairs_per_s\": " << result.single_pairs_per_s << ",\n";
+            }
+            if (options.subscription_count > 0)
+            {
+                out << "      \"subscription_mutations_per_s\": " << result.subscription_mutations_per_s << ",\n";
+                out << "      \"polls_per_s\": " << result.polls_per_s << ",\n";
+                out << "      \"subscription_notifications\": " << result.subscription_notifications << ",\n";
+            }
+            if (!options.wal_path.empty())
+            {
+                out << "      \"wal_records\": " << result.wal_record_count << ",\n";
+                out << "      \"wal_syncs\": " << result.wal_sync_count << ",\n";
+                out << "      \"wal_synced_records_per_s\": " << result.wal_synced_records_per_s << ",\n";
+                out << "      \"wal_grouped_records_per_s\": " << result.wal_grouped_records_per_s << ",\n";
+                out << "      \"wal_replay_ms\": " << result.wal_replay_ms << ",\n";
+                out << "      \"wal_checkpoint_open_ms\": " << result.wal_checkpoint_open_ms << ",\n";
+            }
+            if (options.scaling)
+            {
+                out << "      \"scaling\": [";
+                for (size_t j = 0; j < result.scaling.size(); ++j)
+                {
+                    const ScalingResult& scaling = result.scaling[j];
+                    out << ((j == 0) ? "\n" : ",\n");
+                    out << "        {\"workers\": " << scaling.worker_count << ", \"batch_throughput_qps\": "
+                        << scaling.batch_throughput_qps << ", \"parallel_bfs_mean_us\": "
+                        << scaling.parallel_bfs_mean_us << "}";
+                }
+                out << "\n      ],\n";
+            }
+            if (options.churn_rounds > 0)
+            {
+                out << "      \"churn_ms\": " << result.churn_ms << ",\n";
+                out << "      \"churn_resident_bytes\": " << result.churn_resident_bytes << ",\n";
+                out << "      \"churn_store_bytes\": " << result.churn_store_bytes << ",\n";
+                out << "      \"churn_adjacency_free_bytes\": " << result.churn_adjacency_free_bytes << ",\n";
+            }
+            out << "      \"labels\": [";
+            for (size_t j = 0; j < result.labels.size(); ++j)
+            {
+                const LabelResult& label = result.labels[j];
+                out << ((j == 0) ? "\n" : ",\n");
+                out << "        {\"label\": " << JsonString(label.label) << ", \"selectivity\": " << label.selectivity
+                    << ", \"labelled_vertices\": " << label.labelled_vertices << ", \"queries\": " << label.query_count
+                    << ", \"found\": " << label.found_count << ", \"truncated\": " << label.truncated_count
+                    << ", \"mean_us\": " << label.mean_us
+                    << ", \"p50_us\": " << label.p50_us << ", \"p95_us\": " << label.p95_us << ", \"p99_us\": "
+                    << label.p99_us << ", \"max_us\": " << label.max_us << ", \"throughput_qps\": "
+                    << label.throughput_qps << ", \"batch_throughput_qps\": " << label.batch_throughput_qps
+                    << ", \"llc_misses_per_query\": ";
+                if (label.llc_misses_per_query < 0)
+                {
+                    out << "null}";
+                }
+                else
+                {
+                    out << label.llc_misses_per_query << "}";
+                }
+            }
+            out << "\n      ]\n";
+            out << "    }";
+        }
+        out << "\n  ]\n";
+        out << "}\n";
+    }
+
+    void PrintResult(std::ostream& out, const ScenarioResult& result)
+    {
+        out << result.name << ": " << result.vertex_count << " vertices, " << result.edge_count << " edges, "
+            << "build " << result.build_ms << "ms, RSS " << (result.resident_bytes >> 20) << "MB, peak RSS "
+            << (result.peak_resident_bytes >> 20) << "MB, " << result.adjacency_bytes_per_edge << " bytes/edge, store "
+            << (result.store_bytes >> 20) << "MB, destroy " << result.destroy_ms << "ms" << std::endl;
+        if (result.matrix_pairs_per_s > 0)
+        {
+            out << "  pairs/s: matrix " << static_cast<size_t>(result.matrix_pairs_per_s) << ", one to many "
+                << static_cast<size_t>(result.one_to_many_pairs_per_s) << ", single "
+                << static_cast<size_t>(result.single_pairs_per_s) << std::endl;
+        }
+        if (result.subscription_mutations_per_s > 0)
+        {
+            out << "  subscriptions: " << static_cast<size_t>(result.subscription_mutations_per_s)
+                << " mutations/s, polling " << static_cast<size_t>(result.polls_per_s) << " rounds/s, "
+                << result.subscription_notifications << " notifications" << std::endl;
+        }
+        if (result.wal_record_count > 0)
+        {
+            out << "  wal: " << static_cast<size_t>(result.wal_synced_records_per_s) << " records/s with a sync each, "
+                << static_cast<size_t>(result.wal_grouped_records_per_s) << " records/s with group commit ("
+                << result.wal_record_count << " records, " << result.wal_sync_count << " syncs), replay "
+                << result.wal_replay_ms << "ms, open from the checkpoint " << result.wal_checkpoint_open_ms << "ms"
+                << std::endl;
+        }
+        for (const ScalingResult& scaling : result.scaling)
+        {
+            out << "  " << scaling.worker_count << " worker(s): batch "
+                << static_cast<size_t>(scaling.batch_throughput_qps) << " queries/s, parallel BFS "
+                << scaling.parallel_bfs_mean_us << "us/query" << std::endl;
+        }
+        if (result.churn_ms > 0)
+        {
+            out << "  churn: " << result.churn_ms << "ms, RSS " << (result.churn_resident_bytes >> 20) << "MB, store "
+                << (result.churn_store_bytes >> 20) << "MB, " << (result.churn_adjacency_free_bytes >> 20)
+                << "MB of free nodes" << std::endl;
+        }
+        for (const LabelResult& label : result.labels)
+        {
+            out << "  " << label.label << ": " << label.found_count << "/" << label.query_count << " found, ";
+            if (label.truncated_count > 0)
+            {
+                out << label.truncated_count << " truncated, ";
+            }
+            out << "p50 "
+                << label.p50_us << "us, p95 " << label.p95_us << "us, p99 " << label.p99_us << "us, max "
+                << label.max_us << "us, " << static_cast<size_t>(label.throughput_qps) << " queries/s, batch "
+                << static_cast<size_t>(label.batch_throughput_qps) << " queries/s";
+            if (label.llc_misses_per_query >= 0)
+            {
+                out << ", " << static_cast<size_t>(label.llc_misses_per_query) << " LLC misses/query";
+            }
+            out << std::endl;
+        }
+    }
+
+    SearchAlgorithm ParseAlgorithm(const std::string& name)
+    {
+        if (name == "auto")
+        {
+            return SearchAlgorithm::Auto;
+        }
+        if (name == "bidirectional")
+        {
+            return SearchAlgorithm::BidirectionalBfs;
+        }
+        if (name == "astar")
+        {
+            return SearchAlgorithm::AStar;
+        }
+        if (name == "alt")
+        {
+            return SearchAlgorithm::Alt;
+        }
+        if (name == "parallel")
+        {
+            return SearchAlgorithm::ParallelBfs;
+        }
+        if (name == "dijkstra")
+        {
+            return SearchAlgorithm::Dijkstra;
+        }
+        throw std::runtime_error("Unknown algorithm " + name);
+    }
+
+    VertexOrder ParseOrder(const std::string& name)
+    {
+        if (name == "bfs")
+        {
+            return VertexOrder::Bfs;
+        }
+        if (name == "rcm")
+        {
+            return VertexOrder::ReverseCuthillMcKee;
+        }
+        if (name == "degree")
+        {
+            return VertexOrder::Degree;
+        }
+        throw std::runtime_error("Unknown order " + name);
+    }
+
+    Options ParseOptions(int argc, char* argv[])
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            const bool has_value = (i + 1 < argc);
+            if (argument == "--large")
+            {
+                options.large = true;
+            }
+            else if (argument == "--metrics")
+            {
+                options.metrics = true;
+            }
+            else if (argument == "--reachability")
+            {
+                options.reachability = true;
+            }
+            else if (argument == "--compressed")
+            {
+                options.compressed = true;
+            }
+            else if (argument == "--compact")
+            {
+                options.compact = true;
+            }
+            else if (argument == "--heap-nodes")
+            {
+                options.heap_nodes = true;
+            }
+            else if (argument == "--scaling")
+            {
+                options.scaling = true;
+            }
+            else if ((argument == "--wal") && has_value)
+            {
+                options.wal_path = argv[++i];
+            }
+            else if ((argument == "--matrix") && has_value)
+            {
+                options.matrix_size = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--max-expanded") && has_value)
+            {
+                options.max_expanded = std::strtoull(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--timeout-us") && has_value)
+            {
+                options.timeout_us = std::strtoull(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--subscriptions") && has_value)
+            {
+                options.subscription_count = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--churn") && has_value)
+            {
+                options.churn_rounds = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (argument == "--distance-index")
+            {
+                options.distance_index = true;
+            }
+            else if ((argument == "--weights") && has_value)
+            {
+                options.max_weight = std::strtod(argv[++i], nullptr);
+            }
+            else if (argument == "--real-weights")
+            {
+                options.real_weights = true;
+            }
+            else if ((argument == "--landmarks") && has_value)
+            {
+                options.landmark_count = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--json") && has_value)
+            {
+                options.json_path = argv[++i];
+            }
+            else if ((argument == "--filter") && has_value)
+            {
+                options.filter = argv[++i];
+            }
+            else if ((argument == "--queries") && has_value)
+            {
+                options.query_count = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+            }
+            else if ((argument == "--threads") && has_value)
+            {
+                options.thread_count = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if ((argument == "--algorithm") && has_value)
+            {
+                options.algorithm = ParseAlgorithm(argv[++i]);
+            }
+            else if ((argument == "--reorder") && has_value)
+            {
+                options.reorder = true;
+                options.order = ParseOrder(argv[++i]);
+            }
+            else
+            {
+                throw std::runtime_error("Unknown argument " + argument);
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const Options options = ParseOptions(argc, argv);
+        ThreadPool pool(options.thread_count);
+        // The progress goes to the error output when the JSON goes to the standard output.
+        std::ostream& progress = (options.json_path == "-") ? std::cerr : std::cout;
+
+        GraphStore::setMetricsEnabled(options.metrics);
+
+        std::vector<ScenarioResult> results;
+        for (const Scenario& scenario : CreateScenarios())
+        {
+            if ((scenario.large && !options.large) || (scenario.name.find(options.filter) == std::string::npos))
+            {
+                continue;
+            }
+            results.push_back(RunScenario(scenario, options, pool));
+            PrintResult(progress, results.back());
+        }
+        if (options.metrics)
+        {
+            progress << PrometheusText(GraphStore::metrics());
+        }
+
+        if (options.json_path == "-")
+        {
+            WriteJson(std::cout, results, options, pool.workerCount());
+        }
+        else if (!options.json_path.empty())
+        {
+            std::ofstream file(options.json_path);
+            WriteJson(file, results, options, pool.workerCount());
+            if (!file)
+            {
+                throw std::runtime_error("Cannot write " + options.json_path);
+            }
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
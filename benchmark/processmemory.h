@@ -0,0 +1,14 @@
+#ifndef PROCESSMEMORY_H
+#define PROCESSMEMORY_H
+
+#include <cstddef>
+
+/// Returns the number of bytes of physical memory the process uses now (resident set size), or 0 if it is not known.
+size_t CurrentResidentBytes();
+
+/// Returns the largest number of bytes of physical memory the process has used since it started, or 0 if it is not
+/// known. This never goes down, so it only describes the last scenario if the scenarios run in increasing size or one
+/// per process.
+size_t PeakResidentBytes();
+
+#endif
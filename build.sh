@@ -1 +1,3 @@
-g++ src/main.cpp src/graphstore.cpp -O3 -o graphstore
+SOURCES="src/graphstore.cpp src/bitsetkernels.cpp src/compressedadjacency.cpp src/concurrentgraphstore.cpp src/csradjacency.cpp src/durablegraphstore.cpp src/edgeweights.cpp src/graphversion.cpp src/hublabelindex.cpp src/labelindex.cpp src/labelpredicate.cpp src/landmarkindex.cpp src/mappedfile.cpp src/mappedlabelindex.cpp src/nodepool.cpp src/pathsubscriptions.cpp src/querycontext.cpp src/querymetrics.cpp src/reachabilityindex.cpp src/snapshotfile.cpp src/threadpool.cpp src/vertexbitmap.cpp src/vertexmapping.cpp src/vertexorder.cpp src/writeaheadlog.cpp"
+g++ src/main.cpp $SOURCES -O3 -pthread -o graphstore
+g++ benchmark/main.cpp benchmark/cachecounters.cpp benchmark/generators.cpp benchmark/processmemory.cpp $SOURCES -O3 -pthread -o graphstore_benchmark
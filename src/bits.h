@@ -0,0 +1,38 @@
+#ifndef BITS_H
+#define BITS_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Returns the index of the lowest set bit of a word. The word must not be 0.
+inline unsigned CountTrailingZeros(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+// Returns the number of bits needed to write a word: the index of its highest set bit + 1, or 0 for 0.
+inline unsigned BitWidth(uint64_t word)
+{
+    if (word == 0)
+    {
+        return 0;
+    }
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<unsigned>(index) + 1;
+#else
+    return 64 - static_cast<unsigned>(__builtin_clzll(word));
+#endif
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "bitsetkernels.h"
+
+#if !defined(GRAPHSTORE_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define GRAPHSTORE_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC emits AVX2 instructions for the intrinsics whatever the target architecture of the build.
+#define GRAPHSTORE_TARGET_AVX2
+#else
+// GCC and Clang only emit AVX2 instructions in functions marked for it, so the rest of the program still runs on
+// processors without it.
+#define GRAPHSTORE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    // The operations as functors so that each loop below is written once and instantiated per operation. Apply works
+    // on words and, on x86, on SSE2 and AVX2 registers.
+    struct And
+    {
+        static uint64_t apply(uint64_t destination, uint64_t source) { return destination & source; }
+#ifdef GRAPHSTORE_X86_SIMD
+        static __m128i apply(__m128i destination, __m128i source) { return _mm_and_si128(destination, source); }
+        GRAPHSTORE_TARGET_AVX2 static __m256i apply(__m256i destination, __m256i source)
+        {
+            return _mm256_and_si256(destination, source);
+        }
+#endif
+    };
+
+    struct Or
+    {
+        static uint64_t apply(uint64_t destination, uint64_t source) { return destination | source; }
+#ifdef GRAPHSTORE_X86_SIMD
+        static __m128i apply(__m128i destination, __m128i source) { return _mm_or_si128(destination, source); }
+        GRAPHSTORE_TARGET_AVX2 static __m256i apply(__m256i destination, __m256i source)
+        {
+            return _mm256_or_si256(destination, source);
+        }
+#endif
+    };
+
+    struct AndNot
+    {
+        static uint64_t apply(uint64_t destination, uint64_t source) { return destination & ~source; }
+#ifdef GRAPHSTORE_X86_SIMD
+        // andnot computes ~first & second.
+        static __m128i apply(__m128i destination, __m128i source) { return _mm_andnot_si128(source, destination); }
+        GRAPHSTORE_TARGET_AVX2 static __m256i apply(__m256i destination, __m256i source)
+        {
+            return _mm256_andnot_si256(source, destination);
+        }
+#endif
+    };
+
+    // Ignores the source.
+    struct Complement
+    {
+        static uint64_t apply(uint64_t destination, uint64_t) { return ~destination; }
+#ifdef GRAPHSTORE_X86_SIMD
+        static __m128i apply(__m128i destination, __m128i)
+        {
+            return _mm_xor_si128(destination, _mm_set1_epi32(-1));
+        }
+        GRAPHSTORE_TARGET_AVX2 static __m256i apply(__m256i destination, __m256i)
+        {
+            return _mm256_xor_si256(destination, _mm256_set1_epi32(-1));
+        }
+#endif
+    };
+
+    template <typename Operation>
+    size_t ApplyScalar(uint64_t* destination, const uint64_t* source, size_t begin, size_t count)
+    {
+        for (size_t i = begin; i < count; ++i)
+        {
+            destination[i] = Operation::apply(destination[i], source[i]);
+        }
+        return count;
+    }
+
+#ifdef GRAPHSTORE_X86_SIMD
+    // The SIMD loops handle the whole registers and return where they stopped; the scalar loop finishes the rest.
+    template <typename Operation>
+    size_t ApplySse2(uint64_t* destination, const uint64_t* source, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const __m128i result = Operation::apply(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), result);
+        }
+        return i;
+    }
+
+    template <typename Operation>
+    GRAPHSTORE_TARGET_AVX2 size_t ApplyAvx2(uint64_t* destination, const uint64_t* source, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m256i result = Operation::apply(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), result);
+        }
+        return i;
+    }
+
+    bool CpuHasAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        // The processor must support AVX and the OS must save the YMM registers across context switches.
+        const bool os_saves_ymm = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 6) == 6);
+        if (!os_saves_ymm || ((info[2] & (1 << 28)) == 0))
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+
+    template <typename Operation>
+    void Apply(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level)
+    {
+        size_t done = 0;
+#ifdef GRAPHSTORE_X86_SIMD
+        if ((level == SimdLevel::Avx2) && (DetectSimdLevel() == SimdLevel::Avx2))
+        {
+            done = ApplyAvx2<Operation>(destination, source, count);
+        }
+        else if (level != SimdLevel::Scalar)
+        {
+            done = ApplySse2<Operation>(destination, source, count);
+        }
+#else
+        (void)level;
+#endif
+        ApplyScalar<Operation>(destination, source, done, count);
+    }
+}
+
+SimdLevel DetectSimdLevel()
+{
+#ifdef GRAPHSTORE_X86_SIMD
+    // SSE2 is part of x86-64.
+    static const SimdLevel level = CpuHasAvx2() ? SimdLevel::Avx2 : SimdLevel::Sse2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+void AndWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level)
+{
+    Apply<And>(destination, source, count, level);
+}
+
+void OrWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level)
+{
+    Apply<Or>(destination, source, count, level);
+}
+
+void AndNotWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level)
+{
+    Apply<AndNot>(destination, source, count, level);
+}
+
+void NotWords(uint64_t* destination, size_t count, SimdLevel level)
+{
+    Apply<Complement>(destination, destination, count, level);
+}
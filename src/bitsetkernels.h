@@ -0,0 +1,40 @@
+#ifndef BITSETKERNELS_H
+#define BITSETKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// The instruction sets the bitset kernels can run on.
+enum class SimdLevel
+{
+    /// Plain 64-bit words.
+    Scalar,
+    /// 128-bit SSE2 registers, two words at a time.
+    Sse2,
+    /// 256-bit AVX2 registers, four words at a time.
+    Avx2
+};
+
+/// Returns the widest level the processor supports, detected once. Building with GRAPHSTORE_NO_SIMD defined always
+/// gives SimdLevel::Scalar.
+SimdLevel DetectSimdLevel();
+
+/// Returns the name of a level: "scalar", "sse2" or "avx2".
+const char* SimdLevelName(SimdLevel level);
+
+// Word-wise operations over bitsets of count words, in place in destination. A level the processor or the build
+// doesn't support falls back to the next narrower one.
+
+/// destination &= source.
+void AndWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level);
+
+/// destination |= source.
+void OrWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level);
+
+/// destination &= ~source.
+void AndNotWords(uint64_t* destination, const uint64_t* source, size_t count, SimdLevel level);
+
+/// destination = ~destination.
+void NotWords(uint64_t* destination, size_t count, SimdLevel level);
+
+#endif
@@ -0,0 +1,191 @@
+#include "compressedadjacency.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    void WriteVarint(uint64_t value, std::vector<uint8_t>& bytes)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    // The arrays of a CsrAdjacency decoded from a CompressedAdjacency, kept alive by the adjacency.
+    struct CsrArrays
+    {
+        std::vector<size_t> offsets;
+        std::vector<VertexId> neighbours;
+    };
+}
+
+const size_t CompressedAdjacency::BlockSize;
+const uint8_t CompressedAdjacency::LargeDegree;
+
+CompressedAdjacency::CompressedAdjacency()
+{
+    finish();
+}
+
+CompressedAdjacency::CompressedAdjacency(const AdjacencySets& adjacency, const EdgeWeights& weights) :
+    m_weights(weights)
+{
+    m_offsets.reserve(adjacency.size());
+    m_degrees.reserve(adjacency.size());
+    m_block_offsets.reserve((adjacency.size() + BlockSize - 1) / BlockSize);
+    for (size_t i = 0; i < adjacency.size(); ++i)
+    {
+        append(static_cast<VertexId>(i + 1), adjacency[i]);
+    }
+    finish();
+}
+
+CompressedAdjacency::CompressedAdjacency(const CompressedAdjacency& base, size_t vertexCount,
+    const std::vector<std::pair<VertexId, VertexId>>& edges, size_t& insertedCount) :
+    m_weights(base.m_weights)
+{
+    m_bytes.reserve(base.m_bytes.size() + (edges.size() * 2));
+    m_offsets.reserve(vertexCount);
+    m_degrees.reserve(vertexCount);
+    m_block_offsets.reserve((vertexCount + BlockSize - 1) / BlockSize);
+    std::vector<VertexId> merged;
+    auto edge = edges.begin();
+    for (VertexId vertex = 1; vertex <= vertexCount; ++vertex)
+    {
+        auto last = edge;
+        while ((last != edges.end()) && (last->first == vertex))
+        {
+            ++last;
+        }
+        if ((edge == last) && (vertex <= base.vertexCount()))
+        {
+            append(vertex, base.neighbours(vertex));
+            continue;
+        }
+
+        merged.clear();
+        auto added = [](const std::pair<VertexId, VertexId>& e) { return e.second; };
+        if (vertex <= base.vertexCount())
+        {
+            const CompressedNeighbourRange existing = base.neighbours(vertex);
+            std::vector<VertexId> additions;
+            std::transform(edge, last, std::back_inserter(additions), added);
+            std::set_union(existing.begin(), existing.end(), additions.begin(), additions.end(),
+                std::back_inserter(merged));
+        }
+        else
+        {
+            std::transform(edge, last, std::back_inserter(merged), added);
+        }
+        append(vertex, merged);
+        edge = last;
+    }
+    if (edge != edges.end())
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+    insertedCount = m_edge_count - base.m_edge_count;
+    finish();
+}
+
+template <typename Neighbours>
+void CompressedAdjacency::append(VertexId vertex, const Neighbours& neighbours)
+{
+    if (((vertex - 1) % BlockSize) == 0)
+    {
+        m_block_offsets.push_back(m_bytes.size());
+    }
+    const uint64_t offset = m_bytes.size() - m_block_offsets.back();
+    if (offset > UINT32_MAX)
+    {
+        throw std::runtime_error("Too many edges to compress");
+    }
+    m_offsets.push_back(static_cast<uint32_t>(offset));
+    if (neighbours.size() < LargeDegree)
+    {
+        m_degrees.push_back(static_cast<uint8_t>(neighbours.size()));
+    }
+    else
+    {
+        m_degrees.push_back(LargeDegree);
+        WriteVarint(neighbours.size(), m_bytes);
+    }
+
+    VertexId previous = 0;
+    bool first = true;
+    for (VertexId neighbour : neighbours)
+    {
+        if (first)
+        {
+            WriteVarint((neighbour >= vertex) ? (uint64_t(neighbour - vertex) * 2)
+                                              : ((uint64_t(vertex - neighbour) * 2) - 1), m_bytes);
+            first = false;
+        }
+        else
+        {
+            WriteVarint(neighbour - previous - 1, m_bytes);
+        }
+        previous = neighbour;
+    }
+    m_edge_count += neighbours.size();
+}
+
+void CompressedAdjacency::finish()
+{
+    m_bytes.resize(m_bytes.size() + 7, 0);
+    m_bytes.shrink_to_fit();
+}
+
+bool CompressedAdjacency::contains(VertexId from, VertexId to) const
+{
+    for (VertexId neighbour : neighbours(from))
+    {
+        if (neighbour >= to)
+        {
+            return neighbour == to;
+        }
+    }
+    return false;
+}
+
+void CompressedAdjacency::decode(AdjacencySets& adjacency, const PoolAllocator<VertexId>& allocator) const
+{
+    adjacency.clear();
+    adjacency.reserve(vertexCount());
+    for (VertexId vertex = 1; vertex <= vertexCount(); ++vertex)
+    {
+        const CompressedNeighbourRange range = neighbours(vertex);
+        // The neighbours are sorted, so each insertion goes at the end of the set in constant time.
+        adjacency.emplace_back(allocator);
+        NeighbourSet& set = adjacency.back();
+        for (VertexId neighbour : range)
+        {
+            set.insert(set.end(), neighbour);
+        }
+    }
+}
+
+std::shared_ptr<const CsrAdjacency> CompressedAdjacency::toCsr() const
+{
+    auto arrays = std::make_shared<CsrArrays>();
+    arrays->offsets.reserve(vertexCount() + 1);
+    arrays->offsets.push_back(0);
+    arrays->neighbours.reserve(m_edge_count);
+    for (VertexId vertex = 1; vertex <= vertexCount(); ++vertex)
+    {
+        const CompressedNeighbourRange range = neighbours(vertex);
+        arrays->neighbours.insert(arrays->neighbours.end(), range.begin(), range.end());
+        arrays->offsets.push_back(arrays->neighbours.size());
+    }
+    return std::make_shared<CsrAdjacency>(vertexCount(), arrays->offsets.data(), arrays->neighbours.data(), arrays);
+}
+
+size_t CompressedAdjacency::memoryUsage() const
+{
+    return m_bytes.capacity() + (m_block_offsets.capacity() * sizeof(uint64_t)) +
+        (m_offsets.capacity() * sizeof(uint32_t)) + m_degrees.capacity() + m_weights.memoryUsage();
+}
@@ -0,0 +1,193 @@
+#ifndef COMPRESSEDADJACENCY_H
+#define COMPRESSEDADJACENCY_H
+
+#include "bits.h"
+#include "csradjacency.h"
+#include "edgeweights.h"
+#include "nodepool.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/// The neighbours of a vertex in a CompressedAdjacency, decoded one at a time as they are iterated over.
+class CompressedNeighbourRange
+{
+public:
+    class Iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef VertexId value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const VertexId* pointer;
+        typedef VertexId reference;
+
+        Iterator(const uint8_t* position, size_t remaining, VertexId current) :
+            m_position(position), m_remaining(remaining), m_current(current)
+        {
+        }
+
+        VertexId operator*() const { return m_current; }
+
+        Iterator& operator++()
+        {
+            if (--m_remaining != 0)
+            {
+                m_current += static_cast<VertexId>(ReadVarint(m_position)) + 1;
+            }
+            return *this;
+        }
+
+        bool operator!=(const Iterator& other) const { return m_remaining != other.m_remaining; }
+        bool operator==(const Iterator& other) const { return m_remaining == other.m_remaining; }
+
+    private:
+        const uint8_t* m_position;
+        size_t m_remaining;
+        VertexId m_current;
+    };
+
+    /// @param position The first byte of the encoded neighbours.
+    CompressedNeighbourRange(VertexId vertex, const uint8_t* position, size_t size) :
+        m_vertex(vertex), m_position(position), m_size(size)
+    {
+    }
+
+    Iterator begin() const
+    {
+        if (m_size == 0)
+        {
+            return end();
+        }
+        // The first neighbour is stored as its zigzag encoded distance to the vertex, which can be negative.
+        const uint8_t* position = m_position;
+        const uint64_t zigzag = ReadVarint(position);
+        const VertexId first = (zigzag & 1) ? (m_vertex - static_cast<VertexId>(zigzag >> 1) - 1)
+                                            : (m_vertex + static_cast<VertexId>(zigzag >> 1));
+        return Iterator(position, m_size, first);
+    }
+
+    Iterator end() const { return Iterator(nullptr, 0, 0); }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /// Reads an unsigned LEB128 varint of at most 8 bytes, which holds up to 56 bits, and moves the position past it.
+    /// The varint is decoded without branches from the 8 bytes at the position, so there must be 8 bytes to read
+    /// even at the end of the data.
+    static uint64_t ReadVarint(const uint8_t*& position)
+    {
+        uint64_t word;
+        std::memcpy(&word, position, sizeof(word));
+        // The varint ends at the first byte without the continuation bit. The bytes are little-endian.
+        const unsigned length = (CountTrailingZeros(~word & 0x8080808080808080ull) / 8) + 1;
+        position += length;
+        word &= ~uint64_t(0) >> (64 - (length * 8));
+        return (word & 0x7f) | ((word >> 1) & (uint64_t(0x7f) << 7)) | ((word >> 2) & (uint64_t(0x7f) << 14)) |
+            ((word >> 3) & (uint64_t(0x7f) << 21)) | ((word >> 4) & (uint64_t(0x7f) << 28)) |
+            ((word >> 5) & (uint64_t(0x7f) << 35)) | ((word >> 6) & (uint64_t(0x7f) << 42)) |
+            ((word >> 7) & (uint64_t(0x7f) << 49));
+    }
+
+private:
+    VertexId m_vertex;
+    const uint8_t* m_position;
+    size_t m_size;
+};
+
+/// Immutable adjacency whose neighbour lists are compressed, for graphs whose edges would not fit in memory as sets
+/// or as a CsrAdjacency. The sorted neighbours of a vertex are stored as the distance from the vertex to its first
+/// neighbour and then the gaps between consecutive neighbours, each as a varint of 7 bits per byte. When neighbours
+/// have close IDs, as in graphs with locality or after GraphStore::reorder, most gaps take a single byte. Each vertex
+/// also costs a 4 byte offset, relative to an 8 byte offset per block of 64 vertices, and a byte for its degree,
+/// which is kept out of the lists so that a search knows how many neighbours to decode without waiting for the
+/// cache miss on the list. Decoding is a few instructions per neighbour without branches, done as the searches
+/// iterate over the neighbours.
+class CompressedAdjacency
+{
+public:
+    /// An adjacency without vertices.
+    CompressedAdjacency();
+
+    /// Compress an adjacency.
+    /// @param adjacency The neighbours of each vertex. The position in the vector is the ID of the vertex - 1.
+    /// @param weights The weights of the edges, kept as they are for the weighted searches.
+    CompressedAdjacency(const AdjacencySets& adjacency, const EdgeWeights& weights);
+
+    /// Build a copy of an adjacency with more vertices and edges, without going through sets.
+    /// @param base The adjacency to copy, weights included.
+    /// @param vertexCount The number of vertices of the copy, at least that of the base.
+    /// @param edges New (from, to) edges, sorted and without duplicates. Those the base has already are ignored.
+    /// @param insertedCount Receives the number of edges that were not in the base.
+    CompressedAdjacency(const CompressedAdjacency& base, size_t vertexCount,
+        const std::vector<std::pair<VertexId, VertexId>>& edges, size_t& insertedCount);
+
+    CompressedAdjacency(const CompressedAdjacency&) = delete;
+    CompressedAdjacency& operator=(const CompressedAdjacency&) = delete;
+
+    /// Returns the number of vertices.
+    size_t vertexCount() const { return m_degrees.size(); }
+
+    /// Returns the number of edges.
+    size_t edgeCount() const { return m_edge_count; }
+
+    /// Returns the neighbours of a vertex, sorted by ID. The vertex must exist.
+    CompressedNeighbourRange neighbours(VertexId vertex) const
+    {
+        const uint8_t* position = m_bytes.data() + m_block_offsets[(vertex - 1) / BlockSize] + m_offsets[vertex - 1];
+        size_t size = m_degrees[vertex - 1];
+        if (size == LargeDegree)
+        {
+            size = static_cast<size_t>(CompressedNeighbourRange::ReadVarint(position));
+        }
+        return CompressedNeighbourRange(vertex, position, size);
+    }
+
+    /// Returns true if there is an edge from one vertex to another. The source vertex must exist.
+    bool contains(VertexId from, VertexId to) const;
+
+    /// Returns the weight of an edge, see EdgeWeights::weight.
+    EdgeWeight weight(VertexId vertex, VertexId neighbour) const { return m_weights.weight(vertex, neighbour); }
+
+    /// Returns true if every weight is an integer, see EdgeWeights::integerWeights().
+    bool integerWeights() const { return m_weights.integerWeights(); }
+
+    /// Decode the neighbour lists back into sets, one per vertex.
+    /// @param allocator The allocator of the sets.
+    void decode(AdjacencySets& adjacency, const PoolAllocator<VertexId>& allocator) const;
+
+    /// Decode the neighbour lists into a CSR copy, without the weights.
+    std::shared_ptr<const CsrAdjacency> toCsr() const;
+
+    /// Returns the number of bytes used by the adjacency, weights included.
+    size_t memoryUsage() const;
+
+private:
+    static const size_t BlockSize = 64;
+    // The value of m_degrees for the vertices whose degree is stored as a varint at the start of their list.
+    static const uint8_t LargeDegree = 255;
+
+    // Appends the list of a vertex to m_bytes, starting a new block when the vertex is the first of one.
+    template <typename Neighbours>
+    void append(VertexId vertex, const Neighbours& neighbours);
+
+    // Pads m_bytes once every list is appended so that ReadVarint can read 8 bytes from the last varint.
+    void finish();
+
+    // The encoded lists of all the vertices, in ID order, followed by 7 bytes of padding.
+    std::vector<uint8_t> m_bytes;
+    // The position in m_bytes of the first list of each block of BlockSize vertices.
+    std::vector<uint64_t> m_block_offsets;
+    // The position of the list of vertex id, at position id - 1, relative to the start of its block.
+    std::vector<uint32_t> m_offsets;
+    // The number of neighbours of vertex id at position id - 1, or LargeDegree.
+    std::vector<uint8_t> m_degrees;
+    size_t m_edge_count = 0;
+    EdgeWeights m_weights;
+};
+
+#endif
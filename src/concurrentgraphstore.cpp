@@ -0,0 +1,186 @@
+#include "concurrentgraphstore.h"
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+ConcurrentGraphStore::Pin::Pin(std::atomic<uint64_t>* slot, const GraphVersion* version, uint64_t versionNumber) :
+    m_slot(slot), m_version(version), m_version_number(versionNumber)
+{
+}
+
+ConcurrentGraphStore::Pin::Pin(Pin&& other) :
+    m_slot(other.m_slot), m_version(other.m_version), m_version_number(other.m_version_number)
+{
+    other.m_slot = nullptr;
+}
+
+ConcurrentGraphStore::Pin::~Pin()
+{
+    if (m_slot != nullptr)
+    {
+        m_slot->store(0);
+    }
+}
+
+ConcurrentGraphStore::ConcurrentGraphStore(size_t readerSlots) :
+    m_slots(new ReaderSlot[readerSlots]), m_slot_count(readerSlots)
+{
+    if (readerSlots == 0)
+    {
+        throw std::runtime_error("At least one reader slot is needed");
+    }
+    for (size_t i = 0; i < m_slot_count; ++i)
+    {
+        m_slots[i].m_epoch.store(0);
+    }
+    publish();
+}
+
+ConcurrentGraphStore::~ConcurrentGraphStore()
+{
+    for (const RetiredVersion& retired : m_retired)
+    {
+        delete retired.m_published;
+    }
+    delete m_current.load();
+}
+
+VertexId ConcurrentGraphStore::createVertex()
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    return m_graph.createVertex();
+}
+
+void ConcurrentGraphStore::createEdge(VertexId from, VertexId to)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    m_graph.createEdge(from, to);
+}
+
+void ConcurrentGraphStore::addLabel(VertexId vertex, const std::string& label)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    m_graph.addLabel(vertex, label);
+}
+
+void ConcurrentGraphStore::removeLabel(VertexId vertex, const std::string& label)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    m_graph.removeLabel(vertex, label);
+}
+
+bool ConcurrentGraphStore::deleteEdge(VertexId from, VertexId to)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    return m_graph.deleteEdge(from, to);
+}
+
+void ConcurrentGraphStore::deleteVertex(VertexId vertex)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    m_graph.deleteVertex(vertex);
+}
+
+std::vector<VertexMove> ConcurrentGraphStore::compact(size_t maxMoves)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    return m_graph.compact(maxMoves);
+}
+
+void ConcurrentGraphStore::reorder(VertexOrder order)
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    m_graph.reorder(order);
+}
+
+void ConcurrentGraphStore::publish()
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+
+    ++m_published_count;
+    const PublishedVersion* published = new PublishedVersion{m_graph.createVersion(), m_published_count};
+    const PublishedVersion* replaced = m_current.exchange(published);
+    if (replaced != nullptr)
+    {
+        // A reader that starts after the increment below can only see the new version. A reader that started before
+        // it has an epoch no greater than the retire epoch and may still be using the replaced one.
+        m_retired.push_back(RetiredVersion{replaced, m_epoch.load()});
+    }
+    m_epoch.fetch_add(1);
+
+    reclaimLocked();
+}
+
+void ConcurrentGraphStore::reclaim()
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    reclaimLocked();
+}
+
+void ConcurrentGraphStore::reclaimLocked()
+{
+    if (m_retired.empty())
+    {
+        return;
+    }
+
+    uint64_t oldest_reader = UINT64_MAX;
+    for (size_t i = 0; i < m_slot_count; ++i)
+    {
+        const uint64_t epoch = m_slots[i].m_epoch.load();
+        if ((epoch != 0) && (epoch < oldest_reader))
+        {
+            oldest_reader = epoch;
+        }
+    }
+
+    size_t kept = 0;
+    for (const RetiredVersion& retired : m_retired)
+    {
+        if (retired.m_epoch < oldest_reader)
+        {
+            delete retired.m_published;
+        }
+        else
+        {
+            m_retired[kept++] = retired;
+        }
+    }
+    m_retired.resize(kept);
+}
+
+size_t ConcurrentGraphStore::retiredVersionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    return m_retired.size();
+}
+
+ConcurrentGraphStore::Pin ConcurrentGraphStore::pin() const
+{
+    // Start looking for a free slot at a position that depends on the thread so that readers on different threads
+    // don't all compete for the first slots.
+    size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_slot_count;
+    while (true)
+    {
+        // The slot is claimed with the current epoch before the current version is read. If a writer replaces the
+        // version in between, it retires it with an epoch no smaller than ours and won't delete it while we hold it.
+        uint64_t free_slot = 0;
+        if (m_slots[index].m_epoch.compare_exchange_strong(free_slot, m_epoch.load()))
+        {
+            const PublishedVersion* published = m_current.load();
+            return Pin(&m_slots[index].m_epoch, published->m_version.get(), published->m_number);
+        }
+
+        index = (index + 1) % m_slot_count;
+        if (index == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::vector<VertexId> ConcurrentGraphStore::shortestPath(VertexId from, VertexId to, const std::string& label) const
+{
+    const Pin version = pin();
+    return version->shortestPath(from, to, label);
+}
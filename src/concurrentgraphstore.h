@@ -0,0 +1,126 @@
+#ifndef CONCURRENTGRAPHSTORE_H
+#define CONCURRENTGRAPHSTORE_H
+
+#include "graphstore.h"
+#include "graphversion.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/// A graph shared between writers and concurrent readers.
+/// Writers mutate a GraphStore and call publish() to make their changes visible, which builds a new immutable
+/// GraphVersion and swaps it in. Readers pin the current version without taking any lock and search it while writers
+/// carry on. A version that is replaced is only deleted once every reader that could have pinned it has let go of it,
+/// which is tracked with epochs: each pinned reader records the epoch it started in and a replaced version is retired
+/// with the epoch it was replaced in.
+/// Publishing copies the parts of the graph that changed, so writers should publish batches of mutations rather than
+/// every single one.
+class ConcurrentGraphStore
+{
+public:
+    /// A version pinned by a reader. The version stays valid until the pin is destroyed.
+    class Pin
+    {
+    public:
+        Pin(Pin&& other);
+        ~Pin();
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin& operator=(Pin&&) = delete;
+
+        const GraphVersion& operator*() const { return *m_version; }
+        const GraphVersion* operator->() const { return m_version; }
+
+        /// Returns the number of the pinned version: 1 for the first published version, then increasing by one per
+        /// publish().
+        uint64_t versionNumber() const { return m_version_number; }
+
+    private:
+        friend class ConcurrentGraphStore;
+        Pin(std::atomic<uint64_t>* slot, const GraphVersion* version, uint64_t versionNumber);
+
+        std::atomic<uint64_t>* m_slot;
+        const GraphVersion* m_version;
+        uint64_t m_version_number;
+    };
+
+    /// Create an empty graph and publish it as the first version.
+    /// @param readerSlots The maximum number of readers that can hold a pin at the same time. Further readers wait for
+    /// a slot to be released.
+    explicit ConcurrentGraphStore(size_t readerSlots);
+
+    /// Delete all the versions. No reader may hold a pin anymore.
+    ~ConcurrentGraphStore();
+
+    ConcurrentGraphStore(const ConcurrentGraphStore&) = delete;
+    ConcurrentGraphStore& operator=(const ConcurrentGraphStore&) = delete;
+
+    /// Writer side. These behave as the GraphStore methods of the same name. Writers are serialized with each other
+    /// but never wait for readers. The changes are not visible to readers until the next publish().
+    VertexId createVertex();
+    void createEdge(VertexId from, VertexId to);
+    void addLabel(VertexId vertex, const std::string& label);
+    void removeLabel(VertexId vertex, const std::string& label);
+    bool deleteEdge(VertexId from, VertexId to);
+    void deleteVertex(VertexId vertex);
+    std::vector<VertexMove> compact(size_t maxMoves);
+    void reorder(VertexOrder order);
+
+    /// Make all the changes done so far visible to the readers that pin a version from now on, and delete the
+    /// replaced versions no reader holds anymore.
+    void publish();
+
+    /// Delete the replaced versions no reader holds anymore. publish() already does this; calling it is only useful
+    /// to release memory when there has been no publish() for a while.
+    void reclaim();
+
+    /// Returns the number of replaced versions that are still waiting for readers to let go of them.
+    size_t retiredVersionCount() const;
+
+    /// Reader side. Pin the current version. This never takes a lock and never waits for writers.
+    Pin pin() const;
+
+    /// Returns the shortest path in the current version. See GraphStore::shortestPath.
+    std::vector<VertexId> shortestPath(VertexId from, VertexId to, const std::string& label) const;
+
+private:
+    // A reader slot holds 0 while free and the epoch the reader started in while it holds a pin. The padding keeps
+    // each slot on its own cache line so that readers don't slow each other down.
+    struct ReaderSlot
+    {
+        std::atomic<uint64_t> m_epoch;
+        char m_padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    struct PublishedVersion
+    {
+        std::unique_ptr<const GraphVersion> m_version;
+        uint64_t m_number;
+    };
+
+    struct RetiredVersion
+    {
+        const PublishedVersion* m_published;
+        uint64_t m_epoch;
+    };
+
+    void reclaimLocked();
+
+    GraphStore m_graph;
+    // Serializes the writers. Readers never take it.
+    mutable std::mutex m_writer_mutex;
+
+    std::atomic<const PublishedVersion*> m_current{nullptr};
+    uint64_t m_published_count = 0;
+    // Epoch 0 marks a free reader slot so the epochs start at 1.
+    std::atomic<uint64_t> m_epoch{1};
+    std::unique_ptr<ReaderSlot[]> m_slots;
+    size_t m_slot_count;
+    std::vector<RetiredVersion> m_retired;
+};
+
+#endif
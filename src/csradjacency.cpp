@@ -0,0 +1,73 @@
+#include "csradjacency.h"
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+template <typename Id>
+BasicCsrAdjacency<Id>::BasicCsrAdjacency(const AdjacencySets& adjacency)
+{
+    if (adjacency.size() > std::numeric_limits<Id>::max())
+    {
+        throw std::runtime_error("Too many vertices for the ID width");
+    }
+
+    m_offsets.reserve(adjacency.size() + 1);
+    m_offsets.push_back(0);
+    size_t edge_count = 0;
+    for (const auto& neighbours : adjacency)
+    {
+        edge_count += neighbours.size();
+        m_offsets.push_back(edge_count);
+    }
+
+    // std::set iterates in order so the neighbours of each vertex end up sorted.
+    m_neighbours.reserve(edge_count);
+    for (const auto& neighbours : adjacency)
+    {
+        for (VertexId neighbour : neighbours)
+        {
+            m_neighbours.push_back(static_cast<Id>(neighbour));
+        }
+    }
+
+    m_vertex_count = adjacency.size();
+    m_offsets_data = m_offsets.data();
+    m_neighbours_data = m_neighbours.data();
+}
+
+template <typename Id>
+BasicCsrAdjacency<Id>::BasicCsrAdjacency(const AdjacencySets& adjacency, const EdgeWeights& weights) :
+    BasicCsrAdjacency(adjacency)
+{
+    if (weights.empty())
+    {
+        return;
+    }
+
+    m_weights.reserve(m_neighbours.size());
+    for (VertexId vertex = 1; vertex <= m_vertex_count; ++vertex)
+    {
+        for (VertexId neighbour : neighbours(vertex))
+        {
+            m_weights.push_back(weights.weight(vertex, neighbour));
+        }
+    }
+    m_integer_weights = weights.integerWeights();
+}
+
+template <typename Id>
+BasicCsrAdjacency<Id>::BasicCsrAdjacency(size_t vertexCount, const size_t* offsets, const Id* neighbours,
+    std::shared_ptr<const void> storage) :
+    m_vertex_count(vertexCount), m_offsets_data(offsets), m_neighbours_data(neighbours), m_storage(std::move(storage))
+{
+}
+
+template <typename Id>
+size_t BasicCsrAdjacency<Id>::memoryUsage() const
+{
+    return (m_offsets.capacity() * sizeof(size_t)) + (m_neighbours.capacity() * sizeof(Id)) +
+        (m_weights.capacity() * sizeof(EdgeWeight));
+}
+
+template class BasicCsrAdjacency<VertexId>;
+template class BasicCsrAdjacency<uint32_t>;
@@ -0,0 +1,132 @@
+#include "durablegraphstore.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    bool FileExists(const std::string& path)
+    {
+        return std::ifstream(path).good();
+    }
+
+    // Replaces a file by another one. On POSIX systems the rename does it in one step; elsewhere the target is removed
+    // first and a crash in between leaves only the new file, which the constructor of DurableGraphStore picks up.
+    void ReplaceFile(const std::string& from, const std::string& to)
+    {
+#ifdef _WIN32
+        std::remove(to.c_str());
+#endif
+        if (std::rename(from.c_str(), to.c_str()) != 0)
+        {
+            throw std::runtime_error("Cannot rename " + from + " to " + to);
+        }
+    }
+}
+
+DurableGraphStore::DurableGraphStore(const std::string& path, const WalOptions& options)
+    : m_path(path), m_options(options)
+{
+    const std::string new_checkpoint = path + ".new";
+    if (!FileExists(path) && FileExists(new_checkpoint))
+    {
+        ReplaceFile(new_checkpoint, path);
+    }
+
+    uint64_t generation = 0;
+    if (FileExists(path))
+    {
+        m_graph = GraphStore::load(path, &generation);
+    }
+
+    m_log.reset(new WriteAheadLog(path + ".wal", generation, options));
+    if ((m_log->generation() == generation + 1) && FileExists(new_checkpoint))
+    {
+        // A crash after the log was emptied for a new checkpoint that was synced but whose rename did not reach the
+        // disk: the new checkpoint is still there under its temporary name.
+        uint64_t new_generation = 0;
+        GraphStore graph = GraphStore::load(new_checkpoint, &new_generation);
+        if (new_generation == m_log->generation())
+        {
+            ReplaceFile(new_checkpoint, path);
+            SyncDirectory(path);
+            m_graph = std::move(graph);
+            generation = new_generation;
+        }
+    }
+
+    if (m_log->generation() == generation)
+    {
+        m_replayed_record_count = m_log->replay(m_graph);
+    }
+    else if (m_log->generation() + 1 == generation)
+    {
+        m_log->reset(generation);
+    }
+    else
+    {
+        throw std::runtime_error(path + ".wal does not go with the checkpoint " + path);
+    }
+}
+
+VertexId DurableGraphStore::createVertex()
+{
+    const VertexId vertex = m_graph.createVertex();
+    m_log->logCreateVertices(1);
+    logged();
+    return vertex;
+}
+
+VertexId DurableGraphStore::createVertices(size_t count)
+{
+    const VertexId first = m_graph.createVertices(count);
+    m_log->logCreateVertices(count);
+    logged();
+    return first;
+}
+
+void DurableGraphStore::createEdge(VertexId from, VertexId to)
+{
+    m_graph.createEdge(from, to);
+    m_log->logCreateEdge(from, to);
+    logged();
+}
+
+void DurableGraphStore::addLabel(VertexId vertex, const std::string& label)
+{
+    m_graph.addLabel(vertex, label);
+    m_log->logAddLabel(vertex, label);
+    logged();
+}
+
+void DurableGraphStore::removeLabel(VertexId vertex, const std::string& label)
+{
+    m_graph.removeLabel(vertex, label);
+    m_log->logRemoveLabel(vertex, label);
+    logged();
+}
+
+void DurableGraphStore::commit()
+{
+    m_log->commit();
+}
+
+void DurableGraphStore::checkpoint()
+{
+    // The new checkpoint must be on disk, under its final name, before the log that it replaces is emptied.
+    const uint64_t generation = m_log->generation() + 1;
+    const std::string new_checkpoint = m_path + ".new";
+    m_graph.save(new_checkpoint, generation);
+    SyncFile(new_checkpoint);
+    ReplaceFile(new_checkpoint, m_path);
+    SyncDirectory(m_path);
+    m_log->reset(generation);
+}
+
+void DurableGraphStore::logged()
+{
+    if ((m_options.checkpoint_interval != 0) && (m_log->recordCount() >= m_options.checkpoint_interval))
+    {
+        checkpoint();
+    }
+}
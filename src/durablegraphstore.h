@@ -0,0 +1,67 @@
+#ifndef DURABLEGRAPHSTORE_H
+#define DURABLEGRAPHSTORE_H
+
+#include "graphstore.h"
+#include "writeaheadlog.h"
+#include <memory>
+#include <string>
+
+/// A GraphStore whose mutations survive a crash.
+/// The graph is kept in two files: a checkpoint, which is a snapshot file of the graph at some point, and a
+/// write-ahead log of the mutations done since. Opening the store loads the checkpoint and replays the log on top of
+/// it. checkpoint() writes a new checkpoint and empties the log, which bounds the time recovery takes.
+/// Each checkpoint has a generation number, stored in its header and at the start of the log that goes with it. A
+/// crash after a new checkpoint is in place but before the log was emptied leaves a log of the previous generation,
+/// whose records are all in the checkpoint already, and opening the store then simply drops it. A crash after the log
+/// was emptied but before the rename of the new checkpoint reached the disk leaves a log one generation ahead of the
+/// checkpoint, and opening the store then finishes the rename of the new checkpoint.
+class DurableGraphStore
+{
+public:
+    /// Open the store, creating it empty if its files don't exist.
+    /// @param path The path of the checkpoint. The log is at the same path with ".wal" appended.
+    /// @param options When to sync the log and when to write checkpoints.
+    /// @throws std::runtime_error if the files can't be read or don't go together.
+    DurableGraphStore(const std::string& path, const WalOptions& options);
+
+    DurableGraphStore(const DurableGraphStore&) = delete;
+    DurableGraphStore& operator=(const DurableGraphStore&) = delete;
+
+    /// These behave as the GraphStore methods of the same name and then log the mutation. A mutation is durable once
+    /// its group has been synced, see WalOptions, or after the next commit(). A mutation that throws because it is
+    /// invalid is not logged.
+    /// @throws std::runtime_error if a vertex does not exist or the log can't be written.
+    VertexId createVertex();
+    VertexId createVertices(size_t count);
+    void createEdge(VertexId from, VertexId to);
+    void addLabel(VertexId vertex, const std::string& label);
+    void removeLabel(VertexId vertex, const std::string& label);
+
+    /// Make every mutation done so far durable.
+    /// @throws std::runtime_error if the log can't be written.
+    void commit();
+
+    /// Write the whole graph to a new checkpoint and empty the log.
+    /// @throws std::runtime_error if the checkpoint or the log can't be written.
+    void checkpoint();
+
+    /// Returns the graph, to search it.
+    const GraphStore& graph() const { return m_graph; }
+
+    /// Returns the log.
+    const WriteAheadLog& log() const { return *m_log; }
+
+    /// Returns the number of log records that were replayed when the store was opened.
+    size_t replayedRecordCount() const { return m_replayed_record_count; }
+
+private:
+    void logged();
+
+    std::string m_path;
+    WalOptions m_options;
+    GraphStore m_graph;
+    std::unique_ptr<WriteAheadLog> m_log;
+    size_t m_replayed_record_count = 0;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "edgeweights.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+constexpr EdgeWeight EdgeWeights::DefaultWeight;
+constexpr EdgeWeight EdgeWeights::MaxIntegerWeight;
+
+void EdgeWeights::set(VertexId from, VertexId to, EdgeWeight weight)
+{
+    if (!std::isfinite(weight) || (weight < 0))
+    {
+        throw std::runtime_error("Edge weight must be finite and not negative");
+    }
+
+    if (from > m_weights.size())
+    {
+        if (weight == DefaultWeight)
+        {
+            return;
+        }
+        m_weights.resize(from);
+    }
+    std::vector<NeighbourWeight>& weights = m_weights[from - 1];
+    auto position = std::lower_bound(weights.begin(), weights.end(), NeighbourWeight(to, 0),
+        [](const NeighbourWeight& a, const NeighbourWeight& b) { return a.first < b.first; });
+    const bool found = (position != weights.end()) && (position->first == to);
+    if (found)
+    {
+        m_fractional_count -= isInteger(position->second) ? 0 : 1;
+        if (weight == DefaultWeight)
+        {
+            weights.erase(position);
+            --m_count;
+            return;
+        }
+        position->second = weight;
+    }
+    else
+    {
+        if (weight == DefaultWeight)
+        {
+            return;
+        }
+        weights.insert(position, NeighbourWeight(to, weight));
+        ++m_count;
+    }
+    m_fractional_count += isInteger(weight) ? 0 : 1;
+}
+
+EdgeWeight EdgeWeights::weight(VertexId from, VertexId to) const
+{
+    if (from > m_weights.size())
+    {
+        return DefaultWeight;
+    }
+    const std::vector<NeighbourWeight>& weights = m_weights[from - 1];
+    auto position = std::lower_bound(weights.begin(), weights.end(), NeighbourWeight(to, 0),
+        [](const NeighbourWeight& a, const NeighbourWeight& b) { return a.first < b.first; });
+    return ((position != weights.end()) && (position->first == to)) ? position->second : DefaultWeight;
+}
+
+void EdgeWeights::shrink(size_t vertexCount)
+{
+    if (vertexCount < m_weights.size())
+    {
+        m_weights.resize(vertexCount);
+        if ((vertexCount * 2) < m_weights.capacity())
+        {
+            m_weights.shrink_to_fit();
+        }
+    }
+}
+
+size_t EdgeWeights::memoryUsage() const
+{
+    size_t usage = m_weights.capacity() * sizeof(std::vector<NeighbourWeight>);
+    for (const std::vector<NeighbourWeight>& weights : m_weights)
+    {
+        usage += weights.capacity() * sizeof(NeighbourWeight);
+    }
+    return usage;
+}
+
+bool EdgeWeights::isInteger(EdgeWeight weight)
+{
+    return (weight <= MaxIntegerWeight) && (std::floor(weight) == weight);
+}
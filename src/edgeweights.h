@@ -0,0 +1,55 @@
+#ifndef EDGEWEIGHTS_H
+#define EDGEWEIGHTS_H
+
+#include "types.h"
+#include <utility>
+#include <vector>
+
+/// The weights of the edges of a mutable graph that don't weigh the default 1. An unweighted graph pays nothing for
+/// them and a graph with a few weighted edges only pays for those. Each vertex keeps the weights of its outgoing
+/// edges in a small vector sorted by neighbour, so looking one up is a binary search over the weighted edges of a
+/// single vertex. CsrAdjacency turns them into a dense array parallel to its neighbours when the graph is frozen.
+class EdgeWeights
+{
+public:
+    /// The weight of the edges that were not given one.
+    static constexpr EdgeWeight DefaultWeight = 1;
+
+    /// The largest weight integerWeights() accepts. Up to it every integer is exact in an EdgeWeight.
+    static constexpr EdgeWeight MaxIntegerWeight = 16777216;
+
+    /// Set the weight of an edge.
+    /// @throws std::runtime_error if the weight is negative or not finite.
+    void set(VertexId from, VertexId to, EdgeWeight weight);
+
+    /// Returns the weight of an edge, DefaultWeight if it was never set.
+    EdgeWeight weight(VertexId from, VertexId to) const;
+
+    /// Release the memory of the vertices from vertexCount + 1 on, which must have no weighted edges left.
+    void shrink(size_t vertexCount);
+
+    /// Returns true if no edge has a weight other than DefaultWeight.
+    bool empty() const { return m_count == 0; }
+
+    /// Returns true if every weight is an integer no larger than MaxIntegerWeight, which lets the searches use integer
+    /// keys.
+    bool integerWeights() const { return m_fractional_count == 0; }
+
+    /// Returns the number of bytes used by the weights.
+    size_t memoryUsage() const;
+
+    /// Returns true if a weight is an integer no larger than MaxIntegerWeight.
+    static bool isInteger(EdgeWeight weight);
+
+private:
+    typedef std::pair<VertexId, EdgeWeight> NeighbourWeight;
+
+    // The weights of the outgoing edges of vertex id at position id - 1, sorted by neighbour. The vector only grows
+    // up to the last vertex that has a weighted edge.
+    std::vector<std::vector<NeighbourWeight>> m_weights;
+    // The number of weights stored and how many of them are not integers.
+    size_t m_count = 0;
+    size_t m_fractional_count = 0;
+};
+
+#endif
@@ -1,161 +1,1427 @@
 #include "graphstore.h"
-#include <limits>
-#include <map>
-#include <queue>
+#include "mappedlabelindex.h"
+#include "multisourcebfs.h"
+#include "search.h"
+#include "snapshotfile.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <stdexcept>
-#include <iostream>
 
 namespace
 {
-    // The wikipedia algorithm we refer to in shortestPath fills some of the sets with infinity. This is wasteful as
-    // we'd have to add all the vertices even the ones we'll never visit. Just assume that if it's not in the set its
-    // score is infinity.
-    int Cost(const std::map<VertexId, int>& scores, VertexId vertex)
+    typedef std::pair<VertexId, VertexId> Edge;
+
+    // The estimated size of a tree node of a set allocated from the global heap: three pointers, the colour and the
+    // value, plus the bookkeeping of the heap.
+    const size_t HeapNodeBytes = 48;
+
+    // Sorts the values, in parallel on the pool if there is one: each worker sorts a slice and the slices are then
+    // merged two by two.
+    void ParallelSort(std::vector<Edge>& values, ThreadPool* pool)
     {
-        if (scores.count(vertex) > 0)
+        const size_t MinSliceSize = 65536;
+        const size_t slice_count = (pool != nullptr) ? std::min(pool->workerCount(), values.size() / MinSliceSize) : 1;
+        if (slice_count <= 1)
         {
-            return scores.at(vertex);
+            std::sort(values.begin(), values.end());
+            return;
         }
-        return std::numeric_limits<int>::max();
-    }
 
-    std::vector<VertexId> ReconstructPath(const std::map<VertexId, VertexId>& cameFrom, VertexId current)
-    {
-        std::vector<VertexId> total_path = {current};
-        while (cameFrom.count(current) > 0)
+        std::vector<size_t> bounds;
+        for (size_t i = 0; i <= slice_count; ++i)
         {
-            current = cameFrom.at(current);
-            total_path.insert(total_path.begin(), current);
+            bounds.push_back((i * values.size()) / slice_count);
         }
-        return total_path;
-    }
-        
-    // Class used to implement a heap with a std::set. This is used in the A* algorithm and helps us identify the vertex
-    // with the lowest score efficiently.
-    class VertexAndScore
-    {
-    public:
-        VertexAndScore(VertexId vertex, int score) : m_vertex(vertex), m_score(score) {};
 
-        bool operator<(const VertexAndScore& other) const
+        pool->parallelFor(slice_count, 1, [&](size_t begin, size_t end)
         {
-            if (m_score < other.m_score)
+            for (size_t i = begin; i < end; ++i)
             {
-                return true;
+                std::sort(values.begin() + bounds[i], values.begin() + bounds[i + 1]);
             }
-            else if (m_score > other.m_score)
+        });
+
+        for (size_t width = 1; width < slice_count; width *= 2)
+        {
+            const size_t pair_count = (slice_count + (2 * width) - 1) / (2 * width);
+            pool->parallelFor(pair_count, 1, [&](size_t begin, size_t end)
             {
-                return false;
-            }
-            else
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const size_t first = i * 2 * width;
+                    const size_t middle = std::min(first + width, slice_count);
+                    const size_t last = std::min(first + (2 * width), slice_count);
+                    std::inplace_merge(values.begin() + bounds[first], values.begin() + bounds[middle],
+                        values.begin() + bounds[last]);
+                }
+            });
+        }
+    }
+
+    // Inserts sorted and deduplicated edges into per-vertex sets, each edge (a, b) adding b to the set of a. The work
+    // is split by source vertex so that no two threads ever touch the same set, and the threads allocate the nodes of
+    // the sets from nodePool through caches of their own. Returns the number of edges that were not in the sets
+    // already.
+    size_t InsertSortedEdges(const std::vector<Edge>& edges, AdjacencySets& vertices, NodePool* nodePool,
+        ThreadPool* pool)
+    {
+        std::atomic<size_t> inserted_count(0);
+        auto insert = [&](size_t begin, size_t end)
+        {
+            auto first = std::lower_bound(edges.begin(), edges.end(), Edge(begin + 1, 0));
+            auto last = std::lower_bound(first, edges.end(), Edge(end + 1, 0));
+            size_t inserted = 0;
+            for (auto edge = first; edge != last; ++edge)
             {
-                return m_vertex < other.m_vertex;
+                NeighbourSet& neighbours = vertices[edge->first - 1];
+                // The edges come in increasing order so the end of the set is the right hint when the vertex had no
+                // neighbours before, which makes the insertion constant time.
+                const size_t size = neighbours.size();
+                neighbours.insert(neighbours.end(), edge->second);
+                inserted += neighbours.size() - size;
             }
+            inserted_count += inserted;
+        };
+
+        if (pool != nullptr)
+        {
+            pool->parallelFor(vertices.size(), 4096, [&](size_t begin, size_t end)
+            {
+                NodePool::ThreadCache cache(nodePool);
+                insert(begin, end);
+            });
+        }
+        else
+        {
+            insert(0, vertices.size());
         }
+        return inserted_count;
+    }
+}
 
-        VertexId m_vertex;
-        int m_score;
-    };
+const uint32_t GraphStore::Unreachable;
+
+GraphStore::GraphStore() :
+    GraphStore(AdjacencyStorage::Sets, true)
+{
+}
+
+GraphStore::GraphStore(AdjacencyStorage storage) :
+    GraphStore(storage, true)
+{
+}
 
-    VertexId cheapestVertex(std::set<VertexAndScore>& open_set)
+GraphStore::GraphStore(AdjacencyStorage storage, bool poolNodes) :
+    m_node_pool(poolNodes), m_storage(storage)
+{
+    if (m_storage == AdjacencyStorage::Compressed)
     {
-        VertexId top = open_set.begin()->m_vertex;
-        open_set.erase(open_set.begin());
-        return top;
+        freeze();
     }
 }
 
 VertexId GraphStore::createVertex()
 {
+    decompress();
+    thaw();
+    ++m_label_generation;
+    if (!m_deleted.empty())
+    {
+        // The slot of a deleted vertex has no edges and no labels left.
+        const VertexId reused_id = *m_deleted.begin();
+        m_deleted.erase(m_deleted.begin());
+        return m_mapping.external(reused_id);
+    }
+
     VertexId new_id = (m_vertices.size() + 1);
-    m_vertices.emplace_back(std::set<VertexId>());
+    m_vertices.emplace_back(m_node_pool.allocator<VertexId>());
+    m_reverse.emplace_back(m_node_pool.allocator<VertexId>());
+    m_mapping.resize(m_vertices.size());
     return new_id;
 }
 
 void GraphStore::createEdge(VertexId from, VertexId to)
 {
-    if (((from - 1) > m_vertices.size()) || ((to - 1) > m_vertices.size()))
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    if (!isAlive(from) || !isAlive(to))
     {
         throw std::runtime_error("Vertex does not exist");
     }
+    decompress();
+    insertEdge(from, to);
+    m_subscriptions.notify(m_mapping);
+}
+
+void GraphStore::insertEdge(VertexId from, VertexId to)
+{
+    if (m_vertices[from-1].insert(to).second)
+    {
+        m_reverse[to-1].insert(from);
+        ++m_edge_count;
+        ++m_edge_generation;
+        thaw();
 
-    m_vertices[from-1].insert(to);
+        for (LabelId label_id = 0; label_id < m_reachability.size(); ++label_id)
+        {
+            const VertexBitmap& labelled = m_labels.vertices(label_id);
+            if (m_reachability[label_id].built() && labelled.contains(from) && labelled.contains(to))
+            {
+                m_reachability[label_id].addEdge(from, to, m_reverse, labelled);
+                m_frozen_reachability = nullptr;
+            }
+        }
+        for (LabelId label_id = 0; label_id < m_distance_indexes.size(); ++label_id)
+        {
+            const VertexBitmap& labelled = m_labels.vertices(label_id);
+            if (labelled.contains(from) && labelled.contains(to))
+            {
+                invalidateDistanceIndex(label_id);
+            }
+        }
+        m_subscriptions.addEdge(from, to, m_vertices, m_labels);
+    }
 }
 
-void GraphStore::addLabel(VertexId vertex, const std::string& label)
+void GraphStore::createEdge(VertexId from, VertexId to, EdgeWeight weight)
 {
-    if ((vertex - 1) > m_vertices.size())
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    if (!isAlive(from) || !isAlive(to))
     {
         throw std::runtime_error("Vertex does not exist");
     }
 
-    m_labels[label].insert(vertex);
+    // The weight is checked before the edge is created so that a bad weight leaves the graph unchanged.
+    decompress();
+    if (m_weights.weight(from, to) != weight)
+    {
+        m_weights.set(from, to, weight);
+        thaw();
+    }
+    insertEdge(from, to);
+    m_subscriptions.notify(m_mapping);
 }
 
-void GraphStore::removeLabel(VertexId vertex, const std::string& label)
+EdgeWeight GraphStore::edgeWeight(VertexId from, VertexId to) const
 {
-    if ((vertex - 1) > m_vertices.size())
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    const bool exists = isAlive(from) &&
+        (m_compressed ? m_compressed->contains(from, to) : (m_vertices[from - 1].count(to) != 0));
+    if (!exists)
     {
-        throw std::runtime_error("Vertex does not exist");
+        throw std::runtime_error("Edge does not exist");
     }
+    return m_weights.weight(from, to);
+}
 
-    m_labels[label].erase(vertex);
-    if (m_labels[label].empty())
+VertexId GraphStore::createVertices(size_t count)
+{
+    VertexId first_id = (idCount() + 1);
+    if (m_compressed && (count > 0))
+    {
+        const size_t vertex_count = idCount() + count;
+        size_t inserted_count = 0;
+        m_compressed = std::make_shared<CompressedAdjacency>(*m_compressed, vertex_count, std::vector<Edge>(),
+            inserted_count);
+        m_compressed_reverse = std::make_shared<CompressedAdjacency>(*m_compressed_reverse, vertex_count,
+            std::vector<Edge>(), inserted_count);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_vertices.emplace_back(m_node_pool.allocator<VertexId>());
+            m_reverse.emplace_back(m_node_pool.allocator<VertexId>());
+        }
+    }
+    m_mapping.resize(idCount());
+    if (count > 0)
     {
-        m_labels.erase(label);
+        thaw();
+        ++m_label_generation;
     }
+    return first_id;
 }
 
-std::vector<VertexId> GraphStore::shortestPath(VertexId from, VertexId to, const std::string& label) const
+void GraphStore::createEdges(const std::vector<std::pair<VertexId, VertexId>>& edges, ThreadPool* pool)
+{
+    std::vector<Edge> sorted(edges);
+    for (Edge& edge : sorted)
+    {
+        edge = Edge(m_mapping.internal(edge.first), m_mapping.internal(edge.second));
+        if (!isAlive(edge.first) || !isAlive(edge.second))
+        {
+            throw std::runtime_error("Vertex does not exist");
+        }
+    }
+
+    // The reachability indexes and the subscriptions are updated from the sets.
+    if (!m_subscriptions.empty() || std::any_of(m_reachability.begin(), m_reachability.end(),
+        [](const ReachabilityIndex& index)
+        {
+            return index.built();
+        }))
+    {
+        decompress();
+    }
+
+    ParallelSort(sorted, pool);
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    size_t inserted_count = 0;
+    std::shared_ptr<const CompressedAdjacency> compressed;
+    if (m_compressed)
+    {
+        compressed = std::make_shared<CompressedAdjacency>(*m_compressed, idCount(), sorted, inserted_count);
+    }
+    else
+    {
+        inserted_count = InsertSortedEdges(sorted, m_vertices, m_node_pool.get(), pool);
+    }
+    if (inserted_count == 0)
+    {
+        return;
+    }
+
+    for (Edge& edge : sorted)
+    {
+        std::swap(edge.first, edge.second);
+    }
+    ParallelSort(sorted, pool);
+    if (m_compressed)
+    {
+        size_t reversed_count = 0;
+        m_compressed_reverse = std::make_shared<CompressedAdjacency>(*m_compressed_reverse, idCount(), sorted,
+            reversed_count);
+        m_compressed = std::move(compressed);
+    }
+    else
+    {
+        InsertSortedEdges(sorted, m_reverse, m_node_pool.get(), pool);
+    }
+
+    m_edge_count += inserted_count;
+    ++m_edge_generation;
+    thaw();
+
+    // Widening the intervals edge by edge walks back from each edge, so a batch that adds a good part of the edges
+    // is cheaper to index from scratch.
+    const bool rebuild = (inserted_count * 4) > m_edge_count;
+    for (LabelId label_id = 0; label_id < m_reachability.size(); ++label_id)
+    {
+        if (!m_reachability[label_id].built())
+        {
+            continue;
+        }
+        const VertexBitmap& labelled = m_labels.vertices(label_id);
+        if (rebuild)
+        {
+            m_reachability[label_id] = ReachabilityIndex(m_vertices, labelled);
+        }
+        else
+        {
+            // The edges are reversed at this point.
+            for (const Edge& edge : sorted)
+            {
+                if (labelled.contains(edge.first) && labelled.contains(edge.second))
+                {
+                    m_reachability[label_id].addEdge(edge.second, edge.first, m_reverse, labelled);
+                }
+            }
+        }
+        m_frozen_reachability = nullptr;
+    }
+
+    for (LabelId label_id = 0; label_id < m_distance_indexes.size(); ++label_id)
+    {
+        if (!m_distance_indexes[label_id])
+        {
+            continue;
+        }
+        const VertexBitmap& labelled = m_labels.vertices(label_id);
+        for (const Edge& edge : sorted)
+        {
+            if (labelled.contains(edge.first) && labelled.contains(edge.second))
+            {
+                invalidateDistanceIndex(label_id);
+                break;
+            }
+        }
+    }
+
+    if (!m_subscriptions.empty())
+    {
+        if (rebuild)
+        {
+            m_subscriptions.rebuild(m_vertices, m_labels, m_mapping);
+        }
+        else
+        {
+            for (const Edge& edge : sorted)
+            {
+                m_subscriptions.addEdge(edge.second, edge.first, m_vertices, m_labels);
+            }
+        }
+        m_subscriptions.notify(m_mapping);
+    }
+}
+
+bool GraphStore::deleteEdge(VertexId from, VertexId to)
+{
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    if (!isAlive(from) || !isAlive(to))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+    decompress();
+    const bool removed = removeEdge(from, to);
+    m_subscriptions.notify(m_mapping);
+    return removed;
+}
+
+bool GraphStore::removeEdge(VertexId from, VertexId to)
 {
-    // This is an implementation of the A* algorithm as described in https://en.wikipedia.org/wiki/A*_search_algorithm
-    // With h(vertex) always 0 and d(vertex_1, vertex_2) always 1 since our graph doesn't have a weight on the edges.
-    // Essentially this disable the heuristic part of the A* algorithm.
+    if (m_vertices[from - 1].erase(to) == 0)
+    {
+        return false;
+    }
+    m_reverse[to - 1].erase(from);
+    m_weights.set(from, to, EdgeWeights::DefaultWeight);
+    --m_edge_count;
+    ++m_edge_generation;
+    thaw();
+
+    // The reachability indexes are left alone: an index that lets a search through where there is no path anymore
+    // is still correct.
+    for (LabelId label_id = 0; label_id < m_distance_indexes.size(); ++label_id)
+    {
+        const VertexBitmap& labelled = m_labels.vertices(label_id);
+        if (labelled.contains(from) && labelled.contains(to))
+        {
+            invalidateDistanceIndex(label_id);
+        }
+    }
+    m_subscriptions.removeEdge(from, to, m_vertices, m_reverse, m_labels);
+    return true;
+}
 
-    if (((from - 1) > m_vertices.size()) || ((to - 1) > m_vertices.size()))
+void GraphStore::deleteVertex(VertexId vertex)
+{
+    vertex = m_mapping.internal(vertex);
+    if (!isAlive(vertex))
     {
         throw std::runtime_error("Vertex does not exist");
     }
+    decompress();
+
+    // The sets are copied as removeEdge changes them.
+    for (VertexId to : std::vector<VertexId>(m_vertices[vertex - 1].begin(), m_vertices[vertex - 1].end()))
+    {
+        removeEdge(vertex, to);
+    }
+    for (VertexId from : std::vector<VertexId>(m_reverse[vertex - 1].begin(), m_reverse[vertex - 1].end()))
+    {
+        removeEdge(from, vertex);
+    }
+    for (LabelId label_id : m_labels.labelsOf(vertex))
+    {
+        m_labels.remove(vertex, label_id);
+        m_frozen_labels = nullptr;
+        invalidateDistanceIndex(label_id);
+        m_subscriptions.removeVertex(vertex, label_id, m_vertices, m_reverse, m_labels);
+    }
+
+    m_deleted.insert(vertex);
+    thaw();
+    ++m_label_generation;
+    trimDeleted();
+    m_subscriptions.notify(m_mapping);
+}
+
+bool GraphStore::containsVertex(VertexId vertex) const
+{
+    return isAlive(m_mapping.internal(vertex));
+}
+
+GraphMemoryUsage GraphStore::memoryUsage() const
+{
+    GraphMemoryUsage usage;
+    usage.adjacency = (m_vertices.capacity() + m_reverse.capacity()) * sizeof(NeighbourSet);
+    size_t heap_nodes = m_compressed ? 0 : (m_edge_count * 2);
+    if (const NodePool* pool = m_node_pool.get())
+    {
+        usage.adjacency += pool->reservedBytes();
+        usage.adjacency_free = pool->reservedBytes() - pool->usedBytes();
+        // The sets copied from another store keep their nodes on the global heap.
+        heap_nodes -= std::min(heap_nodes, pool->nodeCount());
+    }
+    usage.adjacency += heap_nodes * HeapNodeBytes;
+
+    if (m_compressed)
+    {
+        usage.frozen = m_compressed->memoryUsage() + m_compressed_reverse->memoryUsage();
+    }
+    if (m_frozen)
+    {
+        usage.frozen += m_frozen->memoryUsage() + m_frozen_reverse->memoryUsage();
+    }
+    if (m_compact)
+    {
+        usage.frozen += m_compact->memoryUsage() + m_compact_reverse->memoryUsage();
+    }
+    usage.weights = m_weights.memoryUsage();
+    usage.labels = m_labels.memoryUsage();
+    for (const ReachabilityIndex& index : m_reachability)
+    {
+        usage.indexes += index.memoryUsage();
+    }
+    for (const std::shared_ptr<const HubLabelIndex>& index : m_distance_indexes)
+    {
+        if (index)
+        {
+            usage.indexes += index->memoryUsage();
+        }
+    }
+    if (m_landmarks)
+    {
+        usage.indexes += m_landmarks->memoryUsage();
+    }
+    usage.indexes += m_subscriptions.memoryUsage();
+    usage.mapping = m_mapping.memoryUsage() + (m_deleted.size() * HeapNodeBytes);
+    return usage;
+}
+
+bool GraphStore::isAlive(VertexId vertex) const
+{
+    return ((vertex - 1) < idCount()) && (m_deleted.empty() || (m_deleted.count(vertex) == 0));
+}
+
+void GraphStore::decompress()
+{
+    if (m_compressed)
+    {
+        m_compressed->decode(m_vertices, m_node_pool.allocator<VertexId>());
+        m_compressed_reverse->decode(m_reverse, m_node_pool.allocator<VertexId>());
+        m_compressed = nullptr;
+        m_compressed_reverse = nullptr;
+    }
+}
+
+void GraphStore::thaw()
+{
+    m_frozen = nullptr;
+    m_frozen_reverse = nullptr;
+    m_compact = nullptr;
+    m_compact_reverse = nullptr;
+}
+
+std::vector<VertexMove> GraphStore::compact(size_t maxMoves)
+{
+    std::vector<VertexMove> moves;
+    std::vector<bool> moved_labels(m_labels.labelCount(), false);
+    if (m_deleted.empty())
+    {
+        return moves;
+    }
+    decompress();
+    trimDeleted();
+    bool moved = false;
+    for (size_t step = 0; (step < maxMoves) && !m_deleted.empty(); ++step)
+    {
+        const VertexId last = static_cast<VertexId>(m_vertices.size());
+        if (m_mapping.empty())
+        {
+            // Once the deleted vertices at the end are trimmed, the last vertex is alive and every hole is below it.
+            const VertexId hole = *m_deleted.begin();
+            m_deleted.erase(m_deleted.begin());
+            for (LabelId label_id : renumberVertex(last, hole))
+            {
+                moved_labels[label_id] = true;
+            }
+            moves.push_back(VertexMove{ last, hole });
+            m_subscriptions.moveEndpoint(last, hole);
+        }
+        else
+        {
+            // The last internal ID is freed, moving its vertex into the lowest hole if it is alive; the vertex keeps
+            // its external ID.
+            if (m_deleted.erase(last) == 0)
+            {
+                const VertexId hole = *m_deleted.begin();
+                m_deleted.erase(m_deleted.begin());
+                for (LabelId label_id : renumberVertex(last, hole))
+                {
+                    moved_labels[label_id] = true;
+                }
+                m_mapping.swapInternal(last, hole);
+            }
+            // Then the last external ID is freed: the vertex that has it takes the external ID of the freed slot.
+            const VertexId freed = m_mapping.external(last);
+            if (freed != last)
+            {
+                const VertexId vertex = m_mapping.internal(last);
+                m_mapping.assign(freed, vertex);
+                if (isAlive(vertex))
+                {
+                    moves.push_back(VertexMove{ last, freed });
+                    m_subscriptions.moveEndpoint(last, freed);
+                }
+            }
+            m_mapping.resize(last - 1);
+            m_frozen_mapping = nullptr;
+        }
+        m_vertices.pop_back();
+        m_reverse.pop_back();
+        moved = true;
+        trimDeleted();
+    }
+    if (!moved)
+    {
+        return moves;
+    }
+
+    ++m_edge_generation;
+    ++m_label_generation;
+    thaw();
+    m_frozen_labels = nullptr;
+    for (LabelId label_id = 0; label_id < moved_labels.size(); ++label_id)
+    {
+        if (!moved_labels[label_id])
+        {
+            continue;
+        }
+        invalidateDistanceIndex(label_id);
+        // The ranks of the index are per ID, so a vertex that changes ID needs the index built again.
+        if ((label_id < m_reachability.size()) && m_reachability[label_id].built())
+        {
+            m_reachability[label_id] = ReachabilityIndex(m_vertices, m_labels.vertices(label_id));
+            m_frozen_reachability = nullptr;
+        }
+    }
+    m_subscriptions.rebuild(m_vertices, m_labels, m_mapping);
+    m_subscriptions.notify(m_mapping);
+    return moves;
+}
+
+std::vector<LabelId> GraphStore::renumberVertex(VertexId oldId, VertexId newId)
+{
+    // A self-loop becomes a loop on the new ID.
+    NeighbourSet neighbours(m_node_pool.allocator<VertexId>());
+    std::vector<std::pair<VertexId, EdgeWeight>> weights;
+    for (VertexId to : m_vertices[oldId - 1])
+    {
+        const VertexId new_to = (to == oldId) ? newId : to;
+        const EdgeWeight weight = m_weights.weight(oldId, to);
+        if (weight != EdgeWeights::DefaultWeight)
+        {
+            m_weights.set(oldId, to, EdgeWeights::DefaultWeight);
+            weights.emplace_back(new_to, weight);
+        }
+        if (to != oldId)
+        {
+            m_reverse[to - 1].erase(oldId);
+            m_reverse[to - 1].insert(newId);
+        }
+        neighbours.insert(new_to);
+    }
+
+    NeighbourSet predecessors(m_node_pool.allocator<VertexId>());
+    for (VertexId from : m_reverse[oldId - 1])
+    {
+        if (from == oldId)
+        {
+            predecessors.insert(newId);
+            continue;
+        }
+        const EdgeWeight weight = m_weights.weight(from, oldId);
+        if (weight != EdgeWeights::DefaultWeight)
+        {
+            m_weights.set(from, oldId, EdgeWeights::DefaultWeight);
+            m_weights.set(from, newId, weight);
+        }
+        m_vertices[from - 1].erase(oldId);
+        m_vertices[from - 1].insert(newId);
+        predecessors.insert(from);
+    }
+
+    m_vertices[newId - 1].swap(neighbours);
+    m_reverse[newId - 1].swap(predecessors);
+    m_vertices[oldId - 1].clear();
+    m_reverse[oldId - 1].clear();
+    for (const std::pair<VertexId, EdgeWeight>& weight : weights)
+    {
+        m_weights.set(newId, weight.first, weight.second);
+    }
+
+    const std::vector<LabelId> label_ids = m_labels.labelsOf(oldId);
+    for (LabelId label_id : label_ids)
+    {
+        m_labels.remove(oldId, label_id);
+        m_labels.add(newId, label_id);
+    }
+    return label_ids;
+}
+
+void GraphStore::trimDeleted()
+{
+    bool trimmed = false;
+    while (!m_deleted.empty() && (*m_deleted.rbegin() == m_vertices.size()) &&
+        (m_mapping.external(m_vertices.size()) == m_vertices.size()))
+    {
+        m_deleted.erase(std::prev(m_deleted.end()));
+        m_vertices.pop_back();
+        m_reverse.pop_back();
+        trimmed = true;
+    }
+    if (!trimmed)
+    {
+        return;
+    }
 
-    if (m_labels.at(label).count(from) == 0)
+    thaw();
+    ++m_label_generation;
+    // The capacity is only given back once it is twice what is used, so that a graph whose size goes up and down
+    // around the same value doesn't reallocate every time.
+    if ((m_vertices.size() * 2) < m_vertices.capacity())
     {
-        return std::vector<VertexId>();
+        m_vertices.shrink_to_fit();
+        m_reverse.shrink_to_fit();
     }
-    
-    // This as heap implementation based on std::set. We use a custom class, VertexAndScore, with a custom operator< to
-    // make sure the element with the lowest score is at the beginning of the set.
-    std::set<VertexAndScore> open_set;
-    open_set.insert(VertexAndScore(from, 0));
-    
-    std::map<VertexId, VertexId> came_from;
+    m_weights.shrink(m_vertices.size());
+    m_mapping.resize(m_vertices.size());
+    m_frozen_mapping = nullptr;
+}
 
-    std::map<VertexId, int> g_score;
-    g_score[from] = 0;
+void GraphStore::reorder(VertexOrder order)
+{
+    decompress();
+    std::vector<VertexId> sequence = OrderVertices(m_vertices, m_reverse, order);
+    // The deleted vertices go last, where trimDeleted() and compact() look for them.
+    std::stable_partition(sequence.begin(), sequence.end(), [&](VertexId vertex) { return isAlive(vertex); });
+    std::vector<VertexId> new_ids(sequence.size());
+    for (size_t i = 0; i < sequence.size(); ++i)
+    {
+        new_ids[sequence[i] - 1] = static_cast<VertexId>(i + 1);
+    }
+    renumberVertices(new_ids);
+    m_subscriptions.notify(m_mapping);
+}
 
-    while (!open_set.empty())
+void GraphStore::renumberVertices(const std::vector<VertexId>& newIds)
+{
+    // The sets are built from sorted ranges, which is linear, and each old set is released once copied so that its
+    // nodes are reused by the next new sets instead of doubling the memory.
+    auto renumber = [&](AdjacencySets& sets)
     {
-        VertexId current_vertex = cheapestVertex(open_set);
-        if (current_vertex == to)
+        AdjacencySets renumbered;
+        renumbered.reserve(sets.size());
+        for (size_t i = 0; i < sets.size(); ++i)
         {
-            return ReconstructPath(came_from, current_vertex);
+            renumbered.emplace_back(m_node_pool.allocator<VertexId>());
         }
-        
-        for (const VertexId& neighbour : m_vertices[current_vertex-1])
+        std::vector<VertexId> neighbours;
+        for (size_t i = 0; i < sets.size(); ++i)
         {
-            if (m_labels.at(label).count(neighbour) == 0)
+            neighbours.clear();
+            for (VertexId neighbour : sets[i])
             {
-                continue;
+                neighbours.push_back(newIds[neighbour - 1]);
             }
+            std::sort(neighbours.begin(), neighbours.end());
+            sets[i].clear();
+            renumbered[newIds[i] - 1].insert(neighbours.begin(), neighbours.end());
+        }
+        sets.swap(renumbered);
+    };
+    renumber(m_reverse);
 
-            int tentative_g_score = Cost(g_score, current_vertex) + 1;
-            if (tentative_g_score < Cost(g_score, neighbour))
+    // The weights are read from the old numbering before m_vertices is renumbered.
+    if (!m_weights.empty())
+    {
+        EdgeWeights weights;
+        for (VertexId from = 1; from <= m_vertices.size(); ++from)
+        {
+            for (VertexId to : m_vertices[from - 1])
             {
-                came_from[neighbour] = current_vertex;
-                g_score[neighbour] = tentative_g_score;
-                open_set.insert(VertexAndScore(neighbour, tentative_g_score));
+                const EdgeWeight weight = m_weights.weight(from, to);
+                if (weight != EdgeWeights::DefaultWeight)
+                {
+                    weights.set(newIds[from - 1], newIds[to - 1], weight);
+                }
             }
         }
+        m_weights = std::move(weights);
+    }
+    renumber(m_vertices);
+
+    std::set<VertexId> deleted;
+    for (VertexId vertex : m_deleted)
+    {
+        deleted.insert(newIds[vertex - 1]);
+    }
+    m_deleted.swap(deleted);
+    m_labels.renumber(newIds);
+    m_mapping.renumber(newIds);
+
+    ++m_edge_generation;
+    ++m_label_generation;
+    thaw();
+    m_frozen_labels = nullptr;
+    m_frozen_mapping = nullptr;
+    for (LabelId label_id = 0; label_id < m_reachability.size(); ++label_id)
+    {
+        if (m_reachability[label_id].built())
+        {
+            m_reachability[label_id] = ReachabilityIndex(m_vertices, m_labels.vertices(label_id));
+            m_frozen_reachability = nullptr;
+        }
+    }
+    for (LabelId label_id = 0; label_id < m_distance_indexes.size(); ++label_id)
+    {
+        invalidateDistanceIndex(label_id);
+    }
+    m_subscriptions.rebuild(m_vertices, m_labels, m_mapping);
+}
+
+void GraphStore::addLabel(VertexId vertex, const std::string& label)
+{
+    vertex = m_mapping.internal(vertex);
+    if (!isAlive(vertex))
+    {
+        throw std::runtime_error("Vertex does not exist");
     }
 
-    return std::vector<VertexId>();
+    const LabelId label_id = m_labels.intern(label);
+    if (m_labels.add(vertex, label_id))
+    {
+        m_frozen_labels = nullptr;
+        ++m_label_generation;
+        invalidateDistanceIndex(label_id);
+        if ((label_id < m_reachability.size()) && m_reachability[label_id].built())
+        {
+            decompress();
+            m_reachability[label_id].addVertex(vertex, m_vertices, m_reverse, m_labels.vertices(label_id));
+            m_frozen_reachability = nullptr;
+        }
+        if (!m_subscriptions.empty())
+        {
+            decompress();
+            m_subscriptions.addVertex(vertex, label_id, m_vertices, m_reverse, m_labels);
+            m_subscriptions.notify(m_mapping);
+        }
+    }
+}
+
+void GraphStore::addLabelToVertices(const std::string& label, const std::vector<VertexId>& vertices)
+{
+    std::vector<VertexId> sorted(vertices);
+    for (VertexId& vertex : sorted)
+    {
+        vertex = m_mapping.internal(vertex);
+        if (!isAlive(vertex))
+        {
+            throw std::runtime_error("Vertex does not exist");
+        }
+    }
+
+    // Adding the vertices in increasing order appends them at the end of the bitmap chunks instead of inserting them
+    // in the middle.
+    std::sort(sorted.begin(), sorted.end());
+
+    const LabelId label_id = m_labels.intern(label);
+    const VertexBitmap& labelled = m_labels.vertices(label_id);
+    ReachabilityIndex* reachability = ((label_id < m_reachability.size()) && m_reachability[label_id].built()) ?
+        &m_reachability[label_id] : nullptr;
+    if ((reachability != nullptr) || !m_subscriptions.empty())
+    {
+        decompress();
+    }
+    // As with createEdges, a batch that labels a good part of the vertices is cheaper to index from scratch.
+    const bool rebuild = (sorted.size() * 4) > labelled.size();
+    bool changed = false;
+    for (VertexId vertex : sorted)
+    {
+        if (m_labels.add(vertex, label_id))
+        {
+            changed = true;
+            if ((reachability != nullptr) && !rebuild)
+            {
+                reachability->addVertex(vertex, m_vertices, m_reverse, labelled);
+            }
+            if (!rebuild)
+            {
+                m_subscriptions.addVertex(vertex, label_id, m_vertices, m_reverse, m_labels);
+            }
+        }
+    }
+    if (changed)
+    {
+        m_frozen_labels = nullptr;
+        ++m_label_generation;
+        invalidateDistanceIndex(label_id);
+        if (reachability != nullptr)
+        {
+            if (rebuild)
+            {
+                *reachability = ReachabilityIndex(m_vertices, labelled);
+            }
+            m_frozen_reachability = nullptr;
+        }
+        if (rebuild)
+        {
+            m_subscriptions.rebuild(label_id, m_vertices, m_labels, m_mapping);
+        }
+        m_subscriptions.notify(m_mapping);
+    }
+}
+
+void GraphStore::removeLabel(VertexId vertex, const std::string& label)
+{
+    vertex = m_mapping.internal(vertex);
+    if (!isAlive(vertex))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+
+    LabelId label_id;
+    if (m_labels.find(label, label_id))
+    {
+        if (m_labels.remove(vertex, label_id))
+        {
+            m_frozen_labels = nullptr;
+            ++m_label_generation;
+            invalidateDistanceIndex(label_id);
+            if (!m_subscriptions.empty())
+            {
+                decompress();
+                m_subscriptions.removeVertex(vertex, label_id, m_vertices, m_reverse, m_labels);
+                m_subscriptions.notify(m_mapping);
+            }
+        }
+    }
+}
+
+std::vector<std::string> GraphStore::labels(VertexId vertex) const
+{
+    vertex = m_mapping.internal(vertex);
+    if (!isAlive(vertex))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+
+    std::vector<std::string> names;
+    for (LabelId label_id : m_labels.labelsOf(vertex))
+    {
+        names.push_back(m_labels.name(label_id));
+    }
+    return names;
+}
+
+std::vector<VertexId> GraphStore::shortestPath(VertexId from, VertexId to, const std::string& label) const
+{
+    return shortestPath(from, to, label, QueryOptions());
+}
+
+std::vector<VertexId> GraphStore::shortestPath(VertexId from, VertexId to, const std::string& label,
+    const QueryOptions& options) const
+{
+    // The convenience overloads share one context per thread so they don't allocate per query either.
+    thread_local QueryContext context;
+    std::vector<VertexId> path;
+    shortestPath(from, to, label, options, context, path);
+    return path;
+}
+
+bool GraphStore::shortestPath(VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+    QueryContext& context, std::vector<VertexId>& path) const
+{
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    // The searches only check that the IDs are in range; a deleted vertex has no edges or labels but is an error too.
+    if (!m_deleted.empty() && (!isAlive(from) || !isAlive(to)))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+
+    const search::Indexes indexes = { &m_reachability, landmarks().get(), &m_distance_indexes };
+    auto run = [&](const auto& forward, const auto& reverse)
+    {
+        return search::ShortestPath(forward, reverse, m_edge_count, m_labels, indexes, from, to, label, options,
+            context, path);
+    };
+    const bool found = m_compressed ? run(*m_compressed, *m_compressed_reverse) :
+        m_compact ? run(*m_compact, *m_compact_reverse) : m_frozen ? run(*m_frozen, *m_frozen_reverse) :
+        run(search::SetAdjacency(m_vertices, &m_weights), search::SetAdjacency(m_reverse, nullptr));
+    m_mapping.toExternal(path);
+    return found;
+}
+
+std::vector<VertexId> GraphStore::shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate,
+    const QueryOptions& options) const
+{
+    thread_local QueryContext context;
+    std::vector<VertexId> path;
+    shortestPath(from, to, predicate, options, context, path);
+    return path;
+}
+
+bool GraphStore::shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate,
+    const QueryOptions& options, QueryContext& context, std::vector<VertexId>& path) const
+{
+    from = m_mapping.internal(from);
+    to = m_mapping.internal(to);
+    if (!m_deleted.empty() && (!isAlive(from) || !isAlive(to)))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+
+    const std::shared_ptr<const MaskCache::Mask> mask = internalMask(predicate);
+    const DenseVertexSet vertices(mask->data(), mask->size());
+    auto run = [&](const auto& forward, const auto& reverse)
+    {
+        return search::ShortestPathWithin(forward, reverse, m_edge_count, vertices, landmarks().get(), from, to,
+            options, context, path);
+    };
+    const bool found = m_compressed ? run(*m_compressed, *m_compressed_reverse) :
+        m_compact ? run(*m_compact, *m_compact_reverse) : m_frozen ? run(*m_frozen, *m_frozen_reverse) :
+        run(search::SetAdjacency(m_vertices, &m_weights), search::SetAdjacency(m_reverse, nullptr));
+    m_mapping.toExternal(path);
+    return found;
+}
+
+std::shared_ptr<const MaskCache::Mask> GraphStore::vertexMask(const LabelPredicate& predicate) const
+{
+    std::shared_ptr<const MaskCache::Mask> mask = internalMask(predicate);
+    if (m_mapping.empty())
+    {
+        return mask;
+    }
+
+    std::shared_ptr<MaskCache::Mask> external = std::make_shared<MaskCache::Mask>(mask->size(), 0);
+    for (VertexId vertex = 1; vertex <= idCount(); ++vertex)
+    {
+        if (((*mask)[vertex >> 6] >> (vertex & 63)) & 1)
+        {
+            const VertexId external_id = m_mapping.external(vertex);
+            (*external)[external_id >> 6] |= uint64_t(1) << (external_id & 63);
+        }
+    }
+    return external;
+}
+
+std::shared_ptr<const MaskCache::Mask> GraphStore::internalMask(const LabelPredicate& predicate) const
+{
+    return m_masks.mask(predicate, m_labels, idCount(), m_label_generation);
+}
+
+std::vector<std::vector<VertexId>> GraphStore::shortestPaths(const std::vector<PathQuery>& queries,
+    ThreadPool& pool, const QueryOptions& options) const
+{
+    // Queries are cheap compared to handing chunks around but their cost varies a lot, so chunks are kept small
+    // enough for stealing to balance the load.
+    const size_t grain_size = 16;
+
+    // The queries of a batch run at the same time so they can't share one stats object or outcome.
+    QueryOptions query_options = options;
+    query_options.stats = nullptr;
+    query_options.outcome = nullptr;
+
+    std::vector<std::vector<VertexId>> paths(queries.size());
+    pool.parallelFor(queries.size(), grain_size, [&](size_t begin, size_t end)
+    {
+        // shortestPath keeps one context per thread, so each worker reuses its own.
+        for (size_t i = begin; i < end; ++i)
+        {
+            paths[i] = shortestPath(queries[i].from, queries[i].to, queries[i].label, query_options);
+        }
+    });
+    return paths;
+}
+
+std::vector<std::vector<VertexId>> GraphStore::shortestPaths(VertexId from, const std::vector<VertexId>& targets,
+    const std::string& label) const
+{
+    const std::vector<VertexId> internal_from = internalIds({ from });
+    const std::vector<VertexId> internal_targets = internalIds(targets);
+    std::vector<std::vector<VertexId>> paths;
+    LabelId label_id;
+    if (!m_labels.find(label, label_id))
+    {
+        paths.resize(targets.size());
+        return paths;
+    }
+
+    thread_local QueryContext context;
+    auto run = [&](const auto& adjacency)
+    {
+        search::OneToManyBfs(adjacency, internal_from[0], internal_targets, m_labels.vertices(label_id), context,
+            paths);
+    };
+    if (m_compressed)
+    {
+        run(*m_compressed);
+    }
+    else if (m_compact)
+    {
+        run(*m_compact);
+    }
+    else if (m_frozen)
+    {
+        run(*m_frozen);
+    }
+    else
+    {
+        run(search::SetAdjacency(m_vertices, nullptr));
+    }
+    for (std::vector<VertexId>& path : paths)
+    {
+        m_mapping.toExternal(path);
+    }
+    return paths;
+}
+
+std::vector<std::vector<uint32_t>> GraphStore::distanceMatrix(const std::vector<VertexId>& sources,
+    const std::vector<VertexId>& targets, const std::string& label, ThreadPool* pool) const
+{
+    const std::vector<VertexId> internal_sources = internalIds(sources);
+    const std::vector<VertexId> internal_targets = internalIds(targets);
+    auto run = [&](const auto& forward, const auto& reverse)
+    {
+        return search::DistanceMatrix(forward, reverse, m_labels, internal_sources, internal_targets, label, pool);
+    };
+    return m_compressed ? run(*m_compressed, *m_compressed_reverse) : m_compact ? run(*m_compact, *m_compact_reverse) :
+        m_frozen ? run(*m_frozen, *m_frozen_reverse) :
+        run(search::SetAdjacency(m_vertices, nullptr), search::SetAdjacency(m_reverse, nullptr));
+}
+
+std::vector<VertexId> GraphStore::internalIds(const std::vector<VertexId>& vertices) const
+{
+    std::vector<VertexId> ids;
+    ids.reserve(vertices.size());
+    for (VertexId vertex : vertices)
+    {
+        ids.push_back(m_mapping.internal(vertex));
+        if (!isAlive(ids.back()))
+        {
+            throw std::runtime_error("Vertex does not exist");
+        }
+    }
+    return ids;
+}
+
+SubscriptionId GraphStore::subscribe(VertexId from, VertexId to, const std::string& label, PathCallback callback)
+{
+    if (!isAlive(m_mapping.internal(from)) || !isAlive(m_mapping.internal(to)))
+    {
+        throw std::runtime_error("Vertex does not exist");
+    }
+    const LabelId label_id = m_labels.intern(label);
+    decompress();
+    return m_subscriptions.add(from, to, label_id, std::move(callback), m_vertices, m_labels, m_mapping);
+}
+
+bool GraphStore::unsubscribe(SubscriptionId subscription)
+{
+    return m_subscriptions.remove(subscription);
+}
+
+std::vector<VertexId> GraphStore::subscribedPath(SubscriptionId subscription) const
+{
+    return m_subscriptions.path(subscription);
+}
+
+void GraphStore::indexReachability(const std::string& label)
+{
+    const LabelId label_id = m_labels.intern(label);
+    if (label_id >= m_reachability.size())
+    {
+        m_reachability.resize(label_id + 1);
+    }
+    decompress();
+    m_reachability[label_id] = ReachabilityIndex(m_vertices, m_labels.vertices(label_id));
+    m_frozen_reachability = nullptr;
+}
+
+void GraphStore::dropReachabilityIndex(const std::string& label)
+{
+    LabelId label_id;
+    if (m_labels.find(label, label_id) && (label_id < m_reachability.size()))
+    {
+        m_reachability[label_id] = ReachabilityIndex();
+        m_frozen_reachability = nullptr;
+    }
+}
+
+void GraphStore::indexDistances(const std::string& label, ThreadPool* pool)
+{
+    const LabelId label_id = m_labels.intern(label);
+    if (label_id >= m_distance_indexes.size())
+    {
+        m_distance_indexes.resize(label_id + 1);
+    }
+    decompress();
+    m_distance_indexes[label_id] = std::make_shared<HubLabelIndex>(m_vertices, m_reverse, m_labels.vertices(label_id),
+        pool);
+    m_frozen_distance_indexes = nullptr;
+}
+
+void GraphStore::dropDistanceIndex(const std::string& label)
+{
+    LabelId label_id;
+    if (m_labels.find(label, label_id))
+    {
+        invalidateDistanceIndex(label_id);
+    }
+}
+
+std::shared_ptr<const HubLabelIndex> GraphStore::distanceIndex(const std::string& label) const
+{
+    LabelId label_id;
+    if (m_labels.find(label, label_id) && (label_id < m_distance_indexes.size()))
+    {
+        return m_distance_indexes[label_id];
+    }
+    return nullptr;
+}
+
+void GraphStore::invalidateDistanceIndex(LabelId labelId)
+{
+    if ((labelId < m_distance_indexes.size()) && m_distance_indexes[labelId])
+    {
+        m_distance_indexes[labelId] = nullptr;
+        m_frozen_distance_indexes = nullptr;
+    }
+}
+
+void GraphStore::buildLandmarks(const LandmarkOptions& options)
+{
+    freeze();
+    if (m_compressed)
+    {
+        // The tables are built from a CSR copy that only lives as long as the build.
+        m_landmarks = std::make_shared<LandmarkIndex>(*m_compressed->toCsr(), *m_compressed_reverse->toCsr(), options,
+            m_edge_generation);
+        return;
+    }
+    if (m_compact)
+    {
+        m_landmarks = std::make_shared<LandmarkIndex>(*m_compact, *m_compact_reverse, options, m_edge_generation);
+        return;
+    }
+    m_landmarks = std::make_shared<LandmarkIndex>(*m_frozen, *m_frozen_reverse, options, m_edge_generation);
+}
+
+std::future<std::shared_ptr<const LandmarkIndex>> GraphStore::buildLandmarksAsync(const LandmarkOptions& options)
+{
+    freeze();
+    // The thread only reads the frozen copy, which stays valid whatever happens to the store in the meantime.
+    std::shared_ptr<const CsrAdjacency> forward = m_frozen;
+    std::shared_ptr<const CsrAdjacency> reverse = m_frozen_reverse;
+    std::shared_ptr<const CompressedAdjacency> compressed = m_compressed;
+    std::shared_ptr<const CompressedAdjacency> compressed_reverse = m_compressed_reverse;
+    std::shared_ptr<const CompactCsrAdjacency> compact = m_compact;
+    std::shared_ptr<const CompactCsrAdjacency> compact_reverse = m_compact_reverse;
+    const uint64_t generation = m_edge_generation;
+    return std::async(std::launch::async,
+        [forward, reverse, compressed, compressed_reverse, compact, compact_reverse, options, generation]()
+    {
+        if (compact)
+        {
+            return std::shared_ptr<const LandmarkIndex>(std::make_shared<LandmarkIndex>(*compact, *compact_reverse,
+                options, generation));
+        }
+        return std::shared_ptr<const LandmarkIndex>(std::make_shared<LandmarkIndex>(
+            forward ? *forward : *compressed->toCsr(), reverse ? *reverse : *compressed_reverse->toCsr(), options,
+            generation));
+    });
+}
+
+bool GraphStore::setLandmarks(std::shared_ptr<const LandmarkIndex> landmarks)
+{
+    if (!landmarks || (landmarks->generation() != m_edge_generation))
+    {
+        m_landmarks = nullptr;
+        return false;
+    }
+    m_landmarks = std::move(landmarks);
+    return true;
+}
+
+std::shared_ptr<const LandmarkIndex> GraphStore::landmarks() const
+{
+    if (m_landmarks && (m_landmarks->generation() == m_edge_generation))
+    {
+        return m_landmarks;
+    }
+    return nullptr;
+}
+
+void GraphStore::setMetricsEnabled(bool enabled)
+{
+    QueryMetrics::global().setEnabled(enabled);
+}
+
+MetricsSnapshot GraphStore::metrics()
+{
+    return QueryMetrics::global().snapshot();
+}
+
+void GraphStore::freeze()
+{
+    if (m_storage == AdjacencyStorage::Compressed)
+    {
+        if (!m_compressed)
+        {
+            m_compressed = std::make_shared<CompressedAdjacency>(m_vertices, m_weights);
+            m_compressed_reverse = std::make_shared<CompressedAdjacency>(m_reverse, EdgeWeights());
+            AdjacencySets().swap(m_vertices);
+            AdjacencySets().swap(m_reverse);
+            thaw();
+        }
+        return;
+    }
+    if ((m_storage == AdjacencyStorage::CompactSets) && (m_vertices.size() <= UINT32_MAX))
+    {
+        if (!m_compact)
+        {
+            m_compact = std::make_shared<CompactCsrAdjacency>(m_vertices, m_weights);
+            m_compact_reverse = std::make_shared<CompactCsrAdjacency>(m_reverse);
+        }
+        return;
+    }
+    if (!m_frozen)
+    {
+        m_frozen = std::make_shared<CsrAdjacency>(m_vertices, m_weights);
+        m_frozen_reverse = std::make_shared<CsrAdjacency>(m_reverse);
+    }
+}
+
+bool GraphStore::isFrozen() const
+{
+    return (m_frozen != nullptr) || (m_compact != nullptr) || (m_compressed != nullptr);
+}
+
+std::shared_ptr<const CsrAdjacency> GraphStore::snapshot() const
+{
+    return m_frozen;
+}
+
+std::shared_ptr<const CompressedAdjacency> GraphStore::compressedSnapshot() const
+{
+    return m_compressed;
+}
+
+std::shared_ptr<const CompactCsrAdjacency> GraphStore::compactSnapshot() const
+{
+    return m_compact;
+}
+
+std::unique_ptr<const GraphVersion> GraphStore::createVersion()
+{
+    freeze();
+    if (!m_frozen_labels)
+    {
+        m_frozen_labels = std::make_shared<LabelIndex>(m_labels);
+    }
+    if (!m_frozen_reachability && !m_reachability.empty())
+    {
+        m_frozen_reachability = std::make_shared<std::vector<ReachabilityIndex>>(m_reachability);
+    }
+    if (!m_frozen_distance_indexes && !m_distance_indexes.empty())
+    {
+        m_frozen_distance_indexes =
+            std::make_shared<std::vector<std::shared_ptr<const HubLabelIndex>>>(m_distance_indexes);
+    }
+    if (!m_frozen_mapping && !m_mapping.empty())
+    {
+        m_frozen_mapping = std::make_shared<VertexMapping>(m_mapping);
+    }
+    if (m_compressed)
+    {
+        return std::unique_ptr<const GraphVersion>(new GraphVersion(m_compressed, m_compressed_reverse,
+            m_frozen_labels, m_frozen_reachability, m_frozen_distance_indexes, landmarks(), m_frozen_mapping));
+    }
+    if (!m_frozen)
+    {
+        // The versions read full width IDs, so a store that searches a compact copy builds this one for them too.
+        m_frozen = std::make_shared<CsrAdjacency>(m_vertices, m_weights);
+        m_frozen_reverse = std::make_shared<CsrAdjacency>(m_reverse);
+    }
+    return std::unique_ptr<const GraphVersion>(new GraphVersion(m_frozen, m_frozen_reverse, m_frozen_labels,
+        m_frozen_reachability, m_frozen_distance_indexes, landmarks(), m_frozen_mapping));
+}
+
+void GraphStore::save(const std::string& path) const
+{
+    save(path, 0);
+}
+
+void GraphStore::save(const std::string& path, uint64_t sequence) const
+{
+    if (!m_mapping.empty())
+    {
+        // The files hold the vertices under the IDs callers use.
+        externalCopy().save(path, sequence);
+        return;
+    }
+    if (m_compressed)
+    {
+        SaveSnapshot(path, *m_compressed->toCsr(), *m_compressed_reverse->toCsr(), m_labels, sequence);
+        return;
+    }
+    if (m_frozen)
+    {
+        SaveSnapshot(path, *m_frozen, *m_frozen_reverse, m_labels, sequence);
+        return;
+    }
+    SaveSnapshot(path, CsrAdjacency(m_vertices), CsrAdjacency(m_reverse), m_labels, sequence);
+}
+
+std::unique_ptr<const GraphVersion> GraphStore::open(const std::string& path, bool verifyChecksum)
+{
+    return OpenSnapshot(path, verifyChecksum);
+}
+
+GraphStore GraphStore::externalCopy() const
+{
+    GraphStore graph;
+    graph.createVertices(idCount());
+    std::vector<Edge> edges;
+    auto add = [&](VertexId from, const auto& neighbours)
+    {
+        for (VertexId to : neighbours)
+        {
+            edges.emplace_back(m_mapping.external(from), m_mapping.external(to));
+        }
+    };
+    for (VertexId from = 1; from <= idCount(); ++from)
+    {
+        if (m_compressed)
+        {
+            add(from, m_compressed->neighbours(from));
+        }
+        else
+        {
+            add(from, m_vertices[from - 1]);
+        }
+    }
+    graph.createEdges(edges, nullptr);
+    std::vector<VertexId> vertices;
+    for (LabelId label_id = 0; label_id < m_labels.labelCount(); ++label_id)
+    {
+        vertices.clear();
+        m_labels.vertices(label_id).forEach([&](VertexId vertex) { vertices.push_back(m_mapping.external(vertex)); });
+        graph.addLabelToVertices(m_labels.name(label_id), vertices);
+    }
+    return graph;
+}
+
+GraphStore GraphStore::load(const std::string& path, uint64_t* sequence)
+{
+    GraphStore graph;
+    LoadSnapshot(path, graph, sequence);
+    return graph;
 }
@@ -1,20 +1,113 @@
 #ifndef GRAPHSTORE_H
 #define GRAPHSTORE_H
 
+#include "compressedadjacency.h"
+#include "csradjacency.h"
+#include "edgeweights.h"
+#include "graphversion.h"
+#include "hublabelindex.h"
+#include "labelindex.h"
+#include "labelpredicate.h"
+#include "landmarkindex.h"
+#include "nodepool.h"
+#include "pathsubscriptions.h"
+#include "querycontext.h"
+#include "querymetrics.h"
+#include "queryoptions.h"
+#include "reachabilityindex.h"
+#include "threadpool.h"
+#include "types.h"
+#include "vertexmapping.h"
+#include "vertexorder.h"
+#include <cstdint>
+#include <future>
+#include <memory>
 #include <set>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
-// The ID of a vertex in the graph.
-// This is a positive integer. 0 represents an invalid vertex.
-typedef size_t VertexId;
+/// One shortest path query of a batch, see GraphStore::shortestPaths.
+struct PathQuery
+{
+    /// The ID of the source vertex.
+    VertexId from;
+    /// The ID of the destination vertex.
+    VertexId to;
+    /// The label that needs to be present on the vertices in the path.
+    std::string label;
+};
+
+/// A vertex given a new ID by GraphStore::compact.
+struct VertexMove
+{
+    /// The ID the vertex had before.
+    VertexId old_id;
+    /// The ID the vertex has now.
+    VertexId new_id;
+};
+
+/// The memory held by a GraphStore, in bytes, see GraphStore::memoryUsage.
+struct GraphMemoryUsage
+{
+    /// The sets of neighbours, both ways: the sets themselves and the slabs of their pool, or the estimated heap
+    /// blocks of their nodes when they don't come from the pool.
+    size_t adjacency = 0;
+    /// The part of adjacency that is free nodes and unused slab space, left by deleted edges and kept for new ones.
+    size_t adjacency_free = 0;
+    /// The frozen CSR copies or the compressed edges.
+    size_t frozen = 0;
+    /// The weights of the edges.
+    size_t weights = 0;
+    /// The label bitmaps.
+    size_t labels = 0;
+    /// The reachability indexes, the distance indexes, the landmark tables and the trees of the subscriptions.
+    size_t indexes = 0;
+    /// The mapping between external and internal IDs and the deleted IDs.
+    size_t mapping = 0;
+
+    /// Returns the sum of the parts.
+    size_t total() const { return adjacency + frozen + weights + labels + indexes + mapping; }
+};
+
+/// How a GraphStore keeps its edges between mutations.
+enum class AdjacencyStorage
+{
+    /// A std::set of neighbours per vertex, both ways, and a CSR copy once frozen. Every mutation is cheap, at
+    /// the cost of a tree node of about 40 bytes per edge and direction.
+    Sets,
+    /// A CompressedAdjacency, both ways, which the searches decode as they go. It takes about 1 byte per edge and
+    /// direction when neighbours have close IDs, see reorder(), up to 3 or 4 when they are spread over a large graph,
+    /// plus 5 bytes per vertex. createVertices() and createEdges() add to it directly. The other mutations of the
+    /// edges and the indexes that need them decode it back into sets, which stay until freeze() compresses them
+    /// again. Meant for graphs that are loaded in bulk and then mostly queried.
+    Compressed,
+    /// Like Sets, but the CSR copy the searches read once frozen is a CompactCsrAdjacency: 32-bit IDs, 4 bytes per
+    /// edge and direction instead of 8. createVersion() builds the full width copy the versions need next to it. A
+    /// store with 2^32 IDs or more freezes as with Sets.
+    CompactSets
+};
 
 /// Class that stores a graph.
 class GraphStore
 {
 public:
-    /// Create a new vertex and return its ID.
+    /// The distance distanceMatrix() gives to the pairs of vertices without a path.
+    static const uint32_t Unreachable = UINT32_MAX;
+
+    /// Create an empty graph that stores its edges as sets.
+    GraphStore();
+
+    /// Create an empty graph that stores its edges as given.
+    explicit GraphStore(AdjacencyStorage storage);
+
+    /// Same as above, choosing where the nodes of the sets of neighbours come from.
+    /// @param poolNodes If true, from slabs owned by the store, see NodePool: the nodes are allocated and freed
+    /// without locking, next to each other, and counted by memoryUsage(). If false, from the global heap.
+    GraphStore(AdjacencyStorage storage, bool poolNodes);
+
+    /// Create a new vertex and return its ID. An ID freed by deleteVertex() is reused, if there is one: the lowest
+    /// unless the store was reordered.
     VertexId createVertex();
 
     /// Create an edge between two vertices.
@@ -23,16 +116,102 @@ public:
     /// @throws std::runtime_error if either vertex does not exist.
     void createEdge(VertexId from, VertexId to);
 
+    /// Create an edge with a weight, or change the weight of an existing edge. Only SearchAlgorithm::Dijkstra looks
+    /// at the weights; the other algorithms count edges. Edges created without a weight weigh 1.
+    /// @param from The ID of the source vertex.
+    /// @param to The ID of the destination vertex.
+    /// @param weight The weight of the edge.
+    /// @throws std::runtime_error if either vertex does not exist or the weight is negative or not finite.
+    void createEdge(VertexId from, VertexId to, EdgeWeight weight);
+
+    /// Returns the weight of an edge.
+    /// @throws std::runtime_error if the edge does not exist.
+    EdgeWeight edgeWeight(VertexId from, VertexId to) const;
+
+    /// Create several vertices at once.
+    /// @param count The number of vertices to create.
+    /// @returns The ID of the first new vertex. The new vertices have consecutive IDs.
+    VertexId createVertices(size_t count);
+
+    /// Create many edges at once. The edges are sorted and deduplicated and then added vertex by vertex, which is much
+    /// faster than calling createEdge for each of them. If any vertex does not exist, no edge is created.
+    /// @param edges The (from, to) pairs of vertex IDs of the edges.
+    /// @param pool The threads used to sort the edges and fill the adjacency, or nullptr to do it on the calling
+    /// thread.
+    /// @throws std::runtime_error if any vertex does not exist.
+    void createEdges(const std::vector<std::pair<VertexId, VertexId>>& edges, ThreadPool* pool);
+
+    /// Delete an edge and its weight. The reachability indexes stay correct but less selective, as when a label is
+    /// removed; the distance index of a label both vertices have goes stale and the landmark tables are dropped.
+    /// @param from The ID of the source vertex.
+    /// @param to The ID of the destination vertex.
+    /// @throws std::runtime_error if either vertex does not exist.
+    /// @returns false if there was no such edge.
+    bool deleteEdge(VertexId from, VertexId to);
+
+    /// Delete a vertex with its edges and labels. Its ID becomes a tombstone: every method given it throws as for an
+    /// ID that was never created, until createVertex() hands it out again. createVertices() always appends, so that
+    /// the IDs it returns are consecutive. Deleting the vertex with the highest ID shrinks the ID space; the holes
+    /// left by the others stay until they are reused or compact() fills them.
+    /// @throws std::runtime_error if the vertex does not exist.
+    void deleteVertex(VertexId vertex);
+
+    /// Returns true if a vertex was created and not deleted since.
+    bool containsVertex(VertexId vertex) const;
+
+    /// Returns the number of vertices, not counting the deleted ones.
+    size_t vertexCount() const { return idCount() - m_deleted.size(); }
+
+    /// Returns the number of edges.
+    size_t edgeCount() const { return m_edge_count; }
+
+    /// Returns the memory held by the store, by part. The copies shared with the versions are counted, and the tree
+    /// nodes that don't come from the pool are estimated.
+    GraphMemoryUsage memoryUsage() const;
+
+    /// Fill up to maxMoves of the holes left by deleted vertices with the vertices at the end of the ID space, lowest
+    /// hole first, and release the memory of the IDs freed at the end. A call with maxMoves at least the number of
+    /// deleted vertices leaves the IDs dense, 1 to vertexCount(). Each call costs the edges of the vertices it moves,
+    /// so a writer can run it a little at a time between other mutations, or ConcurrentGraphStore between publishes,
+    /// while readers keep searching the published versions. Once the store is reordered, the vertices move in memory
+    /// and the ID of a vertex only changes when the vertex with the highest ID takes the ID of a deleted one.
+    /// The edges, weights and labels move with the vertices. The distance indexes of their labels go stale, the
+    /// reachability indexes of their labels are rebuilt and the landmark tables are dropped.
+    /// @param maxMoves The maximum number of vertices to move.
+    /// @returns The vertices that were given a new ID, in the order they were moved. Callers that keep vertex IDs
+    /// must apply them.
+    std::vector<VertexMove> compact(size_t maxMoves);
+
+    /// Renumber the vertices in memory so that the vertices a search visits one after the other are stored close to
+    /// each other, which saves cache misses in every search that follows. The IDs callers use don't change: a mapping
+    /// translates them on the way in and on the way out, which costs two vectors of IDs. The reachability indexes
+    /// are rebuilt, the distance indexes go stale and the landmark tables are dropped. The CSR copy of snapshot(), the
+    /// distance indexes and the landmark tables use the IDs of the vertices in memory. Snapshot files don't: save()
+    /// writes the vertices under the IDs callers use.
+    /// @param order How to order the vertices, see VertexOrder.
+    void reorder(VertexOrder order);
+
     /// Add a label to a vertex.
     /// @param vertex The ID of the vertex.
     /// @param label The label to add to the vertex.
     /// @throws std::runtime_error if the vertex does not exist.
     void addLabel(VertexId vertex, const std::string& label);
 
+    /// Add a label to many vertices at once. The label string is looked up once and the vertices are added in ID
+    /// order. If any vertex does not exist, the label is added to none of them.
+    /// @param label The label to add to the vertices.
+    /// @param vertices The IDs of the vertices.
+    /// @throws std::runtime_error if any vertex does not exist.
+    void addLabelToVertices(const std::string& label, const std::vector<VertexId>& vertices);
+
     /// Remove a label from a vertex.
     /// @throws std::runtime_error if the vertex does not exist.
     void removeLabel(VertexId vertex, const std::string& label);
 
+    /// Returns the labels of a vertex.
+    /// @throws std::runtime_error if the vertex does not exist.
+    std::vector<std::string> labels(VertexId vertex) const;
+
     /// Returns the shortest path from one vertex to another. All vertices in the path must have the label given as
     /// parameter. If these is no path between the vertices an empty path is returned.
     /// @param from The ID of the source vertex.
@@ -43,15 +222,320 @@ public:
     /// exists.
     std::vector<VertexId> shortestPath(VertexId from, VertexId to, const std::string& label) const;
 
+    /// Same as above but with options that control the search.
+    /// @param options The options of the search, for instance the algorithm to use, or limits on the hops, the
+    /// vertices expanded and the time the search takes and a token to cancel it. A limited search returns an empty
+    /// path when it stops early, and reports why in QueryOptions::outcome.
+    std::vector<VertexId> shortestPath(VertexId from, VertexId to, const std::string& label,
+        const QueryOptions& options) const;
+
+    /// Same as above but with the scratch space of the search and the resulting path provided by the caller. Once the
+    /// context and the path have grown to the size of the graph, a search does no heap allocation.
+    /// @param context The scratch space of the search. It must not be used by another search at the same time.
+    /// @param path Receives the IDs of the vertices in the shortest path, or is left empty if no such path exists.
+    /// @throws std::runtime_error if either vertex does not exist.
+    /// @returns true if a path was found.
+    bool shortestPath(VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+        QueryContext& context, std::vector<VertexId>& path) const;
+
+    /// Same as above but all the vertices in the path must match a predicate over their labels instead of having one
+    /// label. The first query with a predicate evaluates it to a bitset of the vertices that match, which the following
+    /// queries with the same predicate reuse until a label changes or a vertex is created. The indexes of the labels
+    /// don't apply; the landmark tables do.
+    /// @param predicate The labels the vertices in the path must match, see LabelPredicate.
+    /// @throws std::runtime_error if either vertex does not exist.
+    /// @returns A vector containing the IDs of the vertices in the shortest path or an empty path if no such path
+    /// exists.
+    std::vector<VertexId> shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate,
+        const QueryOptions& options) const;
+
+    /// Same as above with the scratch space of the search and the resulting path provided by the caller.
+    /// @returns true if a path was found.
+    bool shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate, const QueryOptions& options,
+        QueryContext& context, std::vector<VertexId>& path) const;
+
+    /// Returns the bitset of the vertices that match a predicate, bit i of word i / 64 being set if vertex i matches,
+    /// as the searches use it. This evaluates the predicate unless the bitset is cached.
+    std::shared_ptr<const MaskCache::Mask> vertexMask(const LabelPredicate& predicate) const;
+
+    /// Run a batch of independent shortest path queries on the threads of a pool. Each worker thread reuses its own
+    /// search scratch space from one query to the next. The graph must not be mutated while the batch runs.
+    /// @param queries The queries to run.
+    /// @param pool The threads to run the queries on.
+    /// @param options The options used for every search. The limits apply to each query on its own, so a deadline or
+    /// a cancelled token stops every query that has not finished.
+    /// @throws std::runtime_error if a vertex of any query does not exist.
+    /// @returns The path found for each query, in the same order as the queries. See shortestPath.
+    std::vector<std::vector<VertexId>> shortestPaths(const std::vector<PathQuery>& queries, ThreadPool& pool,
+        const QueryOptions& options) const;
+
+    /// Returns the shortest paths from one vertex to each of many. A single breadth-first search from the source
+    /// finds them all, stopping once it has reached every target, instead of one search per pair. As in
+    /// shortestPath, all vertices in a path must have the label; the edges are counted, not weighed.
+    /// @param from The ID of the source vertex.
+    /// @param targets The IDs of the destination vertices.
+    /// @param label The label that needs to be present on the vertices in the paths.
+    /// @throws std::runtime_error if any vertex does not exist.
+    /// @returns The shortest path to each target, in the order of the targets, or an empty path if there is none.
+    std::vector<std::vector<VertexId>> shortestPaths(VertexId from, const std::vector<VertexId>& targets,
+        const std::string& label) const;
+
+    /// Returns the number of edges of a shortest path from each of many vertices to each of many, through the
+    /// vertices that have the label. The searches from up to 256 sources run as one multi-source BFS: every vertex
+    /// holds a bit per source, and a vertex reached by many of the searches at the same level is expanded once for
+    /// all of them, so the edges are walked about once per batch of sources rather than once per pair. When there
+    /// are fewer targets than sources, the searches go backward from the targets instead. See multisourcebfs.h. The
+    /// weights of the edges and the indexes of the label are not used.
+    /// @param sources The IDs of the source vertices.
+    /// @param targets The IDs of the destination vertices.
+    /// @param label The label that needs to be present on the vertices in the paths.
+    /// @param pool The threads to run the batches of sources on, or nullptr to run them on the calling thread.
+    /// @throws std::runtime_error if any vertex does not exist.
+    /// @returns The distance from sources[i] to targets[j] at [i][j], or Unreachable if there is no path.
+    std::vector<std::vector<uint32_t>> distanceMatrix(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets, const std::string& label, ThreadPool* pool) const;
+
+    /// Register a standing shortest path query: the store keeps the breadth-first tree of the shortest paths from the
+    /// source through the vertices of the label and updates it as edges and labels change, instead of searching
+    /// again, and calls back once the path to the destination changes. Creating an edge or adding the label to a
+    /// vertex relaxes the vertices it brings closer; deleting an edge or removing the label only repairs the part of
+    /// the tree below it, see ShortestPathTree. Renumbering the vertices, by reorder() or compact(), and large batches
+    /// build the trees again. Each subscription costs 12 bytes per vertex, counted by memoryUsage() as an index, and
+    /// keeps the edges as sets, as a reachability index does. As in distanceMatrix, the edges are counted, not
+    /// weighed. A subscription follows the IDs of its vertices: once one is deleted the path is empty, and compact()
+    /// moves the subscription along with the vertices it moves.
+    /// @param from The ID of the source vertex.
+    /// @param to The ID of the destination vertex.
+    /// @param label The label that needs to be present on the vertices in the path.
+    /// @param callback Called with the ID of the subscription and the new path, or an empty path once there is none,
+    /// each time the path changes, at the end of the mutation that changed it and on the thread that made it. It must
+    /// not call the store. It can be empty, to only poll subscribedPath().
+    /// @throws std::runtime_error if either vertex does not exist.
+    /// @returns The ID of the subscription.
+    SubscriptionId subscribe(VertexId from, VertexId to, const std::string& label, PathCallback callback);
+
+    /// Drop a subscription.
+    /// @returns false if there was no such subscription.
+    bool unsubscribe(SubscriptionId subscription);
+
+    /// Returns the current path of a subscription, without searching: a shortest path, but not necessarily the one
+    /// shortestPath would pick among those of the same length.
+    /// @throws std::runtime_error if there is no such subscription.
+    std::vector<VertexId> subscribedPath(SubscriptionId subscription) const;
+
+    /// Build a reachability index for a label. From then on shortestPath answers in constant time most queries between
+    /// vertices that can't reach each other through the vertices of the label, instead of searching the whole part of
+    /// the graph the source reaches. The index costs 16 bytes per vertex. It is kept up to date as edges are created
+    /// and the label is added to vertices; removing the label leaves it correct but less selective, and calling this
+    /// again rebuilds it from scratch. Versions built by createVersion() get a copy. See reachabilityindex.h.
+    /// @param label The label to index.
+    void indexReachability(const std::string& label);
+
+    /// Drop the reachability index of a label, if it has one.
+    void dropReachabilityIndex(const std::string& label);
+
+    /// Build a distance index for a label: a 2-hop cover of the distances between its vertices, built by pruned
+    /// landmark labeling. shortestPath on the label then merges two short sorted lists and follows the hints they hold
+    /// to rebuild the path instead of searching the graph. Creating an edge between two vertices that have the label,
+    /// or adding the label to or removing it from a vertex, makes the index stale: shortestPath searches again until
+    /// the index is built again. See hublabelindex.h.
+    /// @param label The label to index.
+    /// @param pool The threads to build the index on, or nullptr to build it on the calling thread.
+    void indexDistances(const std::string& label, ThreadPool* pool);
+
+    /// Drop the distance index of a label, if it has one.
+    void dropDistanceIndex(const std::string& label);
+
+    /// Returns the distance index of a label, for instance to check its memoryUsage(), or nullptr if it has none or it
+    /// is stale.
+    std::shared_ptr<const HubLabelIndex> distanceIndex(const std::string& label) const;
+
+    /// Build the landmark tables that guide SearchAlgorithm::Alt. This freezes the store. The tables are used until the
+    /// next edge is created; labels and new vertices don't affect them. See landmarkindex.h.
+    /// @param options How many landmarks to pick and how.
+    /// @throws std::runtime_error if more than LandmarkIndex::MaxLandmarkCount landmarks are asked for.
+    void buildLandmarks(const LandmarkOptions& options);
+
+    /// Start building landmark tables on a new thread from the edges as they are now. This freezes the store, which
+    /// then keeps serving queries and taking mutations while the tables are built from the frozen copy. Pass the
+    /// result to setLandmarks() once it is ready.
+    /// @param options How many landmarks to pick and how. The pool, if any, must outlive the build.
+    std::future<std::shared_ptr<const LandmarkIndex>> buildLandmarksAsync(const LandmarkOptions& options);
+
+    /// Use landmark tables built by buildLandmarksAsync().
+    /// @returns false, and drops the tables, if edges were created since the build started.
+    bool setLandmarks(std::shared_ptr<const LandmarkIndex> landmarks);
+
+    /// Returns the landmark tables SearchAlgorithm::Alt uses, or nullptr if there are none or edges were created since
+    /// they were built.
+    std::shared_ptr<const LandmarkIndex> landmarks() const;
+
+    /// Start or stop recording the shortestPath queries of every graph of the process, GraphVersion included, in the
+    /// global metrics. They are off by default.
+    static void setMetricsEnabled(bool enabled);
+
+    /// Returns the global metrics: counters and histograms over the queries recorded since they were enabled. This is
+    /// cheap enough to be scraped periodically; PrometheusText formats the result for Prometheus.
+    static MetricsSnapshot metrics();
+
+    /// Build an immutable CSR copy of the edges and their weights. Until the next call to createVertex or createEdge,
+    /// shortestPath traverses this copy instead of the per-vertex sets. Mutating the graph discards the copy; call
+    /// freeze() again once the new edges are in. With AdjacencyStorage::Compressed, compress the edges instead and
+    /// release the sets. With AdjacencyStorage::CompactSets, the copy is a CompactCsrAdjacency.
+    void freeze();
+
+    /// Returns true if shortestPath currently runs against a frozen CSR copy or the compressed copy of the edges.
+    bool isFrozen() const;
+
+    /// Returns the CSR copy built by the last call to freeze(), or nullptr if the graph was mutated since or keeps its
+    /// edges compressed. With AdjacencyStorage::CompactSets, the full width copy createVersion() builds instead. The
+    /// copy stays valid for as long as the caller holds on to it, even if the graph is mutated afterwards. Its
+    /// vertices are in the order of reorder().
+    std::shared_ptr<const CsrAdjacency> snapshot() const;
+
+    /// Returns the compressed copy of the edges, or nullptr unless the graph stores its edges compressed and they
+    /// have not been decoded since the last freeze(). Like snapshot(), it stays valid for as long as it is held.
+    std::shared_ptr<const CompressedAdjacency> compressedSnapshot() const;
+
+    /// Returns the CSR copy with 32-bit IDs built by the last call to freeze(), or nullptr unless the graph stores its
+    /// edges as AdjacencyStorage::CompactSets and has not been mutated since. Like snapshot(), it stays valid for as
+    /// long as it is held.
+    std::shared_ptr<const CompactCsrAdjacency> compactSnapshot() const;
+
+    /// Build an immutable version of the graph as it is now, edges and labels, that can be searched from any number
+    /// of threads while this store keeps being mutated. This freezes the store; the parts that did not change since
+    /// the last version are shared with it instead of being copied again.
+    std::unique_ptr<const GraphVersion> createVersion();
+
+    /// Write the graph, edges and labels, to a binary snapshot file that open() can map. See snapshotfile.h for the
+    /// layout of the file. The weights of the edges are not saved: the edges read back weigh 1. Deleted vertices are
+    /// saved as vertices without edges or labels; compact() first to leave them out.
+    /// @throws std::runtime_error if the file can't be written.
+    void save(const std::string& path) const;
+
+    /// Same as above with a sequence number stored in the file, for instance the position of the snapshot in a
+    /// write-ahead log. load() gives it back.
+    void save(const std::string& path, uint64_t sequence) const;
+
+    /// Map a snapshot file written by save(). The returned version answers shortestPath queries straight from the
+    /// mapped pages: nothing is parsed or copied beyond the label names, so opening a large graph costs the page
+    /// faults of the pages the queries actually touch.
+    /// @param path The path of the snapshot file.
+    /// @param verifyChecksum If true, read the whole file once to check its checksum and its consistency.
+    /// @throws std::runtime_error if the file can't be mapped or is not a valid snapshot file.
+    static std::unique_ptr<const GraphVersion> open(const std::string& path, bool verifyChecksum);
+
+    /// Read a snapshot file written by save() back into a mutable graph. Unlike open(), this copies the whole file in
+    /// memory and can then be mutated. The file is always verified.
+    /// @param path The path of the snapshot file.
+    /// @param sequence Receives the sequence number the file was saved with, unless it is nullptr.
+    /// @throws std::runtime_error if the file can't be mapped or is not a valid snapshot file.
+    static GraphStore load(const std::string& path, uint64_t* sequence);
+
 private:
+    // The public methods map the vertex IDs they are given to the internal IDs on the way in, and the IDs they return
+    // back on the way out. Everything else, the private methods included, works on internal IDs.
+
+    // Returns true if an internal ID is a vertex that was not deleted.
+    bool isAlive(VertexId vertex) const;
+
+    // Returns the internal IDs of vertices given by the caller.
+    // @throws std::runtime_error if any vertex does not exist.
+    std::vector<VertexId> internalIds(const std::vector<VertexId>& vertices) const;
+
+    // Returns the number of internal IDs, deleted vertices included.
+    size_t idCount() const { return m_compressed ? m_compressed->vertexCount() : m_vertices.size(); }
+
+    // Decodes the compressed edges back into m_vertices and m_reverse, if they are compressed, before a mutation
+    // that needs the sets.
+    void decompress();
+
+    // Drops the frozen CSR copies, after a mutation that makes them stale.
+    void thaw();
+
+    // The parts of createEdge and deleteEdge that come after the vertices are checked.
+    void insertEdge(VertexId from, VertexId to);
+    bool removeEdge(VertexId from, VertexId to);
+
+    // Renumbers all the vertices: vertex id becomes newIds[id - 1].
+    void renumberVertices(const std::vector<VertexId>& newIds);
+
+    // Returns the bitset of a predicate over the internal IDs.
+    std::shared_ptr<const MaskCache::Mask> internalMask(const LabelPredicate& predicate) const;
+
+    // Returns a copy of the graph with its vertices under their external IDs.
+    GraphStore externalCopy() const;
+
+    // Drops the distance index of a label, which no longer matches the graph.
+    void invalidateDistanceIndex(LabelId labelId);
+
+    // Gives vertex oldId, which is alive, the free internal ID newId: its edges, weights and labels move, and its
+    // neighbours point to the new ID. Returns the labels of the vertex.
+    std::vector<LabelId> renumberVertex(VertexId oldId, VertexId newId);
+
+    // Drops the deleted vertices at the end of the ID space and releases the memory they held. Once the store is
+    // reordered, only those whose internal and external IDs are both the last.
+    void trimDeleted();
+
+    // The slabs the nodes of the sets below are allocated from. A copy of the store gets its own pool, and the sets it
+    // copies come from the global heap, see PoolAllocator.
+    OwnedNodePool m_node_pool;
     // We store the vertices in a vector of sets. The position in the vector is the ID of the vertex - 1. We want to
     // avoid 0 being a valid ID. Each set contains the neighbors of the corresponding vertex.
-    // Note: at the moment we do not support deletion of vertices. This could be implemented something like std::hive.
-    std::vector<std::set<VertexId>> m_vertices;
-    // The list of labels. Each label has a set of vertices that have this label.
-    // Note: this is optimized for checking whether a vertex has a certain label but listing all labels a node has would
-    // be inefficient.
-    std::unordered_map<std::string, std::set<VertexId>> m_labels;
+    // Deleted vertices keep their slot, with no neighbours, until the slot is reused or compact() moves the last
+    // vertex into it.
+    AdjacencySets m_vertices;
+    // The same edges as m_vertices but reversed: each set contains the vertices that have an edge to the
+    // corresponding vertex. This is what lets the bidirectional BFS search backward from the destination.
+    AdjacencySets m_reverse;
+    size_t m_edge_count = 0;
+    // How the edges are stored between mutations.
+    AdjacencyStorage m_storage = AdjacencyStorage::Sets;
+    // With AdjacencyStorage::Compressed, the compressed copies of m_vertices and m_reverse, which are then empty.
+    // Reset to nullptr by decompress().
+    std::shared_ptr<const CompressedAdjacency> m_compressed;
+    std::shared_ptr<const CompressedAdjacency> m_compressed_reverse;
+    // The IDs of the deleted vertices, lower than m_vertices.size() + 1. createVertex() takes the lowest.
+    std::set<VertexId> m_deleted;
+    // The external IDs of the vertices, empty until reorder() is called.
+    VertexMapping m_mapping;
+    // Copy of m_mapping handed out to the versions. Reset to nullptr whenever the mapping changes.
+    std::shared_ptr<const VertexMapping> m_frozen_mapping;
+    // The weights of the edges that don't weigh 1.
+    EdgeWeights m_weights;
+    // Incremented whenever edges are created or deleted, or vertices renumbered. The landmark tables are only valid
+    // for the generation they were built for.
+    uint64_t m_edge_generation = 0;
+    // Read-optimized copies of m_vertices and m_reverse built by freeze(). Reset to nullptr whenever the edges change.
+    // With AdjacencyStorage::CompactSets, freeze() builds m_compact and m_compact_reverse instead, which the searches
+    // use, and m_frozen is only built for the versions.
+    std::shared_ptr<const CsrAdjacency> m_frozen;
+    std::shared_ptr<const CsrAdjacency> m_frozen_reverse;
+    std::shared_ptr<const CompactCsrAdjacency> m_compact;
+    std::shared_ptr<const CompactCsrAdjacency> m_compact_reverse;
+    // The labels, interned to small integer IDs. Each label has a bitmap of the vertices that have this label so that
+    // the label check in shortestPath is a single bit test. Listing the labels of a vertex tests each label in turn.
+    LabelIndex m_labels;
+    // Copy of m_labels handed out to the versions built by createVersion(). Reset to nullptr whenever a label changes.
+    std::shared_ptr<const LabelIndex> m_frozen_labels;
+    // Incremented whenever a label changes or vertices are created or deleted, which changes the vertices that match
+    // predicates.
+    uint64_t m_label_generation = 0;
+    // The bitsets of the predicates searched recently.
+    mutable MaskCache m_masks;
+    // The reachability index of each label, indexed by label ID. Most labels have none: their index is not built.
+    std::vector<ReachabilityIndex> m_reachability;
+    // Copy of m_reachability handed out to the versions. Reset to nullptr whenever an index changes.
+    std::shared_ptr<const std::vector<ReachabilityIndex>> m_frozen_reachability;
+    // The distance index of each label, indexed by label ID, or nullptr when a label has none or it went stale. They
+    // are immutable and shared with the versions.
+    std::vector<std::shared_ptr<const HubLabelIndex>> m_distance_indexes;
+    // Copy of m_distance_indexes handed out to the versions. Reset to nullptr whenever an index changes.
+    std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> m_frozen_distance_indexes;
+    // The landmark tables. They are immutable and shared with the versions.
+    std::shared_ptr<const LandmarkIndex> m_landmarks;
+    // The standing shortest path queries, updated by every mutation of the edges and labels.
+    PathSubscriptions m_subscriptions;
 };
 
 #endif
@@ -0,0 +1,90 @@
+#include "graphversion.h"
+#include "search.h"
+#include <utility>
+
+GraphVersion::GraphVersion(std::shared_ptr<const CsrAdjacency> forward, std::shared_ptr<const CsrAdjacency> reverse,
+    std::shared_ptr<const LabelIndex> labels, std::shared_ptr<const std::vector<ReachabilityIndex>> reachability,
+    std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> distances,
+    std::shared_ptr<const LandmarkIndex> landmarks, std::shared_ptr<const VertexMapping> mapping) :
+    m_forward(std::move(forward)), m_reverse(std::move(reverse)), m_labels(std::move(labels)),
+    m_reachability(std::move(reachability)), m_distances(std::move(distances)), m_landmarks(std::move(landmarks)),
+    m_mapping(std::move(mapping))
+{
+}
+
+GraphVersion::GraphVersion(std::shared_ptr<const CsrAdjacency> forward, std::shared_ptr<const CsrAdjacency> reverse,
+    std::shared_ptr<const MappedLabelIndex> labels) :
+    m_forward(std::move(forward)), m_reverse(std::move(reverse)), m_mapped_labels(std::move(labels))
+{
+}
+
+GraphVersion::GraphVersion(std::shared_ptr<const CompressedAdjacency> forward,
+    std::shared_ptr<const CompressedAdjacency> reverse, std::shared_ptr<const LabelIndex> labels,
+    std::shared_ptr<const std::vector<ReachabilityIndex>> reachability,
+    std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> distances,
+    std::shared_ptr<const LandmarkIndex> landmarks, std::shared_ptr<const VertexMapping> mapping) :
+    m_compressed(std::move(forward)), m_compressed_reverse(std::move(reverse)), m_labels(std::move(labels)),
+    m_reachability(std::move(reachability)), m_distances(std::move(distances)), m_landmarks(std::move(landmarks)),
+    m_mapping(std::move(mapping))
+{
+}
+
+std::vector<VertexId> GraphVersion::shortestPath(VertexId from, VertexId to, const std::string& label) const
+{
+    thread_local QueryContext context;
+    std::vector<VertexId> path;
+    shortestPath(from, to, label, QueryOptions(), context, path);
+    return path;
+}
+
+bool GraphVersion::shortestPath(VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+    QueryContext& context, std::vector<VertexId>& path) const
+{
+    const search::Indexes indexes = { m_reachability.get(), m_landmarks.get(), m_distances.get() };
+    if (m_mapped_labels)
+    {
+        return search::ShortestPath(*m_forward, *m_reverse, m_forward->edgeCount(), *m_mapped_labels, indexes, from,
+            to, label, options, context, path);
+    }
+    if (m_mapping)
+    {
+        from = m_mapping->internal(from);
+        to = m_mapping->internal(to);
+    }
+    auto run = [&](const auto& forward, const auto& reverse)
+    {
+        return search::ShortestPath(forward, reverse, edgeCount(), *m_labels, indexes, from, to, label, options,
+            context, path);
+    };
+    const bool found = m_forward ? run(*m_forward, *m_reverse) : run(*m_compressed, *m_compressed_reverse);
+    if (m_mapping)
+    {
+        m_mapping->toExternal(path);
+    }
+    return found;
+}
+
+bool GraphVersion::shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate,
+    const QueryOptions& options, QueryContext& context, std::vector<VertexId>& path) const
+{
+    const std::shared_ptr<const MaskCache::Mask> mask = m_mapped_labels ?
+        m_masks.mask(predicate, *m_mapped_labels, vertexCount(), 0) :
+        m_masks.mask(predicate, *m_labels, vertexCount(), 0);
+    if (m_mapping)
+    {
+        from = m_mapping->internal(from);
+        to = m_mapping->internal(to);
+    }
+    const DenseVertexSet vertices(mask->data(), mask->size());
+    auto run = [&](const auto& forward, const auto& reverse)
+    {
+        return search::ShortestPathWithin(forward, reverse, edgeCount(), vertices, m_landmarks.get(), from, to,
+            options, context, path);
+    };
+    const bool found = m_forward ? run(*m_forward, *m_reverse) : run(*m_compressed, *m_compressed_reverse);
+    if (m_mapping)
+    {
+        m_mapping->toExternal(path);
+    }
+    return found;
+}
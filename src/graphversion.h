@@ -0,0 +1,89 @@
+#ifndef GRAPHVERSION_H
+#define GRAPHVERSION_H
+
+#include "compressedadjacency.h"
+#include "csradjacency.h"
+#include "hublabelindex.h"
+#include "labelindex.h"
+#include "labelpredicate.h"
+#include "landmarkindex.h"
+#include "mappedlabelindex.h"
+#include "querycontext.h"
+#include "queryoptions.h"
+#include "reachabilityindex.h"
+#include "types.h"
+#include "vertexmapping.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/// An immutable version of a graph: the CSR or compressed copies of its edges and a copy of its labels and indexes.
+/// Nothing in a version changes once it is built so any number of threads can search it at the same time. Versions
+/// built from the same GraphStore share the parts of the graph that did not change between them. A version can also
+/// be backed by a memory-mapped snapshot file, see GraphStore::open.
+class GraphVersion
+{
+public:
+    /// @param reachability The reachability indexes of the labels, one per label ID, or nullptr if there are none.
+    /// @param distances The up to date distance indexes of the labels, one per label ID, or nullptr if there are
+    /// none.
+    /// @param landmarks The landmark tables of the edges, or nullptr if there are none.
+    /// @param mapping The external IDs of the vertices, or nullptr if they are the IDs of the CSR copies.
+    GraphVersion(std::shared_ptr<const CsrAdjacency> forward, std::shared_ptr<const CsrAdjacency> reverse,
+        std::shared_ptr<const LabelIndex> labels, std::shared_ptr<const std::vector<ReachabilityIndex>> reachability,
+        std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> distances,
+        std::shared_ptr<const LandmarkIndex> landmarks, std::shared_ptr<const VertexMapping> mapping);
+
+    GraphVersion(std::shared_ptr<const CsrAdjacency> forward, std::shared_ptr<const CsrAdjacency> reverse,
+        std::shared_ptr<const MappedLabelIndex> labels);
+
+    /// Same as the first constructor with the edges of a store that keeps them compressed, see AdjacencyStorage.
+    GraphVersion(std::shared_ptr<const CompressedAdjacency> forward, std::shared_ptr<const CompressedAdjacency> reverse,
+        std::shared_ptr<const LabelIndex> labels, std::shared_ptr<const std::vector<ReachabilityIndex>> reachability,
+        std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> distances,
+        std::shared_ptr<const LandmarkIndex> landmarks, std::shared_ptr<const VertexMapping> mapping);
+
+    /// Returns the number of vertices in this version.
+    size_t vertexCount() const { return m_forward ? m_forward->vertexCount() : m_compressed->vertexCount(); }
+
+    /// Returns the number of edges in this version.
+    size_t edgeCount() const { return m_forward ? m_forward->edgeCount() : m_compressed->edgeCount(); }
+
+    /// Returns the shortest path from one vertex to another. See GraphStore::shortestPath.
+    /// @throws std::runtime_error if either vertex does not exist in this version.
+    std::vector<VertexId> shortestPath(VertexId from, VertexId to, const std::string& label) const;
+
+    /// Same as above with options and with the scratch space of the search and the resulting path provided by the
+    /// caller. See GraphStore::shortestPath.
+    /// @throws std::runtime_error if either vertex does not exist in this version.
+    /// @returns true if a path was found.
+    bool shortestPath(VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+        QueryContext& context, std::vector<VertexId>& path) const;
+
+    /// Same as above but all the vertices in the path must match a predicate over their labels. See
+    /// GraphStore::shortestPath.
+    bool shortestPath(VertexId from, VertexId to, const LabelPredicate& predicate, const QueryOptions& options,
+        QueryContext& context, std::vector<VertexId>& path) const;
+
+private:
+    // Exactly one of the two pairs is set.
+    std::shared_ptr<const CsrAdjacency> m_forward;
+    std::shared_ptr<const CsrAdjacency> m_reverse;
+    std::shared_ptr<const CompressedAdjacency> m_compressed;
+    std::shared_ptr<const CompressedAdjacency> m_compressed_reverse;
+    // Exactly one of the two is set.
+    std::shared_ptr<const LabelIndex> m_labels;
+    std::shared_ptr<const MappedLabelIndex> m_mapped_labels;
+    // The reachability indexes of the store the version was built from, if it had any.
+    std::shared_ptr<const std::vector<ReachabilityIndex>> m_reachability;
+    // The distance indexes of the store the version was built from, if it had any.
+    std::shared_ptr<const std::vector<std::shared_ptr<const HubLabelIndex>>> m_distances;
+    // The landmark tables of the store the version was built from, if they were valid for these edges.
+    std::shared_ptr<const LandmarkIndex> m_landmarks;
+    // The external IDs of the vertices of a reordered store, see GraphStore::reorder.
+    std::shared_ptr<const VertexMapping> m_mapping;
+    // The bitsets of the predicates searched recently. The labels of a version never change so they never go stale.
+    mutable MaskCache m_masks;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "hublabelindex.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+    // The number of hubs searched one at a time before the searches are batched, and the number of hubs per batch
+    // and per worker thread after that.
+    const size_t SequentialHubCount = 256;
+    const size_t HubsPerWorker = 4;
+}
+
+const uint32_t HubLabelIndex::Unreachable;
+
+// The state of one search, sized to the graph once and reset after each search by undoing what it wrote.
+struct HubLabelIndex::Scratch
+{
+    explicit Scratch(size_t vertexCount, size_t hubCount) :
+        m_hub_distances(hubCount, Unreachable), m_distances(vertexCount + 1, Unreachable), m_parents(vertexCount + 1)
+    {
+    }
+
+    // The distances between the hub being searched and the hubs of its own list, by hub rank.
+    std::vector<uint32_t> m_hub_distances;
+    std::vector<uint32_t> m_distances;
+    std::vector<VertexId> m_parents;
+    std::vector<VertexId> m_queue;
+};
+
+HubLabelIndex::HubLabelIndex(const AdjacencySets& forward, const AdjacencySets& reverse, const VertexBitmap& labelled,
+    ThreadPool* pool)
+{
+    const size_t vertex_count = forward.size();
+    if (vertex_count >= UINT32_MAX)
+    {
+        throw std::runtime_error("Too many vertices for a distance index");
+    }
+
+    labelled.forEach([&](VertexId vertex)
+    {
+        if (vertex <= vertex_count)
+        {
+            m_hubs.push_back(vertex);
+        }
+    });
+    std::stable_sort(m_hubs.begin(), m_hubs.end(), [&](VertexId a, VertexId b)
+    {
+        return (forward[a - 1].size() + reverse[a - 1].size()) > (forward[b - 1].size() + reverse[b - 1].size());
+    });
+    const size_t hub_count = m_hubs.size();
+
+    std::vector<std::vector<Entry>> in_lists(vertex_count + 1);
+    std::vector<std::vector<Entry>> out_lists(vertex_count + 1);
+
+    // Scratch spaces are handed to the chunks of the pool as they start, so that there is one per thread at most.
+    std::mutex scratch_mutex;
+    std::vector<std::unique_ptr<Scratch>> free_scratch;
+    auto acquire = [&]()
+    {
+        std::lock_guard<std::mutex> lock(scratch_mutex);
+        if (free_scratch.empty())
+        {
+            return std::unique_ptr<Scratch>(new Scratch(vertex_count, hub_count));
+        }
+        std::unique_ptr<Scratch> scratch = std::move(free_scratch.back());
+        free_scratch.pop_back();
+        return scratch;
+    };
+    auto release = [&](std::unique_ptr<Scratch> scratch)
+    {
+        std::lock_guard<std::mutex> lock(scratch_mutex);
+        free_scratch.push_back(std::move(scratch));
+    };
+
+    // Each search of a batch fills its own list of entries. The entries are only added to the lists once the whole
+    // batch is done, in hub order, so that the lists stay sorted by hub.
+    std::vector<std::vector<std::pair<VertexId, Entry>>> found;
+    for (size_t first = 0; first < hub_count;)
+    {
+        size_t batch_size = 1;
+        if ((pool != nullptr) && (first >= SequentialHubCount))
+        {
+            batch_size = HubsPerWorker * pool->workerCount();
+        }
+        batch_size = std::min(batch_size, hub_count - first);
+
+        // Search i is the forward search of hub first + i / 2 if i is even, its backward search otherwise.
+        found.resize(2 * batch_size);
+        auto search = [&](size_t begin, size_t end)
+        {
+            std::unique_ptr<Scratch> scratch = acquire();
+            for (size_t i = begin; i < end; ++i)
+            {
+                const uint32_t rank = static_cast<uint32_t>(first + (i / 2));
+                if ((i % 2) == 0)
+                {
+                    prunedSearch(rank, forward, out_lists, in_lists, labelled, *scratch, found[i]);
+                }
+                else
+                {
+                    prunedSearch(rank, reverse, in_lists, out_lists, labelled, *scratch, found[i]);
+                }
+            }
+            release(std::move(scratch));
+        };
+        if (pool != nullptr)
+        {
+            pool->parallelFor(2 * batch_size, 1, search);
+        }
+        else
+        {
+            search(0, 2 * batch_size);
+        }
+
+        for (size_t i = 0; i < 2 * batch_size; ++i)
+        {
+            std::vector<std::vector<Entry>>& lists = ((i % 2) == 0) ? in_lists : out_lists;
+            for (const std::pair<VertexId, Entry>& entry : found[i])
+            {
+                lists[entry.first].push_back(entry.second);
+            }
+            found[i].clear();
+        }
+        first += batch_size;
+    }
+
+    auto compact = [vertex_count](std::vector<std::vector<Entry>>& lists, std::vector<size_t>& offsets,
+        std::vector<Entry>& entries)
+    {
+        offsets.assign(vertex_count + 2, 0);
+        for (size_t vertex = 0; vertex <= vertex_count; ++vertex)
+        {
+            offsets[vertex + 1] = offsets[vertex] + lists[vertex].size();
+        }
+        entries.reserve(offsets[vertex_count + 1]);
+        for (std::vector<Entry>& list : lists)
+        {
+            entries.insert(entries.end(), list.begin(), list.end());
+            std::vector<Entry>().swap(list);
+        }
+    };
+    compact(in_lists, m_in_offsets, m_in_entries);
+    compact(out_lists, m_out_offsets, m_out_entries);
+}
+
+void HubLabelIndex::prunedSearch(uint32_t rank, const AdjacencySets& adjacency,
+    const std::vector<std::vector<Entry>>& ownLists, const std::vector<std::vector<Entry>>& otherLists,
+    const VertexBitmap& labelled, Scratch& scratch, std::vector<std::pair<VertexId, Entry>>& found) const
+{
+    // A forward search from the hub finds d(hub, v) and the lists built so far already know it if the out-list of the
+    // hub and the in-list of v share a hub with that sum of distances. The backward search is the mirror image.
+    const VertexId hub = m_hubs[rank];
+    const std::vector<Entry>& hub_list = ownLists[hub];
+    for (const Entry& entry : hub_list)
+    {
+        scratch.m_hub_distances[entry.m_hub] = entry.m_distance;
+    }
+
+    scratch.m_queue.assign(1, hub);
+    scratch.m_distances[hub] = 0;
+    scratch.m_parents[hub] = 0;
+    for (size_t i = 0; i < scratch.m_queue.size(); ++i)
+    {
+        const VertexId vertex = scratch.m_queue[i];
+        const uint32_t distance = scratch.m_distances[vertex];
+
+        bool known = false;
+        for (const Entry& entry : otherLists[vertex])
+        {
+            const uint32_t hub_distance = scratch.m_hub_distances[entry.m_hub];
+            if ((hub_distance != Unreachable) && (hub_distance + entry.m_distance <= distance))
+            {
+                known = true;
+                break;
+            }
+        }
+        if (known)
+        {
+            continue;
+        }
+
+        // The parent was not pruned either, so it has an entry for this hub too.
+        found.emplace_back(vertex, Entry{ rank, distance, static_cast<uint32_t>(scratch.m_parents[vertex]) });
+        for (VertexId neighbour : adjacency[vertex - 1])
+        {
+            if ((scratch.m_distances[neighbour] == Unreachable) && labelled.contains(neighbour))
+            {
+                scratch.m_distances[neighbour] = distance + 1;
+                scratch.m_parents[neighbour] = vertex;
+                scratch.m_queue.push_back(neighbour);
+            }
+        }
+    }
+
+    for (VertexId vertex : scratch.m_queue)
+    {
+        scratch.m_distances[vertex] = Unreachable;
+    }
+    for (const Entry& entry : hub_list)
+    {
+        scratch.m_hub_distances[entry.m_hub] = Unreachable;
+    }
+}
+
+uint32_t HubLabelIndex::bestHub(VertexId from, VertexId to, uint32_t& hub) const
+{
+    if ((from >= m_out_offsets.size() - 1) || (to >= m_in_offsets.size() - 1))
+    {
+        return Unreachable;
+    }
+
+    const Entry* out = m_out_entries.data() + m_out_offsets[from];
+    const Entry* out_end = m_out_entries.data() + m_out_offsets[from + 1];
+    const Entry* in = m_in_entries.data() + m_in_offsets[to];
+    const Entry* in_end = m_in_entries.data() + m_in_offsets[to + 1];
+    uint32_t best = Unreachable;
+    while ((out != out_end) && (in != in_end))
+    {
+        if (out->m_hub < in->m_hub)
+        {
+            ++out;
+        }
+        else if (in->m_hub < out->m_hub)
+        {
+            ++in;
+        }
+        else
+        {
+            if (out->m_distance + in->m_distance < best)
+            {
+                best = out->m_distance + in->m_distance;
+                hub = out->m_hub;
+            }
+            ++out;
+            ++in;
+        }
+    }
+    return best;
+}
+
+uint32_t HubLabelIndex::distance(VertexId from, VertexId to) const
+{
+    uint32_t hub;
+    return bestHub(from, to, hub);
+}
+
+bool HubLabelIndex::shortestPath(VertexId from, VertexId to, std::vector<VertexId>& path) const
+{
+    path.clear();
+    uint32_t hub = 0;
+    if (bestHub(from, to, hub) == Unreachable)
+    {
+        return false;
+    }
+
+    // From the source forward to the hub, then from the destination backward to the hub, reversed.
+    const VertexId hub_vertex = m_hubs[hub];
+    for (VertexId vertex = from; vertex != hub_vertex;)
+    {
+        path.push_back(vertex);
+        vertex = find(m_out_entries.data() + m_out_offsets[vertex], m_out_entries.data() + m_out_offsets[vertex + 1],
+            hub).m_next;
+    }
+    const size_t middle = path.size();
+    for (VertexId vertex = to; vertex != hub_vertex;)
+    {
+        path.push_back(vertex);
+        vertex = find(m_in_entries.data() + m_in_offsets[vertex], m_in_entries.data() + m_in_offsets[vertex + 1],
+            hub).m_next;
+    }
+    path.push_back(hub_vertex);
+    std::reverse(path.begin() + middle, path.end());
+    return true;
+}
+
+size_t HubLabelIndex::memoryUsage() const
+{
+    return (m_hubs.capacity() * sizeof(VertexId)) + (m_in_offsets.capacity() * sizeof(size_t)) +
+        (m_out_offsets.capacity() * sizeof(size_t)) + (m_in_entries.capacity() * sizeof(Entry)) +
+        (m_out_entries.capacity() * sizeof(Entry));
+}
+
+const HubLabelIndex::Entry& HubLabelIndex::find(const Entry* begin, const Entry* end, uint32_t hub)
+{
+    return *std::lower_bound(begin, end, hub, [](const Entry& entry, uint32_t value) { return entry.m_hub < value; });
+}
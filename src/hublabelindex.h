@@ -0,0 +1,90 @@
+#ifndef HUBLABELINDEX_H
+#define HUBLABELINDEX_H
+
+#include "nodepool.h"
+#include "threadpool.h"
+#include "types.h"
+#include "vertexbitmap.h"
+#include <cstdint>
+#include <vector>
+
+/// Exact distances between the vertices of a label, stored as a 2-hop cover built by pruned landmark labeling (Akiba,
+/// Iwata and Yoshida, "Fast Exact Shortest-Path Distance Queries on Large Networks by Pruned Landmark Labeling").
+/// Each vertex gets an out-list of (hub, distance from the vertex to the hub) and an in-list of (hub, distance from the
+/// hub to the vertex), such that every pair of vertices connected through the label has a hub on one of its shortest
+/// paths in both lists. The distance between two vertices is then the smallest sum over the hubs their lists share,
+/// which is a merge of two lists sorted by hub. Every entry also holds the next vertex toward its hub, a vertex that
+/// has an entry for the same hub, so a shortest path is rebuilt by following the entries of the best hub.
+/// The hubs are the vertices in decreasing order of degree. A breadth-first search from each hub in turn, forward and
+/// backward, adds the hub to the lists of the vertices it reaches, except where the lists built so far already give
+/// the distance: the search is pruned there. With a thread pool, after the first hubs, which prune the most, the
+/// hubs are searched in batches side by side and only see the lists of the previous batches. They prune a little
+/// less, which makes the lists longer but leaves the distances exact.
+/// The lists stay short on graphs where a few vertices lie on most shortest paths, such as social or web graphs. On
+/// graphs without such hubs, a sparse uniform random graph for instance, they grow with the number of vertices and
+/// the index can take much more memory than the graph: check memoryUsage().
+/// The index describes the graph it was built from: any new edge between labelled vertices or change to the vertices
+/// that have the label makes it stale.
+class HubLabelIndex
+{
+public:
+    /// The distance of the vertices that can't reach each other.
+    static const uint32_t Unreachable = UINT32_MAX;
+
+    /// Build the index of the vertices of a label.
+    /// @param forward The neighbours of each vertex. The position in the vector is the ID of the vertex - 1.
+    /// @param reverse The vertices that have an edge to each vertex.
+    /// @param labelled The vertices that have the label.
+    /// @param pool The threads to build the index on, or nullptr to build it on the calling thread.
+    /// @throws std::runtime_error if the graph has 2^32 - 1 vertices or more.
+    HubLabelIndex(const AdjacencySets& forward, const AdjacencySets& reverse, const VertexBitmap& labelled,
+        ThreadPool* pool);
+
+    /// Returns the number of edges of a shortest path between two vertices of the label, or Unreachable.
+    uint32_t distance(VertexId from, VertexId to) const;
+
+    /// Rebuild a shortest path between two vertices of the label.
+    /// @param path Receives the IDs of the vertices in the path, or is left empty if there is no path.
+    /// @returns true if a path was found.
+    bool shortestPath(VertexId from, VertexId to, std::vector<VertexId>& path) const;
+
+    /// Returns the number of entries of all the lists.
+    size_t entryCount() const { return m_in_entries.size() + m_out_entries.size(); }
+
+    /// Returns the number of bytes used by the index.
+    size_t memoryUsage() const;
+
+private:
+    struct Entry
+    {
+        // The rank of the hub: its position in m_hubs.
+        uint32_t m_hub;
+        uint32_t m_distance;
+        // The next vertex on the path to the hub of an out-list entry, or from the hub of an in-list entry. 0 for
+        // the entry of the hub itself.
+        uint32_t m_next;
+    };
+
+    struct Scratch;
+
+    // Searches from one hub, forward to fill in-lists or backward to fill out-lists, against the lists built so far.
+    void prunedSearch(uint32_t rank, const AdjacencySets& adjacency, const std::vector<std::vector<Entry>>& ownLists,
+        const std::vector<std::vector<Entry>>& otherLists, const VertexBitmap& labelled, Scratch& scratch,
+        std::vector<std::pair<VertexId, Entry>>& found) const;
+
+    // Finds the shared hub with the smallest sum of distances. Returns Unreachable if there is none.
+    uint32_t bestHub(VertexId from, VertexId to, uint32_t& hub) const;
+
+    // Returns the entry of a hub in a sorted list. The entry must exist.
+    static const Entry& find(const Entry* begin, const Entry* end, uint32_t hub);
+
+    // The vertices in the order they were used as hubs.
+    std::vector<VertexId> m_hubs;
+    // The lists of all the vertices in CSR form: the list of vertex id is at [offsets[id], offsets[id + 1]).
+    std::vector<size_t> m_in_offsets;
+    std::vector<Entry> m_in_entries;
+    std::vector<size_t> m_out_offsets;
+    std::vector<Entry> m_out_entries;
+};
+
+#endif
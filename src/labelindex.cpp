@@ -0,0 +1,64 @@
+#include "labelindex.h"
+#include <algorithm>
+
+LabelId LabelIndex::intern(const std::string& label)
+{
+    auto inserted = m_ids.emplace(label, static_cast<LabelId>(m_names.size()));
+    if (inserted.second)
+    {
+        m_names.push_back(label);
+        m_vertices.emplace_back();
+    }
+    return inserted.first->second;
+}
+
+bool LabelIndex::find(const std::string& label, LabelId& id) const
+{
+    auto found = m_ids.find(label);
+    if (found == m_ids.end())
+    {
+        return false;
+    }
+    id = found->second;
+    return true;
+}
+
+std::vector<LabelId> LabelIndex::labelsOf(VertexId vertex) const
+{
+    std::vector<LabelId> labels;
+    for (LabelId id = 0; id < m_vertices.size(); ++id)
+    {
+        if (m_vertices[id].contains(vertex))
+        {
+            labels.push_back(id);
+        }
+    }
+    return labels;
+}
+
+void LabelIndex::renumber(const std::vector<VertexId>& newIds)
+{
+    std::vector<VertexId> renumbered;
+    for (VertexBitmap& vertices : m_vertices)
+    {
+        renumbered.clear();
+        vertices.forEach([&](VertexId vertex) { renumbered.push_back(newIds[vertex - 1]); });
+        // Inserted in increasing order, the vertices are appended to the chunks.
+        std::sort(renumbered.begin(), renumbered.end());
+        vertices = VertexBitmap();
+        for (VertexId vertex : renumbered)
+        {
+            vertices.insert(vertex);
+        }
+    }
+}
+
+size_t LabelIndex::memoryUsage() const
+{
+    size_t usage = 0;
+    for (const VertexBitmap& vertices : m_vertices)
+    {
+        usage += vertices.memoryUsage();
+    }
+    return usage;
+}
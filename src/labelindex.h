@@ -0,0 +1,57 @@
+#ifndef LABELINDEX_H
+#define LABELINDEX_H
+
+#include "types.h"
+#include "vertexbitmap.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Dictionary of the labels of a graph along with, for each label, the set of vertices that have it.
+/// Labels are interned: each label string is given a small integer ID the first time it is seen and keeps it for the
+/// lifetime of the index, even when no vertex has the label anymore.
+class LabelIndex
+{
+public:
+    /// Returns the ID of a label, creating it if this is the first time the label is seen.
+    LabelId intern(const std::string& label);
+
+    /// Look up the ID of a label without creating it.
+    /// @returns false if the label has never been seen.
+    bool find(const std::string& label, LabelId& id) const;
+
+    /// Returns the name of a label. The label must exist.
+    const std::string& name(LabelId id) const { return m_names[id]; }
+
+    /// Returns the number of labels in the dictionary.
+    size_t labelCount() const { return m_names.size(); }
+
+    /// Returns the vertices that have a label. The label must exist.
+    const VertexBitmap& vertices(LabelId id) const { return m_vertices[id]; }
+
+    /// Add a label to a vertex.
+    /// @returns true if the vertex did not have the label already.
+    bool add(VertexId vertex, LabelId id) { return m_vertices[id].insert(vertex); }
+
+    /// Remove a label from a vertex.
+    /// @returns true if the vertex had the label.
+    bool remove(VertexId vertex, LabelId id) { return m_vertices[id].erase(vertex); }
+
+    /// Renumber the vertices: vertex id becomes newIds[id - 1] in the set of every label.
+    void renumber(const std::vector<VertexId>& newIds);
+
+    /// Returns the IDs of the labels a vertex has, in increasing order. This tests every label of the dictionary so its
+    /// cost grows with the number of labels, not with the number of labels of the vertex.
+    std::vector<LabelId> labelsOf(VertexId vertex) const;
+
+    /// Returns the number of bytes used by the vertex sets of all the labels.
+    size_t memoryUsage() const;
+
+private:
+    std::unordered_map<std::string, LabelId> m_ids;
+    // The name and the vertices of each label. The position in the vectors is the ID of the label.
+    std::vector<std::string> m_names;
+    std::vector<VertexBitmap> m_vertices;
+};
+
+#endif
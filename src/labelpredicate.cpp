@@ -0,0 +1,86 @@
+#include "labelpredicate.h"
+#include <utility>
+
+namespace
+{
+    std::string Quote(const std::string& label)
+    {
+        std::string quoted = "\"";
+        for (char c : label)
+        {
+            if ((c == '"') || (c == '\\'))
+            {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+}
+
+LabelPredicate LabelPredicate::has(const std::string& label)
+{
+    return LabelPredicate(std::make_shared<const Node>(Node{ Operator::Label, label, nullptr, nullptr }),
+        Quote(label));
+}
+
+LabelPredicate operator&&(const LabelPredicate& left, const LabelPredicate& right)
+{
+    typedef LabelPredicate::Node Node;
+    return LabelPredicate(std::make_shared<const Node>(Node{ LabelPredicate::Operator::And, std::string(), left.m_root,
+        right.m_root }), "(" + left.m_text + " AND " + right.m_text + ")");
+}
+
+LabelPredicate operator||(const LabelPredicate& left, const LabelPredicate& right)
+{
+    typedef LabelPredicate::Node Node;
+    return LabelPredicate(std::make_shared<const Node>(Node{ LabelPredicate::Operator::Or, std::string(), left.m_root,
+        right.m_root }), "(" + left.m_text + " OR " + right.m_text + ")");
+}
+
+LabelPredicate operator!(const LabelPredicate& operand)
+{
+    typedef LabelPredicate::Node Node;
+    return LabelPredicate(std::make_shared<const Node>(Node{ LabelPredicate::Operator::Not, std::string(),
+        operand.m_root, nullptr }), "NOT " + operand.m_text);
+}
+
+void LabelPredicate::ClearInvalid(size_t vertexCount, std::vector<uint64_t>& words)
+{
+    words[0] &= ~uint64_t(1);
+    const size_t used_bits = (vertexCount + 1) & 63;
+    if (used_bits != 0)
+    {
+        words.back() &= (uint64_t(1) << used_bits) - 1;
+    }
+}
+
+size_t MaskCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void MaskCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+void MaskCache::insert(const std::string& text, std::shared_ptr<const Mask> mask, uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[text] = Entry{ std::move(mask), generation, ++m_clock };
+    if (m_entries.size() > Capacity)
+    {
+        auto oldest = m_entries.begin();
+        for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry)
+        {
+            if (entry->second.m_last_use < oldest->second.m_last_use)
+            {
+                oldest = entry;
+            }
+        }
+        m_entries.erase(oldest);
+    }
+}
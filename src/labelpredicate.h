@@ -0,0 +1,193 @@
+#ifndef LABELPREDICATE_H
+#define LABELPREDICATE_H
+
+#include "bitsetkernels.h"
+#include "types.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// A boolean expression over the labels of a vertex, such as "has A and (B or not C)", written
+/// LabelPredicate::has("A") && (LabelPredicate::has("B") || !LabelPredicate::has("C")).
+/// A search restricted to a predicate first evaluates it to a bitset of the vertices that match, one bit per vertex
+/// ID, with word-wise AND, OR and AND NOT over the vertex sets of the labels. The traversal then tests one bit per
+/// neighbour, whatever the size of the expression. See MaskCache.
+class LabelPredicate
+{
+public:
+    /// The vertices that have a label. A label no vertex ever had matches no vertex.
+    static LabelPredicate has(const std::string& label);
+
+    friend LabelPredicate operator&&(const LabelPredicate& left, const LabelPredicate& right);
+    friend LabelPredicate operator||(const LabelPredicate& left, const LabelPredicate& right);
+    friend LabelPredicate operator!(const LabelPredicate& operand);
+
+    /// Returns the expression as text, for instance ("A" AND ("B" OR NOT "C")). The label names are quoted so two
+    /// predicates with the same text match the same vertices.
+    const std::string& text() const { return m_text; }
+
+    /// Evaluate the predicate.
+    /// @param labels The labels of the graph, a LabelIndex or a MappedLabelIndex.
+    /// @param vertexCount The number of vertices of the graph.
+    /// @param level The instruction set of the word-wise operations.
+    /// @param words Receives vertexCount / 64 + 1 words, bit i being set if vertex i matches.
+    template <typename Labels>
+    void evaluate(const Labels& labels, size_t vertexCount, SimdLevel level, std::vector<uint64_t>& words) const
+    {
+        words.assign((vertexCount / 64) + 1, 0);
+        evaluate(*m_root, labels, vertexCount, level, words);
+    }
+
+private:
+    enum class Operator
+    {
+        Label,
+        And,
+        Or,
+        Not
+    };
+
+    struct Node
+    {
+        Operator m_operator;
+        // The label of Operator::Label nodes.
+        std::string m_label;
+        // The operands. Operator::Not only has a left one.
+        std::shared_ptr<const Node> m_left;
+        std::shared_ptr<const Node> m_right;
+    };
+
+    LabelPredicate(std::shared_ptr<const Node> root, std::string text) :
+        m_root(std::move(root)), m_text(std::move(text))
+    {
+    }
+
+    // Evaluates a node into words, which have the right size. AND NOT is fused: a AND NOT b never complements b.
+    template <typename Labels>
+    static void evaluate(const Node& node, const Labels& labels, size_t vertexCount, SimdLevel level,
+        std::vector<uint64_t>& words)
+    {
+        if (node.m_operator == Operator::Label)
+        {
+            LabelId label_id;
+            if (labels.find(node.m_label, label_id))
+            {
+                labels.vertices(label_id).copyTo(words);
+            }
+            else
+            {
+                std::fill(words.begin(), words.end(), 0);
+            }
+            return;
+        }
+        if (node.m_operator == Operator::Not)
+        {
+            evaluate(*node.m_left, labels, vertexCount, level, words);
+            NotWords(words.data(), words.size(), level);
+            ClearInvalid(vertexCount, words);
+            return;
+        }
+
+        const Node* left = node.m_left.get();
+        const Node* right = node.m_right.get();
+        const bool and_not = (node.m_operator == Operator::And) &&
+            ((right->m_operator == Operator::Not) || (left->m_operator == Operator::Not));
+        if (and_not && (right->m_operator != Operator::Not))
+        {
+            std::swap(left, right);
+        }
+        std::vector<uint64_t> operand(words.size());
+        evaluate(*left, labels, vertexCount, level, words);
+        evaluate(and_not ? *right->m_left : *right, labels, vertexCount, level, operand);
+        if (and_not)
+        {
+            AndNotWords(words.data(), operand.data(), words.size(), level);
+        }
+        else if (node.m_operator == Operator::And)
+        {
+            AndWords(words.data(), operand.data(), words.size(), level);
+        }
+        else
+        {
+            OrWords(words.data(), operand.data(), words.size(), level);
+        }
+    }
+
+    // Clears the bits of vertex 0 and of the IDs past the last vertex, which a complement sets.
+    static void ClearInvalid(size_t vertexCount, std::vector<uint64_t>& words);
+
+    std::shared_ptr<const Node> m_root;
+    std::string m_text;
+};
+
+/// The bitsets of the predicates searched recently, keyed by their text, so that repeated queries with the same
+/// predicate evaluate it once. Each bitset is stamped with a generation chosen by the owner, which changes it whenever
+/// the labels or the number of vertices change; a bitset of an older generation is evaluated again. The cache keeps
+/// the Capacity bitsets used last. It is thread safe, and copying it gives an empty cache.
+class MaskCache
+{
+public:
+    static const size_t Capacity = 64;
+
+    typedef std::vector<uint64_t> Mask;
+
+    MaskCache() {}
+    MaskCache(const MaskCache&) {}
+    MaskCache& operator=(const MaskCache&)
+    {
+        clear();
+        return *this;
+    }
+
+    /// Returns the bitset of a predicate, evaluating it if it is not in the cache or is stale.
+    /// See LabelPredicate::evaluate.
+    template <typename Labels>
+    std::shared_ptr<const Mask> mask(const LabelPredicate& predicate, const Labels& labels, size_t vertexCount,
+        uint64_t generation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_entries.find(predicate.text());
+            if ((found != m_entries.end()) && (found->second.m_generation == generation))
+            {
+                found->second.m_last_use = ++m_clock;
+                return found->second.m_mask;
+            }
+        }
+
+        // Evaluated outside of the lock so that queries on other predicates don't wait. Two threads may evaluate the
+        // same predicate at the same time, the last one wins.
+        std::shared_ptr<Mask> mask = std::make_shared<Mask>();
+        predicate.evaluate(labels, vertexCount, DetectSimdLevel(), *mask);
+        insert(predicate.text(), mask, generation);
+        return mask;
+    }
+
+    /// Returns the number of bitsets in the cache.
+    size_t size() const;
+
+    /// Drop all the bitsets.
+    void clear();
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const Mask> m_mask;
+        uint64_t m_generation;
+        // The value of m_clock when the bitset was last returned.
+        uint64_t m_last_use;
+    };
+
+    void insert(const std::string& text, std::shared_ptr<const Mask> mask, uint64_t generation);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    uint64_t m_clock = 0;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "landmarkindex.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t Infinite = std::numeric_limits<uint32_t>::max();
+
+    // Breadth-first search from the sources over the edges of one or two adjacencies, filling the distance of every
+    // vertex, Infinite for the vertices it doesn't reach.
+    template <typename Adjacency>
+    void Bfs(const Adjacency& first, const Adjacency* second, const std::vector<VertexId>& sources,
+        std::vector<uint32_t>& distances)
+    {
+        distances.assign(first.vertexCount() + 1, Infinite);
+        std::vector<VertexId> frontier;
+        for (VertexId source : sources)
+        {
+            distances[source] = 0;
+            frontier.push_back(source);
+        }
+        std::vector<VertexId> next_frontier;
+        for (uint32_t distance = 1; !frontier.empty(); ++distance)
+        {
+            next_frontier.clear();
+            for (VertexId vertex : frontier)
+            {
+                for (const Adjacency* adjacency = &first; adjacency != nullptr;
+                    adjacency = (adjacency == &first) ? second : nullptr)
+                {
+                    for (VertexId neighbour : adjacency->neighbours(vertex))
+                    {
+                        if (distances[neighbour] == Infinite)
+                        {
+                            distances[neighbour] = distance;
+                            next_frontier.push_back(neighbour);
+                        }
+                    }
+                }
+            }
+            frontier.swap(next_frontier);
+        }
+    }
+
+    template <typename Adjacency>
+    std::vector<VertexId> PickLandmarks(const Adjacency& forward, const Adjacency& reverse,
+        const LandmarkOptions& options)
+    {
+        const size_t vertex_count = forward.vertexCount();
+        std::vector<size_t> degrees(vertex_count + 1, 0);
+        std::vector<VertexId> candidates;
+        for (VertexId vertex = 1; vertex <= vertex_count; ++vertex)
+        {
+            degrees[vertex] = forward.neighbours(vertex).size() + reverse.neighbours(vertex).size();
+            // An isolated vertex bounds nothing.
+            if (degrees[vertex] > 0)
+            {
+                candidates.push_back(vertex);
+            }
+        }
+        const size_t count = std::min(options.count, candidates.size());
+        auto by_degree = [&](VertexId a, VertexId b)
+        {
+            return (degrees[a] > degrees[b]) || ((degrees[a] == degrees[b]) && (a < b));
+        };
+
+        if (options.selection == LandmarkSelection::Degree)
+        {
+            std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), by_degree);
+            candidates.resize(count);
+            return candidates;
+        }
+
+        // Each new landmark is the candidate farthest from the ones picked so far, the vertices they can't reach
+        // first, and the one with the most edges among equally far candidates. The multi-source BFS gives the
+        // distance to the closest landmark.
+        std::vector<VertexId> landmarks;
+        std::vector<uint32_t> distances;
+        while (landmarks.size() < count)
+        {
+            VertexId best = 0;
+            if (landmarks.empty())
+            {
+                best = *std::min_element(candidates.begin(), candidates.end(), by_degree);
+            }
+            else
+            {
+                Bfs(forward, &reverse, landmarks, distances);
+                for (VertexId vertex : candidates)
+                {
+                    if ((best == 0) || (distances[vertex] > distances[best]) ||
+                        ((distances[vertex] == distances[best]) && by_degree(vertex, best)))
+                    {
+                        best = vertex;
+                    }
+                }
+            }
+            landmarks.push_back(best);
+        }
+        return landmarks;
+    }
+
+    // Copies the distances of one landmark into its column of the table, clamped to UINT16_MAX - 1, UINT16_MAX meaning
+    // unreachable. Returns the longest distance.
+    uint32_t FillColumn(const std::vector<uint32_t>& distances, size_t column, size_t rowSize,
+        std::vector<uint16_t>& table)
+    {
+        uint32_t longest = 0;
+        for (size_t vertex = 1; vertex < distances.size(); ++vertex)
+        {
+            const uint32_t distance = distances[vertex];
+            if (distance == Infinite)
+            {
+                table[(vertex * rowSize) + column] = UINT16_MAX;
+                continue;
+            }
+            longest = std::max(longest, distance);
+            table[(vertex * rowSize) + column] = static_cast<uint16_t>(std::min<uint32_t>(distance, UINT16_MAX - 1));
+        }
+        return longest;
+    }
+}
+
+template <typename Adjacency>
+LandmarkIndex::LandmarkIndex(const Adjacency& forward, const Adjacency& reverse, const LandmarkOptions& options,
+    uint64_t generation) :
+    m_generation(generation)
+{
+    if (options.count > MaxLandmarkCount)
+    {
+        throw std::runtime_error("Too many landmarks");
+    }
+
+    m_landmarks = PickLandmarks(forward, reverse, options);
+    m_row_count = forward.vertexCount() + 1;
+    const size_t landmark_count = m_landmarks.size();
+    const size_t row_size = 2 * landmark_count;
+
+    // The distances go into the two-byte table first, as the width of the table depends on the longest one, and are
+    // narrowed at the end if they all fit in a byte.
+    m_wide.assign(m_row_count * row_size, 0);
+    std::vector<uint32_t> longest(row_size, 0);
+    auto compute = [&](size_t begin, size_t end)
+    {
+        std::vector<uint32_t> distances;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const std::vector<VertexId> source(1, m_landmarks[i / 2]);
+            Bfs<Adjacency>(((i % 2) == 0) ? forward : reverse, nullptr, source, distances);
+            longest[i] = FillColumn(distances, i, row_size, m_wide);
+        }
+    };
+    if (options.pool != nullptr)
+    {
+        options.pool->parallelFor(row_size, 1, compute);
+    }
+    else
+    {
+        compute(0, row_size);
+    }
+
+    if (longest.empty() || (*std::max_element(longest.begin(), longest.end()) < UINT8_MAX))
+    {
+        m_narrow.resize(m_wide.size());
+        for (size_t i = 0; i < m_wide.size(); ++i)
+        {
+            m_narrow[i] = (m_wide[i] == UINT16_MAX) ? UINT8_MAX : static_cast<uint8_t>(m_wide[i]);
+        }
+        std::vector<uint16_t>().swap(m_wide);
+    }
+}
+
+template LandmarkIndex::LandmarkIndex(const CsrAdjacency&, const CsrAdjacency&, const LandmarkOptions&, uint64_t);
+template LandmarkIndex::LandmarkIndex(const CompactCsrAdjacency&, const CompactCsrAdjacency&, const LandmarkOptions&,
+    uint64_t);
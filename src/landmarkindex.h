@@ -0,0 +1,162 @@
+#ifndef LANDMARKINDEX_H
+#define LANDMARKINDEX_H
+
+#include "csradjacency.h"
+#include "threadpool.h"
+#include "types.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// How LandmarkIndex picks its landmarks.
+enum class LandmarkSelection
+{
+    /// The vertices with the most edges, in and out.
+    Degree,
+    /// The vertex with the most edges, then each time the vertex farthest from the landmarks picked so far, ignoring
+    /// the direction of the edges. This spreads the landmarks over the edges of the graph and usually gives tighter
+    /// bounds than Degree.
+    FarthestPoint
+};
+
+/// Options of LandmarkIndex.
+struct LandmarkOptions
+{
+    /// The number of landmarks, at most LandmarkIndex::MaxLandmarkCount. Each one costs 2 or 4 bytes per vertex.
+    size_t count = 16;
+    /// How the landmarks are picked.
+    LandmarkSelection selection = LandmarkSelection::FarthestPoint;
+    /// The threads the distances of the landmarks are computed on, or nullptr to compute them on the calling thread.
+    ThreadPool* pool = nullptr;
+};
+
+/// Distances between a few landmark vertices and every other vertex, used by SearchAlgorithm::Alt as the heuristic of
+/// A* (Goldberg and Harrelson, "Computing the Shortest Path: A* Search Meets Graph Theory").
+/// For a landmark L the triangle inequality gives two lower bounds of the distance from v to t: d(L, t) - d(L, v) and
+/// d(v, L) - d(t, L). The heuristic is the largest of these bounds over the landmarks, which is admissible and
+/// consistent, so A* still finds a shortest path while expanding the vertices that lead toward t first. The distances
+/// are the ones of the whole graph, which are never longer than those through the vertices of a label, so the bounds
+/// hold whatever the label of the query. The tables also prove some pairs unreachable: if L reaches v but not t, or
+/// t reaches L but v doesn't, v can't reach t.
+/// The distances are stored in one byte each when they all fit, in two bytes otherwise; longer distances are clamped,
+/// which keeps the bounds admissible. The tables are only valid for the edges they were built from: the store that
+/// owns them stops using them as soon as an edge is added.
+class LandmarkIndex
+{
+public:
+    static const size_t MaxLandmarkCount = 64;
+
+    /// Pick the landmarks and compute their distances to and from every vertex.
+    /// @param forward The edges of the graph.
+    /// @param reverse The same edges reversed.
+    /// @param options How many landmarks to pick and how.
+    /// @param generation Identifies the edges the tables are built from, see generation().
+    /// Defined for CsrAdjacency and CompactCsrAdjacency.
+    template <typename Adjacency>
+    LandmarkIndex(const Adjacency& forward, const Adjacency& reverse, const LandmarkOptions& options,
+        uint64_t generation);
+
+    /// Returns the value given to the constructor. GraphStore passes the number of times its edges had changed.
+    uint64_t generation() const { return m_generation; }
+
+    /// Returns the landmarks.
+    const std::vector<VertexId>& landmarks() const { return m_landmarks; }
+
+    /// Returns the number of bytes used by the tables.
+    size_t memoryUsage() const { return m_narrow.capacity() + (m_wide.capacity() * sizeof(uint16_t)); }
+
+private:
+    friend class LandmarkHeuristic;
+
+    // The row of a vertex holds, for each landmark in turn, the distance from the landmark to the vertex and the
+    // distance from the vertex to the landmark. Exactly one of the two tables is used.
+    std::vector<uint8_t> m_narrow;
+    std::vector<uint16_t> m_wide;
+    std::vector<VertexId> m_landmarks;
+    // The number of rows, vertex 0 included.
+    size_t m_row_count = 0;
+    uint64_t m_generation;
+};
+
+/// The A* heuristic of the searches toward one destination. See LandmarkIndex.
+class LandmarkHeuristic
+{
+public:
+    /// The estimate of the vertices that can't reach the destination.
+    static const uint32_t Unreachable = UINT32_MAX;
+
+    LandmarkHeuristic(const LandmarkIndex& index, VertexId to) :
+        m_index(index), m_row_size(2 * index.m_landmarks.size()), m_landmark_count(index.m_landmarks.size()),
+        m_wide(!index.m_wide.empty()), m_unreachable(m_wide ? UINT16_MAX : UINT8_MAX)
+    {
+        if (to >= index.m_row_count)
+        {
+            // The tables don't know the destination and give no bound.
+            m_landmark_count = 0;
+            return;
+        }
+        for (size_t i = 0; i < m_row_size; ++i)
+        {
+            m_target[i] = m_wide ? index.m_wide[(to * m_row_size) + i] : index.m_narrow[(to * m_row_size) + i];
+        }
+    }
+
+    /// Returns a lower bound of the distance from a vertex to the destination, or Unreachable.
+    uint32_t estimate(VertexId vertex) const
+    {
+        if ((vertex >= m_index.m_row_count) || (m_landmark_count == 0))
+        {
+            return 0;
+        }
+        return m_wide ? estimate(&m_index.m_wide[vertex * m_row_size]) :
+            estimate(&m_index.m_narrow[vertex * m_row_size]);
+    }
+
+private:
+    template <typename Distance>
+    uint32_t estimate(const Distance* row) const
+    {
+        uint32_t bound = 0;
+        for (size_t i = 0; i < m_landmark_count; ++i)
+        {
+            const uint32_t from_landmark = row[2 * i];
+            const uint32_t to_landmark = row[(2 * i) + 1];
+            const uint32_t target_from_landmark = m_target[2 * i];
+            const uint32_t target_to_landmark = m_target[(2 * i) + 1];
+            if (from_landmark != m_unreachable)
+            {
+                if (target_from_landmark == m_unreachable)
+                {
+                    return Unreachable;
+                }
+                if (target_from_landmark > from_landmark)
+                {
+                    bound = std::max(bound, target_from_landmark - from_landmark);
+                }
+            }
+            if (target_to_landmark != m_unreachable)
+            {
+                if (to_landmark == m_unreachable)
+                {
+                    return Unreachable;
+                }
+                if (to_landmark > target_to_landmark)
+                {
+                    bound = std::max(bound, to_landmark - target_to_landmark);
+                }
+            }
+        }
+        return bound;
+    }
+
+    const LandmarkIndex& m_index;
+    size_t m_row_size;
+    size_t m_landmark_count;
+    bool m_wide;
+    uint32_t m_unreachable;
+    // The row of the destination.
+    std::array<uint32_t, 2 * LandmarkIndex::MaxLandmarkCount> m_target;
+};
+
+#endif
@@ -1,7 +1,19 @@
+#include "concurrentgraphstore.h"
+#include "durablegraphstore.h"
 #include "graphstore.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
 
 namespace
 {
@@ -25,26 +37,32 @@ namespace
     {
         GraphStore graph_store;
 
+        const VertexId first_id = graph_store.createVertices(vertex_count);
+        std::vector<VertexId> vertices;
         for (size_t i = 0; i < vertex_count; ++i)
         {
-            VertexId v_id = graph_store.createVertex();
-            graph_store.addLabel(v_id, "label 1");
+            vertices.push_back(first_id + i);
         }
+        graph_store.addLabelToVertices("label 1", vertices);
 
         std::mt19937 rng(0);
         std::uniform_int_distribution<std::mt19937::result_type> dist(1, static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
         for (size_t i = 0; i < edge_count; ++i)
         {
             VertexId from = dist(rng);
             VertexId to = dist(rng);
             if (from != to)
             {
-                graph_store.createEdge(from, to);
+                edges.emplace_back(from, to);
             }
         }
+        graph_store.createEdges(edges, nullptr);
+
+        graph_store.freeze();
 
         return graph_store;
-    } 
+    }
 
     // Checks that a path is found in a graph with 2 vertices.
     void SimpleTest1()
@@ -279,156 +297,2602 @@ namespace
         std::cout << std::endl;
     }
 
-    // Performance test with 10,000 vertices and 10,000 edges
-    void PerfTest1()
+    // Checks that a frozen graph gives the same answer as the mutable one and that mutating it discards the frozen
+    // copy.
+    void SnapshotTest1()
     {
-        std::cout << "PerfTest1" << std::endl;
+        std::cout << "SnapshotTest1" << std::endl;
 
-        GraphStore graph_store = CreateLargeGraphStore(10000, 10000);
+        GraphStore graph_store;
+
+        VertexId v_id_1 = graph_store.createVertex();
+        graph_store.addLabel(v_id_1, "label 1");
+        VertexId v_id_2 = graph_store.createVertex();
+        graph_store.addLabel(v_id_2, "label 1");
+        VertexId v_id_3 = graph_store.createVertex();
+        graph_store.addLabel(v_id_3, "label 1");
 
-        std::mt19937 rng(1);
-        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 10000);
+        graph_store.createEdge(v_id_1, v_id_2);
+        graph_store.createEdge(v_id_2, v_id_3);
 
-        std::chrono::microseconds total_time{0};
+        graph_store.freeze();
+        const auto snapshot = graph_store.snapshot();
+        const auto frozen_path = graph_store.shortestPath(v_id_1, v_id_3, "label 1");
+        PrintPath(frozen_path);
 
-        size_t solutions_count = 0;
+        graph_store.createEdge(v_id_1, v_id_3);
+        const auto mutable_path = graph_store.shortestPath(v_id_1, v_id_3, "label 1");
+        PrintPath(mutable_path);
 
-        const size_t path_search_count = 100;
-        for (size_t i = 0; i < path_search_count; ++i)
+        if ((frozen_path == std::vector<VertexId>{1, 2, 3}) && (mutable_path == std::vector<VertexId>{1, 3}) &&
+            !graph_store.isFrozen() && snapshot && (snapshot->edgeCount() == 2))
         {
-            VertexId from = dist(rng);
-            VertexId to = dist(rng);
+            std::cout << "SnapshotTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "SnapshotTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
 
-            auto t1 = std::chrono::high_resolution_clock::now();
+    // Checks that the labels of a vertex can be listed, including after a label went from dense to sparse storage.
+    void LabelTest1()
+    {
+        std::cout << "LabelTest1" << std::endl;
+
+        GraphStore graph_store;
 
-            const auto path = graph_store.shortestPath(from, to, "label 1");
-            if (!path.empty())
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            VertexId v_id = graph_store.createVertex();
+            graph_store.addLabel(v_id, "label 1");
+            if ((v_id % 3) == 0)
             {
-                ++solutions_count;
+                graph_store.addLabel(v_id, "label 2");
             }
+        }
+        for (VertexId v_id = 100; v_id <= 10000; ++v_id)
+        {
+            graph_store.removeLabel(v_id, "label 1");
+        }
+        graph_store.removeLabel(1, "unknown label");
+
+        const auto labels_3 = graph_store.labels(3);
+        const auto labels_9999 = graph_store.labels(9999);
+        const auto labels_10000 = graph_store.labels(10000);
+        if ((labels_3 == std::vector<std::string>{"label 1", "label 2"}) &&
+            (labels_9999 == std::vector<std::string>{"label 2"}) && labels_10000.empty() &&
+            graph_store.shortestPath(1, 2, "label 2").empty())
+        {
+            std::cout << "LabelTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "LabelTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Checks that the bidirectional BFS finds paths of the same length as A* on a random graph, on both the mutable and
+    // the frozen edges.
+    void SearchTest1()
+    {
+        std::cout << "SearchTest1" << std::endl;
+
+        GraphStore graph_store = CreateLargeGraphStore(2000, 3000);
+        GraphStore mutable_graph_store = graph_store;
+        mutable_graph_store.createVertex();
 
-            auto t2 = std::chrono::high_resolution_clock::now();
+        QueryOptions a_star;
+        a_star.algorithm = SearchAlgorithm::AStar;
+
+        std::mt19937 rng(2);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 2000);
+
+        size_t solutions_count = 0;
+        bool passed = true;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            VertexId from = dist(rng);
+            VertexId to = dist(rng);
 
-            total_time += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+            const auto expected = graph_store.shortestPath(from, to, "label 1", a_star);
+            const auto frozen_path = graph_store.shortestPath(from, to, "label 1");
+            const auto mutable_path = mutable_graph_store.shortestPath(from, to, "label 1");
+            if ((frozen_path.size() != expected.size()) || (mutable_path.size() != expected.size()) ||
+                (!frozen_path.empty() && ((frozen_path.front() != from) || (frozen_path.back() != to))))
+            {
+                passed = false;
+            }
+            if (!expected.empty())
+            {
+                ++solutions_count;
+            }
         }
 
         std::cout << "Searches that found a path: " << solutions_count << std::endl;
-        std::cout << "Total time spent in shortestPath function: " << total_time.count() << "us" << std::endl;
+        if (passed && !graph_store.shortestPath(5, 5, "label 1").empty())
+        {
+            std::cout << "SearchTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "SearchTest1 failed" << std::endl;
+        }
         std::cout << std::endl;
     }
 
-    // Performance test with 100,000 vertices and 100,000 edges
-    void PerfTest2()
+    // Checks that a query context can be reused across searches and across graphs of different sizes.
+    void ContextTest1()
     {
-        std::cout << "PerfTest2" << std::endl;
+        std::cout << "ContextTest1" << std::endl;
 
-        GraphStore graph_store = CreateLargeGraphStore(100000, 100000);
+        GraphStore small_graph_store = CreateLargeGraphStore(100, 300);
+        GraphStore large_graph_store = CreateLargeGraphStore(2000, 3000);
 
-        std::mt19937 rng(1);
-        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 100000);
+        QueryOptions a_star;
+        a_star.algorithm = SearchAlgorithm::AStar;
 
-        std::chrono::microseconds total_time{0};
+        QueryContext context;
+        std::vector<VertexId> path;
 
-        size_t solutions_count = 0;
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 100);
 
-        const size_t path_search_count = 100;
-        for (size_t i = 0; i < path_search_count; ++i)
+        bool passed = true;
+        for (size_t i = 0; i < 100; ++i)
         {
             VertexId from = dist(rng);
             VertexId to = dist(rng);
 
-            auto t1 = std::chrono::high_resolution_clock::now();
-            
-            const auto path = graph_store.shortestPath(from, to, "label 1");
-            if (!path.empty())
+            const GraphStore& graph_store = ((i % 2) == 0) ? small_graph_store : large_graph_store;
+            const QueryOptions options = ((i % 3) == 0) ? a_star : QueryOptions();
+            const bool found = graph_store.shortestPath(from, to, "label 1", options, context, path);
+            const auto expected = graph_store.shortestPath(from, to, "label 1", a_star);
+            if ((found != !expected.empty()) || (path.size() != expected.size()))
             {
-                ++solutions_count;
+                passed = false;
             }
+        }
+
+        if (passed)
+        {
+            std::cout << "ContextTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "ContextTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Checks that a batch of queries gives the same paths as running them one by one, in the same order, and that an
+    // invalid query makes the batch throw.
+    void BatchTest1()
+    {
+        std::cout << "BatchTest1" << std::endl;
+
+        GraphStore graph_store = CreateLargeGraphStore(2000, 3000);
+        ThreadPool pool(4);
 
-            auto t2 = std::chrono::high_resolution_clock::now();
+        std::mt19937 rng(4);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 2000);
 
-            total_time += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+        std::vector<PathQuery> queries;
+        for (size_t i = 0; i < 500; ++i)
+        {
+            queries.push_back(PathQuery{dist(rng), dist(rng), "label 1"});
         }
 
-        std::cout << "Searches that found a path: " << solutions_count << std::endl;
-        std::cout << "Total time spent in shortestPath function: " << total_time.count() << "us" << std::endl;
+        const auto paths = graph_store.shortestPaths(queries, pool, QueryOptions());
+        bool passed = (paths.size() == queries.size());
+        for (size_t i = 0; passed && (i < queries.size()); ++i)
+        {
+            passed = (paths[i] == graph_store.shortestPath(queries[i].from, queries[i].to, queries[i].label));
+        }
+
+        queries[250].to = 3000;
+        bool thrown = false;
+        try
+        {
+            graph_store.shortestPaths(queries, pool, QueryOptions());
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+
+        if (passed && thrown)
+        {
+            std::cout << "BatchTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "BatchTest1 failed" << std::endl;
+        }
         std::cout << std::endl;
     }
 
-    // Performance test with 100,000 vertices and 150,000 edges
-    void PerfTest3()
+    // Checks that the parallel BFS finds paths of the same length as the bidirectional BFS, with and without a pool, on
+    // a graph dense enough for it to switch to bottom-up steps, and with a label that excludes some of the vertices.
+    void ParallelBfsTest1()
     {
-        std::cout << "PerfTest3" << std::endl;
+        std::cout << "ParallelBfsTest1" << std::endl;
 
-        GraphStore graph_store = CreateLargeGraphStore(100000, 150000);
+        GraphStore graph_store = CreateLargeGraphStore(20000, 80000);
+        for (VertexId v_id = 1; v_id <= 20000; ++v_id)
+        {
+            if ((v_id % 5) != 0)
+            {
+                graph_store.addLabel(v_id, "label 2");
+            }
+        }
+        ThreadPool pool(3);
 
-        std::mt19937 rng(1);
-        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 100000);
+        QueryOptions parallel;
+        parallel.algorithm = SearchAlgorithm::ParallelBfs;
+        QueryOptions parallel_with_pool = parallel;
+        parallel_with_pool.pool = &pool;
 
-        std::chrono::microseconds total_time{0};
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 20000);
 
         size_t solutions_count = 0;
-
-        const size_t path_search_count = 100;
-        for (size_t i = 0; i < path_search_count; ++i)
+        bool passed = true;
+        for (size_t i = 0; i < 100; ++i)
         {
             VertexId from = dist(rng);
             VertexId to = dist(rng);
-            
-            auto t1 = std::chrono::high_resolution_clock::now();
+            const std::string label = ((i % 2) == 0) ? "label 1" : "label 2";
 
-            const auto path = graph_store.shortestPath(from, to, "label 1");
-            if (!path.empty())
+            const auto expected = graph_store.shortestPath(from, to, label);
+            const auto path = graph_store.shortestPath(from, to, label, parallel);
+            const auto pool_path = graph_store.shortestPath(from, to, label, parallel_with_pool);
+            if ((path.size() != expected.size()) || (pool_path.size() != expected.size()) ||
+                (!pool_path.empty() && ((pool_path.front() != from) || (pool_path.back() != to))))
+            {
+                passed = false;
+            }
+            if (!expected.empty())
             {
                 ++solutions_count;
             }
+        }
+
+        std::cout << "Searches that found a path: " << solutions_count << std::endl;
+        if (passed)
+        {
+            std::cout << "ParallelBfsTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "ParallelBfsTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
 
-            auto t2 = std::chrono::high_resolution_clock::now();
+    // Checks that readers always see a consistent version of the graph while a writer keeps adding edges, and that the
+    // replaced versions are deleted once the readers are done with them.
+    void ConcurrencyTest1()
+    {
+        std::cout << "ConcurrencyTest1" << std::endl;
 
-            total_time += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+        const size_t vertex_count = 500;
+        ConcurrentGraphStore graph_store(8);
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            VertexId v_id = graph_store.createVertex();
+            graph_store.addLabel(v_id, "label 1");
         }
+        graph_store.publish();
 
-        std::cout << "Searches that found a path: " << solutions_count << std::endl;
-        std::cout << "Total time spent in shortestPath function: " << total_time.count() << "us" << std::endl;
+        std::atomic<bool> writing(true);
+        std::atomic<bool> passed(true);
+        auto read = [&]()
+        {
+            uint64_t last_version = 0;
+            while (writing)
+            {
+                const auto version = graph_store.pin();
+                // The writer builds the chain 1 -> 2 -> 3 ... so a version with n edges has a path of n + 1 vertices.
+                const size_t edge_count = version->edgeCount();
+                const auto path = version->shortestPath(1, edge_count + 1, "label 1");
+                if ((path.size() != edge_count + 1) || (version.versionNumber() < last_version))
+                {
+                    passed = false;
+                }
+                last_version = version.versionNumber();
+            }
+        };
+        std::thread reader_1(read);
+        std::thread reader_2(read);
+
+        for (VertexId v_id = 1; v_id < vertex_count; ++v_id)
+        {
+            graph_store.createEdge(v_id, v_id + 1);
+            if ((v_id % 10) == 0)
+            {
+                graph_store.publish();
+            }
+        }
+        graph_store.publish();
+        writing = false;
+        reader_1.join();
+        reader_2.join();
+        graph_store.reclaim();
+
+        const auto path = graph_store.shortestPath(1, vertex_count, "label 1");
+        if (passed && (path.size() == vertex_count) && (graph_store.retiredVersionCount() == 0))
+        {
+            std::cout << "ConcurrencyTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "ConcurrencyTest1 failed" << std::endl;
+        }
         std::cout << std::endl;
     }
 
-    // Performance test with 1,000,000 vertices and 1,500,000 edges. This test uses a dataset beyond what the spec asks
-    // for and takes more time than allowed.
-    void PerfTest4()
+    // Checks that the bulk operations build the same graph as creating the vertices, labels and edges one by one,
+    // including duplicate edges and edges that already exist, and that they change nothing when a vertex is invalid.
+    void BulkTest1()
     {
-        std::cout << "PerfTest4" << std::endl;
+        std::cout << "BulkTest1" << std::endl;
+
+        std::mt19937 rng(6);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 300);
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 600; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
 
-        GraphStore graph_store = CreateLargeGraphStore(1000000, 1500000);
+        GraphStore graph_store;
+        for (size_t i = 0; i < 300; ++i)
+        {
+            VertexId v_id = graph_store.createVertex();
+            graph_store.addLabel(v_id, "label 1");
+        }
+        for (const auto& edge : edges)
+        {
+            graph_store.createEdge(edge.first, edge.second);
+        }
 
-        std::mt19937 rng(1);
-        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 1000000);
+        ThreadPool pool(2);
+        GraphStore bulk_graph_store;
+        const VertexId first_id = bulk_graph_store.createVertices(300);
+        std::vector<VertexId> vertices;
+        for (VertexId v_id = 300; v_id >= first_id; --v_id)
+        {
+            vertices.push_back(v_id);
+        }
+        bulk_graph_store.addLabelToVertices("label 1", vertices);
+        bulk_graph_store.createEdge(edges[0].first, edges[0].second);
+        bulk_graph_store.createEdges(std::vector<std::pair<VertexId, VertexId>>(edges.begin(), edges.begin() + 300),
+            &pool);
+        bulk_graph_store.createEdges(edges, nullptr);
+
+        bool thrown = false;
+        try
+        {
+            bulk_graph_store.createEdges(std::vector<std::pair<VertexId, VertexId>>{{1, 2}, {1, 301}}, nullptr);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
 
-        std::chrono::microseconds total_time{ 0 };
+        graph_store.freeze();
+        bulk_graph_store.freeze();
+        bool passed = thrown && (first_id == 1) &&
+            (bulk_graph_store.snapshot()->edgeCount() == graph_store.snapshot()->edgeCount());
+        for (VertexId v_id = 2; passed && (v_id <= 300); ++v_id)
+        {
+            const auto expected = graph_store.shortestPath(1, v_id, "label 1");
+            passed = (bulk_graph_store.shortestPath(1, v_id, "label 1") == expected);
+        }
 
-        size_t solutions_count = 0;
+        if (passed)
+        {
+            std::cout << "BulkTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "BulkTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Checks that a graph saved to a snapshot file and mapped back gives the same paths, and that a damaged file is
+    // rejected.
+    void SnapshotFileTest1()
+    {
+        std::cout << "SnapshotFileTest1" << std::endl;
+
+        const std::string path = "SnapshotFileTest1.graph";
+        GraphStore graph_store = CreateLargeGraphStore(2000, 3000);
+        for (VertexId v_id = 1; v_id <= 2000; v_id += 3)
+        {
+            graph_store.addLabel(v_id, "label 2");
+        }
+        graph_store.save(path);
 
-        const size_t path_search_count = 100;
-        for (size_t i = 0; i < path_search_count; ++i)
+        const auto mapped = GraphStore::open(path, false);
+        const auto verified = GraphStore::open(path, true);
+
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 2000);
+
+        bool passed = (mapped->vertexCount() == 2000) && (mapped->edgeCount() == graph_store.snapshot()->edgeCount());
+        for (size_t i = 0; passed && (i < 200); ++i)
         {
             VertexId from = dist(rng);
             VertexId to = dist(rng);
+            const std::string label = ((i % 2) == 0) ? "label 1" : "label 2";
+            const auto expected = graph_store.shortestPath(from, to, label);
+            passed = (mapped->shortestPath(from, to, label) == expected) &&
+                (verified->shortestPath(from, to, label) == expected);
+        }
+
+        // Flip a byte in the middle of the adjacency.
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(1000);
+            file.put('\x7f');
+        }
+        bool thrown = false;
+        try
+        {
+            GraphStore::open(path, true);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        std::remove(path.c_str());
 
-            auto t1 = std::chrono::high_resolution_clock::now();
+        if (passed && thrown)
+        {
+            std::cout << "SnapshotFileTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "SnapshotFileTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
 
-            const auto path = graph_store.shortestPath(from, to, "label 1");
-            if (!path.empty())
+    void WalTest1()
+    {
+        std::cout << "WalTest1" << std::endl;
+
+        const std::string path = "WalTest1.graph";
+        const std::string log_path = path + ".wal";
+        const std::string new_path = path + ".new";
+        std::remove(path.c_str());
+        std::remove(log_path.c_str());
+        std::remove(new_path.c_str());
+
+        WalOptions options;
+        options.group_size = 64;
+
+        // Same mutations on a plain graph to compare with.
+        GraphStore expected;
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 500);
+        auto mutate = [&](DurableGraphStore& durable, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
             {
-                ++solutions_count;
+                VertexId from = dist(rng);
+                VertexId to = dist(rng);
+                durable.createEdge(from, to);
+                expected.createEdge(from, to);
+                const std::string label = ((i % 3) == 0) ? "label 2" : "label 1";
+                durable.addLabel(from, label);
+                expected.addLabel(from, label);
+                if ((i % 7) == 0)
+                {
+                    durable.removeLabel(to, "label 1");
+                    expected.removeLabel(to, "label 1");
+                }
             }
+        };
+        auto matches = [&](const GraphStore& graph)
+        {
+            bool same = true;
+            for (VertexId v_id = 1; same && (v_id <= 500); v_id += 7)
+            {
+                const VertexId to = 501 - v_id;
+                same = (graph.labels(v_id) == expected.labels(v_id)) &&
+                    (graph.shortestPath(v_id, to, "label 1") == expected.shortestPath(v_id, to, "label 1")) &&
+                    (graph.shortestPath(v_id, to, "label 2") == expected.shortestPath(v_id, to, "label 2"));
+            }
+            return same;
+        };
 
-            auto t2 = std::chrono::high_resolution_clock::now();
+        bool passed = true;
+        {
+            DurableGraphStore durable(path, options);
+            durable.createVertices(500);
+            expected.createVertices(500);
+            mutate(durable, 1000);
+            passed = (durable.log().syncCount() > 1);
+
+            // The last records are synced once their window has passed, without waiting for another record.
+            const size_t sync_count = durable.log().syncCount();
+            durable.createEdge(1, 2);
+            expected.createEdge(1, 2);
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while ((durable.log().pendingCount() != 0) && (std::chrono::steady_clock::now() < deadline))
+            {
+                std::this_thread::sleep_for(options.group_window);
+            }
+            passed = passed && (durable.log().pendingCount() == 0) && (durable.log().syncCount() > sync_count);
+        }
+        {
+            // Recovery from the log alone.
+            DurableGraphStore durable(path, options);
+            passed = passed && (durable.replayedRecordCount() > 2000) && matches(durable.graph());
+            durable.checkpoint();
+            mutate(durable, 200);
+            durable.commit();
+        }
 
-            total_time += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+        // A crash in the middle of a write leaves a torn record at the end of the log.
+        {
+            std::ofstream file(log_path, std::ios::binary | std::ios::app);
+            file.put('\x02');
+            file.put('\x81');
+        }
+        std::string old_log;
+        {
+            // Recovery from the checkpoint and the records logged after it.
+            DurableGraphStore durable(path, options);
+            passed = passed && matches(durable.graph());
+            std::ifstream file(log_path, std::ios::binary);
+            old_log.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            durable.checkpoint();
         }
 
-        std::cout << "Searches that found a path: " << solutions_count << std::endl;
-        std::cout << "Total time spent in shortestPath function: " << total_time.count() << "us" << std::endl;
+        // A crash right after a checkpoint, before the log was emptied, leaves the log of the previous checkpoint.
+        {
+            std::ofstream file(log_path, std::ios::binary | std::ios::trunc);
+            file.write(old_log.data(), static_cast<std::streamsize>(old_log.size()));
+        }
+        std::string old_checkpoint;
+        {
+            DurableGraphStore durable(path, options);
+            passed = passed && (durable.replayedRecordCount() == 0) && matches(durable.graph());
+            std::ifstream file(path, std::ios::binary);
+            old_checkpoint.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            durable.checkpoint();
+            mutate(durable, 100);
+            durable.commit();
+        }
+
+        // A crash after the log was emptied, but before the rename of the new checkpoint reached the disk, leaves the
+        // previous checkpoint, the new one under its temporary name and a log that goes with the new one.
+        std::rename(path.c_str(), new_path.c_str());
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(old_checkpoint.data(), static_cast<std::streamsize>(old_checkpoint.size()));
+        }
+        {
+            DurableGraphStore durable(path, options);
+            passed = passed && (durable.replayedRecordCount() > 100) && matches(durable.graph()) &&
+                !std::ifstream(new_path).good();
+        }
+        std::remove(path.c_str());
+        std::remove(log_path.c_str());
+
+        if (passed)
+        {
+            std::cout << "WalTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "WalTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void StatsTest1()
+    {
+        std::cout << "StatsTest1" << std::endl;
+
+        // A chain 1 -> 2 -> ... -> 10 where vertex 5 also leads to vertex 11, which lacks the label.
+        GraphStore graph_store;
+        for (int i = 0; i < 11; ++i)
+        {
+            graph_store.createVertex();
+        }
+        for (VertexId v_id = 1; v_id < 10; ++v_id)
+        {
+            graph_store.createEdge(v_id, v_id + 1);
+            graph_store.addLabel(v_id, "label 1");
+        }
+        graph_store.addLabel(10, "label 1");
+        graph_store.createEdge(5, 11);
+
+        QueryStats stats;
+        QueryOptions options;
+        options.stats = &stats;
+        QueryContext context;
+        std::vector<VertexId> path;
+
+        bool passed = graph_store.shortestPath(1, 10, "label 1", options, context, path) && stats.found &&
+            (stats.vertices_popped >= 9) && (stats.edges_scanned >= 9) && (stats.label_rejects == 1) &&
+            (stats.peak_frontier >= 1) && (stats.allocations > 0);
+
+        // The context is warm now.
+        passed = passed && graph_store.shortestPath(1, 10, "label 1", options, context, path) &&
+            (stats.allocations == 0) && (stats.label_rejects == 1);
+
+        options.algorithm = SearchAlgorithm::AStar;
+        passed = passed && graph_store.shortestPath(1, 10, "label 1", options, context, path) &&
+            (stats.label_rejects == 1) && (stats.vertices_popped == 10);
+
+        GraphStore::setMetricsEnabled(true);
+        const MetricsSnapshot before = GraphStore::metrics();
+        graph_store.shortestPath(1, 10, "label 1");
+        graph_store.shortestPath(10, 1, "label 1");
+        const MetricsSnapshot after = GraphStore::metrics();
+        GraphStore::setMetricsEnabled(false);
+        graph_store.shortestPath(1, 10, "label 1");
+
+        passed = passed && (after.queries == before.queries + 2) && (after.paths_found == before.paths_found + 1) &&
+            (after.label_rejects == before.label_rejects + 1) && (GraphStore::metrics().queries == after.queries) &&
+            (after.duration_seconds.count == after.queries);
+
+        const std::string text = PrometheusText(after);
+        passed = passed && (text.find("# TYPE graphstore_queries_total counter") != std::string::npos) &&
+            (text.find("graphstore_query_duration_seconds_bucket{le=\"+Inf\"} " + std::to_string(after.queries)) !=
+            std::string::npos);
+
+        if (passed)
+        {
+            std::cout << "StatsTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "StatsTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Runs the same queries on two graphs and returns the number of them that have a path, or -1 if the graphs
+    // disagree on any of them.
+    int CompareQueries(const GraphStore& indexed, const GraphStore& plain, size_t vertexCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertexCount));
+        int found = 0;
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            const std::vector<VertexId> path = indexed.shortestPath(from, to, "label 1");
+            if (path.size() != plain.shortestPath(from, to, "label 1").size())
+            {
+                return -1;
+            }
+            found += path.empty() ? 0 : 1;
+        }
+        return found;
+    }
+
+    void ReachabilityTest1()
+    {
+        std::cout << "ReachabilityTest1" << std::endl;
+
+        // A sparse random graph where about two thirds of the vertices have the label.
+        const size_t vertex_count = 3000;
+        GraphStore plain;
+        plain.createVertices(vertex_count);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 4500; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        plain.createEdges(edges, nullptr);
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        plain.addLabelToVertices("label 1", labelled);
+
+        GraphStore indexed = plain;
+        indexed.indexReachability("label 1");
+        bool passed = (CompareQueries(indexed, plain, vertex_count, 1) >= 0);
+
+        // Most queries without a path are answered by the index, without expanding a single vertex.
+        QueryStats stats;
+        QueryOptions options;
+        options.stats = &stats;
+        QueryContext context;
+        std::vector<VertexId> path;
+        size_t no_path = 0;
+        size_t rejected = 0;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const VertexId from = labelled[rng() % labelled.size()];
+            const VertexId to = labelled[rng() % labelled.size()];
+            if (!indexed.shortestPath(from, to, "label 1", options, context, path))
+            {
+                ++no_path;
+                rejected += (stats.vertices_popped == 0) ? 1 : 0;
+            }
+        }
+        passed = passed && (no_path > 0) && (rejected * 2 > no_path);
+
+        // The index follows the graph as it grows, one change at a time and in batches, and stays correct when labels
+        // are removed.
+        for (size_t i = 0; i < 300; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            plain.createEdge(from, to);
+            indexed.createEdge(from, to);
+        }
+        const VertexId new_vertex = plain.createVertex();
+        indexed.createVertex();
+        std::vector<std::pair<VertexId, VertexId>> new_edges;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            new_edges.emplace_back(dist(rng), dist(rng));
+        }
+        new_edges.emplace_back(new_vertex, 1);
+        new_edges.emplace_back(2, new_vertex);
+        plain.createEdges(new_edges, nullptr);
+        indexed.createEdges(new_edges, nullptr);
+        std::vector<VertexId> new_labelled(1, new_vertex);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const VertexId vertex = dist(rng);
+            plain.addLabel(vertex, "label 1");
+            indexed.addLabel(vertex, "label 1");
+            new_labelled.push_back(dist(rng));
+        }
+        plain.addLabelToVertices("label 1", new_labelled);
+        indexed.addLabelToVertices("label 1", new_labelled);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const VertexId vertex = dist(rng);
+            plain.removeLabel(vertex, "label 1");
+            indexed.removeLabel(vertex, "label 1");
+        }
+        passed = passed && (CompareQueries(indexed, plain, vertex_count + 1, 2) >= 0);
+
+        // Versions carry a copy of the index.
+        std::unique_ptr<const GraphVersion> version = indexed.createVersion();
+        indexed.createEdge(1, 2);
+        for (size_t i = 0; (i < 200) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            passed = (version->shortestPath(from, to, "label 1").size() ==
+                plain.shortestPath(from, to, "label 1").size());
+        }
+
+        indexed.dropReachabilityIndex("label 1");
+        plain.createEdge(1, 2);
+        passed = passed && (CompareQueries(indexed, plain, vertex_count + 1, 3) >= 0);
+
+        if (passed)
+        {
+            std::cout << "ReachabilityTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "ReachabilityTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void AltTest1()
+    {
+        std::cout << "AltTest1" << std::endl;
+
+        GraphStore graph_store = CreateLargeGraphStore(20000, 40000);
+        std::vector<VertexId> half;
+        for (VertexId v_id = 1; v_id <= 20000; v_id += 2)
+        {
+            half.push_back(v_id);
+        }
+        graph_store.addLabelToVertices("label 2", half);
+
+        QueryStats stats;
+        QueryOptions bfs;
+        bfs.algorithm = SearchAlgorithm::BidirectionalBfs;
+        QueryOptions a_star;
+        a_star.algorithm = SearchAlgorithm::AStar;
+        a_star.stats = &stats;
+        QueryOptions alt;
+        alt.algorithm = SearchAlgorithm::Alt;
+        alt.stats = &stats;
+
+        // Runs random queries with A* and ALT, checks that ALT finds paths as short as the BFS and returns the number
+        // of vertices each A* expanded, or 0 if any path was wrong.
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1, 20000);
+        auto run = [&](const std::string& label, uint64_t& a_star_popped)
+        {
+            uint64_t alt_popped = 0;
+            a_star_popped = 0;
+            for (size_t i = 0; i < 300; ++i)
+            {
+                const VertexId from = dist(rng);
+                const VertexId to = dist(rng);
+                const size_t expected = graph_store.shortestPath(from, to, label, bfs).size();
+                const size_t a_star_length = graph_store.shortestPath(from, to, label, a_star).size();
+                a_star_popped += stats.vertices_popped;
+                const std::vector<VertexId> path = graph_store.shortestPath(from, to, label, alt);
+                alt_popped += stats.vertices_popped;
+                if ((path.size() != expected) || (a_star_length != expected) ||
+                    (!path.empty() && ((path.front() != from) || (path.back() != to))))
+                {
+                    return uint64_t(0);
+                }
+            }
+            return alt_popped + 1;
+        };
+
+        // Without tables ALT is the plain A*.
+        uint64_t a_star_popped = 0;
+        bool passed = (graph_store.landmarks() == nullptr) && (run("label 1", a_star_popped) == a_star_popped + 1);
+
+        LandmarkOptions landmark_options;
+        landmark_options.count = 8;
+        graph_store.buildLandmarks(landmark_options);
+        const uint64_t farthest_popped = run("label 1", a_star_popped);
+        passed = passed && (graph_store.landmarks() != nullptr) && (graph_store.landmarks()->landmarks().size() == 8) &&
+            (farthest_popped > 0) && (farthest_popped * 2 < a_star_popped) && (run("label 2", a_star_popped) > 0);
+
+        landmark_options.selection = LandmarkSelection::Degree;
+        graph_store.buildLandmarks(landmark_options);
+        const uint64_t degree_popped = run("label 1", a_star_popped);
+        passed = passed && (degree_popped > 0) && (degree_popped < a_star_popped);
+
+        // Labels don't matter to the tables but edges do.
+        graph_store.addLabel(2, "label 1");
+        passed = passed && (graph_store.landmarks() != nullptr);
+        std::unique_ptr<const GraphVersion> version = graph_store.createVersion();
+        graph_store.createEdge(1, 2);
+        passed = passed && (graph_store.landmarks() == nullptr) && (run("label 1", a_star_popped) > 0);
+        passed = passed && (version->shortestPath(3, 4, "label 1").size() ==
+            graph_store.createVersion()->shortestPath(3, 4, "label 1").size());
+
+        // A build in the background is only taken if no edge was created in the meantime.
+        std::future<std::shared_ptr<const LandmarkIndex>> stale = graph_store.buildLandmarksAsync(landmark_options);
+        graph_store.createEdge(2, 3);
+        passed = passed && !graph_store.setLandmarks(stale.get()) && (graph_store.landmarks() == nullptr);
+        std::future<std::shared_ptr<const LandmarkIndex>> fresh = graph_store.buildLandmarksAsync(landmark_options);
+        graph_store.addLabel(3, "label 1");
+        passed = passed && graph_store.setLandmarks(fresh.get()) && (run("label 1", a_star_popped) > 0);
+
+        // Distances longer than 254 need two bytes each.
+        GraphStore chain;
+        chain.createVertices(600);
+        std::vector<VertexId> chain_vertices;
+        for (VertexId v_id = 1; v_id <= 600; ++v_id)
+        {
+            chain_vertices.push_back(v_id);
+            if (v_id < 600)
+            {
+                chain.createEdge(v_id, v_id + 1);
+            }
+        }
+        chain.addLabelToVertices("label 1", chain_vertices);
+        landmark_options.count = 2;
+        chain.buildLandmarks(landmark_options);
+        passed = passed && (chain.landmarks()->memoryUsage() >= 601 * 2 * 2 * sizeof(uint16_t)) &&
+            (chain.shortestPath(10, 590, "label 1", alt).size() == 581) && (stats.vertices_popped == 581) &&
+            chain.shortestPath(590, 10, "label 1", alt).empty();
+
+        if (passed)
+        {
+            std::cout << "AltTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "AltTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void HubLabelTest1()
+    {
+        std::cout << "HubLabelTest1" << std::endl;
+
+        // A sparse random graph where about two thirds of the vertices have the label.
+        const size_t vertex_count = 2000;
+        GraphStore plain;
+        plain.createVertices(vertex_count);
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        plain.createEdges(edges, nullptr);
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        plain.addLabelToVertices("label 1", labelled);
+
+        GraphStore indexed = plain;
+        indexed.indexDistances("label 1", nullptr);
+        std::shared_ptr<const HubLabelIndex> index = indexed.distanceIndex("label 1");
+        bool passed = (index != nullptr) && (index->entryCount() > 0) && (index->memoryUsage() > 0) &&
+            (indexed.distanceIndex("label 2") == nullptr) && (CompareQueries(indexed, plain, vertex_count, 1) > 0);
+
+        // The paths rebuilt from the index follow the edges of the graph through labelled vertices.
+        const std::set<std::pair<VertexId, VertexId>> edge_set(edges.begin(), edges.end());
+        const std::set<VertexId> labelled_set(labelled.begin(), labelled.end());
+        size_t found = 0;
+        for (size_t i = 0; (i < 1000) && passed; ++i)
+        {
+            const VertexId from = labelled[rng() % labelled.size()];
+            const VertexId to = labelled[rng() % labelled.size()];
+            const std::vector<VertexId> path = indexed.shortestPath(from, to, "label 1");
+            passed = (path.size() == plain.shortestPath(from, to, "label 1").size()) &&
+                (path.empty() || ((path.front() == from) && (path.back() == to)));
+            for (size_t j = 0; (j < path.size()) && passed; ++j)
+            {
+                passed = (labelled_set.count(path[j]) == 1) &&
+                    ((j == 0) || (edge_set.count(std::make_pair(path[j - 1], path[j])) == 1));
+            }
+            found += path.empty() ? 0 : 1;
+        }
+        passed = passed && (found > 0);
+
+        // Searching the hubs side by side gives the same distances.
+        ThreadPool pool(4);
+        GraphStore parallel = plain;
+        parallel.indexDistances("label 1", &pool);
+        std::shared_ptr<const HubLabelIndex> parallel_index = parallel.distanceIndex("label 1");
+        for (size_t i = 0; (i < 1000) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            passed = (parallel_index->distance(from, to) == index->distance(from, to));
+        }
+
+        // Changes to the labelled part of the graph make the index stale and the queries search again. Versions keep
+        // the index they were created with.
+        std::unique_ptr<const GraphVersion> version = indexed.createVersion();
+        indexed.createEdge(labelled[0], labelled[1]);
+        plain.createEdge(labelled[0], labelled[1]);
+        passed = passed && (indexed.distanceIndex("label 1") == nullptr) &&
+            (CompareQueries(indexed, plain, vertex_count, 2) >= 0);
+        for (size_t i = 0; (i < 200) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            const uint32_t distance = index->distance(from, to);
+            const std::vector<VertexId> path = version->shortestPath(from, to, "label 1");
+            passed = (distance == HubLabelIndex::Unreachable) ? path.empty() : (path.size() == distance + 1);
+        }
+
+        indexed.indexDistances("label 1", nullptr);
+        const VertexId unlabelled = (labelled_set.count(1) == 1) ? 0 : 1;
+        if (unlabelled != 0)
+        {
+            indexed.addLabel(unlabelled, "label 1");
+            plain.addLabel(unlabelled, "label 1");
+            passed = passed && (indexed.distanceIndex("label 1") == nullptr);
+        }
+        indexed.indexDistances("label 1", nullptr);
+        indexed.removeLabel(labelled[2], "label 1");
+        plain.removeLabel(labelled[2], "label 1");
+        passed = passed && (indexed.distanceIndex("label 1") == nullptr) &&
+            (CompareQueries(indexed, plain, vertex_count, 3) >= 0);
+
+        indexed.indexDistances("label 1", nullptr);
+        indexed.dropDistanceIndex("label 1");
+        passed = passed && (indexed.distanceIndex("label 1") == nullptr);
+
+        if (passed)
+        {
+            std::cout << "HubLabelTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "HubLabelTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Weight of the lightest path between two vertices through the vertices of a label, or -1 if there is none, by
+    // a plain Dijkstra over a std::set to check the searches against.
+    double ReferenceWeight(const std::vector<std::vector<std::pair<VertexId, double>>>& edges,
+        const std::set<VertexId>& labelled, VertexId from, VertexId to)
+    {
+        std::vector<double> weights(edges.size(), -1);
+        std::set<std::pair<double, VertexId>> open_set;
+        weights[from] = 0;
+        open_set.emplace(0, from);
+        while (!open_set.empty())
+        {
+            const std::pair<double, VertexId> current = *open_set.begin();
+            open_set.erase(open_set.begin());
+            if (current.second == to)
+            {
+                return current.first;
+            }
+            for (const std::pair<VertexId, double>& edge : edges[current.second])
+            {
+                const double weight = current.first + edge.second;
+                if ((labelled.count(edge.first) == 1) && ((weights[edge.first] < 0) || (weight < weights[edge.first])))
+                {
+                    open_set.erase(std::make_pair(weights[edge.first], edge.first));
+                    weights[edge.first] = weight;
+                    open_set.emplace(weight, edge.first);
+                }
+            }
+        }
+        return -1;
+    }
+
+    void DijkstraTest1()
+    {
+        std::cout << "DijkstraTest1" << std::endl;
+
+        const size_t vertex_count = 500;
+        GraphStore graph_store;
+        graph_store.createVertices(vertex_count);
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::vector<std::pair<VertexId, double>>> edges(vertex_count + 1);
+        for (size_t i = 0; i < 2500; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            // Created twice sometimes, in which case the last weight wins.
+            const EdgeWeight weight = static_cast<EdgeWeight>(rng() % 10);
+            graph_store.createEdge(from, to, weight);
+            edges[from].erase(std::remove_if(edges[from].begin(), edges[from].end(),
+                [to](const std::pair<VertexId, double>& edge) { return edge.first == to; }), edges[from].end());
+            edges[from].emplace_back(to, weight);
+        }
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 4) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        graph_store.addLabelToVertices("label 1", labelled);
+        const std::set<VertexId> labelled_set(labelled.begin(), labelled.end());
+
+        QueryOptions dijkstra;
+        dijkstra.algorithm = SearchAlgorithm::Dijkstra;
+
+        // Compares the weight of the paths of random queries with the reference, weighing them with the reference
+        // edges, which also checks that the edges exist.
+        auto check = [&](const std::function<std::vector<VertexId>(VertexId, VertexId)>& search, uint32_t seed)
+        {
+            std::mt19937 query_rng(seed);
+            size_t found = 0;
+            for (size_t i = 0; i < 300; ++i)
+            {
+                const VertexId from = labelled[query_rng() % labelled.size()];
+                const VertexId to = labelled[query_rng() % labelled.size()];
+                const std::vector<VertexId> path = search(from, to);
+                const double expected = ReferenceWeight(edges, labelled_set, from, to);
+                if (path.empty() != (expected < 0))
+                {
+                    return false;
+                }
+                if (path.empty())
+                {
+                    continue;
+                }
+                double weight = 0;
+                for (size_t j = 1; j < path.size(); ++j)
+                {
+                    const std::vector<std::pair<VertexId, double>>& out = edges[path[j - 1]];
+                    auto edge = std::find_if(out.begin(), out.end(),
+                        [&](const std::pair<VertexId, double>& e) { return e.first == path[j]; });
+                    if (edge == out.end())
+                    {
+                        return false;
+                    }
+                    weight += edge->second;
+                }
+                if ((path.front() != from) || (path.back() != to) || (weight != expected))
+                {
+                    return false;
+                }
+                ++found;
+            }
+            return found > 0;
+        };
+        auto search_store = [&](VertexId from, VertexId to)
+        {
+            return graph_store.shortestPath(from, to, "label 1", dijkstra);
+        };
+
+        // Integer weights, on the sets and then on the CSR copy.
+        bool passed = check(search_store, 1);
+        graph_store.freeze();
+        passed = passed && check(search_store, 2);
+
+        // Fractional weights. Halves are exact so the sums can be compared as is.
+        for (size_t i = 0; i < 300; ++i)
+        {
+            const VertexId from = dist(rng);
+            if (!edges[from].empty())
+            {
+                std::pair<VertexId, double>& edge = edges[from][rng() % edges[from].size()];
+                edge.second += 0.5;
+                graph_store.createEdge(from, edge.first, static_cast<EdgeWeight>(edge.second));
+            }
+        }
+        passed = passed && !graph_store.isFrozen() && check(search_store, 3);
+        for (VertexId v_id = 1; (v_id <= vertex_count) && passed; ++v_id)
+        {
+            for (const std::pair<VertexId, double>& edge : edges[v_id])
+            {
+                passed = passed && (graph_store.edgeWeight(v_id, edge.first) == static_cast<EdgeWeight>(edge.second));
+            }
+        }
+
+        // Versions keep the weights they were created with.
+        std::unique_ptr<const GraphVersion> version = graph_store.createVersion();
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            for (const std::pair<VertexId, double>& edge : edges[v_id])
+            {
+                graph_store.createEdge(v_id, edge.first, 1);
+            }
+        }
+        QueryContext context;
+        passed = passed && check([&](VertexId from, VertexId to)
+        {
+            std::vector<VertexId> path;
+            version->shortestPath(from, to, "label 1", dijkstra, context, path);
+            return path;
+        }, 4);
+
+        // Without weights Dijkstra finds paths as short as the BFS.
+        for (size_t i = 0; (i < 300) && passed; ++i)
+        {
+            const VertexId from = labelled[rng() % labelled.size()];
+            const VertexId to = labelled[rng() % labelled.size()];
+            passed = (graph_store.shortestPath(from, to, "label 1", dijkstra).size() ==
+                graph_store.shortestPath(from, to, "label 1").size());
+        }
+
+        bool thrown = false;
+        try
+        {
+            graph_store.createEdge(1, 3, -1);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        passed = passed && thrown;
+        thrown = false;
+        try
+        {
+            graph_store.edgeWeight(1, graph_store.createVertex());
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        passed = passed && thrown;
+
+        if (passed)
+        {
+            std::cout << "DijkstraTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "DijkstraTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void PredicateTest1()
+    {
+        std::cout << "PredicateTest1" << std::endl;
+
+        // Three overlapping labels on a random graph.
+        const size_t vertex_count = 3000;
+        GraphStore graph_store;
+        graph_store.createVertices(vertex_count);
+        std::mt19937 rng(9);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 9000; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        graph_store.createEdges(edges, nullptr);
+        std::vector<VertexId> a;
+        std::vector<VertexId> b;
+        std::vector<VertexId> c;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 4) != 0)
+            {
+                a.push_back(v_id);
+            }
+            if ((rng() % 2) == 0)
+            {
+                b.push_back(v_id);
+            }
+            if ((rng() % 3) == 0)
+            {
+                c.push_back(v_id);
+            }
+        }
+        graph_store.addLabelToVertices("A", a);
+        graph_store.addLabelToVertices("B", b);
+        graph_store.addLabelToVertices("C", c);
+
+        // A AND (B OR NOT C), checked against the labels of each vertex.
+        const LabelPredicate predicate = LabelPredicate::has("A") &&
+            (LabelPredicate::has("B") || !LabelPredicate::has("C"));
+        auto matches = [&](const GraphStore& graph, VertexId vertex)
+        {
+            const std::vector<std::string> labels = graph.labels(vertex);
+            auto has = [&](const char* label)
+            {
+                return std::find(labels.begin(), labels.end(), label) != labels.end();
+            };
+            return has("A") && (has("B") || !has("C"));
+        };
+        std::shared_ptr<const MaskCache::Mask> mask = graph_store.vertexMask(predicate);
+        bool passed = (predicate.text() == "(\"A\" AND (\"B\" OR NOT \"C\"))") &&
+            (mask->size() == (vertex_count / 64) + 1) && ((*mask)[0] & 1) == 0;
+        std::vector<VertexId> matching;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            const bool bit = (((*mask)[v_id >> 6] >> (v_id & 63)) & 1) != 0;
+            passed = passed && (bit == matches(graph_store, v_id));
+            if (bit)
+            {
+                matching.push_back(v_id);
+            }
+        }
+        // No vertex past the last one matches NOT C.
+        const std::shared_ptr<const MaskCache::Mask> not_c = graph_store.vertexMask(!LabelPredicate::has("C"));
+        passed = passed && ((not_c->back() >> ((vertex_count & 63) + 1)) == 0);
+
+        // Every instruction set gives the same bitset, including over lengths that don't fill a whole register.
+        for (size_t count : { size_t(1), size_t(7), size_t(4096) })
+        {
+            std::vector<uint64_t> first(count);
+            std::vector<uint64_t> second(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                first[i] = (static_cast<uint64_t>(rng()) << 32) | rng();
+                second[i] = (static_cast<uint64_t>(rng()) << 32) | rng();
+            }
+            std::vector<std::vector<uint64_t>> results;
+            for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 })
+            {
+                std::vector<uint64_t> result = first;
+                AndWords(result.data(), second.data(), count, level);
+                std::vector<uint64_t> other = first;
+                OrWords(other.data(), second.data(), count, level);
+                result.insert(result.end(), other.begin(), other.end());
+                other = first;
+                AndNotWords(other.data(), second.data(), count, level);
+                result.insert(result.end(), other.begin(), other.end());
+                other = first;
+                NotWords(other.data(), count, level);
+                result.insert(result.end(), other.begin(), other.end());
+                results.push_back(result);
+            }
+            passed = passed && (results[0] == results[1]) && (results[0] == results[2]) &&
+                (results[0][0] == (first[0] & second[0])) && (results[0][count] == (first[0] | second[0])) &&
+                (results[0][2 * count] == (first[0] & ~second[0])) && (results[0][3 * count] == ~first[0]);
+        }
+
+        // The paths are as short as those through a label given to exactly the matching vertices.
+        GraphStore materialized = graph_store;
+        materialized.addLabelToVertices("M", matching);
+        QueryOptions options;
+        for (size_t i = 0; (i < 500) && passed; ++i)
+        {
+            const VertexId from = matching[rng() % matching.size()];
+            const VertexId to = matching[rng() % matching.size()];
+            const std::vector<VertexId> path = graph_store.shortestPath(from, to, predicate, options);
+            passed = (path.size() == materialized.shortestPath(from, to, "M").size());
+            for (VertexId vertex : path)
+            {
+                passed = passed && matches(graph_store, vertex);
+            }
+        }
+
+        // The bitset is evaluated once and evaluated again when a label changes.
+        passed = passed && (graph_store.vertexMask(predicate) == mask);
+        graph_store.removeLabel(matching[0], "A");
+        std::shared_ptr<const MaskCache::Mask> new_mask = graph_store.vertexMask(predicate);
+        passed = passed && (new_mask != mask) && ((((*new_mask)[matching[0] >> 6] >> (matching[0] & 63)) & 1) == 0) &&
+            graph_store.shortestPath(matching[0], matching[1], predicate, options).empty();
+
+        // Versions and mapped snapshots take predicates too.
+        std::unique_ptr<const GraphVersion> version = graph_store.createVersion();
+        const std::string path_name = "PredicateTest1.graph";
+        graph_store.save(path_name);
+        std::unique_ptr<const GraphVersion> mapped = GraphStore::open(path_name, true);
+        QueryContext context;
+        std::vector<VertexId> version_path;
+        std::vector<VertexId> mapped_path;
+        for (size_t i = 0; (i < 200) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            const size_t expected = graph_store.shortestPath(from, to, predicate, options).size();
+            version->shortestPath(from, to, predicate, options, context, version_path);
+            mapped->shortestPath(from, to, predicate, options, context, mapped_path);
+            passed = (version_path.size() == expected) && (mapped_path.size() == expected);
+        }
+        mapped.reset();
+        std::remove(path_name.c_str());
+
+        if (passed)
+        {
+            std::cout << "PredicateTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "PredicateTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void DeleteTest1()
+    {
+        std::cout << "DeleteTest1" << std::endl;
+
+        // A random graph with weighted edges that loses and gains vertices and edges round after round, mirrored in
+        // plain sets.
+        typedef std::pair<VertexId, VertexId> Edge;
+        GraphStore graph_store;
+        graph_store.createVertices(1000);
+        std::mt19937 rng(11);
+        std::set<VertexId> alive;
+        std::set<VertexId> labelled;
+        std::map<Edge, EdgeWeight> edges;
+        for (VertexId v_id = 1; v_id <= 1000; ++v_id)
+        {
+            alive.insert(v_id);
+        }
+        auto random_vertex = [&]()
+        {
+            auto position = alive.begin();
+            std::advance(position, rng() % alive.size());
+            return *position;
+        };
+        auto label = [&](VertexId vertex)
+        {
+            if ((rng() % 3) != 0)
+            {
+                graph_store.addLabel(vertex, "label 1");
+                labelled.insert(vertex);
+            }
+        };
+        auto add_edges = [&](size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Edge edge(random_vertex(), random_vertex());
+                const EdgeWeight weight = static_cast<EdgeWeight>(1 + (rng() % 3));
+                graph_store.createEdge(edge.first, edge.second, weight);
+                edges[edge] = weight;
+            }
+        };
+        for (VertexId v_id : alive)
+        {
+            label(v_id);
+        }
+        graph_store.indexReachability("label 1");
+        add_edges(3000);
+
+        bool passed = true;
+        // The moves are applied one after the other, as a caller that keeps IDs would.
+        auto apply = [&](const std::vector<VertexMove>& moves)
+        {
+            for (const VertexMove& move : moves)
+            {
+                passed = passed && (alive.count(move.old_id) == 1) && (alive.count(move.new_id) == 0);
+                alive.erase(move.old_id);
+                alive.insert(move.new_id);
+                if (labelled.erase(move.old_id) == 1)
+                {
+                    labelled.insert(move.new_id);
+                }
+                std::map<Edge, EdgeWeight> moved;
+                for (const std::pair<const Edge, EdgeWeight>& edge : edges)
+                {
+                    moved[Edge((edge.first.first == move.old_id) ? move.new_id : edge.first.first,
+                        (edge.first.second == move.old_id) ? move.new_id : edge.first.second)] = edge.second;
+                }
+                edges.swap(moved);
+            }
+        };
+
+        size_t peak_count = alive.size();
+        for (size_t round = 0; (round < 30) && passed; ++round)
+        {
+            // Even rounds shrink the graph and odd rounds grow it back.
+            const size_t delete_count = ((round % 2) == 0) ? 80 : 40;
+            for (size_t i = 0; i < delete_count; ++i)
+            {
+                const VertexId vertex = random_vertex();
+                graph_store.deleteVertex(vertex);
+                alive.erase(vertex);
+                labelled.erase(vertex);
+                for (auto edge = edges.begin(); edge != edges.end();)
+                {
+                    edge = ((edge->first.first == vertex) || (edge->first.second == vertex)) ? edges.erase(edge) :
+                        std::next(edge);
+                }
+            }
+            for (size_t i = 0; i < 100; ++i)
+            {
+                auto edge = edges.begin();
+                std::advance(edge, rng() % edges.size());
+                passed = passed && graph_store.deleteEdge(edge->first.first, edge->first.second) &&
+                    !graph_store.deleteEdge(edge->first.first, edge->first.second);
+                edges.erase(edge);
+            }
+
+            // New vertices take the IDs of deleted ones first.
+            for (size_t i = 0; i < 120 - delete_count; ++i)
+            {
+                const VertexId vertex = graph_store.createVertex();
+                passed = passed && (alive.count(vertex) == 0) && (vertex <= (peak_count + 1));
+                alive.insert(vertex);
+                label(vertex);
+            }
+            peak_count = std::max(peak_count, alive.size());
+            add_edges(150);
+            if ((round % 3) == 0)
+            {
+                apply(graph_store.compact(20));
+            }
+            passed = passed && (graph_store.vertexCount() == alive.size()) &&
+                (graph_store.edgeCount() == edges.size()) && (*alive.rbegin() <= peak_count);
+        }
+
+        // A deleted ID is an error until it is reused.
+        const VertexId deleted = random_vertex();
+        graph_store.deleteVertex(deleted);
+        alive.erase(deleted);
+        labelled.erase(deleted);
+        for (auto edge = edges.begin(); edge != edges.end();)
+        {
+            edge = ((edge->first.first == deleted) || (edge->first.second == deleted)) ? edges.erase(edge) :
+                std::next(edge);
+        }
+        int thrown = 0;
+        const VertexId other = random_vertex();
+        std::vector<std::function<void()>> invalid = {
+            [&]() { graph_store.shortestPath(deleted, other, "label 1"); },
+            [&]() { graph_store.createEdge(other, deleted); },
+            [&]() { graph_store.addLabel(deleted, "label 1"); },
+            [&]() { graph_store.deleteVertex(deleted); } };
+        for (const std::function<void()>& call : invalid)
+        {
+            try
+            {
+                call();
+            }
+            catch (const std::runtime_error&)
+            {
+                ++thrown;
+            }
+        }
+        passed = passed && (thrown == 4) && !graph_store.containsVertex(deleted);
+
+        // Compacting all the way leaves the IDs dense and the graph the same as one built from scratch.
+        apply(graph_store.compact(alive.size()));
+        const size_t vertex_count = alive.size();
+        passed = passed && (*alive.rbegin() == vertex_count) && graph_store.compact(1).empty() &&
+            (graph_store.vertexCount() == vertex_count) && (graph_store.edgeCount() == edges.size());
+        GraphStore plain;
+        plain.createVertices(vertex_count);
+        std::vector<Edge> edge_list;
+        for (const std::pair<const Edge, EdgeWeight>& edge : edges)
+        {
+            edge_list.push_back(edge.first);
+            passed = passed && (graph_store.edgeWeight(edge.first.first, edge.first.second) == edge.second);
+        }
+        plain.createEdges(edge_list, nullptr);
+        plain.addLabelToVertices("label 1", std::vector<VertexId>(labelled.begin(), labelled.end()));
+        passed = passed && (CompareQueries(graph_store, plain, vertex_count, 3) > 0);
+        graph_store.freeze();
+        passed = passed && (CompareQueries(graph_store, plain, vertex_count, 4) > 0);
+        passed = passed && (graph_store.createVertex() == (vertex_count + 1));
+
+        if (passed)
+        {
+            std::cout << "DeleteTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "DeleteTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void ReorderTest1()
+    {
+        std::cout << "ReorderTest1" << std::endl;
+
+        // A random graph with weighted edges and a label, searched before and after each reordering.
+        typedef std::pair<VertexId, VertexId> Edge;
+        const size_t vertex_count = 2000;
+        GraphStore plain;
+        plain.createVertices(vertex_count);
+        std::mt19937 rng(12);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::map<Edge, EdgeWeight> edges;
+        for (size_t i = 0; i < 6000; ++i)
+        {
+            const Edge edge(dist(rng), dist(rng));
+            edges[edge] = static_cast<EdgeWeight>(1 + (rng() % 3));
+            plain.createEdge(edge.first, edge.second, edges[edge]);
+        }
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        plain.addLabelToVertices("label 1", labelled);
+
+        // The paths come back under the IDs the graph was built with, so they can be checked against the edges.
+        auto valid_path = [&](const std::vector<VertexId>& path)
+        {
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                if (edges.count(Edge(path[i - 1], path[i])) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        bool passed = true;
+        GraphStore reordered;
+        for (VertexOrder order : { VertexOrder::Bfs, VertexOrder::ReverseCuthillMcKee, VertexOrder::Degree })
+        {
+            reordered = plain;
+            reordered.indexReachability("label 1");
+            reordered.reorder(order);
+            passed = passed && (CompareQueries(reordered, plain, vertex_count, 5) > 0);
+            for (const std::pair<const Edge, EdgeWeight>& edge : edges)
+            {
+                passed = passed && (reordered.edgeWeight(edge.first.first, edge.first.second) == edge.second);
+            }
+            for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+            {
+                passed = passed && (reordered.labels(v_id) == plain.labels(v_id));
+            }
+
+            reordered.freeze();
+            std::unique_ptr<const GraphVersion> version = reordered.createVersion();
+            QueryContext context;
+            std::vector<VertexId> version_path;
+            for (size_t i = 0; (i < 500) && passed; ++i)
+            {
+                const VertexId from = dist(rng);
+                const VertexId to = dist(rng);
+                const std::vector<VertexId> path = reordered.shortestPath(from, to, "label 1");
+                version->shortestPath(from, to, "label 1", QueryOptions(), context, version_path);
+                passed = valid_path(path) && (path == version_path) &&
+                    (path.size() == plain.shortestPath(from, to, "label 1").size()) &&
+                    (path.empty() || ((path.front() == from) && (path.back() == to)));
+            }
+        }
+
+        // The reordered graph keeps taking mutations under the same IDs. Deleted IDs are reused and compacting
+        // renames only the vertices at the end of the ID space.
+        std::set<VertexId> alive;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            alive.insert(v_id);
+        }
+        for (size_t i = 0; i < 300; ++i)
+        {
+            const VertexId vertex = dist(rng);
+            if (alive.erase(vertex) == 1)
+            {
+                reordered.deleteVertex(vertex);
+                for (auto edge = edges.begin(); edge != edges.end();)
+                {
+                    edge = ((edge->first.first == vertex) || (edge->first.second == vertex)) ? edges.erase(edge) :
+                        std::next(edge);
+                }
+            }
+        }
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const VertexId vertex = reordered.createVertex();
+            passed = passed && (vertex <= vertex_count) && alive.insert(vertex).second;
+            const Edge edge(vertex, *alive.begin());
+            reordered.createEdge(edge.first, edge.second, 2);
+            edges[edge] = 2;
+        }
+        for (const VertexMove& move : reordered.compact(alive.size()))
+        {
+            passed = passed && (move.old_id > alive.size()) && (alive.count(move.new_id) == 0);
+            alive.erase(move.old_id);
+            alive.insert(move.new_id);
+            std::map<Edge, EdgeWeight> moved;
+            for (const std::pair<const Edge, EdgeWeight>& edge : edges)
+            {
+                moved[Edge((edge.first.first == move.old_id) ? move.new_id : edge.first.first,
+                    (edge.first.second == move.old_id) ? move.new_id : edge.first.second)] = edge.second;
+            }
+            edges.swap(moved);
+        }
+        passed = passed && (*alive.rbegin() == alive.size()) && (reordered.vertexCount() == alive.size()) &&
+            (reordered.edgeCount() == edges.size());
+        for (const std::pair<const Edge, EdgeWeight>& edge : edges)
+        {
+            passed = passed && (reordered.edgeWeight(edge.first.first, edge.first.second) == edge.second);
+        }
+
+        // Snapshot files are written under the same IDs.
+        const std::string path_name = "ReorderTest1.graph";
+        reordered.save(path_name);
+        GraphStore loaded = GraphStore::load(path_name, nullptr);
+        std::remove(path_name.c_str());
+        passed = passed && (CompareQueries(reordered, loaded, alive.size(), 6) > 0);
+
+        if (passed)
+        {
+            std::cout << "ReorderTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "ReorderTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void CompressedTest1()
+    {
+        std::cout << "CompressedTest1" << std::endl;
+
+        // Neighbours with close IDs, as in a graph with locality, plus a few edges across the whole graph. The edges
+        // come in two batches so that the second one is merged into the compressed adjacency.
+        typedef std::pair<VertexId, VertexId> Edge;
+        const size_t vertex_count = 5000;
+        std::mt19937 rng(13);
+        std::vector<Edge> edges;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            for (size_t i = 0; i < 16; ++i)
+            {
+                const VertexId to = v_id + (rng() % 128);
+                edges.emplace_back(v_id, (to > 64) && (to - 64 <= vertex_count) ? (to - 64) : v_id);
+            }
+        }
+        for (size_t i = 0; i < 500; ++i)
+        {
+            edges.emplace_back(1 + (rng() % vertex_count), 1 + (rng() % vertex_count));
+        }
+        std::vector<Edge> first_batch;
+        std::vector<Edge> second_batch;
+        for (const Edge& edge : edges)
+        {
+            const bool first = (edge.first <= vertex_count / 2) && (edge.second <= vertex_count / 2);
+            (first ? first_batch : second_batch).push_back(edge);
+        }
+
+        GraphStore plain;
+        GraphStore compressed(AdjacencyStorage::Compressed);
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 4) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        for (GraphStore* graph : { &plain, &compressed })
+        {
+            graph->createVertices(vertex_count / 2);
+            graph->createEdges(first_batch, nullptr);
+            graph->createVertices(vertex_count - (vertex_count / 2));
+            graph->createEdges(second_batch, nullptr);
+            graph->addLabelToVertices("label 1", labelled);
+        }
+
+        std::shared_ptr<const CompressedAdjacency> adjacency = compressed.compressedSnapshot();
+        bool passed = (adjacency != nullptr) && compressed.isFrozen() && (compressed.snapshot() == nullptr) &&
+            (compressed.edgeCount() == plain.edgeCount()) && (adjacency->edgeCount() == plain.edgeCount()) &&
+            (compressed.vertexCount() == vertex_count);
+        if (adjacency != nullptr)
+        {
+            const double bytes_per_edge = static_cast<double>(adjacency->memoryUsage()) / adjacency->edgeCount();
+            std::cout << "Compressed: " << bytes_per_edge << " bytes per edge" << std::endl;
+            passed = passed && (bytes_per_edge < 2);
+        }
+        passed = passed && (CompareQueries(compressed, plain, vertex_count, 1) > 0);
+
+        // The searches that read the weights, a version and the landmarks run on the compressed edges as well.
+        QueryOptions dijkstra;
+        dijkstra.algorithm = SearchAlgorithm::Dijkstra;
+        for (GraphStore* graph : { &plain, &compressed })
+        {
+            for (size_t i = 0; i < 200; ++i)
+            {
+                graph->createEdge(1 + (i * 20), 20 + (i * 20), 0.5f);
+            }
+        }
+        passed = passed && (compressed.compressedSnapshot() == nullptr) && !compressed.isFrozen() &&
+            (compressed.edgeWeight(1, 20) == 0.5f);
+        compressed.freeze();
+        compressed.buildLandmarks(LandmarkOptions());
+        std::unique_ptr<const GraphVersion> version = compressed.createVersion();
+        QueryOptions alt;
+        alt.algorithm = SearchAlgorithm::Alt;
+        QueryContext context;
+        std::vector<VertexId> version_path;
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        auto weight = [](const GraphStore& graph, const std::vector<VertexId>& path)
+        {
+            EdgeWeight total = 0;
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                total += graph.edgeWeight(path[i - 1], path[i]);
+            }
+            return total;
+        };
+        for (size_t i = 0; (i < 300) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            const std::vector<VertexId> path = plain.shortestPath(from, to, "label 1");
+            version->shortestPath(from, to, "label 1", QueryOptions(), context, version_path);
+            passed = (compressed.compressedSnapshot() != nullptr) && (version_path.size() == path.size()) &&
+                (compressed.shortestPath(from, to, "label 1", alt).size() == path.size()) &&
+                (weight(compressed, compressed.shortestPath(from, to, "label 1", dijkstra)) ==
+                    weight(plain, plain.shortestPath(from, to, "label 1", dijkstra)));
+        }
+
+        // Indexes built on the sets, then snapshot files.
+        compressed.indexReachability("label 1");
+        plain.indexReachability("label 1");
+        for (GraphStore* graph : { &plain, &compressed })
+        {
+            graph->createEdges({ Edge(vertex_count, 1), Edge(1, vertex_count) }, nullptr);
+        }
+        compressed.freeze();
+        passed = passed && (CompareQueries(compressed, plain, vertex_count, 2) > 0);
+        const std::string path_name = "CompressedTest1.graph";
+        compressed.save(path_name);
+        GraphStore loaded = GraphStore::load(path_name, nullptr);
+        std::remove(path_name.c_str());
+        passed = passed && (loaded.edgeCount() == plain.edgeCount()) &&
+            (CompareQueries(loaded, plain, vertex_count, 3) > 0);
+
+        if (passed)
+        {
+            std::cout << "CompressedTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "CompressedTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void PoolTest1()
+    {
+        std::cout << "PoolTest1" << std::endl;
+
+        // The same random graph with its set nodes from the pool of the store and from the global heap.
+        const size_t vertex_count = 3000;
+        GraphStore pooled;
+        GraphStore heap(AdjacencyStorage::Sets, false);
+        std::mt19937 rng(17);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 3 * vertex_count; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        for (GraphStore* graph : { &pooled, &heap })
+        {
+            graph->createVertices(vertex_count);
+            for (const std::pair<VertexId, VertexId>& edge : edges)
+            {
+                graph->createEdge(edge.first, edge.second);
+            }
+            graph->addLabelToVertices("label 1", labelled);
+        }
+
+        const GraphMemoryUsage built = pooled.memoryUsage();
+        bool passed = (built.adjacency > 0) && (built.adjacency_free < built.adjacency / 4) &&
+            (built.labels > 0) && (built.total() >= built.adjacency) && (heap.memoryUsage().adjacency_free == 0) &&
+            (CompareQueries(pooled, heap, vertex_count, 1) > 0);
+
+        // Churn: the nodes of the deleted edges are reused by the new ones instead of growing the slabs.
+        for (size_t round = 0; round < 3; ++round)
+        {
+            std::vector<VertexId> deleted;
+            for (size_t i = 0; i < vertex_count / 10; ++i)
+            {
+                const VertexId vertex = dist(rng);
+                if (pooled.containsVertex(vertex))
+                {
+                    pooled.deleteVertex(vertex);
+                    heap.deleteVertex(vertex);
+                    deleted.push_back(vertex);
+                }
+            }
+            passed = passed && (pooled.memoryUsage().adjacency_free > built.adjacency_free);
+            for (size_t i = 0; i < deleted.size(); ++i)
+            {
+                passed = passed && (pooled.createVertex() == heap.createVertex());
+            }
+            for (VertexId vertex : deleted)
+            {
+                for (size_t i = 0; i < 6; ++i)
+                {
+                    const VertexId other = dist(rng);
+                    const bool outgoing = (i % 2) == 0;
+                    pooled.createEdge(outgoing ? vertex : other, outgoing ? other : vertex);
+                    heap.createEdge(outgoing ? vertex : other, outgoing ? other : vertex);
+                }
+                pooled.addLabel(vertex, "label 1");
+                heap.addLabel(vertex, "label 1");
+            }
+        }
+        const GraphMemoryUsage churned = pooled.memoryUsage();
+        std::cout << "Adjacency: " << built.adjacency << " bytes built, " << churned.adjacency << " bytes after churn"
+                  << std::endl;
+        passed = passed && (pooled.edgeCount() == heap.edgeCount()) &&
+            (churned.adjacency < built.adjacency + (built.adjacency / 10)) &&
+            (CompareQueries(pooled, heap, vertex_count, 2) > 0);
+
+        // A copy outlives the store it was copied from and keeps being mutated.
+        std::unique_ptr<GraphStore> original(new GraphStore());
+        original->createVertices(vertex_count);
+        for (const std::pair<VertexId, VertexId>& edge : edges)
+        {
+            original->createEdge(edge.first, edge.second);
+        }
+        GraphStore copy = *original;
+        original.reset();
+        GraphStore plain(AdjacencyStorage::Sets, false);
+        plain.createVertices(vertex_count);
+        for (const std::pair<VertexId, VertexId>& edge : edges)
+        {
+            plain.createEdge(edge.first, edge.second);
+        }
+        for (GraphStore* graph : { &copy, &plain })
+        {
+            for (size_t i = 0; i < 500; ++i)
+            {
+                graph->createEdge(1 + (i * 5), vertex_count - i);
+            }
+            graph->deleteEdge(edges[0].first, edges[0].second);
+            graph->addLabelToVertices("label 1", labelled);
+        }
+        passed = passed && (copy.edgeCount() == plain.edgeCount()) && (copy.memoryUsage().adjacency > 0) &&
+            (CompareQueries(copy, plain, vertex_count, 3) > 0);
+
+        if (passed)
+        {
+            std::cout << "PoolTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "PoolTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Checks that edges created in bulk by several threads at once, into sets allocating from the one pool of the
+    // store, give the same graph as edges created by one thread, including once deletions have freed nodes.
+    void PoolTest2()
+    {
+        std::cout << "PoolTest2" << std::endl;
+
+        const size_t vertex_count = 20000;
+        std::mt19937 rng(23);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 10 * vertex_count; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<std::pair<VertexId, VertexId>> more_edges;
+        for (size_t i = 0; i < 5 * vertex_count; ++i)
+        {
+            more_edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<VertexId> labelled;
+        std::vector<VertexId> deleted;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+            else if ((rng() % 4) == 0)
+            {
+                deleted.push_back(v_id);
+            }
+        }
+
+        ThreadPool pool(4);
+        GraphStore serial;
+        GraphStore parallel;
+        for (GraphStore* graph : { &serial, &parallel })
+        {
+            ThreadPool* const edge_pool = (graph == &parallel) ? &pool : nullptr;
+            graph->createVertices(vertex_count);
+            graph->createEdges(edges, edge_pool);
+            for (VertexId vertex : deleted)
+            {
+                graph->deleteVertex(vertex);
+            }
+            for (size_t i = 0; i < deleted.size(); ++i)
+            {
+                graph->createVertex();
+            }
+            graph->createEdges(more_edges, edge_pool);
+            graph->addLabelToVertices("label 1", labelled);
+        }
+
+        const GraphMemoryUsage serial_usage = serial.memoryUsage();
+        const GraphMemoryUsage parallel_usage = parallel.memoryUsage();
+        const size_t used = serial_usage.adjacency - serial_usage.adjacency_free;
+        bool passed = (parallel.edgeCount() == serial.edgeCount()) &&
+            (parallel_usage.adjacency - parallel_usage.adjacency_free == used) &&
+            (parallel_usage.adjacency < serial_usage.adjacency + (serial_usage.adjacency / 10)) &&
+            (CompareQueries(parallel, serial, vertex_count, 4) > 0);
+
+        // The sets filled by the threads keep working with the pool of the store.
+        for (GraphStore* graph : { &serial, &parallel })
+        {
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                graph->deleteEdge(edges[i].first, edges[i].second);
+                graph->createEdge(more_edges[i].second, more_edges[i].first);
+            }
+        }
+        passed = passed && (parallel.edgeCount() == serial.edgeCount()) &&
+            (CompareQueries(parallel, serial, vertex_count, 5) > 0);
+
+        if (passed)
+        {
+            std::cout << "PoolTest2 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "PoolTest2 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void MultiSourceTest1()
+    {
+        std::cout << "MultiSourceTest1" << std::endl;
+
+        // A sparse random graph where about two thirds of the vertices have the label, in each storage.
+        const size_t vertex_count = 2000;
+        GraphStore plain;
+        GraphStore frozen;
+        GraphStore compressed(AdjacencyStorage::Compressed);
+        std::mt19937 rng(19);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 3 * vertex_count; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        for (GraphStore* graph : { &plain, &frozen, &compressed })
+        {
+            graph->createVertices(vertex_count);
+            graph->createEdges(edges, nullptr);
+            graph->addLabelToVertices("label 1", labelled);
+        }
+        frozen.reorder(VertexOrder::Bfs);
+        frozen.freeze();
+
+        // More sources than one batch of 256 lanes, some of them twice, and targets with and without the label.
+        std::vector<VertexId> sources;
+        for (size_t i = 0; i < 300; ++i)
+        {
+            sources.push_back(dist(rng));
+        }
+        sources.push_back(sources[0]);
+        std::vector<VertexId> targets;
+        for (size_t i = 0; i < 40; ++i)
+        {
+            targets.push_back(dist(rng));
+        }
+        targets.push_back(targets[0]);
+        targets.push_back(sources[1]);
+
+        ThreadPool pool(4);
+        const std::vector<std::vector<uint32_t>> matrix = plain.distanceMatrix(sources, targets, "label 1", nullptr);
+        bool passed = (matrix.size() == sources.size()) &&
+            (frozen.distanceMatrix(sources, targets, "label 1", &pool) == matrix) &&
+            (compressed.distanceMatrix(sources, targets, "label 1", nullptr) == matrix) &&
+            (plain.distanceMatrix({ sources.begin(), sources.begin() + 10 }, targets, "label 1", &pool) ==
+                std::vector<std::vector<uint32_t>>(matrix.begin(), matrix.begin() + 10));
+        size_t found = 0;
+        for (size_t i = 0; (i < sources.size()) && passed; ++i)
+        {
+            passed = (matrix[i].size() == targets.size());
+            for (size_t j = 0; (j < targets.size()) && passed; ++j)
+            {
+                const std::vector<VertexId> path = plain.shortestPath(sources[i], targets[j], "label 1");
+                passed = path.empty() ? (matrix[i][j] == GraphStore::Unreachable) : (matrix[i][j] == path.size() - 1);
+                found += path.empty() ? 0 : 1;
+            }
+        }
+        std::cout << "Distances: " << found << " of " << (sources.size() * targets.size()) << " pairs connected"
+                  << std::endl;
+        passed = passed && (found > 0) &&
+            (plain.distanceMatrix(sources, targets, "label 2", nullptr)[0][0] == GraphStore::Unreachable);
+
+        // Enough sources and targets for the lanes of 256 sources.
+        const std::vector<std::vector<uint32_t>> square = compressed.distanceMatrix(sources, sources, "label 1",
+            nullptr);
+        for (size_t i = 0; (i < 300) && passed; ++i)
+        {
+            const size_t from = rng() % sources.size();
+            const size_t to = rng() % sources.size();
+            const std::vector<VertexId> path = plain.shortestPath(sources[from], sources[to], "label 1");
+            passed = path.empty() ? (square[from][to] == GraphStore::Unreachable) :
+                (square[from][to] == path.size() - 1);
+        }
+
+        // The paths from one vertex to many are shortest and valid, whatever the storage.
+        for (size_t i = 0; (i < 20) && passed; ++i)
+        {
+            for (const GraphStore* graph : { &plain, &frozen, &compressed })
+            {
+                const std::vector<std::vector<VertexId>> paths = graph->shortestPaths(sources[i], targets, "label 1");
+                passed = passed && (paths.size() == targets.size());
+                for (size_t j = 0; (j < targets.size()) && passed; ++j)
+                {
+                    const std::vector<VertexId>& path = paths[j];
+                    passed = (path.size() == plain.shortestPath(sources[i], targets[j], "label 1").size()) &&
+                        (path.empty() || ((path.front() == sources[i]) && (path.back() == targets[j])));
+                    for (size_t k = 1; (k < path.size()) && passed; ++k)
+                    {
+                        const std::vector<VertexId> step = graph->shortestPath(path[k - 1], path[k], "label 1");
+                        passed = (step.size() == 2);
+                    }
+                }
+            }
+        }
+
+        try
+        {
+            plain.distanceMatrix(sources, { vertex_count + 1 }, "label 1", nullptr);
+            passed = false;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+
+        if (passed)
+        {
+            std::cout << "MultiSourceTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "MultiSourceTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void SubscriptionTest1()
+    {
+        std::cout << "SubscriptionTest1" << std::endl;
+
+        // A sparse random graph where about two thirds of the vertices have the label, compressed so that the
+        // subscriptions also go through decompress and freeze.
+        const size_t vertex_count = 500;
+        GraphStore graph(AdjacencyStorage::Compressed);
+        std::mt19937 rng(23);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        for (size_t i = 0; i < 2 * vertex_count; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if ((rng() % 3) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+        graph.createVertices(vertex_count);
+        graph.createEdges(edges, nullptr);
+        graph.addLabelToVertices("label 1", labelled);
+
+        // Each callback records the path it was given and how many times it was called.
+        const size_t subscription_count = 20;
+        std::vector<std::pair<VertexId, VertexId>> endpoints;
+        std::vector<SubscriptionId> subscriptions;
+        std::vector<std::vector<VertexId>> reported(subscription_count);
+        std::vector<size_t> calls(subscription_count, 0);
+        for (size_t i = 0; i < subscription_count; ++i)
+        {
+            endpoints.emplace_back(dist(rng), dist(rng));
+            subscriptions.push_back(graph.subscribe(endpoints[i].first, endpoints[i].second, "label 1",
+                [&reported, &calls, i](SubscriptionId, const std::vector<VertexId>& path)
+                {
+                    reported[i] = path;
+                    ++calls[i];
+                }));
+            reported[i] = graph.subscribedPath(subscriptions[i]);
+        }
+
+        // The path of a subscription is a path through the label, as long as the one of shortestPath, and each change
+        // of it is reported once.
+        auto check = [&](const std::vector<size_t>& previous_calls, const std::vector<std::vector<VertexId>>& previous)
+        {
+            for (size_t i = 0; i < subscription_count; ++i)
+            {
+                const std::vector<VertexId> path = graph.subscribedPath(subscriptions[i]);
+                const size_t expected_calls = previous_calls[i] + ((path != previous[i]) ? 1 : 0);
+                if ((path != reported[i]) || (calls[i] != expected_calls) ||
+                    (path.size() != graph.shortestPath(endpoints[i].first, endpoints[i].second, "label 1").size()))
+                {
+                    return false;
+                }
+                for (size_t k = 0; k < path.size(); ++k)
+                {
+                    const std::vector<std::string> labels = graph.labels(path[k]);
+                    if (std::find(labels.begin(), labels.end(), "label 1") == labels.end())
+                    {
+                        return false;
+                    }
+                    if (k > 0)
+                    {
+                        graph.edgeWeight(path[k - 1], path[k]);
+                    }
+                }
+            }
+            return true;
+        };
+
+        // Random mutations, none of which deletes an endpoint: edges one at a time and in batches, labels added and
+        // removed, and other vertices deleted and created again.
+        bool passed = true;
+        std::set<VertexId> kept;
+        for (const std::pair<VertexId, VertexId>& endpoint : endpoints)
+        {
+            kept.insert(endpoint.first);
+            kept.insert(endpoint.second);
+        }
+        size_t changes = 0;
+        try
+        {
+            for (size_t step = 0; (step < 2000) && passed; ++step)
+            {
+                const std::vector<size_t> previous_calls = calls;
+                const std::vector<std::vector<VertexId>> previous = reported;
+                const VertexId a = dist(rng);
+                const VertexId b = dist(rng);
+                const unsigned kind = rng() % 20;
+                if ((!graph.containsVertex(a) || !graph.containsVertex(b)) && (kind != 19))
+                {
+                    continue;
+                }
+                if (kind < 7)
+                {
+                    graph.createEdge(a, b);
+                }
+                else if (kind < 11)
+                {
+                    graph.deleteEdge(a, b);
+                }
+                else if (kind < 14)
+                {
+                    graph.addLabel(a, "label 1");
+                }
+                else if (kind < 17)
+                {
+                    graph.removeLabel(a, "label 1");
+                }
+                else if (kind == 17)
+                {
+                    const VertexId c = dist(rng);
+                    if (graph.containsVertex(c))
+                    {
+                        graph.createEdges({ { a, b }, { b, c }, { c, a } }, nullptr);
+                    }
+                }
+                else if (kind == 18)
+                {
+                    if (kept.count(a) == 0)
+                    {
+                        graph.deleteVertex(a);
+                    }
+                }
+                else
+                {
+                    graph.createVertex();
+                    graph.freeze();
+                }
+                passed = check(previous_calls, previous);
+            }
+            for (size_t i = 0; i < subscription_count; ++i)
+            {
+                changes += calls[i];
+            }
+            std::cout << "Reported changes: " << changes << std::endl;
+
+            // Renumbering builds the trees again, under the same IDs.
+            std::vector<size_t> previous_calls = calls;
+            std::vector<std::vector<VertexId>> previous = reported;
+            graph.reorder(VertexOrder::Bfs);
+            passed = passed && check(previous_calls, previous);
+
+            // Deleting a destination empties the path; once unsubscribed, nothing is reported any more.
+            const VertexId deleted = endpoints[0].second;
+            graph.deleteVertex(deleted);
+            passed = passed && graph.subscribedPath(subscriptions[0]).empty() && reported[0].empty();
+            passed = passed && graph.unsubscribe(subscriptions[0]) && !graph.unsubscribe(subscriptions[0]);
+            previous_calls = calls;
+            while (!graph.containsVertex(deleted))
+            {
+                graph.createVertex();
+            }
+            graph.addLabel(deleted, "label 1");
+            graph.createEdge(endpoints[0].first, deleted);
+            passed = passed && (calls[0] == previous_calls[0]);
+            try
+            {
+                graph.subscribedPath(subscriptions[0]);
+                passed = false;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+        }
+        catch (const std::runtime_error&)
+        {
+            passed = false;
+        }
+
+        if (passed && (changes > 0))
+        {
+            std::cout << "SubscriptionTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "SubscriptionTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void LimitTest1()
+    {
+        std::cout << "LimitTest1" << std::endl;
+
+        // A chain of 1000 labelled vertices, the only path from its first vertex to its last being 999 edges long, and
+        // a vertex off the chain that nothing reaches.
+        const size_t vertex_count = 1000;
+        GraphStore graph;
+        graph.createVertices(vertex_count + 1);
+        std::vector<std::pair<VertexId, VertexId>> edges;
+        std::vector<VertexId> labelled;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            if (v_id < vertex_count)
+            {
+                edges.emplace_back(v_id, v_id + 1);
+            }
+            labelled.push_back(v_id);
+        }
+        labelled.push_back(vertex_count + 1);
+        graph.createEdges(edges, nullptr);
+        graph.addLabelToVertices("label 1", labelled);
+        graph.freeze();
+
+        // Every algorithm finds the path within 999 hops and reports that it stopped short of it with 998.
+        ThreadPool pool(2);
+        bool passed = true;
+        for (SearchAlgorithm algorithm : { SearchAlgorithm::Auto, SearchAlgorithm::AStar, SearchAlgorithm::Alt,
+            SearchAlgorithm::Dijkstra, SearchAlgorithm::ParallelBfs })
+        {
+            QueryOutcome outcome = QueryOutcome::Cancelled;
+            QueryOptions options;
+            options.algorithm = algorithm;
+            options.pool = &pool;
+            options.outcome = &outcome;
+            options.max_hops = vertex_count - 1;
+            passed = passed && (graph.shortestPath(1, vertex_count, "label 1", options).size() == vertex_count) &&
+                (outcome == QueryOutcome::Exact);
+            options.max_hops = vertex_count - 2;
+            passed = passed && graph.shortestPath(1, vertex_count, "label 1", options).empty() &&
+                (outcome == QueryOutcome::Truncated);
+
+            // The expansions are capped, and a vertex that can't be reached is an exact answer.
+            options.max_hops = UINT32_MAX;
+            options.max_expanded = 100;
+            passed = passed && graph.shortestPath(1, vertex_count, "label 1", options).empty() &&
+                (outcome == QueryOutcome::Truncated);
+            passed = passed && (graph.shortestPath(10, 20, "label 1", options).size() == 11) &&
+                (outcome == QueryOutcome::Exact);
+            passed = passed && graph.shortestPath(vertex_count + 1, 1, "label 1", options).empty() &&
+                (outcome == QueryOutcome::Exact);
+            options.max_expanded = UINT64_MAX;
+
+            // A deadline that has passed and a cancelled token stop the search before it starts.
+            options.deadline = std::chrono::steady_clock::now();
+            passed = passed && graph.shortestPath(1, vertex_count, "label 1", options).empty() &&
+                (outcome == QueryOutcome::Truncated);
+            options.deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+            CancellationToken token;
+            options.cancellation = &token;
+            passed = passed && (graph.shortestPath(1, vertex_count, "label 1", options).size() == vertex_count) &&
+                (outcome == QueryOutcome::Exact);
+            token.cancel();
+            passed = passed && graph.shortestPath(1, vertex_count, "label 1", options).empty() &&
+                (outcome == QueryOutcome::Cancelled);
+            token.reset();
+            passed = passed && (graph.shortestPath(1, vertex_count, "label 1", options).size() == vertex_count);
+        }
+
+        // The limits don't change the queries they don't stop, in a batch or on a version, and a cancelled token
+        // stops every query of a batch.
+        std::vector<PathQuery> queries;
+        for (VertexId v_id = 1; v_id <= 100; ++v_id)
+        {
+            queries.push_back(PathQuery{ v_id, v_id * 10, "label 1" });
+        }
+        QueryOptions options;
+        options.max_hops = 200;
+        QueryOutcome outcome = QueryOutcome::Exact;
+        options.outcome = &outcome;
+        const std::vector<std::vector<VertexId>> paths = graph.shortestPaths(queries, pool, options);
+        for (size_t i = 0; (i < queries.size()) && passed; ++i)
+        {
+            const size_t hops = queries[i].to - queries[i].from;
+            passed = (paths[i].size() == ((hops <= 200) ? (hops + 1) : 0));
+        }
+        CancellationToken token;
+        token.cancel();
+        options.cancellation = &token;
+        for (const std::vector<VertexId>& path : graph.shortestPaths(queries, pool, options))
+        {
+            passed = passed && path.empty();
+        }
+        passed = passed && (outcome == QueryOutcome::Exact);
+
+        options = QueryOptions();
+        options.outcome = &outcome;
+        options.max_hops = 5;
+        std::unique_ptr<const GraphVersion> version = graph.createVersion();
+        QueryContext context;
+        std::vector<VertexId> path;
+        passed = passed && version->shortestPath(1, 6, "label 1", options, context, path) && (path.size() == 6) &&
+            (outcome == QueryOutcome::Exact);
+        passed = passed && !version->shortestPath(1, 7, "label 1", options, context, path) &&
+            (outcome == QueryOutcome::Truncated);
+
+        // The distance index answers without searching but still keeps to the hop limit.
+        graph.indexDistances("label 1", nullptr);
+        passed = passed && (graph.shortestPath(1, 6, "label 1", options).size() == 6) &&
+            (outcome == QueryOutcome::Exact);
+        passed = passed && graph.shortestPath(1, 7, "label 1", options).empty() &&
+            (outcome == QueryOutcome::Truncated);
+
+        if (passed)
+        {
+            std::cout << "LimitTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "LimitTest1 failed" << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    void CompactTest1()
+    {
+        std::cout << "CompactTest1" << std::endl;
+
+        // A random weighted graph where every vertex has "all" and three quarters of them "label 1", searched by a
+        // store with 64-bit and a store with 32-bit neighbours.
+        typedef std::pair<VertexId, VertexId> Edge;
+        const size_t vertex_count = 4000;
+        std::mt19937 rng(29);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,
+            static_cast<std::mt19937::result_type>(vertex_count));
+        std::vector<Edge> edges;
+        for (size_t i = 0; i < 4 * vertex_count; ++i)
+        {
+            edges.emplace_back(dist(rng), dist(rng));
+        }
+        std::vector<VertexId> labelled;
+        std::vector<VertexId> all;
+        for (VertexId v_id = 1; v_id <= vertex_count; ++v_id)
+        {
+            all.push_back(v_id);
+            if ((rng() % 4) != 0)
+            {
+                labelled.push_back(v_id);
+            }
+        }
+
+        GraphStore plain;
+        GraphStore compact(AdjacencyStorage::CompactSets);
+        for (GraphStore* graph : { &plain, &compact })
+        {
+            graph->createVertices(vertex_count);
+            graph->createEdges(edges, nullptr);
+            for (size_t i = 0; i < 300; ++i)
+            {
+                graph->createEdge(edges[i].first, edges[i].second, static_cast<EdgeWeight>(1 + (i % 5)));
+            }
+            graph->addLabelToVertices("label 1", labelled);
+            graph->addLabelToVertices("all", all);
+            graph->freeze();
+        }
+
+        // Half the bytes per neighbour, the offsets and the weights staying as they are.
+        const size_t plain_bytes = plain.memoryUsage().frozen;
+        const size_t compact_bytes = compact.memoryUsage().frozen;
+        std::cout << "Frozen copies: " << plain_bytes << " bytes with 64-bit IDs, " << compact_bytes <<
+            " bytes with 32-bit IDs" << std::endl;
+        bool passed = compact.isFrozen() && (compact.snapshot() == nullptr) && (compact_bytes < plain_bytes * 0.7) &&
+            (CompareQueries(compact, plain, vertex_count, 1) > 0);
+
+        // Every algorithm, through a label and through the label every vertex has, which runs without label checks.
+        // The predicate over that label runs with them, and finds the same paths.
+        const LabelPredicate every_vertex = LabelPredicate::has("all");
+        ThreadPool pool(2);
+        std::vector<QueryOptions> options(5);
+        options[1].algorithm = SearchAlgorithm::AStar;
+        options[2].algorithm = SearchAlgorithm::Dijkstra;
+        options[3].algorithm = SearchAlgorithm::ParallelBfs;
+        options[3].pool = &pool;
+        options[4].algorithm = SearchAlgorithm::Alt;
+        compact.buildLandmarks(LandmarkOptions());
+        plain.buildLandmarks(LandmarkOptions());
+        auto weight = [](const GraphStore& graph, const std::vector<VertexId>& path)
+        {
+            EdgeWeight total = 0;
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                total += graph.edgeWeight(path[i - 1], path[i]);
+            }
+            return total;
+        };
+        size_t found = 0;
+        for (size_t i = 0; (i < 200) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            for (const std::string label : { "label 1", "all" })
+            {
+                for (const QueryOptions& query_options : options)
+                {
+                    const std::vector<VertexId> expected = plain.shortestPath(from, to, label, query_options);
+                    const std::vector<VertexId> path = compact.shortestPath(from, to, label, query_options);
+                    passed = passed && (path.size() == expected.size()) &&
+                        ((query_options.algorithm != SearchAlgorithm::Dijkstra) ||
+                            (weight(compact, path) == weight(plain, expected))) && ((label != "all") ||
+                            (compact.shortestPath(from, to, every_vertex, query_options).size() == path.size()));
+                    found += path.empty() ? 0 : 1;
+                }
+            }
+        }
+        passed = passed && (found > 0);
+
+        const std::vector<VertexId> targets(all.begin(), all.begin() + 100);
+        const std::vector<VertexId> sources(all.begin() + 100, all.begin() + 120);
+        passed = passed && (compact.distanceMatrix(sources, targets, "label 1", nullptr) ==
+            plain.distanceMatrix(sources, targets, "label 1", nullptr));
+        const std::vector<std::vector<VertexId>> paths = compact.shortestPaths(1, targets, "all");
+        const std::vector<std::vector<VertexId>> expected_paths = plain.shortestPaths(1, targets, "all");
+        for (size_t i = 0; (i < targets.size()) && passed; ++i)
+        {
+            passed = (paths[i].size() == expected_paths[i].size());
+        }
+
+        // The versions get a full width copy, built once.
+        std::unique_ptr<const GraphVersion> version = compact.createVersion();
+        std::shared_ptr<const CsrAdjacency> snapshot = compact.snapshot();
+        std::unique_ptr<const GraphVersion> second_version = compact.createVersion();
+        passed = passed && (snapshot != nullptr) && (compact.snapshot() == snapshot) &&
+            (snapshot->edgeCount() == plain.edgeCount());
+        QueryContext context;
+        std::vector<VertexId> version_path;
+        for (size_t i = 0; (i < 200) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            version->shortestPath(from, to, "all", QueryOptions(), context, version_path);
+            passed = (version_path.size() == plain.shortestPath(from, to, "all").size());
+        }
+
+        // Once a vertex loses the label, the label check is back.
+        for (GraphStore* graph : { &plain, &compact })
+        {
+            graph->removeLabel(all[vertex_count / 2], "all");
+            graph->createEdge(1, vertex_count);
+            graph->freeze();
+        }
+        passed = passed && (compact.snapshot() == nullptr);
+        for (size_t i = 0; (i < 500) && passed; ++i)
+        {
+            const VertexId from = dist(rng);
+            const VertexId to = dist(rng);
+            passed = (compact.shortestPath(from, to, "all").size() == plain.shortestPath(from, to, "all").size());
+        }
+
+        if (passed)
+        {
+            std::cout << "CompactTest1 passed" << std::endl;
+        }
+        else
+        {
+            std::cout << "CompactTest1 failed" << std::endl;
+        }
         std::cout << std::endl;
     }
 }
@@ -444,12 +2908,31 @@ int main(int argc, char* argv[])
         SimpleTest5();
         SimpleTest6();
         SimpleTest7();
-        PerfTest1();
-        PerfTest2();
-        PerfTest3();
-        // This test is commented out because it takes 110s to run on my machine. It exceeds the requirements but it
-        // has more vertices and edges than the requiremnts ask for.
-        //PerfTest4();
+        SnapshotTest1();
+        LabelTest1();
+        SearchTest1();
+        ContextTest1();
+        BatchTest1();
+        ParallelBfsTest1();
+        ConcurrencyTest1();
+        BulkTest1();
+        SnapshotFileTest1();
+        WalTest1();
+        StatsTest1();
+        ReachabilityTest1();
+        AltTest1();
+        HubLabelTest1();
+        DijkstraTest1();
+        PredicateTest1();
+        DeleteTest1();
+        ReorderTest1();
+        CompressedTest1();
+        PoolTest1();
+        PoolTest2();
+        MultiSourceTest1();
+        SubscriptionTest1();
+        LimitTest1();
+        CompactTest1();
     }
     catch (...)
     {
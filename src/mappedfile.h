@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/// A file mapped read-only in memory. Pages are loaded by the operating system when they are first accessed.
+class MappedFile
+{
+public:
+    /// Map a whole file.
+    /// @throws std::runtime_error if the file can't be opened or mapped.
+    explicit MappedFile(const std::string& path);
+
+    /// Unmap the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Returns the start of the mapped file.
+    const char* data() const { return m_data; }
+
+    /// Returns the size of the file in bytes.
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif
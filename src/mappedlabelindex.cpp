@@ -0,0 +1,31 @@
+#include "mappedlabelindex.h"
+#include <algorithm>
+#include <utility>
+
+void DenseVertexSet::copyTo(std::vector<uint64_t>& words) const
+{
+    const size_t count = std::min(words.size(), m_word_count);
+    std::copy(m_words, m_words + count, words.begin());
+    std::fill(words.begin() + count, words.end(), 0);
+}
+
+MappedLabelIndex::MappedLabelIndex(std::vector<std::string> names, const uint64_t* words, size_t wordsPerLabel,
+    std::shared_ptr<const void> storage) :
+    m_names(std::move(names)), m_words(words), m_words_per_label(wordsPerLabel), m_storage(std::move(storage))
+{
+    for (size_t id = 0; id < m_names.size(); ++id)
+    {
+        m_ids.emplace(m_names[id], static_cast<LabelId>(id));
+    }
+}
+
+bool MappedLabelIndex::find(const std::string& label, LabelId& id) const
+{
+    auto found = m_ids.find(label);
+    if (found == m_ids.end())
+    {
+        return false;
+    }
+    id = found->second;
+    return true;
+}
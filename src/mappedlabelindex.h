@@ -0,0 +1,68 @@
+#ifndef MAPPEDLABELINDEX_H
+#define MAPPEDLABELINDEX_H
+
+#include "types.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// A set of vertices stored as a plain bitset in memory owned by someone else, bit i standing for vertex i.
+class DenseVertexSet
+{
+public:
+    DenseVertexSet(const uint64_t* words, size_t wordCount) : m_words(words), m_word_count(wordCount) {};
+
+    /// Returns true if the vertex is in the set.
+    bool contains(VertexId vertex) const
+    {
+        const size_t word_index = vertex >> 6;
+        return (word_index < m_word_count) && ((m_words[word_index] >> (vertex & 63)) & 1);
+    }
+
+    /// Write the set as a plain bitset. See VertexBitmap::copyTo.
+    void copyTo(std::vector<uint64_t>& words) const;
+
+private:
+    const uint64_t* m_words;
+    size_t m_word_count;
+};
+
+/// Read-only label dictionary whose vertex sets are bitsets stored elsewhere, typically in a memory-mapped snapshot
+/// file. It offers the same lookups as LabelIndex.
+class MappedLabelIndex
+{
+public:
+    /// @param names The name of each label. The position in the vector is the ID of the label.
+    /// @param words The bitsets of all the labels, one after the other.
+    /// @param wordsPerLabel The number of words in the bitset of each label.
+    /// @param storage Keeps the memory of the bitsets alive for as long as the index exists.
+    MappedLabelIndex(std::vector<std::string> names, const uint64_t* words, size_t wordsPerLabel,
+        std::shared_ptr<const void> storage);
+
+    /// Look up the ID of a label.
+    /// @returns false if there is no such label.
+    bool find(const std::string& label, LabelId& id) const;
+
+    /// Returns the name of a label. The label must exist.
+    const std::string& name(LabelId id) const { return m_names[id]; }
+
+    /// Returns the number of labels in the dictionary.
+    size_t labelCount() const { return m_names.size(); }
+
+    /// Returns the vertices that have a label. The label must exist.
+    DenseVertexSet vertices(LabelId id) const
+    {
+        return DenseVertexSet(m_words + (id * m_words_per_label), m_words_per_label);
+    }
+
+private:
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, LabelId> m_ids;
+    const uint64_t* m_words;
+    size_t m_words_per_label;
+    std::shared_ptr<const void> m_storage;
+};
+
+#endif
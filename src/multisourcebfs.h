@@ -0,0 +1,380 @@
+#ifndef MULTISOURCEBFS_H
+#define MULTISOURCEBFS_H
+
+#include "bits.h"
+#include "querycontext.h"
+#include "search.h"
+#include "threadpool.h"
+#include "types.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The searches behind GraphStore::shortestPaths from one vertex to many and GraphStore::distanceMatrix. Like those of
+// search.h, they are templates over the adjacency and the vertices of a label, and count edges: the weights are
+// ignored.
+namespace search
+{
+    // The distance of the pairs of vertices without a path.
+    const uint32_t NoPath = UINT32_MAX;
+
+    // Breadth-first search from one vertex that stops as soon as every target is reached, then rebuilds the path to
+    // each target from the parents. The vertices are internal IDs in range. A target without the label gets an empty
+    // path, the source itself a path of one vertex.
+    template <typename Adjacency, typename LabelSet>
+    void OneToManyBfs(const Adjacency& adjacency, VertexId from, const std::vector<VertexId>& targets,
+        const LabelSet& labelled, QueryContext& context, std::vector<std::vector<VertexId>>& paths)
+    {
+        paths.assign(targets.size(), std::vector<VertexId>());
+        if (!labelled.contains(from))
+        {
+            return;
+        }
+
+        // The backward visits mark the targets, so that each one is counted once however often it is given.
+        VisitMap& visits = context.m_forward;
+        VisitMap& pending = context.m_backward;
+        visits.clear(adjacency.vertexCount());
+        pending.clear(adjacency.vertexCount());
+        size_t pending_count = 0;
+        for (VertexId target : targets)
+        {
+            if ((target != from) && labelled.contains(target) && pending.visit(target, 0, 0))
+            {
+                ++pending_count;
+            }
+        }
+
+        visits.visit(from, 0, 0);
+        std::vector<VertexId>& frontier = context.m_forward_frontier;
+        std::vector<VertexId>& next_frontier = context.m_next_frontier;
+        frontier.assign(1, from);
+        for (uint32_t distance = 1; (pending_count > 0) && !frontier.empty(); ++distance)
+        {
+            next_frontier.clear();
+            for (VertexId vertex : frontier)
+            {
+                for (VertexId neighbour : adjacency.neighbours(vertex))
+                {
+                    if (labelled.contains(neighbour) && visits.visit(neighbour, vertex, distance))
+                    {
+                        next_frontier.push_back(neighbour);
+                        pending_count -= pending.visited(neighbour) ? 1 : 0;
+                    }
+                }
+                if (pending_count == 0)
+                {
+                    break;
+                }
+            }
+            frontier.swap(next_frontier);
+        }
+
+        for (size_t i = 0; i < targets.size(); ++i)
+        {
+            if (visits.visited(targets[i]))
+            {
+                AppendParents(visits, targets[i], paths[i]);
+                std::reverse(paths[i].begin(), paths[i].end());
+            }
+        }
+    }
+
+    // The distinct targets of a distance matrix, numbered by slot in the order they are added.
+    class TargetSlots
+    {
+    public:
+        explicit TargetSlots(size_t vertexCount) : m_words((vertexCount / 64) + 1) { m_slots.clear(vertexCount); }
+
+        // Returns the slot of a vertex, adding it if it is not a target yet.
+        size_t add(VertexId vertex)
+        {
+            if (m_slots.visit(vertex, m_count + 1, 0))
+            {
+                m_words[vertex / 64] |= uint64_t(1) << (vertex % 64);
+                ++m_count;
+            }
+            return slot(vertex);
+        }
+
+        bool contains(VertexId vertex) const { return ((m_words[vertex / 64] >> (vertex % 64)) & 1) != 0; }
+
+        // Returns the slot of a target.
+        size_t slot(VertexId vertex) const { return m_slots.parent(vertex) - 1; }
+
+        size_t size() const { return m_count; }
+
+    private:
+        // A bit per vertex ID, tested for every vertex the searches reach, which fits in the cache where the visit
+        // map doesn't.
+        std::vector<uint64_t> m_words;
+        // The slot of each target + 1 as its parent.
+        VisitMap m_slots;
+        size_t m_count = 0;
+    };
+
+    // The state of a multi-source BFS over Words * 64 sources: bit i of the lanes of a vertex stands for source i. The
+    // array is allocated once for a run of batches; a batch only clears the vertices it reached.
+    template <size_t Words>
+    struct LaneScratch
+    {
+        typedef std::array<uint64_t, Words> Lanes;
+
+        // The sources that reached a vertex before the current level, and those that reach it at the next level.
+        // They are kept together so that reaching a vertex touches a single cache line.
+        struct Vertex
+        {
+            Lanes seen;
+            Lanes next;
+        };
+
+        explicit LaneScratch(size_t vertexCount) : vertices(vertexCount) {}
+
+        static bool empty(const Lanes& lanes)
+        {
+            return std::all_of(lanes.begin(), lanes.end(), [](uint64_t word) { return word == 0; });
+        }
+
+        std::vector<Vertex> vertices;
+        // The vertices of the current level with the sources that reached them at this level.
+        std::vector<std::pair<VertexId, Lanes>> frontier;
+        // The vertices whose next lanes are not all 0.
+        std::vector<VertexId> next_frontier;
+        // The vertices whose seen lanes are not all 0.
+        std::vector<VertexId> touched;
+    };
+
+    // Multi-source BFS, as described by Then et al. in "The More the Merrier: Efficient Multi-Source Graph Traversal":
+    // the searches from up to Words * 64 sources advance one level at a time together, and a vertex that several of
+    // them reach at the same level is expanded once for all of them, its lanes ORed into those of its neighbours with
+    // a few word operations. The adjacency is thus walked once per level at which some source reaches a vertex
+    // instead of once per source: a large saving where the searches of the batch overlap, as in small-world graphs,
+    // and a small one on sparse graphs of large diameter, where each source reaches a vertex at a different level.
+    // The distance from source i to the target of slot s goes to distances[i * targets.size() + s], which must be
+    // NoPath beforehand. The search stops once every source has reached every target.
+    template <size_t Words, typename Adjacency, typename LabelSet>
+    void MultiSourceBfs(const Adjacency& adjacency, const VertexId* sources, size_t sourceCount,
+        const TargetSlots& targets, const LabelSet& labelled, LaneScratch<Words>& scratch, uint32_t* distances)
+    {
+        typedef LaneScratch<Words> Scratch;
+        typedef typename Scratch::Lanes Lanes;
+
+        // The sources make up the level 0.
+        size_t pending_count = 0;
+        for (size_t i = 0; i < sourceCount; ++i)
+        {
+            const VertexId source = sources[i];
+            if (!labelled.contains(source))
+            {
+                continue;
+            }
+            pending_count += targets.size();
+            Lanes& next = scratch.vertices[source - 1].next;
+            if (Scratch::empty(next))
+            {
+                scratch.next_frontier.push_back(source);
+            }
+            next[i / 64] |= uint64_t(1) << (i % 64);
+        }
+
+        for (uint32_t distance = 0; (pending_count > 0) && !scratch.next_frontier.empty(); ++distance)
+        {
+            // The seen lanes only change once a whole level is expanded, so that every source of the frontier reaches
+            // the neighbours it shares with the others.
+            scratch.frontier.clear();
+            for (VertexId vertex : scratch.next_frontier)
+            {
+                typename Scratch::Vertex& state = scratch.vertices[vertex - 1];
+                if (Scratch::empty(state.seen))
+                {
+                    scratch.touched.push_back(vertex);
+                }
+                for (size_t w = 0; w < Words; ++w)
+                {
+                    state.seen[w] |= state.next[w];
+                }
+                if (targets.contains(vertex))
+                {
+                    const size_t slot = targets.slot(vertex);
+                    for (size_t w = 0; w < Words; ++w)
+                    {
+                        for (uint64_t bits = state.next[w]; bits != 0; bits &= bits - 1)
+                        {
+                            distances[(((w * 64) + CountTrailingZeros(bits)) * targets.size()) + slot] = distance;
+                            --pending_count;
+                        }
+                    }
+                }
+                scratch.frontier.emplace_back(vertex, state.next);
+                state.next = Lanes();
+            }
+            scratch.next_frontier.clear();
+            if (pending_count == 0)
+            {
+                break;
+            }
+
+            for (const std::pair<VertexId, Lanes>& entry : scratch.frontier)
+            {
+                for (VertexId neighbour : adjacency.neighbours(entry.first))
+                {
+                    if (!labelled.contains(neighbour))
+                    {
+                        continue;
+                    }
+                    typename Scratch::Vertex& state = scratch.vertices[neighbour - 1];
+                    uint64_t pending_lanes = 0;
+                    uint64_t new_lanes = 0;
+                    for (size_t w = 0; w < Words; ++w)
+                    {
+                        pending_lanes |= state.next[w];
+                        const uint64_t lanes = entry.second[w] & ~state.seen[w];
+                        state.next[w] |= lanes;
+                        new_lanes |= lanes;
+                    }
+                    if ((pending_lanes == 0) && (new_lanes != 0))
+                    {
+                        scratch.next_frontier.push_back(neighbour);
+                    }
+                }
+            }
+        }
+
+        for (VertexId vertex : scratch.touched)
+        {
+            scratch.vertices[vertex - 1].seen = Lanes();
+        }
+        for (VertexId vertex : scratch.next_frontier)
+        {
+            scratch.vertices[vertex - 1].next = Lanes();
+        }
+        scratch.touched.clear();
+        scratch.next_frontier.clear();
+    }
+
+    // Runs the multi-source BFS over batches of Words * 64 sources, side by side on the pool if there is one. The
+    // distances have a row per source. Each chunk of batches takes a scratch that an earlier chunk gave back, if there
+    // is one, so that no more scratches are allocated than there are chunks running at the same time.
+    template <size_t Words, typename Adjacency, typename LabelSet>
+    void BatchedMultiSourceBfs(const Adjacency& adjacency, const std::vector<VertexId>& sources,
+        const TargetSlots& targets, const LabelSet& labelled, ThreadPool* pool, std::vector<uint32_t>& distances)
+    {
+        const size_t batch_size = Words * 64;
+        const size_t batch_count = (sources.size() + batch_size - 1) / batch_size;
+        std::mutex mutex;
+        std::vector<std::unique_ptr<LaneScratch<Words>>> free_scratches;
+        ParallelFor(pool, batch_count, 1, [&](size_t begin, size_t end)
+        {
+            std::unique_ptr<LaneScratch<Words>> scratch;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!free_scratches.empty())
+                {
+                    scratch = std::move(free_scratches.back());
+                    free_scratches.pop_back();
+                }
+            }
+            if (!scratch)
+            {
+                scratch.reset(new LaneScratch<Words>(adjacency.vertexCount()));
+            }
+            for (size_t batch = begin; batch < end; ++batch)
+            {
+                const size_t first = batch * batch_size;
+                const size_t count = std::min(batch_size, sources.size() - first);
+                MultiSourceBfs(adjacency, sources.data() + first, count, targets, labelled, *scratch,
+                    distances.data() + (first * targets.size()));
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            free_scratches.push_back(std::move(scratch));
+        });
+    }
+
+    // Fills matrix[i][j] with the distance from sources[i] to targets[j] through the vertices of a label, by
+    // multi-source BFS from the sources. Batches of 256 sources walk the adjacency about as often as batches of 64,
+    // so the wider lanes are used unless they would leave threads of the pool idle.
+    template <typename Adjacency, typename LabelSet>
+    void MultiSourceDistances(const Adjacency& adjacency, const LabelSet& labelled,
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets, ThreadPool* pool,
+        std::vector<std::vector<uint32_t>>& matrix)
+    {
+        matrix.assign(sources.size(), std::vector<uint32_t>(targets.size(), NoPath));
+
+        // The targets that have the label are numbered by slot, once each, so that the searches record each of them
+        // once and stop when they have reached them all.
+        TargetSlots target_slots(adjacency.vertexCount());
+        std::vector<size_t> slots(targets.size(), SIZE_MAX);
+        for (size_t j = 0; j < targets.size(); ++j)
+        {
+            if (labelled.contains(targets[j]))
+            {
+                slots[j] = target_slots.add(targets[j]);
+            }
+        }
+        if (sources.empty() || (target_slots.size() == 0))
+        {
+            return;
+        }
+
+        std::vector<uint32_t> distances(sources.size() * target_slots.size(), NoPath);
+        const size_t workers = (pool != nullptr) ? std::max(pool->workerCount(), size_t(1)) : 1;
+        if (sources.size() > 64 * workers)
+        {
+            BatchedMultiSourceBfs<4>(adjacency, sources, target_slots, labelled, pool, distances);
+        }
+        else
+        {
+            BatchedMultiSourceBfs<1>(adjacency, sources, target_slots, labelled, pool, distances);
+        }
+
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            for (size_t j = 0; j < targets.size(); ++j)
+            {
+                if (slots[j] != SIZE_MAX)
+                {
+                    matrix[i][j] = distances[(i * target_slots.size()) + slots[j]];
+                }
+            }
+        }
+    }
+
+    // Computes the distances from each source to each target through the vertices of a label. The vertices are
+    // internal IDs in range. The searches start from the smaller of the two sides, going backward from the targets
+    // when they are fewer than the sources, so that there are as few batches as possible.
+    template <typename Adjacency, typename Labels>
+    std::vector<std::vector<uint32_t>> DistanceMatrix(const Adjacency& forward, const Adjacency& backward,
+        const Labels& labels, const std::vector<VertexId>& sources, const std::vector<VertexId>& targets,
+        const std::string& label, ThreadPool* pool)
+    {
+        std::vector<std::vector<uint32_t>> matrix(sources.size(), std::vector<uint32_t>(targets.size(), NoPath));
+        LabelId label_id;
+        if (!labels.find(label, label_id))
+        {
+            return matrix;
+        }
+        const auto& labelled = labels.vertices(label_id);
+        if (sources.size() <= targets.size())
+        {
+            MultiSourceDistances(forward, labelled, sources, targets, pool, matrix);
+            return matrix;
+        }
+
+        std::vector<std::vector<uint32_t>> transposed;
+        MultiSourceDistances(backward, labelled, targets, sources, pool, transposed);
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            for (size_t j = 0; j < targets.size(); ++j)
+            {
+                matrix[i][j] = transposed[j][i];
+            }
+        }
+        return matrix;
+    }
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "nodepool.h"
+#include <algorithm>
+
+const size_t NodePool::MaxNodeSize;
+const size_t NodePool::Alignment;
+const size_t NodePool::MaxSlabSize;
+const size_t NodePool::CacheBlockSize;
+
+namespace
+{
+    // The cache the current thread allocates through, if any.
+    thread_local NodePool::ThreadCache* t_thread_cache = nullptr;
+}
+
+void* NodePool::allocate(size_t size)
+{
+    const size_t size_class = (size + Alignment - 1) / Alignment;
+    if ((t_thread_cache != nullptr) && (t_thread_cache->m_pool == this))
+    {
+        return t_thread_cache->allocate(size_class);
+    }
+
+    const size_t rounded_size = size_class * Alignment;
+    void*& free_list = m_free_lists[size_class - 1];
+    void* node;
+    if (free_list != nullptr)
+    {
+        node = free_list;
+        free_list = *static_cast<void**>(node);
+    }
+    else
+    {
+        node = carve(rounded_size);
+    }
+    m_used_bytes += rounded_size;
+    ++m_node_count;
+    return node;
+}
+
+void NodePool::deallocate(void* node, size_t size)
+{
+    const size_t size_class = (size + Alignment - 1) / Alignment;
+    if ((t_thread_cache != nullptr) && (t_thread_cache->m_pool == this))
+    {
+        t_thread_cache->deallocate(node, size_class);
+        return;
+    }
+
+    push(node, size_class);
+    m_used_bytes -= size_class * Alignment;
+    --m_node_count;
+}
+
+char* NodePool::carve(size_t size)
+{
+    if (static_cast<size_t>(m_end - m_cursor) < size)
+    {
+        // The end of the previous slab, smaller than what is asked, is left unused.
+        const size_t slab_size = m_slabs.empty() ? FirstSlabSize : std::min(m_reserved_bytes, MaxSlabSize);
+        m_slabs.emplace_back(new char[slab_size]);
+        m_cursor = m_slabs.back().get();
+        m_end = m_cursor + slab_size;
+        m_reserved_bytes += slab_size;
+    }
+    char* const block = m_cursor;
+    m_cursor += size;
+    return block;
+}
+
+void NodePool::push(void* node, size_t sizeClass)
+{
+    void*& free_list = m_free_lists[sizeClass - 1];
+    *static_cast<void**>(node) = free_list;
+    free_list = node;
+}
+
+NodePool::ThreadCache::ThreadCache(NodePool* pool) :
+    m_pool(pool), m_previous(t_thread_cache)
+{
+    if (m_pool != nullptr)
+    {
+        t_thread_cache = this;
+    }
+}
+
+NodePool::ThreadCache::~ThreadCache()
+{
+    if (m_pool == nullptr)
+    {
+        return;
+    }
+    t_thread_cache = m_previous;
+
+    std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+    for (size_t i = 0; i < SizeClassCount; ++i)
+    {
+        while (m_free_lists[i] != nullptr)
+        {
+            void* node = m_free_lists[i];
+            m_free_lists[i] = *static_cast<void**>(node);
+            m_pool->push(node, i + 1);
+        }
+    }
+    giveBackBlock();
+    m_pool->m_used_bytes += m_used_bytes;
+    m_pool->m_node_count += m_node_count;
+}
+
+void* NodePool::ThreadCache::allocate(size_t sizeClass)
+{
+    const size_t rounded_size = sizeClass * Alignment;
+    void*& free_list = m_free_lists[sizeClass - 1];
+    void* node;
+    if (free_list != nullptr)
+    {
+        node = free_list;
+        free_list = *static_cast<void**>(node);
+    }
+    else if (static_cast<size_t>(m_end - m_cursor) >= rounded_size)
+    {
+        node = m_cursor;
+        m_cursor += rounded_size;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+        // The nodes freed in the pool by deletions are reused first, a block's worth at a time.
+        void*& pool_free_list = m_pool->m_free_lists[sizeClass - 1];
+        if (pool_free_list != nullptr)
+        {
+            node = pool_free_list;
+            pool_free_list = *static_cast<void**>(node);
+            for (size_t i = rounded_size; (i < CacheBlockSize) && (pool_free_list != nullptr); i += rounded_size)
+            {
+                void* free_node = pool_free_list;
+                pool_free_list = *static_cast<void**>(free_node);
+                *static_cast<void**>(free_node) = free_list;
+                free_list = free_node;
+            }
+        }
+        else
+        {
+            giveBackBlock();
+            m_cursor = m_pool->carve(CacheBlockSize);
+            m_end = m_cursor + CacheBlockSize;
+            m_last_size_class = sizeClass;
+            node = m_cursor;
+            m_cursor += rounded_size;
+        }
+    }
+    m_used_bytes += rounded_size;
+    ++m_node_count;
+    return node;
+}
+
+void NodePool::ThreadCache::giveBackBlock()
+{
+    // The rest of the block goes back as free nodes of the size it was cut for, the size the next insertions are
+    // likely to ask for.
+    if (m_last_size_class != 0)
+    {
+        const size_t node_size = m_last_size_class * Alignment;
+        for (; static_cast<size_t>(m_end - m_cursor) >= node_size; m_cursor += node_size)
+        {
+            m_pool->push(m_cursor, m_last_size_class);
+        }
+    }
+    m_cursor = nullptr;
+    m_end = nullptr;
+}
+
+void NodePool::ThreadCache::deallocate(void* node, size_t sizeClass)
+{
+    void*& free_list = m_free_lists[sizeClass - 1];
+    *static_cast<void**>(node) = free_list;
+    free_list = node;
+    // The counts are merged into the pool's when the cache is destroyed, so they may go below zero meanwhile.
+    m_used_bytes -= sizeClass * Alignment;
+    --m_node_count;
+}
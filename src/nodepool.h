@@ -0,0 +1,208 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include "types.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+/// Allocator of the small fixed-size nodes of node-based containers such as std::set, carved out of large slabs.
+/// Allocating a node pops a free list or bumps a pointer and freeing one pushes it on the free list of its size, so
+/// neither goes through the global heap; the nodes of a graph built in one go end up next to each other in memory. The
+/// slabs are only given back when the pool is destroyed, and nodes freed by deletions are reused by the next
+/// insertions of the same size. A pool is not thread-safe: it belongs to one container owner, see OwnedNodePool, and
+/// threads that fill containers of the same pool at the same time each go through a ThreadCache.
+class NodePool
+{
+public:
+    class ThreadCache;
+
+    /// The largest node the pool allocates. PoolAllocator sends larger ones to the global heap.
+    static const size_t MaxNodeSize = 64;
+
+    /// The alignment of every node. PoolAllocator sends the types that need more to the global heap.
+    static const size_t Alignment = alignof(void*);
+
+    NodePool() = default;
+    ~NodePool() = default;
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    /// Returns a node of size bytes, at most MaxNodeSize.
+    void* allocate(size_t size);
+
+    /// Give back a node returned by allocate with the same size.
+    void deallocate(void* node, size_t size);
+
+    /// Returns the number of bytes of the slabs.
+    size_t reservedBytes() const { return m_reserved_bytes; }
+
+    /// Returns the number of bytes of the nodes in use. The rest of reservedBytes() is free nodes and the unused end of
+    /// the slabs.
+    size_t usedBytes() const { return m_used_bytes; }
+
+    /// Returns the number of nodes in use.
+    size_t nodeCount() const { return m_node_count; }
+
+private:
+    static const size_t SizeClassCount = MaxNodeSize / Alignment;
+    static const size_t FirstSlabSize = 4096;
+    static const size_t MaxSlabSize = 1 << 20;
+    // The bytes a thread cache takes from the slabs at a time.
+    static const size_t CacheBlockSize = 4096;
+
+    // Returns size bytes, a multiple of Alignment, from the end of the last slab or from a new one.
+    char* carve(size_t size);
+    // Pushes a node on the free list of its size class.
+    void push(void* node, size_t sizeClass);
+
+    // Taken by the thread caches when they get a block or give back what they did not use.
+    std::mutex m_mutex;
+
+    // The slabs, each twice as large as the one before up to MaxSlabSize, so that small graphs stay small.
+    std::vector<std::unique_ptr<char[]>> m_slabs;
+    // The unused end of the last slab.
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    // The first free node of each size, by size / Alignment - 1. Each free node starts with a pointer to the next one.
+    void* m_free_lists[SizeClassCount] = {};
+    size_t m_reserved_bytes = 0;
+    size_t m_used_bytes = 0;
+    size_t m_node_count = 0;
+};
+
+/// Lets the calling thread allocate nodes from a pool at the same time as other threads that hold a cache of the same
+/// pool, for as long as the cache lives. The cache takes blocks of the slabs from the pool under its lock and carves
+/// nodes out of them on its own; when it is destroyed, its free nodes, the rest of its block and its counts go back to
+/// the pool. The containers filled through a cache keep using the pool as usual once the caches are gone.
+class NodePool::ThreadCache
+{
+public:
+    /// @param pool The pool to allocate from, or nullptr for a cache that does nothing.
+    explicit ThreadCache(NodePool* pool);
+    ~ThreadCache();
+
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+private:
+    friend class NodePool;
+
+    void* allocate(size_t sizeClass);
+    void deallocate(void* node, size_t sizeClass);
+    // Gives the rest of the block back to the pool, whose lock must be held.
+    void giveBackBlock();
+
+    NodePool* m_pool;
+    // The cache of the thread before this one, restored when this one is destroyed.
+    ThreadCache* m_previous;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    // The size class the block was taken for, which the rest of it is cut into when it is given back.
+    size_t m_last_size_class = 0;
+    void* m_free_lists[SizeClassCount] = {};
+    size_t m_used_bytes = 0;
+    size_t m_node_count = 0;
+};
+
+/// Standard allocator that takes single small objects, the nodes of node-based containers, from a NodePool and
+/// anything else from the global heap. A default constructed allocator uses the global heap only.
+/// A container copy-constructed from one that uses a pool gets a default allocator rather than sharing the pool, so
+/// that the copy can be used from another thread.
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    PoolAllocator() = default;
+
+    explicit PoolAllocator(std::shared_ptr<NodePool> pool) : m_pool(std::move(pool)) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : m_pool(other.pool()) {}
+
+    T* allocate(size_t count)
+    {
+        if (pooled(count))
+        {
+            return static_cast<T*>(m_pool->allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count)
+    {
+        if (pooled(count))
+        {
+            m_pool->deallocate(pointer, sizeof(T));
+            return;
+        }
+        ::operator delete(pointer);
+    }
+
+    PoolAllocator select_on_container_copy_construction() const { return PoolAllocator(); }
+
+    /// Returns the pool, or nullptr for the global heap.
+    const std::shared_ptr<NodePool>& pool() const { return m_pool; }
+
+private:
+    bool pooled(size_t count) const
+    {
+        return m_pool && (count == 1) && (sizeof(T) <= NodePool::MaxNodeSize) && (alignof(T) <= NodePool::Alignment);
+    }
+
+    std::shared_ptr<NodePool> m_pool;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+    return a.pool() == b.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+    return a.pool() != b.pool();
+}
+
+/// The pool of a class whose containers allocate from it, as a member of that class. A copy of the class gets a new
+/// pool of its own instead of sharing the pool, and assigning the class keeps the pool it has.
+class OwnedNodePool
+{
+public:
+    /// @param enabled If false, the allocators use the global heap.
+    explicit OwnedNodePool(bool enabled) : m_pool(enabled ? std::make_shared<NodePool>() : nullptr) {}
+
+    OwnedNodePool(const OwnedNodePool& other) : OwnedNodePool(other.m_pool != nullptr) {}
+    OwnedNodePool(OwnedNodePool&&) = default;
+    OwnedNodePool& operator=(const OwnedNodePool&) { return *this; }
+    OwnedNodePool& operator=(OwnedNodePool&&) = default;
+
+    /// Returns an allocator that allocates from the pool.
+    template <typename T>
+    PoolAllocator<T> allocator() const { return PoolAllocator<T>(m_pool); }
+
+    /// Returns the pool, or nullptr if it is disabled.
+    NodePool* get() const { return m_pool.get(); }
+
+private:
+    std::shared_ptr<NodePool> m_pool;
+};
+
+/// The neighbours of a vertex of a mutable graph, sorted by ID.
+typedef std::set<VertexId, std::less<VertexId>, PoolAllocator<VertexId>> NeighbourSet;
+
+/// The neighbours of each vertex of a mutable graph. The position in the vector is the ID of the vertex - 1.
+typedef std::vector<NeighbourSet> AdjacencySets;
+
+#endif
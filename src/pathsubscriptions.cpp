@@ -0,0 +1,394 @@
+#include "pathsubscriptions.h"
+#include <algorithm>
+#include <stdexcept>
+
+const uint32_t ShortestPathTree::Unreached;
+
+ShortestPathTree::ShortestPathTree(VertexId root, const AdjacencySets& adjacency, const VertexBitmap& labelled) :
+    m_root(root)
+{
+    build(adjacency, labelled);
+}
+
+void ShortestPathTree::path(VertexId to, std::vector<VertexId>& path) const
+{
+    path.clear();
+    if (distance(to) == Unreached)
+    {
+        return;
+    }
+    for (VertexId vertex = to; vertex != 0; vertex = m_parents[vertex - 1])
+    {
+        path.push_back(vertex);
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+bool ShortestPathTree::addEdge(VertexId from, VertexId to, const AdjacencySets& adjacency,
+    const VertexBitmap& labelled)
+{
+    // A vertex the root reaches has the label, so only the destination is checked.
+    const uint32_t from_distance = distance(from);
+    if ((from_distance == Unreached) || ((from_distance + 1) >= distance(to)) || !labelled.contains(to))
+    {
+        return false;
+    }
+    relax(to, from_distance + 1, from, adjacency, labelled);
+    return true;
+}
+
+bool ShortestPathTree::removeEdge(VertexId from, VertexId to, const AdjacencySets& adjacency,
+    const AdjacencySets& reverse, const VertexBitmap& labelled)
+{
+    // Only the edges of the tree hold distances up. The root has no parent.
+    if ((distance(to) == Unreached) || (m_parents[to - 1] != from))
+    {
+        return false;
+    }
+    if (!repair(to, adjacency, reverse, labelled))
+    {
+        build(adjacency, labelled);
+    }
+    return true;
+}
+
+bool ShortestPathTree::addVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+    const VertexBitmap& labelled)
+{
+    if (vertex == m_root)
+    {
+        build(adjacency, labelled);
+        return true;
+    }
+
+    uint32_t best = Unreached;
+    VertexId parent = 0;
+    for (VertexId predecessor : reverse[vertex - 1])
+    {
+        const uint32_t predecessor_distance = distance(predecessor);
+        if (predecessor_distance < best)
+        {
+            best = predecessor_distance;
+            parent = predecessor;
+        }
+    }
+    if (best == Unreached)
+    {
+        return false;
+    }
+    relax(vertex, best + 1, parent, adjacency, labelled);
+    return true;
+}
+
+bool ShortestPathTree::removeVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+    const VertexBitmap& labelled)
+{
+    if (distance(vertex) == Unreached)
+    {
+        return false;
+    }
+    if (!repair(vertex, adjacency, reverse, labelled))
+    {
+        build(adjacency, labelled);
+    }
+    return true;
+}
+
+void ShortestPathTree::set(VertexId vertex, uint32_t distance, VertexId parent)
+{
+    if (vertex > m_distances.size())
+    {
+        m_distances.resize(vertex, Unreached);
+        m_parents.resize(vertex, 0);
+    }
+    if (m_distances[vertex - 1] == Unreached)
+    {
+        ++m_reached_count;
+    }
+    m_distances[vertex - 1] = distance;
+    m_parents[vertex - 1] = parent;
+}
+
+void ShortestPathTree::build(const AdjacencySets& adjacency, const VertexBitmap& labelled)
+{
+    m_distances.assign(adjacency.size(), Unreached);
+    m_parents.assign(adjacency.size(), 0);
+    m_reached_count = 0;
+    if (labelled.contains(m_root))
+    {
+        relax(m_root, 0, 0, adjacency, labelled);
+    }
+}
+
+void ShortestPathTree::relax(VertexId vertex, uint32_t distance, VertexId parent, const AdjacencySets& adjacency,
+    const VertexBitmap& labelled)
+{
+    // The queue is in order of distance, so each vertex gets its final distance the first time it is reached. The
+    // children of a vertex whose distance drops are always reached again, which keeps every parent one edge closer to
+    // the root than its children.
+    set(vertex, distance, parent);
+    m_queue.clear();
+    m_queue.push_back(vertex);
+    for (size_t i = 0; i < m_queue.size(); ++i)
+    {
+        const VertexId current = m_queue[i];
+        const uint32_t next_distance = m_distances[current - 1] + 1;
+        for (VertexId neighbour : adjacency[current - 1])
+        {
+            if ((next_distance < this->distance(neighbour)) && labelled.contains(neighbour))
+            {
+                set(neighbour, next_distance, current);
+                m_queue.push_back(neighbour);
+            }
+        }
+    }
+}
+
+bool ShortestPathTree::repair(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+    const VertexBitmap& labelled)
+{
+    // The subtree is found from the parents, which form a tree, so no vertex is found twice and nothing needs to be
+    // marked until the subtree is known to be small enough.
+    const size_t limit = m_reached_count / 2;
+    m_queue.clear();
+    m_queue.push_back(vertex);
+    for (size_t i = 0; i < m_queue.size(); ++i)
+    {
+        const VertexId current = m_queue[i];
+        for (VertexId neighbour : adjacency[current - 1])
+        {
+            if ((distance(neighbour) != Unreached) && (m_parents[neighbour - 1] == current))
+            {
+                m_queue.push_back(neighbour);
+            }
+        }
+        if (m_queue.size() > limit)
+        {
+            return false;
+        }
+    }
+
+    for (VertexId cut : m_queue)
+    {
+        m_distances[cut - 1] = Unreached;
+        m_parents[cut - 1] = 0;
+        --m_reached_count;
+    }
+
+    // The vertices outside of the subtree kept their distance, which is still the shortest. Each vertex of the subtree
+    // starts from the closest of them it has an edge from.
+    m_candidates.clear();
+    for (VertexId cut : m_queue)
+    {
+        if (!labelled.contains(cut))
+        {
+            continue;
+        }
+        uint32_t best = Unreached;
+        VertexId parent = 0;
+        for (VertexId predecessor : reverse[cut - 1])
+        {
+            const uint32_t predecessor_distance = distance(predecessor);
+            if (predecessor_distance < best)
+            {
+                best = predecessor_distance;
+                parent = predecessor;
+            }
+        }
+        if (best != Unreached)
+        {
+            m_parents[cut - 1] = parent;
+            m_candidates.emplace_back(best + 1, cut);
+        }
+    }
+    // The distances are only set once every candidate is known, so that none starts from another one.
+    for (const std::pair<uint32_t, VertexId>& entry : m_candidates)
+    {
+        set(entry.second, entry.first, m_parents[entry.second - 1]);
+    }
+    std::sort(m_candidates.begin(), m_candidates.end());
+
+    // The candidates are then expanded closest first. The vertices they reach go to a FIFO whose distances only grow,
+    // so merging it with the sorted candidates gives the order of a Dijkstra search without a heap. An entry whose
+    // vertex got closer since it was queued is skipped.
+    m_frontier.clear();
+    size_t candidate = 0;
+    size_t queued = 0;
+    while ((candidate < m_candidates.size()) || (queued < m_frontier.size()))
+    {
+        const bool from_frontier = (queued < m_frontier.size()) &&
+            ((candidate == m_candidates.size()) || (m_frontier[queued].first <= m_candidates[candidate].first));
+        const std::pair<uint32_t, VertexId> entry = from_frontier ? m_frontier[queued++] : m_candidates[candidate++];
+        if (entry.first != m_distances[entry.second - 1])
+        {
+            continue;
+        }
+        for (VertexId neighbour : adjacency[entry.second - 1])
+        {
+            if (((entry.first + 1) < distance(neighbour)) && labelled.contains(neighbour))
+            {
+                set(neighbour, entry.first + 1, entry.second);
+                m_frontier.emplace_back(entry.first + 1, neighbour);
+            }
+        }
+    }
+    return true;
+}
+
+SubscriptionId PathSubscriptions::add(VertexId from, VertexId to, LabelId labelId, PathCallback callback,
+    const AdjacencySets& adjacency, const LabelIndex& labels, const VertexMapping& mapping)
+{
+    Subscription subscription{ from, to, labelId, std::move(callback),
+        ShortestPathTree(mapping.internal(from), adjacency, labels.vertices(labelId)), {}, false };
+    subscription.m_path = currentPath(subscription, mapping);
+    const SubscriptionId id = m_next_id++;
+    m_subscriptions.emplace(id, std::move(subscription));
+    return id;
+}
+
+const std::vector<VertexId>& PathSubscriptions::path(SubscriptionId subscription) const
+{
+    auto found = m_subscriptions.find(subscription);
+    if (found == m_subscriptions.end())
+    {
+        throw std::runtime_error("Subscription does not exist");
+    }
+    return found->second.m_path;
+}
+
+void PathSubscriptions::addEdge(VertexId from, VertexId to, const AdjacencySets& adjacency, const LabelIndex& labels)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if (subscription.m_tree.addEdge(from, to, adjacency, labels.vertices(subscription.m_label_id)))
+        {
+            subscription.m_changed = true;
+        }
+    }
+}
+
+void PathSubscriptions::removeEdge(VertexId from, VertexId to, const AdjacencySets& adjacency,
+    const AdjacencySets& reverse, const LabelIndex& labels)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if (subscription.m_tree.removeEdge(from, to, adjacency, reverse, labels.vertices(subscription.m_label_id)))
+        {
+            subscription.m_changed = true;
+        }
+    }
+}
+
+void PathSubscriptions::addVertex(VertexId vertex, LabelId labelId, const AdjacencySets& adjacency,
+    const AdjacencySets& reverse, const LabelIndex& labels)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if ((subscription.m_label_id == labelId) &&
+            subscription.m_tree.addVertex(vertex, adjacency, reverse, labels.vertices(labelId)))
+        {
+            subscription.m_changed = true;
+        }
+    }
+}
+
+void PathSubscriptions::removeVertex(VertexId vertex, LabelId labelId, const AdjacencySets& adjacency,
+    const AdjacencySets& reverse, const LabelIndex& labels)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if ((subscription.m_label_id == labelId) &&
+            subscription.m_tree.removeVertex(vertex, adjacency, reverse, labels.vertices(labelId)))
+        {
+            subscription.m_changed = true;
+        }
+    }
+}
+
+void PathSubscriptions::moveEndpoint(VertexId oldId, VertexId newId)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if (subscription.m_from == oldId)
+        {
+            subscription.m_from = newId;
+        }
+        if (subscription.m_to == oldId)
+        {
+            subscription.m_to = newId;
+        }
+    }
+}
+
+void PathSubscriptions::rebuild(const AdjacencySets& adjacency, const LabelIndex& labels,
+    const VertexMapping& mapping)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        subscription.m_tree = ShortestPathTree(mapping.internal(subscription.m_from), adjacency,
+            labels.vertices(subscription.m_label_id));
+        subscription.m_changed = true;
+    }
+}
+
+void PathSubscriptions::rebuild(LabelId labelId, const AdjacencySets& adjacency, const LabelIndex& labels,
+    const VertexMapping& mapping)
+{
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if (subscription.m_label_id == labelId)
+        {
+            subscription.m_tree = ShortestPathTree(mapping.internal(subscription.m_from), adjacency,
+                labels.vertices(labelId));
+            subscription.m_changed = true;
+        }
+    }
+}
+
+void PathSubscriptions::notify(const VertexMapping& mapping)
+{
+    // Most changes of a tree leave the path to the destination as it was, which the comparison below filters out.
+    for (auto& entry : m_subscriptions)
+    {
+        Subscription& subscription = entry.second;
+        if (!subscription.m_changed)
+        {
+            continue;
+        }
+        subscription.m_changed = false;
+        std::vector<VertexId> path = currentPath(subscription, mapping);
+        if (path != subscription.m_path)
+        {
+            subscription.m_path.swap(path);
+            if (subscription.m_callback)
+            {
+                subscription.m_callback(entry.first, subscription.m_path);
+            }
+        }
+    }
+}
+
+size_t PathSubscriptions::memoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& entry : m_subscriptions)
+    {
+        bytes += entry.second.m_tree.memoryUsage();
+    }
+    return bytes;
+}
+
+std::vector<VertexId> PathSubscriptions::currentPath(const Subscription& subscription, const VertexMapping& mapping)
+{
+    std::vector<VertexId> path;
+    subscription.m_tree.path(mapping.internal(subscription.m_to), path);
+    mapping.toExternal(path);
+    return path;
+}
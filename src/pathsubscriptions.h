@@ -0,0 +1,190 @@
+#ifndef PATHSUBSCRIPTIONS_H
+#define PATHSUBSCRIPTIONS_H
+
+#include "labelindex.h"
+#include "nodepool.h"
+#include "types.h"
+#include "vertexbitmap.h"
+#include "vertexmapping.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+/// The ID of a standing query, see GraphStore::subscribe.
+typedef uint64_t SubscriptionId;
+
+/// Called with the ID of a subscription and its new path, in the IDs callers use, or an empty path once there is none.
+typedef std::function<void(SubscriptionId, const std::vector<VertexId>&)> PathCallback;
+
+/// The breadth-first tree of the shortest paths from one vertex through the vertices of a label, kept up to date as
+/// the graph changes instead of searched again. Each vertex holds its distance from the root and its parent in the
+/// tree, 12 bytes per vertex.
+/// Edges and labelled vertices only make distances shorter: the vertices they bring closer are relaxed from there,
+/// breadth-first, as in the dynamic SSSP algorithm of Ramalingam and Reps ("An incremental algorithm for a
+/// generalization of the shortest-path problem"). That walks the vertices whose distance changes and their edges.
+/// Removing an edge of the tree or the label of a vertex of the tree only affects the subtree below it: the subtree is
+/// cut off, each of its vertices takes the best distance it can get from the vertices outside, and the subtree is
+/// searched again from there, closest first. The repair is bounded: once the subtree holds more than half of the
+/// vertices the root reaches, the tree is built again from scratch, which is then cheaper. Edges and labels outside
+/// of the tree change nothing and cost a couple of lookups.
+class ShortestPathTree
+{
+public:
+    /// The distance of the vertices the root does not reach.
+    static const uint32_t Unreached = UINT32_MAX;
+
+    /// Build the tree of a root.
+    /// @param adjacency The neighbours of each vertex. The position in the vector is the ID of the vertex - 1.
+    /// @param labelled The vertices that have the label. The tree is empty while the root does not have it.
+    ShortestPathTree(VertexId root, const AdjacencySets& adjacency, const VertexBitmap& labelled);
+
+    /// Returns the root of the tree.
+    VertexId root() const { return m_root; }
+
+    /// Returns the number of edges from the root to a vertex, or Unreached.
+    uint32_t distance(VertexId vertex) const
+    {
+        return (vertex <= m_distances.size()) ? m_distances[vertex - 1] : Unreached;
+    }
+
+    /// Fill a path with the vertices from the root to a vertex, or leave it empty if the root does not reach it.
+    void path(VertexId to, std::vector<VertexId>& path) const;
+
+    /// Update the tree after an edge was added. Returns true if the tree changed.
+    bool addEdge(VertexId from, VertexId to, const AdjacencySets& adjacency, const VertexBitmap& labelled);
+
+    /// Update the tree after an edge was removed.
+    /// @param reverse The vertices that have an edge to each vertex.
+    /// @returns true if the tree changed.
+    bool removeEdge(VertexId from, VertexId to, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const VertexBitmap& labelled);
+
+    /// Update the tree after a vertex was given the label. Returns true if the tree changed.
+    bool addVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const VertexBitmap& labelled);
+
+    /// Update the tree after the label was removed from a vertex. Returns true if the tree changed.
+    bool removeVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const VertexBitmap& labelled);
+
+    /// Returns the number of bytes used by the tree.
+    size_t memoryUsage() const
+    {
+        return (m_distances.capacity() * sizeof(uint32_t)) + (m_parents.capacity() * sizeof(VertexId));
+    }
+
+private:
+    // Sets the distance and the parent of a vertex, growing the vectors to new vertices.
+    void set(VertexId vertex, uint32_t distance, VertexId parent);
+
+    // Builds the tree from scratch.
+    void build(const AdjacencySets& adjacency, const VertexBitmap& labelled);
+
+    // Gives a vertex a shorter distance and then its labelled neighbours, breadth-first, until no distance improves.
+    void relax(VertexId vertex, uint32_t distance, VertexId parent, const AdjacencySets& adjacency,
+        const VertexBitmap& labelled);
+
+    // Cuts off the subtree of a vertex and searches it again from the vertices around it. Returns false, leaving the
+    // tree as it was, if the subtree holds more than half of the vertices the root reaches.
+    bool repair(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const VertexBitmap& labelled);
+
+    VertexId m_root;
+    // The distance of each vertex, at position id - 1, or Unreached. Vertices created after the tree are past the end.
+    std::vector<uint32_t> m_distances;
+    // The vertex before each reached vertex on its path from the root, or 0 for the root and the unreached vertices.
+    std::vector<VertexId> m_parents;
+    // The number of vertices whose distance is not Unreached.
+    size_t m_reached_count = 0;
+    // Scratch space of the updates, kept between them.
+    std::vector<VertexId> m_queue;
+    std::vector<std::pair<uint32_t, VertexId>> m_candidates;
+    std::vector<std::pair<uint32_t, VertexId>> m_frontier;
+};
+
+/// The standing shortest path queries of a GraphStore: a ShortestPathTree per query, updated by the store as it
+/// mutates, and the callbacks to call once the path of a query changes. Everything is on internal IDs but the
+/// endpoints and the paths handed to the callbacks. A copy of the store starts without subscriptions, like a copy of
+/// OwnedNodePool, so that the callbacks are not called twice for the same change.
+class PathSubscriptions
+{
+public:
+    PathSubscriptions() = default;
+    PathSubscriptions(const PathSubscriptions&) {}
+    PathSubscriptions(PathSubscriptions&&) = default;
+    PathSubscriptions& operator=(const PathSubscriptions&) { return *this; }
+    PathSubscriptions& operator=(PathSubscriptions&&) = default;
+
+    /// Returns true if there is no subscription.
+    bool empty() const { return m_subscriptions.empty(); }
+
+    /// Register a query and build its tree.
+    /// @param from The external ID of the source vertex.
+    /// @param to The external ID of the destination vertex.
+    /// @param labels The labels of the store, which hold the label of the query.
+    SubscriptionId add(VertexId from, VertexId to, LabelId labelId, PathCallback callback,
+        const AdjacencySets& adjacency, const LabelIndex& labels, const VertexMapping& mapping);
+
+    /// Drop a query. Returns false if there was no such subscription.
+    bool remove(SubscriptionId subscription) { return m_subscriptions.erase(subscription) != 0; }
+
+    /// Returns the path of a query as last reported, in external IDs.
+    /// @throws std::runtime_error if there is no such subscription.
+    const std::vector<VertexId>& path(SubscriptionId subscription) const;
+
+    /// Update the trees after an edge was added.
+    void addEdge(VertexId from, VertexId to, const AdjacencySets& adjacency, const LabelIndex& labels);
+
+    /// Update the trees after an edge was removed.
+    void removeEdge(VertexId from, VertexId to, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const LabelIndex& labels);
+
+    /// Update the trees of a label after it was added to a vertex.
+    void addVertex(VertexId vertex, LabelId labelId, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const LabelIndex& labels);
+
+    /// Update the trees of a label after it was removed from a vertex.
+    void removeVertex(VertexId vertex, LabelId labelId, const AdjacencySets& adjacency,
+        const AdjacencySets& reverse, const LabelIndex& labels);
+
+    /// Give the endpoints of the queries that had an external ID the new ID of their vertex. The trees need to be
+    /// built again afterwards.
+    void moveEndpoint(VertexId oldId, VertexId newId);
+
+    /// Build every tree again, for instance once the vertices were renumbered.
+    void rebuild(const AdjacencySets& adjacency, const LabelIndex& labels, const VertexMapping& mapping);
+
+    /// Build the trees of a label again, for instance once it was added to many vertices at once.
+    void rebuild(LabelId labelId, const AdjacencySets& adjacency, const LabelIndex& labels,
+        const VertexMapping& mapping);
+
+    /// Call the callback of each query whose path changed since it was last reported, in the order of the IDs.
+    void notify(const VertexMapping& mapping);
+
+    /// Returns the number of bytes used by the trees.
+    size_t memoryUsage() const;
+
+private:
+    struct Subscription
+    {
+        VertexId m_from;
+        VertexId m_to;
+        LabelId m_label_id;
+        PathCallback m_callback;
+        ShortestPathTree m_tree;
+        // The path last reported, in external IDs.
+        std::vector<VertexId> m_path;
+        // True if the tree changed since the path was last reported.
+        bool m_changed;
+    };
+
+    // Returns the path of a tree to the destination of its query, in external IDs.
+    static std::vector<VertexId> currentPath(const Subscription& subscription, const VertexMapping& mapping);
+
+    std::map<SubscriptionId, Subscription> m_subscriptions;
+    SubscriptionId m_next_id = 1;
+};
+
+#endif
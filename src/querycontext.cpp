@@ -0,0 +1,32 @@
+#include "querycontext.h"
+#include <algorithm>
+
+void VisitMap::clear(size_t vertexCount)
+{
+    if (m_entries.size() < vertexCount)
+    {
+        m_entries.resize(vertexCount, Entry{0, 0, 0});
+    }
+
+    ++m_epoch;
+    if (m_epoch == 0)
+    {
+        // The counter wrapped around: entries stamped 2^32 searches ago would look current again.
+        std::fill(m_entries.begin(), m_entries.end(), Entry{0, 0, 0});
+        m_epoch = 1;
+    }
+}
+
+QueryContext::Capacities QueryContext::capacities() const
+{
+    // The buckets of the radix heap count as one buffer: their total capacity changes whenever one of them grows.
+    size_t bucket_capacity = 0;
+    for (const auto& bucket : m_radix_buckets)
+    {
+        bucket_capacity += bucket.capacity();
+    }
+    return Capacities{{m_forward.capacity(), m_backward.capacity(), m_forward_frontier.capacity(),
+        m_backward_frontier.capacity(), m_next_frontier.capacity(), m_heap.capacity(), m_label_words.capacity(),
+        m_frontier_words.capacity(), m_next_words.capacity(), m_visited_words.capacity(), m_path_weights.capacity(),
+        m_heap_positions.capacity(), bucket_capacity}};
+}
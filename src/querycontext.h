@@ -0,0 +1,112 @@
+#ifndef QUERYCONTEXT_H
+#define QUERYCONTEXT_H
+
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// Per-vertex state of a search: whether the vertex was reached, from which vertex and at which distance.
+/// The state lives in dense arrays indexed by vertex ID. Each entry is stamped with the epoch of the search that wrote
+/// it so clearing the map for the next search is a counter increment instead of a pass over the arrays.
+class VisitMap
+{
+public:
+    /// Forget all the visits and make sure vertices up to vertexCount can be recorded. This only allocates when the
+    /// graph has grown since the last call.
+    void clear(size_t vertexCount);
+
+    /// Returns true if the vertex was reached by the current search.
+    bool visited(VertexId vertex) const { return m_entries[vertex - 1].m_epoch == m_epoch; }
+
+    /// Record that a vertex was reached. Does nothing if it was already reached.
+    /// @returns true if the vertex had not been reached yet.
+    bool visit(VertexId vertex, VertexId parent, uint32_t distance)
+    {
+        Entry& entry = m_entries[vertex - 1];
+        if (entry.m_epoch == m_epoch)
+        {
+            return false;
+        }
+        entry = Entry{m_epoch, distance, parent};
+        return true;
+    }
+
+    /// Record that a vertex was reached, replacing any previous visit.
+    void update(VertexId vertex, VertexId parent, uint32_t distance)
+    {
+        m_entries[vertex - 1] = Entry{m_epoch, distance, parent};
+    }
+
+    /// Returns the vertex a visited vertex was reached from, 0 for the vertex the search started from.
+    VertexId parent(VertexId vertex) const { return m_entries[vertex - 1].m_parent; }
+
+    /// Returns the distance of a visited vertex, or UINT32_MAX if it was not reached.
+    uint32_t distance(VertexId vertex) const
+    {
+        const Entry& entry = m_entries[vertex - 1];
+        return (entry.m_epoch == m_epoch) ? entry.m_distance : UINT32_MAX;
+    }
+
+    /// Returns the number of vertices the map can hold without allocating.
+    size_t capacity() const { return m_entries.capacity(); }
+
+private:
+    // The three fields of a vertex are kept together so that a visit touches a single cache line.
+    struct Entry
+    {
+        uint32_t m_epoch;
+        uint32_t m_distance;
+        VertexId m_parent;
+    };
+
+    std::vector<Entry> m_entries;
+    uint32_t m_epoch = 0;
+};
+
+/// Scratch space reused across calls to GraphStore::shortestPath.
+/// A search sizes the buffers of the context to the graph the first time and then only reuses them, so a caller that
+/// keeps a context around (typically one per thread) does no heap allocation per query once warmed up. A context must
+/// not be used by two searches at the same time.
+class QueryContext
+{
+public:
+    /// The capacity of each buffer, see capacities().
+    typedef std::array<size_t, 13> Capacities;
+
+    /// Returns the capacity of each buffer. Comparing them before and after a search tells which buffers it had to
+    /// grow.
+    Capacities capacities() const;
+
+    /// Visits of the search going forward from the source of the path.
+    VisitMap m_forward;
+    /// Visits of the search going backward from the destination of the path. The A* search marks the vertices it
+    /// expanded there.
+    VisitMap m_backward;
+    /// Frontiers of the breadth-first searches.
+    std::vector<VertexId> m_forward_frontier;
+    std::vector<VertexId> m_backward_frontier;
+    std::vector<VertexId> m_next_frontier;
+    /// Open set of the A* search as a binary heap of (scores, vertex), and of the weighted search as a 4-ary heap.
+    std::vector<std::pair<uint64_t, VertexId>> m_heap;
+    /// Weight of the best path found so far to each vertex reached by the weighted search, by vertex ID. Only the
+    /// entries of the vertices of m_forward are meaningful, so the array is never cleared.
+    std::vector<double> m_path_weights;
+    /// Position of each vertex in the 4-ary heap of the weighted search, by vertex ID. Like m_path_weights, only the
+    /// entries of the vertices in the heap are meaningful.
+    std::vector<size_t> m_heap_positions;
+    /// Buckets of the radix heap of the weighted search, see search::RadixHeap.
+    std::array<std::vector<std::pair<uint64_t, VertexId>>, 65> m_radix_buckets;
+    /// Bitsets of the parallel BFS with one bit per vertex ID: the vertices with the label of the query and the
+    /// current and next frontiers of the bottom-up steps.
+    std::vector<uint64_t> m_label_words;
+    std::vector<uint64_t> m_frontier_words;
+    std::vector<uint64_t> m_next_words;
+    /// Vertices reached by the parallel BFS. The words are atomic because two threads of a top-down step may reach the
+    /// same vertex.
+    std::vector<std::atomic<uint64_t>> m_visited_words;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "querymetrics.h"
+#include <sstream>
+
+namespace
+{
+    // 1, 2.5 and 5 times each power of ten from 1us to 5s, then 10s.
+    std::vector<double> DurationBounds()
+    {
+        std::vector<double> bounds;
+        for (double decade = 1e-6; decade < 1.0 + 1e-9; decade *= 10)
+        {
+            bounds.push_back(decade);
+            bounds.push_back(decade * 2.5);
+            bounds.push_back(decade * 5);
+        }
+        bounds.push_back(10.0);
+        return bounds;
+    }
+
+    // The powers of ten from 1 to 10^10.
+    std::vector<double> EdgeBounds()
+    {
+        std::vector<double> bounds;
+        for (double bound = 1; bound < 1e10 + 1; bound *= 10)
+        {
+            bounds.push_back(bound);
+        }
+        return bounds;
+    }
+
+    size_t BucketOf(const std::vector<double>& bounds, double value)
+    {
+        size_t bucket = 0;
+        while ((bucket < bounds.size()) && (value > bounds[bucket]))
+        {
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    // Each thread writes to its own shard, handed out in turn as threads record their first query.
+    size_t ShardIndex(size_t shardCount)
+    {
+        static std::atomic<size_t> next_index(0);
+        thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+        return index % shardCount;
+    }
+
+    void WriteCounter(std::ostream& out, const char* name, const char* help, uint64_t value)
+    {
+        out << "# HELP graphstore_" << name << " " << help << "\n";
+        out << "# TYPE graphstore_" << name << " counter\n";
+        out << "graphstore_" << name << " " << value << "\n";
+    }
+
+    void WriteHistogram(std::ostream& out, const char* name, const char* help, const HistogramSnapshot& histogram)
+    {
+        out << "# HELP graphstore_" << name << " " << help << "\n";
+        out << "# TYPE graphstore_" << name << " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < histogram.counts.size(); ++i)
+        {
+            cumulative += histogram.counts[i];
+            out << "graphstore_" << name << "_bucket{le=\"";
+            if (i < histogram.upper_bounds.size())
+            {
+                out << histogram.upper_bounds[i];
+            }
+            else
+            {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "graphstore_" << name << "_sum " << histogram.sum << "\n";
+        out << "graphstore_" << name << "_count " << histogram.count << "\n";
+    }
+}
+
+QueryMetrics& QueryMetrics::global()
+{
+    static QueryMetrics metrics;
+    return metrics;
+}
+
+QueryMetrics::QueryMetrics() : m_enabled(false)
+{
+    reset();
+}
+
+void QueryMetrics::record(const QueryStats& stats)
+{
+    static const std::vector<double> duration_bounds = DurationBounds();
+    static const std::vector<double> edge_bounds = EdgeBounds();
+
+    Shard& shard = m_shards[ShardIndex(ShardCount)];
+    const uint64_t nanoseconds = static_cast<uint64_t>(stats.wall_time.count());
+    shard.m_queries.fetch_add(1, std::memory_order_relaxed);
+    shard.m_paths_found.fetch_add(stats.found ? 1 : 0, std::memory_order_relaxed);
+    shard.m_vertices_popped.fetch_add(stats.vertices_popped, std::memory_order_relaxed);
+    shard.m_edges_scanned.fetch_add(stats.edges_scanned, std::memory_order_relaxed);
+    shard.m_label_rejects.fetch_add(stats.label_rejects, std::memory_order_relaxed);
+    shard.m_allocations.fetch_add(stats.allocations, std::memory_order_relaxed);
+    shard.m_duration_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    shard.m_duration_buckets[BucketOf(duration_bounds, static_cast<double>(nanoseconds) * 1e-9)].fetch_add(1,
+        std::memory_order_relaxed);
+    shard.m_edge_buckets[BucketOf(edge_bounds, static_cast<double>(stats.edges_scanned))].fetch_add(1,
+        std::memory_order_relaxed);
+}
+
+MetricsSnapshot QueryMetrics::snapshot() const
+{
+    MetricsSnapshot metrics;
+    metrics.duration_seconds.upper_bounds = DurationBounds();
+    metrics.duration_seconds.counts.assign(DurationBucketCount + 1, 0);
+    metrics.edges_scanned_per_query.upper_bounds = EdgeBounds();
+    metrics.edges_scanned_per_query.counts.assign(EdgeBucketCount + 1, 0);
+
+    uint64_t duration_nanoseconds = 0;
+    for (const Shard& shard : m_shards)
+    {
+        metrics.queries += shard.m_queries.load(std::memory_order_relaxed);
+        metrics.paths_found += shard.m_paths_found.load(std::memory_order_relaxed);
+        metrics.vertices_popped += shard.m_vertices_popped.load(std::memory_order_relaxed);
+        metrics.edges_scanned += shard.m_edges_scanned.load(std::memory_order_relaxed);
+        metrics.label_rejects += shard.m_label_rejects.load(std::memory_order_relaxed);
+        metrics.allocations += shard.m_allocations.load(std::memory_order_relaxed);
+        duration_nanoseconds += shard.m_duration_nanoseconds.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= DurationBucketCount; ++i)
+        {
+            metrics.duration_seconds.counts[i] += shard.m_duration_buckets[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i <= EdgeBucketCount; ++i)
+        {
+            metrics.edges_scanned_per_query.counts[i] += shard.m_edge_buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (uint64_t count : metrics.duration_seconds.counts)
+    {
+        metrics.duration_seconds.count += count;
+    }
+    metrics.duration_seconds.sum = static_cast<double>(duration_nanoseconds) * 1e-9;
+    metrics.edges_scanned_per_query.count = metrics.duration_seconds.count;
+    metrics.edges_scanned_per_query.sum = static_cast<double>(metrics.edges_scanned);
+    return metrics;
+}
+
+void QueryMetrics::reset()
+{
+    for (Shard& shard : m_shards)
+    {
+        shard.m_queries.store(0, std::memory_order_relaxed);
+        shard.m_paths_found.store(0, std::memory_order_relaxed);
+        shard.m_vertices_popped.store(0, std::memory_order_relaxed);
+        shard.m_edges_scanned.store(0, std::memory_order_relaxed);
+        shard.m_label_rejects.store(0, std::memory_order_relaxed);
+        shard.m_allocations.store(0, std::memory_order_relaxed);
+        shard.m_duration_nanoseconds.store(0, std::memory_order_relaxed);
+        for (auto& bucket : shard.m_duration_buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        for (auto& bucket : shard.m_edge_buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string PrometheusText(const MetricsSnapshot& metrics)
+{
+    std::ostringstream out;
+    WriteCounter(out, "queries_total", "Shortest path queries run.", metrics.queries);
+    WriteCounter(out, "paths_found_total", "Shortest path queries that found a path.", metrics.paths_found);
+    WriteCounter(out, "vertices_popped_total", "Vertices expanded by the searches.", metrics.vertices_popped);
+    WriteCounter(out, "edges_scanned_total", "Edges followed by the searches.", metrics.edges_scanned);
+    WriteCounter(out, "label_rejects_total", "Edges skipped because the vertex lacked the label of the query.",
+        metrics.label_rejects);
+    WriteCounter(out, "allocations_total", "Scratch buffers the searches had to grow.", metrics.allocations);
+    WriteHistogram(out, "query_duration_seconds", "Wall time of the shortest path queries.",
+        metrics.duration_seconds);
+    WriteHistogram(out, "query_edges_scanned", "Edges followed by each shortest path query.",
+        metrics.edges_scanned_per_query);
+    return out.str();
+}
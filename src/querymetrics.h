@@ -0,0 +1,93 @@
+#ifndef QUERYMETRICS_H
+#define QUERYMETRICS_H
+
+#include "querystats.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// The state of a histogram at one point in time.
+struct HistogramSnapshot
+{
+    /// The upper bound of each bucket, in increasing order. A last bucket with no upper bound follows them.
+    std::vector<double> upper_bounds;
+    /// The number of observations in each bucket, the one with no upper bound included. Not cumulative.
+    std::vector<uint64_t> counts;
+    /// The number of observations.
+    uint64_t count = 0;
+    /// The sum of the observations.
+    double sum = 0;
+};
+
+/// The state of the process-wide query metrics at one point in time. The counters are the sums of the QueryStats of
+/// all the queries recorded since the metrics were enabled or reset.
+struct MetricsSnapshot
+{
+    uint64_t queries = 0;
+    uint64_t paths_found = 0;
+    uint64_t vertices_popped = 0;
+    uint64_t edges_scanned = 0;
+    uint64_t label_rejects = 0;
+    uint64_t allocations = 0;
+    /// The wall time of the queries, in seconds.
+    HistogramSnapshot duration_seconds;
+    /// The number of edges each query scanned.
+    HistogramSnapshot edges_scanned_per_query;
+};
+
+/// Process-wide counters and histograms of the shortestPath queries of every GraphStore and GraphVersion.
+/// The metrics are off by default and a query then pays a single relaxed load for them. Once enabled, each query is
+/// recorded with a few relaxed atomic additions into one of several shards, picked per thread so that threads running
+/// queries side by side rarely write to the same cache line. Reading the metrics sums the shards.
+/// Building with GRAPHSTORE_NO_STATS defined removes the collection from the searches altogether.
+class QueryMetrics
+{
+public:
+    /// Returns the metrics of the process.
+    static QueryMetrics& global();
+
+    /// Start or stop recording the queries.
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /// Returns true if the queries are recorded.
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /// Add the stats of one query to the metrics.
+    void record(const QueryStats& stats);
+
+    /// Returns the current value of the metrics. Queries recorded at the same time may be partially included.
+    MetricsSnapshot snapshot() const;
+
+    /// Set all the metrics back to zero.
+    void reset();
+
+private:
+    static const size_t ShardCount = 16;
+    static const size_t DurationBucketCount = 22;
+    static const size_t EdgeBucketCount = 11;
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> m_queries;
+        std::atomic<uint64_t> m_paths_found;
+        std::atomic<uint64_t> m_vertices_popped;
+        std::atomic<uint64_t> m_edges_scanned;
+        std::atomic<uint64_t> m_label_rejects;
+        std::atomic<uint64_t> m_allocations;
+        std::atomic<uint64_t> m_duration_nanoseconds;
+        std::array<std::atomic<uint64_t>, DurationBucketCount + 1> m_duration_buckets;
+        std::array<std::atomic<uint64_t>, EdgeBucketCount + 1> m_edge_buckets;
+    };
+
+    QueryMetrics();
+
+    std::atomic<bool> m_enabled;
+    std::array<Shard, ShardCount> m_shards;
+};
+
+/// Format metrics in the Prometheus text exposition format, with metric names prefixed by graphstore_.
+std::string PrometheusText(const MetricsSnapshot& metrics);
+
+#endif
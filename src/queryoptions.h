@@ -0,0 +1,91 @@
+#ifndef QUERYOPTIONS_H
+#define QUERYOPTIONS_H
+
+#include "querystats.h"
+#include "threadpool.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// The algorithms shortestPath can use to search the graph.
+enum class SearchAlgorithm
+{
+    /// ParallelBfs for graphs with at least QueryOptions::parallel_threshold vertices when QueryOptions::pool is set,
+    /// BidirectionalBfs otherwise.
+    Auto,
+    /// Breadth-first search run from both ends of the path at the same time until the two searches meet.
+    BidirectionalBfs,
+    /// A* search. This is kept for the weighted case, on the unweighted graph it explores more than the BFS.
+    AStar,
+    /// A* search guided by the landmark tables of the graph, see GraphStore::buildLandmarks. Without valid tables this
+    /// is the same as AStar.
+    Alt,
+    /// Direction-optimizing breadth-first search whose steps are split over the threads of QueryOptions::pool. This
+    /// is for single queries on very large graphs, where one core would otherwise do all the work.
+    ParallelBfs,
+    /// Dijkstra's algorithm on the weights of the edges: this finds the path of least total weight instead of the one
+    /// with the fewest edges. Edges created without a weight weigh 1. The queue is a radix heap when all the weights
+    /// are integers and a 4-ary heap otherwise. Distance indexes, which count edges, are not used.
+    Dijkstra
+};
+
+/// Whether shortestPath answered a query in full, see QueryOptions::outcome.
+enum class QueryOutcome
+{
+    /// The search ran to its end: the path is a shortest path, or there is none.
+    Exact,
+    /// A limit of the options stopped the search, or kept it from following the longer paths, before it found one:
+    /// the path is empty but there may be one. With SearchAlgorithm::Dijkstra and a hop limit, the path found may also
+    /// not be the lightest of those within the limit.
+    Truncated,
+    /// The cancellation token of the options stopped the search. The path is empty.
+    Cancelled
+};
+
+/// A flag that stops the searches it was given to, from any thread, see QueryOptions::cancellation.
+class CancellationToken
+{
+public:
+    /// Stop the searches that use the token. The searches that start afterwards stop right away.
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+    /// Let the token be used again.
+    void reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+
+    /// Returns true once cancel() was called.
+    bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{ false };
+};
+
+/// Options that control how shortestPath searches the graph.
+struct QueryOptions
+{
+    /// The algorithm used to search the graph.
+    SearchAlgorithm algorithm = SearchAlgorithm::Auto;
+    /// The threads used by SearchAlgorithm::ParallelBfs. If null it runs on the calling thread only. This must not be
+    /// the pool a batch of queries runs on.
+    ThreadPool* pool = nullptr;
+    /// The number of vertices from which SearchAlgorithm::Auto picks the parallel BFS.
+    size_t parallel_threshold = 1000000;
+    /// If not null, receives what the search did. The counters cost nothing to queries that don't ask for them.
+    /// Batches of queries ignore it. Building with GRAPHSTORE_NO_STATS defined leaves it untouched.
+    QueryStats* stats = nullptr;
+    /// The most edges a path can have. The search doesn't look further from the ends of the query than that.
+    uint32_t max_hops = UINT32_MAX;
+    /// The most vertices the search expands before it gives up, counted as in QueryStats::vertices_popped.
+    uint64_t max_expanded = UINT64_MAX;
+    /// The time past which the search gives up. The searches read the clock every few hundred vertices they expand,
+    /// and the parallel BFS once per level.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    /// If not null, a token that stops the search once cancelled. It is checked as often as the deadline, and must
+    /// outlive the search.
+    const CancellationToken* cancellation = nullptr;
+    /// If not null, receives whether the limits above stopped the search, see QueryOutcome. A query without limits is
+    /// always exact. Batches of queries ignore it.
+    QueryOutcome* outcome = nullptr;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef QUERYSTATS_H
+#define QUERYSTATS_H
+
+#include <chrono>
+#include <cstdint>
+
+/// What one shortestPath search did, filled in when QueryOptions::stats points to it.
+struct QueryStats
+{
+    /// The vertices the search expanded: taken out of a frontier or of the A* open set, or checked for a parent in a
+    /// bottom-up step of the parallel BFS.
+    uint64_t vertices_popped = 0;
+    /// The edges the search followed from the vertices it expanded.
+    uint64_t edges_scanned = 0;
+    /// The edges whose other end was skipped because it doesn't have the label of the query. The bottom-up steps of
+    /// the parallel BFS filter a whole word of vertices at once and don't count them.
+    uint64_t label_rejects = 0;
+    /// The largest number of vertices waiting to be expanded at any one time.
+    uint64_t peak_frontier = 0;
+    /// The scratch buffers of the query context and the path that had to grow. Each one is at least one heap
+    /// allocation. This is 0 once the context has served a search on a graph of the same size.
+    uint64_t allocations = 0;
+    /// The time the call took, label lookup and argument checks included.
+    std::chrono::nanoseconds wall_time = std::chrono::nanoseconds(0);
+    /// true if a path was found.
+    bool found = false;
+};
+
+#endif
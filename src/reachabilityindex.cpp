@@ -0,0 +1,324 @@
+#include "reachabilityindex.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace
+{
+    const uint32_t None = std::numeric_limits<uint32_t>::max();
+
+    // Finds the strongly connected components of the labelled vertices with Tarjan's algorithm, written with an
+    // explicit stack so that long paths don't overflow the call stack. The components are numbered in reverse
+    // topological order: an edge between two components always goes to the lower number. Returns the number of
+    // components and leaves None for the vertices without the label.
+    uint32_t StronglyConnectedComponents(const AdjacencySets& adjacency, const VertexBitmap& labelled,
+        std::vector<uint32_t>& components)
+    {
+        struct Frame
+        {
+            VertexId m_vertex;
+            NeighbourSet::const_iterator m_next;
+        };
+
+        const size_t vertex_count = adjacency.size();
+        components.assign(vertex_count + 1, None);
+        std::vector<uint32_t> order(vertex_count + 1, None);
+        std::vector<uint32_t> low_link(vertex_count + 1, 0);
+        std::vector<VertexId> component_stack;
+        std::vector<Frame> frames;
+        uint32_t next_order = 0;
+        uint32_t component_count = 0;
+
+        auto enter = [&](VertexId vertex)
+        {
+            order[vertex] = next_order;
+            low_link[vertex] = next_order;
+            ++next_order;
+            component_stack.push_back(vertex);
+            frames.push_back(Frame{ vertex, adjacency[vertex - 1].begin() });
+        };
+
+        labelled.forEach([&](VertexId root)
+        {
+            if ((root > vertex_count) || (order[root] != None))
+            {
+                return;
+            }
+
+            enter(root);
+            while (!frames.empty())
+            {
+                const VertexId vertex = frames.back().m_vertex;
+                const NeighbourSet& neighbours = adjacency[vertex - 1];
+                bool entered = false;
+                while (frames.back().m_next != neighbours.end())
+                {
+                    const VertexId neighbour = *frames.back().m_next;
+                    ++frames.back().m_next;
+                    if (!labelled.contains(neighbour))
+                    {
+                        continue;
+                    }
+                    if (order[neighbour] == None)
+                    {
+                        enter(neighbour);
+                        entered = true;
+                        break;
+                    }
+                    // A neighbour already in a component is in a finished one, below this vertex.
+                    if (components[neighbour] == None)
+                    {
+                        low_link[vertex] = std::min(low_link[vertex], order[neighbour]);
+                    }
+                }
+                if (entered)
+                {
+                    continue;
+                }
+
+                frames.pop_back();
+                if (low_link[vertex] == order[vertex])
+                {
+                    VertexId member;
+                    do
+                    {
+                        member = component_stack.back();
+                        component_stack.pop_back();
+                        components[member] = component_count;
+                    } while (member != vertex);
+                    ++component_count;
+                }
+                if (!frames.empty())
+                {
+                    const VertexId parent = frames.back().m_vertex;
+                    low_link[parent] = std::min(low_link[parent], low_link[vertex]);
+                }
+            }
+        });
+        return component_count;
+    }
+}
+
+ReachabilityIndex::ReachabilityIndex(const AdjacencySets& adjacency, const VertexBitmap& labelled)
+{
+    std::vector<uint32_t> components;
+    const uint32_t component_count = StronglyConnectedComponents(adjacency, labelled, components);
+
+    // The edges between components, in CSR form. Duplicates are left in: they cost a little time in the walks but
+    // removing them would cost more.
+    std::vector<size_t> offsets(component_count + 1, 0);
+    for (VertexId vertex = 1; vertex <= adjacency.size(); ++vertex)
+    {
+        if (components[vertex] == None)
+        {
+            continue;
+        }
+        for (VertexId neighbour : adjacency[vertex - 1])
+        {
+            if ((components[neighbour] != None) && (components[neighbour] != components[vertex]))
+            {
+                ++offsets[components[vertex] + 1];
+            }
+        }
+    }
+    for (size_t i = 0; i < component_count; ++i)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+    std::vector<uint32_t> children(offsets[component_count]);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (VertexId vertex = 1; vertex <= adjacency.size(); ++vertex)
+    {
+        if (components[vertex] == None)
+        {
+            continue;
+        }
+        for (VertexId neighbour : adjacency[vertex - 1])
+        {
+            if ((components[neighbour] != None) && (components[neighbour] != components[vertex]))
+            {
+                children[fill[components[vertex]]++] = components[neighbour];
+            }
+        }
+    }
+
+    // Each walk starts from the components in a random order and visits the children of each component from a random
+    // position, so that the walks number the DAG differently and filter different pairs.
+    struct Frame
+    {
+        uint32_t m_component;
+        size_t m_visited;
+        size_t m_start;
+    };
+
+    std::mt19937 random(0x5eed);
+    std::vector<uint32_t> roots(component_count);
+    for (uint32_t i = 0; i < component_count; ++i)
+    {
+        roots[i] = i;
+    }
+    std::vector<Interval> component_intervals(static_cast<size_t>(component_count) * WalkCount);
+    std::vector<bool> visited;
+    std::vector<Frame> frames;
+    for (size_t walk = 0; walk < WalkCount; ++walk)
+    {
+        std::shuffle(roots.begin(), roots.end(), random);
+        visited.assign(component_count, false);
+        uint32_t next_rank = 0;
+        auto enter = [&](uint32_t component)
+        {
+            visited[component] = true;
+            component_intervals[(component * WalkCount) + walk].m_low = None;
+            const size_t child_count = offsets[component + 1] - offsets[component];
+            frames.push_back(Frame{ component, 0, (child_count > 0) ? (random() % child_count) : 0 });
+        };
+
+        for (uint32_t root : roots)
+        {
+            if (visited[root])
+            {
+                continue;
+            }
+            enter(root);
+            while (!frames.empty())
+            {
+                Frame& frame = frames.back();
+                const uint32_t component = frame.m_component;
+                const size_t child_count = offsets[component + 1] - offsets[component];
+                Interval& interval = component_intervals[(component * WalkCount) + walk];
+                if (frame.m_visited < child_count)
+                {
+                    const uint32_t child =
+                        children[offsets[component] + ((frame.m_start + frame.m_visited) % child_count)];
+                    ++frame.m_visited;
+                    if (!visited[child])
+                    {
+                        enter(child);
+                    }
+                    else
+                    {
+                        // The graph of the components has no cycle so a visited child is already finished.
+                        const Interval& child_interval = component_intervals[(child * WalkCount) + walk];
+                        interval.m_low = std::min(interval.m_low, child_interval.m_low);
+                    }
+                    continue;
+                }
+
+                interval.m_high = next_rank;
+                interval.m_low = std::min(interval.m_low, next_rank);
+                ++next_rank;
+                frames.pop_back();
+                if (!frames.empty())
+                {
+                    Interval& parent = component_intervals[(frames.back().m_component * WalkCount) + walk];
+                    parent.m_low = std::min(parent.m_low, interval.m_low);
+                }
+            }
+        }
+    }
+
+    m_vertex_count = adjacency.size() + 1;
+    m_next_rank = component_count;
+    m_intervals.assign(m_vertex_count * WalkCount, Interval{ None, 0 });
+    for (VertexId vertex = 1; vertex < m_vertex_count; ++vertex)
+    {
+        if (components[vertex] != None)
+        {
+            std::copy_n(&component_intervals[components[vertex] * WalkCount], WalkCount,
+                &m_intervals[vertex * WalkCount]);
+        }
+    }
+}
+
+void ReachabilityIndex::addEdge(VertexId from, VertexId to, const AdjacencySets& reverse, const VertexBitmap& labelled)
+{
+    grow(reverse.size() + 1);
+    Interval intervals[WalkCount];
+    std::copy_n(&m_intervals[to * WalkCount], WalkCount, intervals);
+    if (!intervals[0].empty())
+    {
+        widen(from, intervals, reverse, labelled);
+    }
+}
+
+void ReachabilityIndex::addVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+    const VertexBitmap& labelled)
+{
+    grow(adjacency.size() + 1);
+
+    // The vertex gets a rank of its own and its intervals grow to cover its labelled neighbours, like a component
+    // of its own added at the top of every walk.
+    Interval intervals[WalkCount];
+    for (Interval& interval : intervals)
+    {
+        interval = Interval{ m_next_rank, m_next_rank };
+    }
+    ++m_next_rank;
+    for (VertexId neighbour : adjacency[vertex - 1])
+    {
+        if (!labelled.contains(neighbour))
+        {
+            continue;
+        }
+        const Interval* neighbour_intervals = &m_intervals[neighbour * WalkCount];
+        for (size_t i = 0; i < WalkCount; ++i)
+        {
+            if (!neighbour_intervals[i].empty())
+            {
+                intervals[i].m_low = std::min(intervals[i].m_low, neighbour_intervals[i].m_low);
+                intervals[i].m_high = std::max(intervals[i].m_high, neighbour_intervals[i].m_high);
+            }
+        }
+    }
+    widen(vertex, intervals, reverse, labelled);
+}
+
+void ReachabilityIndex::grow(size_t vertexCount)
+{
+    if (vertexCount > m_vertex_count)
+    {
+        m_vertex_count = vertexCount;
+        m_intervals.resize(m_vertex_count * WalkCount, Interval{ None, 0 });
+    }
+}
+
+void ReachabilityIndex::widen(VertexId vertex, const Interval* intervals,
+    const AdjacencySets& reverse, const VertexBitmap& labelled)
+{
+    // The walk back stops at the vertices whose intervals already cover the new ones: whatever reaches them was
+    // covered along with them.
+    std::vector<VertexId> pending(1, vertex);
+    while (!pending.empty())
+    {
+        const VertexId current = pending.back();
+        pending.pop_back();
+        Interval* current_intervals = &m_intervals[current * WalkCount];
+        bool widened = false;
+        for (size_t i = 0; i < WalkCount; ++i)
+        {
+            Interval& interval = current_intervals[i];
+            if (interval.empty())
+            {
+                interval = intervals[i];
+                widened = true;
+            }
+            else if ((intervals[i].m_low < interval.m_low) || (intervals[i].m_high > interval.m_high))
+            {
+                interval.m_low = std::min(interval.m_low, intervals[i].m_low);
+                interval.m_high = std::max(interval.m_high, intervals[i].m_high);
+                widened = true;
+            }
+        }
+        if (!widened)
+        {
+            continue;
+        }
+        for (VertexId parent : reverse[current - 1])
+        {
+            if (labelled.contains(parent))
+            {
+                pending.push_back(parent);
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef REACHABILITYINDEX_H
+#define REACHABILITYINDEX_H
+
+#include "nodepool.h"
+#include "types.h"
+#include "vertexbitmap.h"
+#include <cstdint>
+#include <vector>
+
+/// Index that proves in constant time that a vertex can't reach another one through the vertices of a label.
+/// The graph of the labelled vertices is condensed into its strongly connected components, which form a DAG, and the
+/// DAG is walked depth-first a few times in random orders as in GRAIL (Yildirim, Chaoji and Zaki, "GRAIL: Scalable
+/// Reachability Index for Large Graphs"). Each walk gives every component an interval: its rank in post-order and the
+/// lowest rank below it. A vertex can only reach another one if the intervals of the first contain those of the
+/// second in every walk, so a query between vertices whose intervals don't nest has no path. Nested intervals prove
+/// nothing and the search still runs.
+/// The index is kept sound as the graph grows: a new edge or a newly labelled vertex widens the intervals of the
+/// vertices that can now reach further, walking back from the edge until the intervals already cover it. Removing a
+/// label or an edge leaves intervals wider than needed, which only makes the index reject fewer queries; building it
+/// again makes it exact.
+class ReachabilityIndex
+{
+public:
+    /// The number of walks of the DAG. Each walk costs 8 bytes per vertex and filters more queries.
+    static const size_t WalkCount = 2;
+
+    /// An index that has not been built. It rejects no query.
+    ReachabilityIndex() = default;
+
+    /// Build the index of the vertices of a label.
+    /// @param adjacency The neighbours of each vertex. The position in the vector is the ID of the vertex - 1.
+    /// @param labelled The vertices that have the label.
+    ReachabilityIndex(const AdjacencySets& adjacency, const VertexBitmap& labelled);
+
+    /// Returns true if the index was built.
+    bool built() const { return !m_intervals.empty(); }
+
+    /// Returns false if there is certainly no path from one vertex to the other through the vertices of the label.
+    /// Both vertices must have the label.
+    bool mayReach(VertexId from, VertexId to) const
+    {
+        if ((from >= m_vertex_count) || (to >= m_vertex_count))
+        {
+            return true;
+        }
+        const Interval* from_intervals = &m_intervals[from * WalkCount];
+        const Interval* to_intervals = &m_intervals[to * WalkCount];
+        for (size_t i = 0; i < WalkCount; ++i)
+        {
+            if (!from_intervals[i].contains(to_intervals[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Update the index after an edge was added between two vertices that have the label.
+    /// @param reverse The vertices that have an edge to each vertex.
+    void addEdge(VertexId from, VertexId to, const AdjacencySets& reverse, const VertexBitmap& labelled);
+
+    /// Update the index after a vertex was given the label.
+    void addVertex(VertexId vertex, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const VertexBitmap& labelled);
+
+    /// Returns the number of bytes used by the index.
+    size_t memoryUsage() const { return m_intervals.capacity() * sizeof(Interval); }
+
+private:
+    // The ranks of the components below a vertex in one walk. A vertex the index knows nothing about, because it was
+    // not labelled when the index was built, has an empty interval, with m_low > m_high, and nothing is rejected for
+    // it.
+    struct Interval
+    {
+        uint32_t m_low;
+        uint32_t m_high;
+
+        bool empty() const { return m_low > m_high; }
+
+        bool contains(const Interval& other) const
+        {
+            return empty() || other.empty() || ((m_low <= other.m_low) && (other.m_high <= m_high));
+        }
+    };
+
+    // Makes room for the vertices created since the index was built.
+    void grow(size_t vertexCount);
+
+    // Widens the intervals of a vertex and of the labelled vertices that reach it to cover the given intervals.
+    void widen(VertexId vertex, const Interval* intervals, const AdjacencySets& reverse, const VertexBitmap& labelled);
+
+    // WalkCount intervals per vertex ID, vertex 0 included so that the position is the ID times WalkCount.
+    std::vector<Interval> m_intervals;
+    size_t m_vertex_count = 0;
+    // The rank given to the next vertex added to the index, above every rank given by the walks.
+    uint32_t m_next_rank = 0;
+};
+
+#endif
@@ -0,0 +1,1111 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "bits.h"
+#include "edgeweights.h"
+#include "hublabelindex.h"
+#include "landmarkindex.h"
+#include "nodepool.h"
+#include "querycontext.h"
+#include "querymetrics.h"
+#include "queryoptions.h"
+#include "querystats.h"
+#include "reachabilityindex.h"
+#include "threadpool.h"
+#include "types.h"
+#include "vertexbitmap.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The search algorithms behind GraphStore::shortestPath. They are templates over the adjacency so that the same code
+// runs against the mutable per-vertex sets, the frozen CSR copies and the compressed adjacency. An adjacency only needs
+// a vertexCount() method, a neighbours(vertex) method returning something that can be iterated over and has a size(),
+// and for the weighted search weight(vertex, neighbour) and integerWeights() methods. Likewise the vertices of a label
+// only need contains(vertex) and copyTo(words) methods, as provided by VertexBitmap, DenseVertexSet and AllVertices.
+namespace search
+{
+    // Gives the search the same interface over the mutable per-vertex sets as the one CsrAdjacency provides.
+    class SetAdjacency
+    {
+    public:
+        // The weights can be null, in which case every edge weighs the default.
+        SetAdjacency(const AdjacencySets& vertices, const EdgeWeights* weights) :
+            m_vertices(vertices), m_weights(weights) {};
+
+        const NeighbourSet& neighbours(VertexId vertex) const
+        {
+            return m_vertices[vertex - 1];
+        }
+
+        EdgeWeight weight(VertexId vertex, VertexId neighbour) const
+        {
+            return (m_weights != nullptr) ? m_weights->weight(vertex, neighbour) : EdgeWeights::DefaultWeight;
+        }
+
+        bool integerWeights() const
+        {
+            return (m_weights == nullptr) || m_weights->integerWeights();
+        }
+
+        size_t vertexCount() const
+        {
+            return m_vertices.size();
+        }
+
+    private:
+        const AdjacencySets& m_vertices;
+        const EdgeWeights* m_weights;
+    };
+
+    // The vertices of a label that every vertex has. contains() is a constant, so the searches through such a label
+    // compile without the label check of their inner loops.
+    class AllVertices
+    {
+    public:
+        explicit AllVertices(size_t vertexCount) : m_vertex_count(vertexCount) {};
+
+        bool contains(VertexId) const
+        {
+            return true;
+        }
+
+        // Sets bits 1 to vertexCount, as far as words goes.
+        void copyTo(std::vector<uint64_t>& words) const
+        {
+            const size_t end = std::min(m_vertex_count + 1, words.size() * 64);
+            std::fill(words.begin(), words.end(), 0);
+            std::fill(words.begin(), words.begin() + (end / 64), ~uint64_t(0));
+            if ((end % 64) != 0)
+            {
+                words[end / 64] = (uint64_t(1) << (end % 64)) - 1;
+            }
+            if (!words.empty())
+            {
+                words[0] &= ~uint64_t(1);
+            }
+        }
+
+    private:
+        size_t m_vertex_count;
+    };
+
+    // Returns true if a set holds every vertex. Only the bitmaps of a LabelIndex know their size without counting.
+    inline bool HoldsAll(const VertexBitmap& vertices, size_t vertexCount)
+    {
+        return vertices.size() == vertexCount;
+    }
+
+    template <typename LabelSet>
+    bool HoldsAll(const LabelSet&, size_t)
+    {
+        return false;
+    }
+
+    // Statistics policies of the searches. NoStats does nothing and compiles away, so that a query that doesn't ask
+    // for stats runs the same code as if the counters didn't exist. CountingStats counts for a QueryStats. Neither is
+    // thread safe: the parallel BFS counts in local variables and adds them once per chunk.
+    class NoStats
+    {
+    public:
+        void popped(size_t) {}
+        void scanned(size_t) {}
+        void rejected(size_t) {}
+        void frontier(size_t) {}
+        void addLocked(std::mutex&, size_t, size_t, size_t) {}
+    };
+
+    class CountingStats
+    {
+    public:
+        void popped(size_t count) { m_popped += count; }
+        void scanned(size_t count) { m_scanned += count; }
+        void rejected(size_t count) { m_rejected += count; }
+        void frontier(size_t size) { m_peak_frontier = std::max(m_peak_frontier, size); }
+
+        // Adds counts made by one of several threads.
+        void addLocked(std::mutex& mutex, size_t popped, size_t scanned, size_t rejected)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            m_popped += popped;
+            m_scanned += scanned;
+            m_rejected += rejected;
+        }
+
+        // The counts live here rather than in the QueryStats so that the compiler can keep them in registers.
+        void copyTo(QueryStats& stats) const
+        {
+            stats.vertices_popped = m_popped;
+            stats.edges_scanned = m_scanned;
+            stats.label_rejects = m_rejected;
+            stats.peak_frontier = m_peak_frontier;
+        }
+
+    private:
+        size_t m_popped = 0;
+        size_t m_scanned = 0;
+        size_t m_rejected = 0;
+        size_t m_peak_frontier = 0;
+    };
+
+    // Limits policies of the searches, like the statistics policies. Unlimited compiles away, so that a query without
+    // limits runs the same code as if they didn't exist. Limited enforces the limits of a QueryOptions: a search calls
+    // expand() before it expands vertices and stops once it returns false, doesn't look for paths longer than
+    // maxHops(), and calls truncate() when the hop limit kept it from a path it could have found otherwise.
+    class Unlimited
+    {
+    public:
+        bool expand(size_t) { return true; }
+        uint32_t maxHops() const { return UINT32_MAX; }
+        void truncate() {}
+    };
+
+    class Limited
+    {
+    public:
+        explicit Limited(const QueryOptions& options) :
+            m_max_expanded(options.max_expanded), m_max_hops(options.max_hops), m_deadline(options.deadline),
+            m_cancellation(options.cancellation)
+        {
+            // Without a deadline or a token, nothing is ever checked.
+            const bool timed = (m_deadline != std::chrono::steady_clock::time_point::max());
+            m_next_check = (timed || (m_cancellation != nullptr)) ? 0 : UINT64_MAX;
+        }
+
+        bool expand(size_t count)
+        {
+            m_expanded += count;
+            if (m_expanded > m_max_expanded)
+            {
+                m_outcome = QueryOutcome::Truncated;
+                return false;
+            }
+            // The clock and the token are read on the first expansion, then every CheckInterval.
+            if (m_expanded >= m_next_check)
+            {
+                m_next_check = m_expanded + CheckInterval;
+                return check();
+            }
+            return true;
+        }
+
+        uint32_t maxHops() const { return m_max_hops; }
+        void truncate() { m_outcome = QueryOutcome::Truncated; }
+        QueryOutcome outcome() const { return m_outcome; }
+
+        // Returns true if the options have a limit, so that the queries without any run Unlimited.
+        static bool applies(const QueryOptions& options)
+        {
+            return (options.max_expanded != UINT64_MAX) || (options.max_hops != UINT32_MAX) ||
+                (options.deadline != std::chrono::steady_clock::time_point::max()) ||
+                (options.cancellation != nullptr);
+        }
+
+    private:
+        static const uint64_t CheckInterval = 256;
+
+        bool check()
+        {
+            if ((m_cancellation != nullptr) && m_cancellation->cancelled())
+            {
+                m_outcome = QueryOutcome::Cancelled;
+                return false;
+            }
+            if ((m_deadline != std::chrono::steady_clock::time_point::max()) &&
+                (std::chrono::steady_clock::now() >= m_deadline))
+            {
+                m_outcome = QueryOutcome::Truncated;
+                return false;
+            }
+            return true;
+        }
+
+        uint64_t m_expanded = 0;
+        uint64_t m_next_check;
+        uint64_t m_max_expanded;
+        uint32_t m_max_hops;
+        std::chrono::steady_clock::time_point m_deadline;
+        const CancellationToken* m_cancellation;
+        QueryOutcome m_outcome = QueryOutcome::Exact;
+    };
+
+    // Appends to path the chain of parents recorded in visits, from vertex back to the start of the search.
+    inline void AppendParents(const VisitMap& visits, VertexId vertex, std::vector<VertexId>& path)
+    {
+        for (; vertex != 0; vertex = visits.parent(vertex))
+        {
+            path.push_back(vertex);
+        }
+    }
+
+    // The heuristic of the plain A* search: 0 for every vertex.
+    class NoHeuristic
+    {
+    public:
+        uint32_t estimate(VertexId) const { return 0; }
+    };
+
+    // This is an implementation of the A* algorithm as described in https://en.wikipedia.org/wiki/A*_search_algorithm
+    // With d(vertex_1, vertex_2) always 1 since our graph doesn't have a weight on the edges. The heuristic gives h,
+    // which must be consistent: NoHeuristic, which essentially disables the heuristic part of the algorithm, or
+    // LandmarkHeuristic. A vertex whose h is LandmarkHeuristic::Unreachable is never added to the open set.
+    // The wikipedia algorithm fills the scores with infinity. Instead the visit map reports a distance of infinity for
+    // the vertices the search hasn't reached, which costs nothing for the vertices we'll never visit.
+    template <typename Adjacency, typename LabelSet, typename Heuristic, typename Stats, typename Limits>
+    bool AStar(const Adjacency& adjacency, size_t vertexCount, VertexId from, VertexId to,
+        const LabelSet& labelled, const Heuristic& heuristic, QueryContext& context, Stats& stats, Limits& limits,
+        std::vector<VertexId>& path)
+    {
+        const uint32_t from_estimate = heuristic.estimate(from);
+        if (from_estimate == LandmarkHeuristic::Unreachable)
+        {
+            return false;
+        }
+
+        // The g score of each vertex is its distance in the forward visits and the backward visits mark the vertices
+        // already expanded. As the heuristic is consistent a vertex is never expanded twice.
+        VisitMap& visits = context.m_forward;
+        VisitMap& expanded = context.m_backward;
+        visits.clear(vertexCount);
+        expanded.clear(vertexCount);
+        visits.visit(from, 0, 0);
+
+        // Binary heap ordered so that the element with the lowest f score is at the front. Among equal f scores the
+        // one with the highest g score, the closest to the destination, comes first: on the unweighted graph many
+        // vertices have the same f score and this goes straight down one path instead of expanding all of them. The
+        // low 32 bits of the key hold the complement of g. Instead of decreasing the key of a vertex we push it again
+        // and skip the entries of the vertices already expanded when they come out.
+        typedef std::pair<uint64_t, VertexId> ScoreAndVertex;
+        auto key = [](uint32_t f, uint32_t g) { return (static_cast<uint64_t>(f) << 32) | (UINT32_MAX - g); };
+        std::vector<ScoreAndVertex>& open_set = context.m_heap;
+        open_set.clear();
+        open_set.emplace_back(key(from_estimate, 0), from);
+
+        // The vertices at the hop limit are not expanded: a shorter path would have been found first.
+        bool pruned = false;
+        while (!open_set.empty())
+        {
+            std::pop_heap(open_set.begin(), open_set.end(), std::greater<ScoreAndVertex>());
+            const VertexId current_vertex = open_set.back().second;
+            open_set.pop_back();
+            if (!expanded.visit(current_vertex, 0, 0))
+            {
+                continue;
+            }
+            if (!limits.expand(1))
+            {
+                return false;
+            }
+            stats.popped(1);
+            if (current_vertex == to)
+            {
+                AppendParents(visits, current_vertex, path);
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+
+            const uint32_t tentative_g_score = visits.distance(current_vertex) + 1;
+            if (tentative_g_score > limits.maxHops())
+            {
+                pruned = true;
+                continue;
+            }
+            for (VertexId neighbour : adjacency.neighbours(current_vertex))
+            {
+                stats.scanned(1);
+                if (!labelled.contains(neighbour))
+                {
+                    stats.rejected(1);
+                    continue;
+                }
+
+                if (tentative_g_score < visits.distance(neighbour))
+                {
+                    const uint32_t estimate = heuristic.estimate(neighbour);
+                    if (estimate == LandmarkHeuristic::Unreachable)
+                    {
+                        continue;
+                    }
+                    visits.update(neighbour, current_vertex, tentative_g_score);
+                    open_set.emplace_back(key(tentative_g_score + estimate, tentative_g_score), neighbour);
+                    std::push_heap(open_set.begin(), open_set.end(), std::greater<ScoreAndVertex>());
+                }
+            }
+            stats.frontier(open_set.size());
+        }
+
+        if (pruned)
+        {
+            limits.truncate();
+        }
+        return false;
+    }
+
+    // Monotone priority queue of integer keys (Ahuja, Mehlhorn, Orlin and Tarjan, "Faster Algorithms for the Shortest
+    // Path Problem"). Dijkstra's algorithm never pushes a key smaller than the last one popped, so the entries can be
+    // kept in 65 buckets by the highest bit in which their key differs from the last key popped, bucket 0 holding the
+    // keys equal to it. When bucket 0 is empty, popping moves the entries of the first non-empty bucket to lower
+    // buckets, relative to the smallest of them; an entry only ever moves down, 64 times at most. Pushing is an
+    // append. Decreasing a key pushes the vertex again and the search skips the entries of settled vertices.
+    class RadixHeap
+    {
+    public:
+        typedef std::pair<uint64_t, VertexId> Entry;
+
+        explicit RadixHeap(std::array<std::vector<Entry>, 65>& buckets) : m_buckets(buckets)
+        {
+            for (std::vector<Entry>& bucket : m_buckets)
+            {
+                bucket.clear();
+            }
+        }
+
+        bool empty() const { return m_size == 0; }
+        size_t size() const { return m_size; }
+
+        void push(VertexId vertex, double weight)
+        {
+            const uint64_t key = static_cast<uint64_t>(weight);
+            m_buckets[BitWidth(key ^ m_last)].emplace_back(key, vertex);
+            ++m_size;
+        }
+
+        void decrease(VertexId vertex, double weight) { push(vertex, weight); }
+
+        VertexId pop()
+        {
+            if (m_buckets[0].empty())
+            {
+                size_t index = 1;
+                while (m_buckets[index].empty())
+                {
+                    ++index;
+                }
+                std::vector<Entry>& bucket = m_buckets[index];
+                m_last = std::min_element(bucket.begin(), bucket.end())->first;
+                for (const Entry& entry : bucket)
+                {
+                    m_buckets[BitWidth(entry.first ^ m_last)].push_back(entry);
+                }
+                bucket.clear();
+            }
+            const VertexId vertex = m_buckets[0].back().second;
+            m_buckets[0].pop_back();
+            --m_size;
+            return vertex;
+        }
+
+    private:
+        std::array<std::vector<Entry>, 65>& m_buckets;
+        uint64_t m_last = 0;
+        size_t m_size = 0;
+    };
+
+    // Min-heap with decrease-key where each node has four children. It is half as deep as a binary heap and the
+    // children of a node sit next to each other in memory, so sifting touches fewer cache lines. The position of each
+    // vertex in the heap is tracked so that its key can be decreased in place instead of pushing it again. The keys
+    // are the bit patterns of the weights: non-negative doubles compare like their patterns as unsigned integers.
+    class QuaternaryHeap
+    {
+    public:
+        typedef std::pair<uint64_t, VertexId> Entry;
+
+        QuaternaryHeap(std::vector<Entry>& entries, std::vector<size_t>& positions, size_t vertexCount) :
+            m_entries(entries), m_positions(positions)
+        {
+            m_entries.clear();
+            if (m_positions.size() < vertexCount + 1)
+            {
+                m_positions.resize(vertexCount + 1);
+            }
+        }
+
+        bool empty() const { return m_entries.empty(); }
+        size_t size() const { return m_entries.size(); }
+
+        void push(VertexId vertex, double weight)
+        {
+            m_entries.emplace_back(Key(weight), vertex);
+            siftUp(m_entries.size() - 1);
+        }
+
+        // The vertex must be in the heap and the weight no larger than its current one.
+        void decrease(VertexId vertex, double weight)
+        {
+            const size_t position = m_positions[vertex];
+            m_entries[position].first = Key(weight);
+            siftUp(position);
+        }
+
+        VertexId pop()
+        {
+            const VertexId vertex = m_entries.front().second;
+            m_entries.front() = m_entries.back();
+            m_entries.pop_back();
+            if (!m_entries.empty())
+            {
+                siftDown(0);
+            }
+            return vertex;
+        }
+
+    private:
+        static uint64_t Key(double weight)
+        {
+            uint64_t key;
+            std::memcpy(&key, &weight, sizeof(key));
+            return key;
+        }
+
+        void siftUp(size_t position)
+        {
+            const Entry entry = m_entries[position];
+            while (position > 0)
+            {
+                const size_t parent = (position - 1) / 4;
+                if (m_entries[parent].first <= entry.first)
+                {
+                    break;
+                }
+                m_entries[position] = m_entries[parent];
+                m_positions[m_entries[position].second] = position;
+                position = parent;
+            }
+            m_entries[position] = entry;
+            m_positions[entry.second] = position;
+        }
+
+        void siftDown(size_t position)
+        {
+            const Entry entry = m_entries[position];
+            const size_t size = m_entries.size();
+            for (;;)
+            {
+                const size_t first_child = (4 * position) + 1;
+                if (first_child >= size)
+                {
+                    break;
+                }
+                size_t smallest = first_child;
+                const size_t last_child = std::min(first_child + 4, size);
+                for (size_t child = first_child + 1; child < last_child; ++child)
+                {
+                    if (m_entries[child].first < m_entries[smallest].first)
+                    {
+                        smallest = child;
+                    }
+                }
+                if (m_entries[smallest].first >= entry.first)
+                {
+                    break;
+                }
+                m_entries[position] = m_entries[smallest];
+                m_positions[m_entries[position].second] = position;
+                position = smallest;
+            }
+            m_entries[position] = entry;
+            m_positions[entry.second] = position;
+        }
+
+        std::vector<Entry>& m_entries;
+        std::vector<size_t>& m_positions;
+    };
+
+    // Dijkstra's algorithm on the weights of the edges, stopping as soon as the destination is settled. The queue is
+    // a RadixHeap or a QuaternaryHeap. The forward visits hold the parent and the number of edges of the best path
+    // found to each vertex, the weight of that path being in QueryContext::m_path_weights, and the backward visits
+    // mark the settled vertices.
+    // With a hop limit, the vertices whose lightest path found so far is at the limit are not expanded. A lighter
+    // path with fewer edges through them may then be missed, which is reported as a truncated search.
+    template <typename Adjacency, typename LabelSet, typename Queue, typename Stats, typename Limits>
+    bool Dijkstra(const Adjacency& adjacency, size_t vertexCount, VertexId from, VertexId to,
+        const LabelSet& labelled, Queue& queue, QueryContext& context, Stats& stats, Limits& limits,
+        std::vector<VertexId>& path)
+    {
+        VisitMap& visits = context.m_forward;
+        VisitMap& settled = context.m_backward;
+        visits.clear(vertexCount);
+        settled.clear(vertexCount);
+        std::vector<double>& path_weights = context.m_path_weights;
+        if (path_weights.size() < vertexCount + 1)
+        {
+            path_weights.resize(vertexCount + 1);
+        }
+
+        visits.visit(from, 0, 0);
+        path_weights[from] = 0;
+        queue.push(from, 0);
+        bool pruned = false;
+        while (!queue.empty())
+        {
+            const VertexId vertex = queue.pop();
+            if (!settled.visit(vertex, 0, 0))
+            {
+                continue;
+            }
+            if (!limits.expand(1))
+            {
+                return false;
+            }
+            stats.popped(1);
+            if (vertex == to)
+            {
+                if (pruned)
+                {
+                    limits.truncate();
+                }
+                AppendParents(visits, vertex, path);
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+
+            const double weight = path_weights[vertex];
+            const uint32_t edge_count = visits.distance(vertex) + 1;
+            if (edge_count > limits.maxHops())
+            {
+                pruned = true;
+                continue;
+            }
+            // A reference into the range, whatever the width of its IDs, which weight() may use to find the edge.
+            for (const auto& neighbour : adjacency.neighbours(vertex))
+            {
+                stats.scanned(1);
+                if (!labelled.contains(neighbour))
+                {
+                    stats.rejected(1);
+                    continue;
+                }
+
+                const double tentative_weight = weight + adjacency.weight(vertex, neighbour);
+                if (visits.visit(neighbour, vertex, edge_count))
+                {
+                    path_weights[neighbour] = tentative_weight;
+                    queue.push(neighbour, tentative_weight);
+                }
+                else if ((tentative_weight < path_weights[neighbour]) && !settled.visited(neighbour))
+                {
+                    visits.update(neighbour, vertex, edge_count);
+                    path_weights[neighbour] = tentative_weight;
+                    queue.decrease(neighbour, tentative_weight);
+                }
+            }
+            stats.frontier(queue.size());
+        }
+
+        if (pruned)
+        {
+            limits.truncate();
+        }
+        return false;
+    }
+
+    // Breadth-first search run forward from the source and backward from the destination, one level at a time,
+    // always expanding the smaller of the two frontiers. On the unweighted graph the first vertex reached by both
+    // searches is on a shortest path: if the searches have gone kf and kb levels deep without meeting, no path is
+    // shorter than kf + kb + 1 and any meeting found while expanding the next level gives a path of exactly that
+    // length.
+    template <typename Adjacency, typename LabelSet, typename Stats, typename Limits>
+    bool BidirectionalBfs(const Adjacency& forward, const Adjacency& backward, size_t vertexCount, VertexId from,
+        VertexId to, const LabelSet& labelled, QueryContext& context, Stats& stats, Limits& limits,
+        std::vector<VertexId>& path)
+    {
+        if (from == to)
+        {
+            path.push_back(from);
+            return true;
+        }
+
+        context.m_forward.clear(vertexCount);
+        context.m_backward.clear(vertexCount);
+        context.m_forward.visit(from, 0, 0);
+        context.m_backward.visit(to, 0, 0);
+        context.m_forward_frontier.assign(1, from);
+        context.m_backward_frontier.assign(1, to);
+
+        // The number of levels both searches have expanded: the next one only finds paths of levels + 1 edges.
+        uint32_t levels = 0;
+        while (!context.m_forward_frontier.empty() && !context.m_backward_frontier.empty())
+        {
+            if (levels >= limits.maxHops())
+            {
+                limits.truncate();
+                return false;
+            }
+            ++levels;
+            stats.frontier(context.m_forward_frontier.size() + context.m_backward_frontier.size());
+            const bool forward_step = context.m_forward_frontier.size() <= context.m_backward_frontier.size();
+            const Adjacency& adjacency = forward_step ? forward : backward;
+            VisitMap& own_visits = forward_step ? context.m_forward : context.m_backward;
+            const VisitMap& other_visits = forward_step ? context.m_backward : context.m_forward;
+            std::vector<VertexId>& frontier = forward_step ? context.m_forward_frontier : context.m_backward_frontier;
+            std::vector<VertexId>& next_frontier = context.m_next_frontier;
+
+            next_frontier.clear();
+            for (VertexId vertex : frontier)
+            {
+                if (!limits.expand(1))
+                {
+                    return false;
+                }
+                stats.popped(1);
+                const uint32_t distance = own_visits.distance(vertex) + 1;
+                for (VertexId neighbour : adjacency.neighbours(vertex))
+                {
+                    stats.scanned(1);
+                    if (!labelled.contains(neighbour))
+                    {
+                        stats.rejected(1);
+                        continue;
+                    }
+                    if (!own_visits.visit(neighbour, vertex, distance))
+                    {
+                        continue;
+                    }
+                    if (other_visits.visited(neighbour))
+                    {
+                        AppendParents(context.m_forward, neighbour, path);
+                        std::reverse(path.begin(), path.end());
+                        AppendParents(context.m_backward, context.m_backward.parent(neighbour), path);
+                        return true;
+                    }
+                    next_frontier.push_back(neighbour);
+                }
+            }
+            frontier.swap(next_frontier);
+        }
+
+        return false;
+    }
+
+    // Runs body over [0, count) on the pool, or directly on the calling thread if there is no pool.
+    inline void ParallelFor(ThreadPool* pool, size_t count, size_t grainSize,
+        const std::function<void(size_t, size_t)>& body)
+    {
+        if (pool != nullptr)
+        {
+            pool->parallelFor(count, grainSize, body);
+        }
+        else if (count > 0)
+        {
+            body(0, count);
+        }
+    }
+
+    // Direction-optimizing breadth-first search from the source, as described by Beamer, Asanovic and Patterson in
+    // "Direction-Optimizing Breadth-First Search". While the frontier is small, a top-down step walks the edges out of
+    // the frontier. Once the edges out of the frontier outnumber the edges left to explore by a factor of Alpha, a
+    // bottom-up step instead checks each vertex not reached yet for an incoming edge from the frontier, which stops at
+    // the first one found. The search goes back to top-down steps when the frontier shrinks below 1/Beta of the graph.
+    // The frontier is a list of vertices in top-down steps and a bitset in bottom-up steps, and the label filter is a
+    // bitset ANDed with the vertices not reached yet. Each step is split over the threads of the pool.
+    // The limits are checked once per level, from the calling thread: a level counts as many expanded vertices as its
+    // frontier holds.
+    template <typename Adjacency, typename LabelSet, typename Stats, typename Limits>
+    bool DirectionOptimizingBfs(const Adjacency& forward, const Adjacency& backward, size_t vertexCount,
+        size_t edgeCount, VertexId from, VertexId to, const LabelSet& labelled, ThreadPool* pool,
+        QueryContext& context, Stats& stats, Limits& limits, std::vector<VertexId>& path)
+    {
+        const size_t Alpha = 14;
+        const size_t Beta = 24;
+        const size_t GrainSize = 1024;
+
+        if (from == to)
+        {
+            path.push_back(from);
+            return true;
+        }
+
+        // Bit i stands for vertex i. Bit 0 is never set since 0 is not a valid vertex.
+        const size_t word_count = (vertexCount / 64) + 1;
+        context.m_label_words.resize(word_count);
+        labelled.copyTo(context.m_label_words);
+        context.m_frontier_words.assign(word_count, 0);
+        context.m_next_words.assign(word_count, 0);
+        if (context.m_visited_words.size() < word_count)
+        {
+            // std::atomic can't be moved so the vector can't be resized in place.
+            context.m_visited_words = std::vector<std::atomic<uint64_t>>(word_count);
+        }
+        for (size_t i = 0; i < word_count; ++i)
+        {
+            context.m_visited_words[i].store(0, std::memory_order_relaxed);
+        }
+
+        const std::vector<uint64_t>& label_words = context.m_label_words;
+        std::vector<std::atomic<uint64_t>>& visited_words = context.m_visited_words;
+        VisitMap& visits = context.m_forward;
+        visits.clear(vertexCount);
+        visits.update(from, 0, 0);
+        visited_words[from >> 6].fetch_or(uint64_t(1) << (from & 63));
+
+        std::vector<VertexId>& frontier = context.m_forward_frontier;
+        std::vector<VertexId>& next_frontier = context.m_next_frontier;
+        frontier.assign(1, from);
+        size_t frontier_size = 1;
+        bool bottom_up = false;
+        size_t unexplored_edges = edgeCount;
+        // Guards the next frontier of the top-down steps, and the stats.
+        std::mutex next_frontier_mutex;
+
+        for (uint32_t distance = 1; frontier_size > 0; ++distance)
+        {
+            if (distance > limits.maxHops())
+            {
+                limits.truncate();
+                return false;
+            }
+            if (!limits.expand(frontier_size))
+            {
+                return false;
+            }
+            stats.frontier(frontier_size);
+            if (!bottom_up)
+            {
+                size_t frontier_edges = 0;
+                for (VertexId vertex : frontier)
+                {
+                    frontier_edges += forward.neighbours(vertex).size();
+                }
+                unexplored_edges = (unexplored_edges > frontier_edges) ? (unexplored_edges - frontier_edges) : 0;
+                if (frontier_edges > (unexplored_edges / Alpha))
+                {
+                    bottom_up = true;
+                    std::fill(context.m_frontier_words.begin(), context.m_frontier_words.end(), 0);
+                    for (VertexId vertex : frontier)
+                    {
+                        context.m_frontier_words[vertex >> 6] |= uint64_t(1) << (vertex & 63);
+                    }
+                }
+            }
+            else if (frontier_size < (vertexCount / Beta))
+            {
+                bottom_up = false;
+                frontier.clear();
+                for (size_t word_index = 0; word_index < word_count; ++word_index)
+                {
+                    for (uint64_t word = context.m_frontier_words[word_index]; word != 0; word &= (word - 1))
+                    {
+                        frontier.push_back((word_index << 6) + CountTrailingZeros(word));
+                    }
+                }
+            }
+
+            std::atomic<size_t> next_size(0);
+            if (bottom_up)
+            {
+                const std::vector<uint64_t>& frontier_words = context.m_frontier_words;
+                std::vector<uint64_t>& next_words = context.m_next_words;
+                // Each thread owns a range of words so it can update them without synchronization.
+                ParallelFor(pool, word_count, GrainSize, [&](size_t begin, size_t end)
+                {
+                    size_t found = 0;
+                    size_t popped = 0;
+                    size_t scanned = 0;
+                    for (size_t word_index = begin; word_index < end; ++word_index)
+                    {
+                        const uint64_t visited = visited_words[word_index].load(std::memory_order_relaxed);
+                        uint64_t reached = 0;
+                        for (uint64_t candidates = label_words[word_index] & ~visited; candidates != 0;
+                            candidates &= (candidates - 1))
+                        {
+                            const unsigned bit_index = CountTrailingZeros(candidates);
+                            const uint64_t bit = uint64_t(1) << bit_index;
+                            const VertexId vertex = (word_index << 6) + bit_index;
+                            ++popped;
+                            for (VertexId parent : backward.neighbours(vertex))
+                            {
+                                ++scanned;
+                                if ((frontier_words[parent >> 6] >> (parent & 63)) & 1)
+                                {
+                                    visits.update(vertex, parent, distance);
+                                    reached |= bit;
+                                    ++found;
+                                    break;
+                                }
+                            }
+                        }
+                        visited_words[word_index].store(visited | reached, std::memory_order_relaxed);
+                        next_words[word_index] = reached;
+                    }
+                    next_size += found;
+                    stats.addLocked(next_frontier_mutex, popped, scanned, 0);
+                });
+                context.m_frontier_words.swap(context.m_next_words);
+            }
+            else
+            {
+                next_frontier.clear();
+                ParallelFor(pool, frontier.size(), GrainSize, [&](size_t begin, size_t end)
+                {
+                    std::vector<VertexId> reached;
+                    size_t scanned = 0;
+                    size_t rejected = 0;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const VertexId vertex = frontier[i];
+                        for (VertexId neighbour : forward.neighbours(vertex))
+                        {
+                            ++scanned;
+                            const uint64_t bit = uint64_t(1) << (neighbour & 63);
+                            if ((label_words[neighbour >> 6] & bit) == 0)
+                            {
+                                ++rejected;
+                                continue;
+                            }
+                            std::atomic<uint64_t>& visited = visited_words[neighbour >> 6];
+                            if (((visited.load(std::memory_order_relaxed) & bit) != 0) ||
+                                ((visited.fetch_or(bit, std::memory_order_relaxed) & bit) != 0))
+                            {
+                                continue;
+                            }
+                            visits.update(neighbour, vertex, distance);
+                            reached.push_back(neighbour);
+                        }
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(next_frontier_mutex);
+                        next_frontier.insert(next_frontier.end(), reached.begin(), reached.end());
+                    }
+                    stats.addLocked(next_frontier_mutex, end - begin, scanned, rejected);
+                });
+                next_size = next_frontier.size();
+                frontier.swap(next_frontier);
+            }
+            frontier_size = next_size;
+
+            if ((visited_words[to >> 6].load(std::memory_order_relaxed) >> (to & 63)) & 1)
+            {
+                AppendParents(visits, to, path);
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // The optional indexes of a graph that a query can use. Any of them can be null.
+    struct Indexes
+    {
+        // The reachability index of each label, indexed by label ID.
+        const std::vector<ReachabilityIndex>* reachability;
+        // Landmark tables that are valid for the edges being searched.
+        const LandmarkIndex* landmarks;
+        // The distance index of each label, indexed by label ID. Only the indexes that are up to date are set.
+        const std::vector<std::shared_ptr<const HubLabelIndex>>* distances;
+    };
+
+    // Throws if either end of a query is not a vertex of the graph.
+    inline void CheckVertices(size_t vertexCount, VertexId from, VertexId to)
+    {
+        if (((from - 1) >= vertexCount) || ((to - 1) >= vertexCount))
+        {
+            throw std::runtime_error("Vertex does not exist");
+        }
+    }
+
+    // Runs the algorithm picked by the options over the vertices of a set, which contains both ends of the path.
+    template <typename Adjacency, typename LabelSet, typename Stats, typename Limits>
+    bool RunSearch(const Adjacency& forward, const Adjacency& backward, size_t edgeCount, const LabelSet& labelled,
+        const LandmarkIndex* landmarks, VertexId from, VertexId to, const QueryOptions& options,
+        QueryContext& context, Stats& stats, Limits& limits, std::vector<VertexId>& path)
+    {
+        const size_t vertex_count = forward.vertexCount();
+        SearchAlgorithm algorithm = options.algorithm;
+        if (algorithm == SearchAlgorithm::Auto)
+        {
+            const bool parallel = (options.pool != nullptr) && (vertex_count >= options.parallel_threshold);
+            algorithm = parallel ? SearchAlgorithm::ParallelBfs : SearchAlgorithm::BidirectionalBfs;
+        }
+
+        switch (algorithm)
+        {
+        case SearchAlgorithm::AStar:
+            return AStar(forward, vertex_count, from, to, labelled, NoHeuristic(), context, stats, limits, path);
+        case SearchAlgorithm::Alt:
+            if (landmarks != nullptr)
+            {
+                return AStar(forward, vertex_count, from, to, labelled, LandmarkHeuristic(*landmarks, to), context,
+                    stats, limits, path);
+            }
+            return AStar(forward, vertex_count, from, to, labelled, NoHeuristic(), context, stats, limits, path);
+        case SearchAlgorithm::Dijkstra:
+            if (forward.integerWeights())
+            {
+                RadixHeap queue(context.m_radix_buckets);
+                return Dijkstra(forward, vertex_count, from, to, labelled, queue, context, stats, limits, path);
+            }
+            else
+            {
+                QuaternaryHeap queue(context.m_heap, context.m_heap_positions, vertex_count);
+                return Dijkstra(forward, vertex_count, from, to, labelled, queue, context, stats, limits, path);
+            }
+        case SearchAlgorithm::ParallelBfs:
+            return DirectionOptimizingBfs(forward, backward, vertex_count, edgeCount, from, to, labelled,
+                options.pool, context, stats, limits, path);
+        default:
+            return BidirectionalBfs(forward, backward, vertex_count, from, to, labelled, context, stats, limits,
+                path);
+        }
+    }
+
+    // Checks the arguments of a shortest path query, resolves its label, tries the indexes of the label and then
+    // searches.
+    template <typename Adjacency, typename Labels, typename Stats, typename Limits>
+    bool RunShortestPath(const Adjacency& forward, const Adjacency& backward, size_t edgeCount, const Labels& labels,
+        const Indexes& indexes, VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+        QueryContext& context, Stats& stats, Limits& limits, std::vector<VertexId>& path)
+    {
+        path.clear();
+        CheckVertices(forward.vertexCount(), from, to);
+
+        LabelId label_id;
+        if (!labels.find(label, label_id))
+        {
+            return false;
+        }
+        const auto& labelled = labels.vertices(label_id);
+        if (!labelled.contains(from) || !labelled.contains(to))
+        {
+            return false;
+        }
+        if ((indexes.reachability != nullptr) && (label_id < indexes.reachability->size()) &&
+            !(*indexes.reachability)[label_id].mayReach(from, to))
+        {
+            return false;
+        }
+        if ((indexes.distances != nullptr) && (label_id < indexes.distances->size()) &&
+            (*indexes.distances)[label_id] && (options.algorithm != SearchAlgorithm::Dijkstra))
+        {
+            // The index answers without expanding anything, so only the hop limit applies.
+            if ((*indexes.distances)[label_id]->shortestPath(from, to, path) && ((path.size() - 1) > limits.maxHops()))
+            {
+                path.clear();
+                limits.truncate();
+            }
+            return !path.empty();
+        }
+
+        if (HoldsAll(labelled, forward.vertexCount()))
+        {
+            return RunSearch(forward, backward, edgeCount, AllVertices(forward.vertexCount()), indexes.landmarks, from,
+                to, options, context, stats, limits, path);
+        }
+        return RunSearch(forward, backward, edgeCount, labelled, indexes.landmarks, from, to, options, context, stats,
+            limits, path);
+    }
+
+    // Runs a query, given as a function of the statistics policy, and fills the stats it asks for and the global
+    // metrics. The counting version of the search only runs when the query asks for stats or the metrics are enabled.
+    template <typename Query>
+    bool MeasureQuery(const QueryOptions& options, QueryContext& context, std::vector<VertexId>& path, Query query)
+    {
+#ifndef GRAPHSTORE_NO_STATS
+        QueryMetrics& metrics = QueryMetrics::global();
+        const bool record = metrics.enabled();
+        if ((options.stats != nullptr) || record)
+        {
+            QueryStats local_stats;
+            QueryStats& stats = (options.stats != nullptr) ? *options.stats : local_stats;
+            stats = QueryStats();
+            const QueryContext::Capacities capacities = context.capacities();
+            const size_t path_capacity = path.capacity();
+            const auto start = std::chrono::steady_clock::now();
+
+            CountingStats counting;
+            stats.found = query(counting);
+            counting.copyTo(stats);
+
+            stats.wall_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+            const QueryContext::Capacities new_capacities = context.capacities();
+            for (size_t i = 0; i < capacities.size(); ++i)
+            {
+                stats.allocations += (new_capacities[i] != capacities[i]) ? 1 : 0;
+            }
+            stats.allocations += (path.capacity() != path_capacity) ? 1 : 0;
+            if (record)
+            {
+                metrics.record(stats);
+            }
+            return stats.found;
+        }
+#endif
+        NoStats no_stats;
+        return query(no_stats);
+    }
+
+    // Runs a query, given as a function of the limits policy, with the limits of the options if it has any, and
+    // reports its outcome.
+    template <typename Query>
+    bool LimitQuery(const QueryOptions& options, Query query)
+    {
+        if (!Limited::applies(options))
+        {
+            if (options.outcome != nullptr)
+            {
+                *options.outcome = QueryOutcome::Exact;
+            }
+            Unlimited unlimited;
+            return query(unlimited);
+        }
+        Limited limited(options);
+        const bool found = query(limited);
+        if (options.outcome != nullptr)
+        {
+            *options.outcome = limited.outcome();
+        }
+        return found;
+    }
+
+    // Runs a shortest path query. This is shared by GraphStore and GraphVersion. The labels can be a LabelIndex or a
+    // MappedLabelIndex. The reachability indexes answer the queries they prove have no path without searching, the
+    // distance indexes answer the queries of their label without searching at all and the landmark tables guide
+    // SearchAlgorithm::Alt.
+    template <typename Adjacency, typename Labels>
+    bool ShortestPath(const Adjacency& forward, const Adjacency& backward, size_t edgeCount, const Labels& labels,
+        const Indexes& indexes, VertexId from, VertexId to, const std::string& label, const QueryOptions& options,
+        QueryContext& context, std::vector<VertexId>& path)
+    {
+        return MeasureQuery(options, context, path, [&](auto& stats)
+        {
+            return LimitQuery(options, [&](auto& limits)
+            {
+                return RunShortestPath(forward, backward, edgeCount, labels, indexes, from, to, label, options,
+                    context, stats, limits, path);
+            });
+        });
+    }
+
+    // Runs a shortest path query through the vertices of a set, such as the bitset of a LabelPredicate. Only the
+    // landmark tables of the indexes apply.
+    template <typename Adjacency, typename LabelSet>
+    bool ShortestPathWithin(const Adjacency& forward, const Adjacency& backward, size_t edgeCount,
+        const LabelSet& vertices, const LandmarkIndex* landmarks, VertexId from, VertexId to,
+        const QueryOptions& options, QueryContext& context, std::vector<VertexId>& path)
+    {
+        return MeasureQuery(options, context, path, [&](auto& stats)
+        {
+            path.clear();
+            CheckVertices(forward.vertexCount(), from, to);
+            if (!vertices.contains(from) || !vertices.contains(to))
+            {
+                return false;
+            }
+            return LimitQuery(options, [&](auto& limits)
+            {
+                return RunSearch(forward, backward, edgeCount, vertices, landmarks, from, to, options, context, stats,
+                    limits, path);
+            });
+        });
+    }
+}
+
+#endif
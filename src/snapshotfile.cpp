@@ -0,0 +1,348 @@
+#include "snapshotfile.h"
+#include "bits.h"
+#include "graphstore.h"
+#include "mappedfile.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // "GRAPHSTR" read as a little-endian word. Reading it back also checks the byte order of the file.
+    const uint64_t SnapshotMagic = 0x5254534850415247ull;
+    const uint32_t SnapshotFormatVersion = 1;
+
+    struct SnapshotHeader
+    {
+        uint64_t m_magic;
+        uint32_t m_format_version;
+        uint32_t m_header_size;
+        uint64_t m_vertex_count;
+        uint64_t m_edge_count;
+        uint64_t m_label_count;
+        uint64_t m_names_size;
+        uint64_t m_checksum;
+        uint64_t m_sequence;
+    };
+    static_assert(sizeof(SnapshotHeader) == 64, "The snapshot header must be 64 bytes");
+
+    // A fast 64-bit checksum over words. It is meant to catch truncated or damaged files, not tampering.
+    class Checksum
+    {
+    public:
+        void add(const uint64_t* words, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                m_value = (((m_value << 5) | (m_value >> 59)) ^ words[i]) * 0x9E3779B97F4A7C15ull;
+            }
+        }
+
+        uint64_t value() const { return m_value; }
+
+    private:
+        uint64_t m_value = 0;
+    };
+
+    // Writes words to a file and keeps the checksum of everything written.
+    class SnapshotWriter
+    {
+    public:
+        explicit SnapshotWriter(std::ofstream& file) : m_file(file) {};
+
+        void write(const uint64_t* words, size_t count)
+        {
+            m_checksum.add(words, count);
+            m_file.write(reinterpret_cast<const char*>(words), static_cast<std::streamsize>(count * sizeof(uint64_t)));
+        }
+
+        // size_t is not 64 bits on every platform so arrays of size_t are converted a block at a time.
+        void writeSizes(const size_t* values, size_t count)
+        {
+            uint64_t block[4096];
+            while (count > 0)
+            {
+                const size_t block_size = (count < 4096) ? count : 4096;
+                for (size_t i = 0; i < block_size; ++i)
+                {
+                    block[i] = values[i];
+                }
+                write(block, block_size);
+                values += block_size;
+                count -= block_size;
+            }
+        }
+
+        uint64_t checksum() const { return m_checksum.value(); }
+
+    private:
+        std::ofstream& m_file;
+        Checksum m_checksum;
+    };
+
+    void WriteAdjacency(SnapshotWriter& writer, const CsrAdjacency& adjacency)
+    {
+        writer.writeSizes(adjacency.offsets(), adjacency.vertexCount() + 1);
+        writer.writeSizes(adjacency.neighbourData(), adjacency.edgeCount());
+    }
+
+    // Checks that the offsets only go up and end at the edge count and that the neighbours are valid vertices, so
+    // that searches can't read outside of the file.
+    bool IsConsistent(const uint64_t* offsets, const uint64_t* neighbours, uint64_t vertexCount, uint64_t edgeCount)
+    {
+        if ((offsets[0] != 0) || (offsets[vertexCount] != edgeCount))
+        {
+            return false;
+        }
+        for (uint64_t i = 0; i < vertexCount; ++i)
+        {
+            if (offsets[i] > offsets[i + 1])
+            {
+                return false;
+            }
+        }
+        for (uint64_t i = 0; i < edgeCount; ++i)
+        {
+            if ((neighbours[i] == 0) || (neighbours[i] > vertexCount))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A mapped snapshot file whose header and section bounds have been checked.
+    struct SnapshotView
+    {
+        std::shared_ptr<const MappedFile> m_file;
+        SnapshotHeader m_header;
+        uint64_t m_words_per_label;
+        const uint64_t* m_forward_offsets;
+        const uint64_t* m_forward_neighbours;
+        const uint64_t* m_reverse_offsets;
+        const uint64_t* m_reverse_neighbours;
+        const uint64_t* m_label_words;
+        std::vector<std::string> m_label_names;
+    };
+
+    SnapshotView MapSnapshot(const std::string& path, bool verifyChecksum)
+    {
+        if ((sizeof(size_t) != sizeof(uint64_t)) || (sizeof(VertexId) != sizeof(uint64_t)))
+        {
+            throw std::runtime_error("Snapshot files can only be mapped by 64-bit builds");
+        }
+
+        std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(path);
+        if (file->size() < sizeof(SnapshotHeader))
+        {
+            throw std::runtime_error(path + " is not a snapshot file");
+        }
+
+        SnapshotHeader header;
+        std::memcpy(&header, file->data(), sizeof(header));
+        if ((header.m_magic != SnapshotMagic) || (header.m_header_size != sizeof(SnapshotHeader)))
+        {
+            throw std::runtime_error(path + " is not a snapshot file");
+        }
+        if (header.m_format_version != SnapshotFormatVersion)
+        {
+            throw std::runtime_error(path + " has an unsupported snapshot format version");
+        }
+
+        // Every count is bounded by the size of the file before being multiplied so that a damaged header can't make
+        // the expected size wrap around.
+        const uint64_t file_words = file->size() / 8;
+        const uint64_t vertex_count = header.m_vertex_count;
+        const uint64_t edge_count = header.m_edge_count;
+        const uint64_t words_per_label = (vertex_count / 64) + 1;
+        if ((vertex_count >= file_words) || (edge_count >= file_words) || (header.m_label_count >= file_words) ||
+            (header.m_names_size >= file->size()) || ((header.m_names_size % 8) != 0) ||
+            ((header.m_label_count > 0) && (words_per_label > (file_words / header.m_label_count))))
+        {
+            throw std::runtime_error(path + " is damaged");
+        }
+        const uint64_t payload_words = (2 * (vertex_count + 1 + edge_count)) +
+            (header.m_label_count * words_per_label) + (header.m_names_size / 8);
+        if (file->size() != sizeof(SnapshotHeader) + (payload_words * 8))
+        {
+            throw std::runtime_error(path + " is damaged");
+        }
+
+        const uint64_t* payload = reinterpret_cast<const uint64_t*>(file->data() + sizeof(SnapshotHeader));
+        const uint64_t* forward_offsets = payload;
+        const uint64_t* forward_neighbours = forward_offsets + vertex_count + 1;
+        const uint64_t* reverse_offsets = forward_neighbours + edge_count;
+        const uint64_t* reverse_neighbours = reverse_offsets + vertex_count + 1;
+        const uint64_t* label_words = reverse_neighbours + edge_count;
+        const char* names = reinterpret_cast<const char*>(label_words + (header.m_label_count * words_per_label));
+
+        if ((forward_offsets[vertex_count] != edge_count) || (reverse_offsets[vertex_count] != edge_count))
+        {
+            throw std::runtime_error(path + " is damaged");
+        }
+        if (verifyChecksum)
+        {
+            Checksum checksum;
+            checksum.add(payload, payload_words);
+            if ((checksum.value() != header.m_checksum) ||
+                !IsConsistent(forward_offsets, forward_neighbours, vertex_count, edge_count) ||
+                !IsConsistent(reverse_offsets, reverse_neighbours, vertex_count, edge_count))
+            {
+                throw std::runtime_error(path + " is damaged");
+            }
+        }
+
+        std::vector<std::string> label_names;
+        size_t position = 0;
+        for (uint64_t i = 0; i < header.m_label_count; ++i)
+        {
+            uint32_t length;
+            if (position + sizeof(length) > header.m_names_size)
+            {
+                throw std::runtime_error(path + " is damaged");
+            }
+            std::memcpy(&length, names + position, sizeof(length));
+            position += sizeof(length);
+            if (position + length > header.m_names_size)
+            {
+                throw std::runtime_error(path + " is damaged");
+            }
+            label_names.emplace_back(names + position, length);
+            position += length;
+        }
+
+        SnapshotView view;
+        view.m_file = file;
+        view.m_header = header;
+        view.m_words_per_label = words_per_label;
+        view.m_forward_offsets = forward_offsets;
+        view.m_forward_neighbours = forward_neighbours;
+        view.m_reverse_offsets = reverse_offsets;
+        view.m_reverse_neighbours = reverse_neighbours;
+        view.m_label_words = label_words;
+        view.m_label_names = std::move(label_names);
+        return view;
+    }
+}
+
+void SaveSnapshot(const std::string& path, const CsrAdjacency& forward, const CsrAdjacency& reverse,
+    const LabelIndex& labels, uint64_t sequence)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot create " + path);
+    }
+
+    const size_t vertex_count = forward.vertexCount();
+    const size_t words_per_label = (vertex_count / 64) + 1;
+
+    std::string names;
+    for (LabelId id = 0; id < labels.labelCount(); ++id)
+    {
+        const std::string& name = labels.name(id);
+        const uint32_t length = static_cast<uint32_t>(name.size());
+        names.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        names.append(name);
+    }
+    names.resize(((names.size() + 7) / 8) * 8, '\0');
+
+    // The header is written again at the end once the checksum is known.
+    SnapshotHeader header = {};
+    header.m_magic = SnapshotMagic;
+    header.m_format_version = SnapshotFormatVersion;
+    header.m_header_size = sizeof(SnapshotHeader);
+    header.m_vertex_count = vertex_count;
+    header.m_edge_count = forward.edgeCount();
+    header.m_label_count = labels.labelCount();
+    header.m_names_size = names.size();
+    header.m_sequence = sequence;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    SnapshotWriter writer(file);
+    WriteAdjacency(writer, forward);
+    WriteAdjacency(writer, reverse);
+
+    std::vector<uint64_t> words(words_per_label);
+    for (LabelId id = 0; id < labels.labelCount(); ++id)
+    {
+        labels.vertices(id).copyTo(words);
+        writer.write(words.data(), words.size());
+    }
+
+    std::vector<uint64_t> name_words(names.size() / 8);
+    if (!names.empty())
+    {
+        std::memcpy(name_words.data(), names.data(), names.size());
+    }
+    writer.write(name_words.data(), name_words.size());
+
+    header.m_checksum = writer.checksum();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.flush();
+    if (!file)
+    {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+std::unique_ptr<const GraphVersion> OpenSnapshot(const std::string& path, bool verifyChecksum)
+{
+    SnapshotView view = MapSnapshot(path, verifyChecksum);
+    const size_t vertex_count = static_cast<size_t>(view.m_header.m_vertex_count);
+    auto forward = std::make_shared<CsrAdjacency>(vertex_count, reinterpret_cast<const size_t*>(view.m_forward_offsets),
+        reinterpret_cast<const VertexId*>(view.m_forward_neighbours), view.m_file);
+    auto reverse = std::make_shared<CsrAdjacency>(vertex_count, reinterpret_cast<const size_t*>(view.m_reverse_offsets),
+        reinterpret_cast<const VertexId*>(view.m_reverse_neighbours), view.m_file);
+    auto labels = std::make_shared<MappedLabelIndex>(std::move(view.m_label_names), view.m_label_words,
+        static_cast<size_t>(view.m_words_per_label), view.m_file);
+    return std::unique_ptr<const GraphVersion>(new GraphVersion(forward, reverse, labels));
+}
+
+void LoadSnapshot(const std::string& path, GraphStore& graph, uint64_t* sequence)
+{
+    // The copy is only as good as the file so it is always verified.
+    const SnapshotView view = MapSnapshot(path, true);
+    const uint64_t vertex_count = view.m_header.m_vertex_count;
+
+    const VertexId first = graph.createVertices(static_cast<size_t>(vertex_count)) - 1;
+    std::vector<std::pair<VertexId, VertexId>> edges;
+    edges.reserve(static_cast<size_t>(view.m_header.m_edge_count));
+    for (uint64_t i = 0; i < vertex_count; ++i)
+    {
+        for (uint64_t j = view.m_forward_offsets[i]; j < view.m_forward_offsets[i + 1]; ++j)
+        {
+            edges.emplace_back(first + i + 1, first + view.m_forward_neighbours[j]);
+        }
+    }
+    graph.createEdges(edges, nullptr);
+
+    std::vector<VertexId> vertices;
+    for (size_t label = 0; label < view.m_label_names.size(); ++label)
+    {
+        const uint64_t* words = view.m_label_words + (label * view.m_words_per_label);
+        vertices.clear();
+        for (uint64_t i = 0; i < view.m_words_per_label; ++i)
+        {
+            for (uint64_t word = words[i]; word != 0; word &= word - 1)
+            {
+                const uint64_t vertex = (i * 64) + CountTrailingZeros(word);
+                if ((vertex == 0) || (vertex > vertex_count))
+                {
+                    throw std::runtime_error(path + " is damaged");
+                }
+                vertices.push_back(first + vertex);
+            }
+        }
+        graph.addLabelToVertices(view.m_label_names[label], vertices);
+    }
+
+    if (sequence != nullptr)
+    {
+        *sequence = view.m_header.m_sequence;
+    }
+}
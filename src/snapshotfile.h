@@ -0,0 +1,41 @@
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+
+#include "csradjacency.h"
+#include "graphversion.h"
+#include "labelindex.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Binary snapshot files of a graph.
+// The file starts with a 64 byte header followed by sections of 64-bit little-endian words, laid out so that a mapped
+// file can be searched in place:
+// - the vertexCount + 1 offsets and the edgeCount neighbours of the forward CSR adjacency,
+// - the same two arrays for the reverse adjacency,
+// - for each label, a bitset of vertexCount / 64 + 1 words with bit i set if vertex i has the label,
+// - the label names, each as a 32-bit length followed by the characters, padded to a whole number of words.
+// The header holds a checksum of everything after it and a sequence number chosen by the writer.
+
+class GraphStore;
+
+/// Write a snapshot file.
+/// @param sequence A number stored in the header, see LoadSnapshot.
+/// @throws std::runtime_error if the file can't be written.
+void SaveSnapshot(const std::string& path, const CsrAdjacency& forward, const CsrAdjacency& reverse,
+    const LabelIndex& labels, uint64_t sequence);
+
+/// Map a snapshot file and return a version of the graph that reads the adjacency and the label bitsets straight
+/// from the mapped pages. Only the label dictionary is loaded in memory.
+/// @param verifyChecksum If true, read the whole file to check its checksum and the consistency of the adjacency
+/// before returning. Otherwise only the header is checked and pages are loaded on demand by the searches.
+/// @throws std::runtime_error if the file can't be mapped, is not a snapshot file or fails verification.
+std::unique_ptr<const GraphVersion> OpenSnapshot(const std::string& path, bool verifyChecksum);
+
+/// Read a snapshot file back into a mutable graph. The file is always verified. The vertices of the file are appended
+/// to the graph, so vertex IDs are the same as in the file when the graph is empty.
+/// @param sequence Receives the sequence number the file was saved with, unless it is nullptr.
+/// @throws std::runtime_error if the file can't be mapped, is not a snapshot file or fails verification.
+void LoadSnapshot(const std::string& path, GraphStore& graph, uint64_t* sequence);
+
+#endif
@@ -0,0 +1,149 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::thread::hardware_concurrency();
+        if (workerCount == 0)
+        {
+            workerCount = 1;
+        }
+    }
+
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(new Worker());
+    }
+    // The threads are started once all the workers exist since any of them may steal from the others.
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        m_workers[i]->m_thread = std::thread(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker->m_thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (grainSize == 0)
+    {
+        grainSize = 1;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+
+    const size_t chunk_count = (count + grainSize - 1) / grainSize;
+    m_body = &body;
+    m_error = nullptr;
+    m_remaining = chunk_count;
+
+    // Each worker gets a contiguous run of chunks. Stealing evens things out if some chunks turn out to be slower.
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+    {
+        Worker& worker = *m_workers[(chunk_index * m_workers.size()) / chunk_count];
+        const size_t begin = chunk_index * grainSize;
+        const size_t end = (begin + grainSize < count) ? (begin + grainSize) : count;
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+        worker.m_chunks.push_back(Chunk{begin, end});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued += chunk_count;
+    }
+    m_wake.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_remaining == 0; });
+    }
+
+    m_body = nullptr;
+    if (m_error)
+    {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void ThreadPool::run(size_t workerIndex)
+{
+    while (true)
+    {
+        Chunk chunk;
+        if (takeChunk(workerIndex, chunk))
+        {
+            try
+            {
+                (*m_body)(chunk.m_begin, chunk.m_end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_error)
+                {
+                    m_error = std::current_exception();
+                }
+            }
+
+            if (--m_remaining == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this] { return m_stopping || (m_queued > 0); });
+        if (m_stopping && (m_queued == 0))
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::takeChunk(size_t workerIndex, Chunk& chunk)
+{
+    {
+        Worker& own = *m_workers[workerIndex];
+        std::lock_guard<std::mutex> lock(own.m_mutex);
+        if (!own.m_chunks.empty())
+        {
+            chunk = own.m_chunks.front();
+            own.m_chunks.pop_front();
+            --m_queued;
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < m_workers.size(); ++offset)
+    {
+        Worker& victim = *m_workers[(workerIndex + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_chunks.empty())
+        {
+            chunk = victim.m_chunks.back();
+            victim.m_chunks.pop_back();
+            --m_queued;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A fixed set of worker threads that run loops split in chunks.
+/// Each worker has its own queue of chunks. A worker takes chunks from the front of its own queue and, once it is
+/// empty, steals chunks from the back of the queues of the other workers, so that a worker that got the slow chunks
+/// doesn't hold up the whole loop.
+class ThreadPool
+{
+public:
+    /// Start the worker threads.
+    /// @param workerCount The number of worker threads, or 0 for one per hardware thread.
+    explicit ThreadPool(size_t workerCount);
+
+    /// Stop and join the worker threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Returns the number of worker threads.
+    size_t workerCount() const { return m_workers.size(); }
+
+    /// Run body(begin, end) over chunks of at most grainSize indices covering [0, count), on the worker threads, and
+    /// wait for all of them to finish. Only one loop runs at a time; concurrent calls are serialized.
+    /// @throws The first exception thrown by body, once all the chunks have run.
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct Chunk
+    {
+        size_t m_begin;
+        size_t m_end;
+    };
+
+    struct Worker
+    {
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::deque<Chunk> m_chunks;
+    };
+
+    void run(size_t workerIndex);
+    bool takeChunk(size_t workerIndex, Chunk& chunk);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Serializes the calls to parallelFor.
+    std::mutex m_submit_mutex;
+    // Protects the wake-up and completion conditions below.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_stopping = false;
+    // Number of chunks waiting in the queues, and number of chunks of the current loop not finished yet.
+    std::atomic<size_t> m_queued{0};
+    std::atomic<size_t> m_remaining{0};
+
+    const std::function<void(size_t, size_t)>* m_body = nullptr;
+    std::exception_ptr m_error;
+};
+
+#endif
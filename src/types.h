@@ -0,0 +1,17 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The ID of a vertex in the graph.
+// This is a positive integer. 0 represents an invalid vertex.
+typedef size_t VertexId;
+
+// The ID of a label, as given out by LabelIndex. Label IDs are small integers starting at 0.
+typedef uint32_t LabelId;
+
+// The weight of an edge: a finite number, 0 or more. Edges created without a weight weigh 1.
+typedef float EdgeWeight;
+
+#endif
@@ -0,0 +1,143 @@
+#include "vertexbitmap.h"
+#include <algorithm>
+
+bool VertexBitmap::Chunk::containsSparse(uint16_t low) const
+{
+    return std::binary_search(m_sparse.begin(), m_sparse.end(), low);
+}
+
+bool VertexBitmap::insert(VertexId vertex)
+{
+    const size_t chunk_index = vertex >> ChunkBits;
+    if (chunk_index >= m_chunks.size())
+    {
+        m_chunks.resize(chunk_index + 1);
+    }
+    Chunk& chunk = m_chunks[chunk_index];
+    const uint16_t low = static_cast<uint16_t>(vertex & ChunkMask);
+
+    if (!chunk.m_bits.empty())
+    {
+        uint64_t& word = chunk.m_bits[low >> 6];
+        const uint64_t bit = uint64_t(1) << (low & 63);
+        if (word & bit)
+        {
+            return false;
+        }
+        word |= bit;
+    }
+    else
+    {
+        auto position = std::lower_bound(chunk.m_sparse.begin(), chunk.m_sparse.end(), low);
+        if ((position != chunk.m_sparse.end()) && (*position == low))
+        {
+            return false;
+        }
+        chunk.m_sparse.insert(position, low);
+
+        if (chunk.m_sparse.size() > DenseThreshold)
+        {
+            chunk.m_bits.assign((ChunkMask + 1) / 64, 0);
+            for (uint16_t sparse_low : chunk.m_sparse)
+            {
+                chunk.m_bits[sparse_low >> 6] |= uint64_t(1) << (sparse_low & 63);
+            }
+            std::vector<uint16_t>().swap(chunk.m_sparse);
+        }
+    }
+
+    ++chunk.m_count;
+    ++m_size;
+    return true;
+}
+
+bool VertexBitmap::erase(VertexId vertex)
+{
+    const size_t chunk_index = vertex >> ChunkBits;
+    if (chunk_index >= m_chunks.size())
+    {
+        return false;
+    }
+    Chunk& chunk = m_chunks[chunk_index];
+    const uint16_t low = static_cast<uint16_t>(vertex & ChunkMask);
+
+    if (!chunk.m_bits.empty())
+    {
+        uint64_t& word = chunk.m_bits[low >> 6];
+        const uint64_t bit = uint64_t(1) << (low & 63);
+        if ((word & bit) == 0)
+        {
+            return false;
+        }
+        word &= ~bit;
+
+        // Go back to the sorted array well below the threshold so that a vertex going in and out of the set doesn't
+        // convert the chunk back and forth.
+        if ((chunk.m_count - 1) < (DenseThreshold / 2))
+        {
+            chunk.m_sparse.reserve(chunk.m_count - 1);
+            for (size_t word_index = 0; word_index < chunk.m_bits.size(); ++word_index)
+            {
+                for (uint64_t bits = chunk.m_bits[word_index]; bits != 0; bits &= (bits - 1))
+                {
+                    chunk.m_sparse.push_back(static_cast<uint16_t>((word_index << 6) + CountTrailingZeros(bits)));
+                }
+            }
+            std::vector<uint64_t>().swap(chunk.m_bits);
+        }
+    }
+    else
+    {
+        auto position = std::lower_bound(chunk.m_sparse.begin(), chunk.m_sparse.end(), low);
+        if ((position == chunk.m_sparse.end()) || (*position != low))
+        {
+            return false;
+        }
+        chunk.m_sparse.erase(position);
+    }
+
+    --chunk.m_count;
+    --m_size;
+    return true;
+}
+
+void VertexBitmap::copyTo(std::vector<uint64_t>& words) const
+{
+    std::fill(words.begin(), words.end(), 0);
+
+    const size_t chunk_words = (ChunkMask + 1) / 64;
+    for (size_t chunk_index = 0; chunk_index < m_chunks.size(); ++chunk_index)
+    {
+        const Chunk& chunk = m_chunks[chunk_index];
+        const size_t first_word = chunk_index * chunk_words;
+        if (first_word >= words.size())
+        {
+            break;
+        }
+
+        if (!chunk.m_bits.empty())
+        {
+            const size_t count = std::min(chunk_words, words.size() - first_word);
+            std::copy(chunk.m_bits.begin(), chunk.m_bits.begin() + count, words.begin() + first_word);
+            continue;
+        }
+        for (uint16_t low : chunk.m_sparse)
+        {
+            const size_t word_index = first_word + (low >> 6);
+            if (word_index < words.size())
+            {
+                words[word_index] |= uint64_t(1) << (low & 63);
+            }
+        }
+    }
+}
+
+size_t VertexBitmap::memoryUsage() const
+{
+    size_t usage = m_chunks.capacity() * sizeof(Chunk);
+    for (const Chunk& chunk : m_chunks)
+    {
+        usage += (chunk.m_sparse.capacity() * sizeof(uint16_t)) + (chunk.m_bits.capacity() * sizeof(uint64_t));
+    }
+    return usage;
+}
@@ -0,0 +1,102 @@
+#ifndef VERTEXBITMAP_H
+#define VERTEXBITMAP_H
+
+#include "bits.h"
+#include "types.h"
+#include <cstdint>
+#include <vector>
+
+/// A set of vertices stored as a compressed bitmap.
+/// The ID space is split in chunks of 65536 vertices, in the spirit of roaring bitmaps. A chunk with few vertices is
+/// stored as a sorted array of 16 bit offsets while a chunk with many vertices is stored as a plain bitset. Checking
+/// whether a vertex of a dense chunk is in the set is a single bit test.
+class VertexBitmap
+{
+public:
+    /// Returns true if the vertex is in the set.
+    bool contains(VertexId vertex) const
+    {
+        const size_t chunk_index = vertex >> ChunkBits;
+        if (chunk_index >= m_chunks.size())
+        {
+            return false;
+        }
+        const Chunk& chunk = m_chunks[chunk_index];
+        const uint16_t low = static_cast<uint16_t>(vertex & ChunkMask);
+        if (!chunk.m_bits.empty())
+        {
+            return (chunk.m_bits[low >> 6] >> (low & 63)) & 1;
+        }
+        return chunk.containsSparse(low);
+    }
+
+    /// Add a vertex to the set.
+    /// @returns true if the vertex was not already in the set.
+    bool insert(VertexId vertex);
+
+    /// Remove a vertex from the set.
+    /// @returns true if the vertex was in the set.
+    bool erase(VertexId vertex);
+
+    /// Returns the number of vertices in the set.
+    size_t size() const { return m_size; }
+
+    /// Returns true if the set is empty.
+    bool empty() const { return m_size == 0; }
+
+    /// Write the set as a plain bitset, bit i of words[i / 64] being set if vertex i is in the set. Vertices that don't
+    /// fit in words are ignored.
+    void copyTo(std::vector<uint64_t>& words) const;
+
+    /// Returns the number of bytes used to store the set.
+    size_t memoryUsage() const;
+
+    /// Call a function on every vertex of the set, in increasing ID order.
+    template <typename Function>
+    void forEach(Function function) const
+    {
+        for (size_t chunk_index = 0; chunk_index < m_chunks.size(); ++chunk_index)
+        {
+            const VertexId base = static_cast<VertexId>(chunk_index) << ChunkBits;
+            const Chunk& chunk = m_chunks[chunk_index];
+            if (chunk.m_bits.empty())
+            {
+                for (uint16_t low : chunk.m_sparse)
+                {
+                    function(base + low);
+                }
+                continue;
+            }
+            for (size_t word_index = 0; word_index < chunk.m_bits.size(); ++word_index)
+            {
+                for (uint64_t word = chunk.m_bits[word_index]; word != 0; word &= (word - 1))
+                {
+                    function(base + (word_index << 6) + CountTrailingZeros(word));
+                }
+            }
+        }
+    }
+
+private:
+    static const unsigned ChunkBits = 16;
+    static const VertexId ChunkMask = (VertexId(1) << ChunkBits) - 1;
+    // A chunk switches from the sorted array to the bitset when the array would take more memory than the bitset.
+    static const size_t DenseThreshold = ((VertexId(1) << ChunkBits) / 16);
+
+    struct Chunk
+    {
+        bool containsSparse(uint16_t low) const;
+
+        // Number of vertices in the chunk.
+        size_t m_count = 0;
+        // Sorted offsets of the vertices in the chunk. Only used while m_bits is empty.
+        std::vector<uint16_t> m_sparse;
+        // One bit per vertex of the chunk. Empty while the chunk is sparse.
+        std::vector<uint64_t> m_bits;
+    };
+
+    std::vector<Chunk> m_chunks;
+    size_t m_size = 0;
+};
+
+#endif
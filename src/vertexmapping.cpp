@@ -0,0 +1,73 @@
+#include "vertexmapping.h"
+#include <utility>
+
+void VertexMapping::toExternal(std::vector<VertexId>& path) const
+{
+    if (empty())
+    {
+        return;
+    }
+    for (VertexId& vertex : path)
+    {
+        vertex = external(vertex);
+    }
+}
+
+void VertexMapping::renumber(const std::vector<VertexId>& newIds)
+{
+    if (empty())
+    {
+        m_internal = newIds;
+    }
+    else
+    {
+        for (VertexId& internal : m_internal)
+        {
+            internal = newIds[internal - 1];
+        }
+    }
+    m_external.resize(m_internal.size());
+    for (size_t i = 0; i < m_internal.size(); ++i)
+    {
+        m_external[m_internal[i] - 1] = static_cast<VertexId>(i + 1);
+    }
+}
+
+void VertexMapping::assign(VertexId external, VertexId internal)
+{
+    m_internal[external - 1] = internal;
+    m_external[internal - 1] = external;
+}
+
+void VertexMapping::swapInternal(VertexId a, VertexId b)
+{
+    std::swap(m_external[a - 1], m_external[b - 1]);
+    m_internal[m_external[a - 1] - 1] = a;
+    m_internal[m_external[b - 1] - 1] = b;
+}
+
+void VertexMapping::resize(size_t vertexCount)
+{
+    if (empty())
+    {
+        return;
+    }
+    const size_t previous_count = m_internal.size();
+    m_internal.resize(vertexCount);
+    m_external.resize(vertexCount);
+    for (size_t i = previous_count; i < vertexCount; ++i)
+    {
+        m_internal[i] = static_cast<VertexId>(i + 1);
+        m_external[i] = static_cast<VertexId>(i + 1);
+    }
+    if ((vertexCount * 2) < m_internal.capacity())
+    {
+        m_internal.shrink_to_fit();
+        m_external.shrink_to_fit();
+    }
+}
+
+size_t VertexMapping::memoryUsage() const
+{
+    return (m_internal.capacity() + m_external.capacity()) * sizeof(VertexId);
+}
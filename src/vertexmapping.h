@@ -0,0 +1,55 @@
+#ifndef VERTEXMAPPING_H
+#define VERTEXMAPPING_H
+
+#include "types.h"
+#include <vector>
+
+/// The permutation between the vertex IDs callers use, the external IDs, and the IDs a graph stores its vertices
+/// under, the internal IDs. A graph only has one once it has been reordered, see GraphStore::reorder; until then the
+/// mapping is empty and every ID maps to itself, for free.
+class VertexMapping
+{
+public:
+    /// Returns true if every ID maps to itself.
+    bool empty() const { return m_internal.empty(); }
+
+    /// Returns the internal ID of an external ID. The IDs past the end of the mapping map to themselves, so an ID that
+    /// doesn't exist still doesn't exist once mapped.
+    VertexId internal(VertexId external) const
+    {
+        return ((external - 1) < m_internal.size()) ? m_internal[external - 1] : external;
+    }
+
+    /// Returns the external ID of an internal ID. The IDs past the end of the mapping map to themselves.
+    VertexId external(VertexId internal) const
+    {
+        return ((internal - 1) < m_external.size()) ? m_external[internal - 1] : internal;
+    }
+
+    /// Replace the internal IDs of a path by the external ones.
+    void toExternal(std::vector<VertexId>& path) const;
+
+    /// Renumber the internal IDs: the vertex of internal ID id gets internal ID newIds[id - 1]. An empty mapping
+    /// becomes newIds itself. The external IDs don't change.
+    void renumber(const std::vector<VertexId>& newIds);
+
+    /// Give the vertex of internal ID internal the external ID external. The vertex that had this external ID and the
+    /// ID the vertex had are left for the caller to map again.
+    void assign(VertexId external, VertexId internal);
+
+    /// Swap the external IDs of two internal IDs.
+    void swapInternal(VertexId a, VertexId b);
+
+    /// Set the number of vertices of a mapping that is not empty. New vertices map to themselves.
+    void resize(size_t vertexCount);
+
+    /// Returns the number of bytes used by the mapping.
+    size_t memoryUsage() const;
+
+private:
+    // The internal ID of external ID id at position id - 1, and the other way around.
+    std::vector<VertexId> m_internal;
+    std::vector<VertexId> m_external;
+};
+
+#endif
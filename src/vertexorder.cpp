@@ -0,0 +1,80 @@
+#include "vertexorder.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    // Appends to order the vertices of the component of start in breadth-first order, order itself being the queue.
+    // With byDegree, the unvisited neighbours of each vertex are taken by increasing degree rather than by ID.
+    void VisitComponent(VertexId start, const AdjacencySets& adjacency, const AdjacencySets& reverse,
+        const std::vector<size_t>& degrees, bool byDegree, std::vector<bool>& visited, std::vector<VertexId>& order)
+    {
+        size_t head = order.size();
+        visited[start - 1] = true;
+        order.push_back(start);
+        std::vector<VertexId> neighbours;
+        while (head < order.size())
+        {
+            const VertexId vertex = order[head++];
+            neighbours.clear();
+            for (const AdjacencySets* sets : { &adjacency, &reverse })
+            {
+                for (VertexId neighbour : (*sets)[vertex - 1])
+                {
+                    if (!visited[neighbour - 1])
+                    {
+                        visited[neighbour - 1] = true;
+                        neighbours.push_back(neighbour);
+                    }
+                }
+            }
+            if (byDegree)
+            {
+                std::sort(neighbours.begin(), neighbours.end(), [&](VertexId a, VertexId b)
+                {
+                    return (degrees[a - 1] != degrees[b - 1]) ? (degrees[a - 1] < degrees[b - 1]) : (a < b);
+                });
+            }
+            order.insert(order.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+}
+
+std::vector<VertexId> OrderVertices(const AdjacencySets& adjacency, const AdjacencySets& reverse, VertexOrder order)
+{
+    const size_t vertex_count = adjacency.size();
+    std::vector<size_t> degrees(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        degrees[i] = adjacency[i].size() + reverse[i].size();
+    }
+
+    // Every order starts from the vertices sorted by degree, highest first except for Cuthill-McKee.
+    std::vector<VertexId> by_degree(vertex_count);
+    std::iota(by_degree.begin(), by_degree.end(), VertexId(1));
+    const bool increasing = (order == VertexOrder::ReverseCuthillMcKee);
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](VertexId a, VertexId b)
+    {
+        return increasing ? (degrees[a - 1] < degrees[b - 1]) : (degrees[a - 1] > degrees[b - 1]);
+    });
+    if (order == VertexOrder::Degree)
+    {
+        return by_degree;
+    }
+
+    std::vector<VertexId> result;
+    result.reserve(vertex_count);
+    std::vector<bool> visited(vertex_count, false);
+    for (VertexId start : by_degree)
+    {
+        if (!visited[start - 1])
+        {
+            VisitComponent(start, adjacency, reverse, degrees, increasing, visited, result);
+        }
+    }
+    if (order == VertexOrder::ReverseCuthillMcKee)
+    {
+        std::reverse(result.begin(), result.end());
+    }
+    return result;
+}
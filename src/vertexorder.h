@@ -0,0 +1,30 @@
+#ifndef VERTEXORDER_H
+#define VERTEXORDER_H
+
+#include "nodepool.h"
+#include "types.h"
+#include <vector>
+
+/// The orders GraphStore::reorder can give the vertices. They all look at the edges as undirected and aim at putting
+/// vertices that are searched one after the other next to each other in memory, so that a traversal touches fewer
+/// cache lines of the adjacency, the visited marks and the label bitmaps.
+enum class VertexOrder
+{
+    /// Breadth-first order, one connected component after the other, starting each from its vertex of highest
+    /// degree. A BFS from anywhere then finds the neighbours of a vertex close to each other.
+    Bfs,
+    /// Reverse Cuthill-McKee: breadth-first from a vertex of lowest degree, neighbours taken by increasing degree, and
+    /// the whole order reversed. It minimizes the bandwidth of the adjacency matrix, which suits meshes and road-like
+    /// graphs.
+    ReverseCuthillMcKee,
+    /// Decreasing degree. The hubs, which most paths go through on skewed graphs, end up in the same few cache lines.
+    Degree
+};
+
+/// Returns the vertices of a graph in the given order.
+/// @param adjacency The out-neighbours of vertex id at position id - 1.
+/// @param reverse The in-neighbours of vertex id at position id - 1.
+/// @returns The IDs of all the vertices, each once: the vertex that should get ID i is at position i - 1.
+std::vector<VertexId> OrderVertices(const AdjacencySets& adjacency, const AdjacencySets& reverse, VertexOrder order);
+
+#endif
@@ -0,0 +1,607 @@
+#include "writeaheadlog.h"
+#include "graphstore.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // "GRAPHWAL" read as a little-endian word.
+    const uint64_t LogMagic = 0x4C41574850415247ull;
+    // The magic and the generation.
+    const size_t LogHeaderSize = 16;
+
+    enum RecordType : uint8_t
+    {
+        CreateVerticesRecord = 1,
+        CreateEdgeRecord = 2,
+        DefineLabelRecord = 3,
+        AddLabelRecord = 4,
+        RemoveLabelRecord = 5
+    };
+
+    // 32-bit FNV-1a. Like the snapshot checksum, it is meant to catch torn and damaged records, not tampering.
+    uint32_t RecordChecksum(const uint8_t* data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Reads the fields of the records being replayed. Every read fails instead of going past the end, which is how a
+    // record cut short by a crash is detected.
+    class RecordReader
+    {
+    public:
+        RecordReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {};
+
+        size_t position() const { return m_position; }
+        bool atEnd() const { return m_position == m_size; }
+
+        bool readByte(uint8_t& value)
+        {
+            if (m_position == m_size)
+            {
+                return false;
+            }
+            value = m_data[m_position++];
+            return true;
+        }
+
+        bool readVarint(uint64_t& value)
+        {
+            value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t byte;
+                if (!readByte(byte))
+                {
+                    return false;
+                }
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool readBytes(size_t count, const uint8_t*& bytes)
+        {
+            if (count > m_size - m_position)
+            {
+                return false;
+            }
+            bytes = m_data + m_position;
+            m_position += count;
+            return true;
+        }
+
+        // Reads the checksum that ends a record and compares it to the bytes from the start of the record.
+        bool readChecksum(size_t recordStart)
+        {
+            const uint32_t expected = RecordChecksum(m_data + recordStart, m_position - recordStart);
+            const uint8_t* bytes;
+            if (!readBytes(4, bytes))
+            {
+                return false;
+            }
+            const uint32_t checksum = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+                (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+            return checksum == expected;
+        }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_position = 0;
+    };
+
+#ifdef _WIN32
+    int OpenFile(const std::string& path)
+    {
+        int file = -1;
+        _sopen_s(&file, path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+        return file;
+    }
+
+    bool SeekTo(int file, uint64_t position)
+    {
+        return _lseeki64(file, static_cast<__int64>(position), SEEK_SET) >= 0;
+    }
+
+    int64_t FileSize(int file)
+    {
+        return _lseeki64(file, 0, SEEK_END);
+    }
+
+    int ReadSome(int file, void* data, size_t size)
+    {
+        return _read(file, data, static_cast<unsigned>((size < 0x40000000) ? size : 0x40000000));
+    }
+
+    int WriteSome(int file, const void* data, size_t size)
+    {
+        return _write(file, data, static_cast<unsigned>((size < 0x40000000) ? size : 0x40000000));
+    }
+
+    bool Sync(int file)
+    {
+        return _commit(file) == 0;
+    }
+
+    bool Truncate(int file, uint64_t size)
+    {
+        return _chsize_s(file, static_cast<__int64>(size)) == 0;
+    }
+
+    void CloseFile(int file)
+    {
+        _close(file);
+    }
+#else
+    int OpenFile(const std::string& path)
+    {
+        return ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+
+    bool SeekTo(int file, uint64_t position)
+    {
+        return lseek(file, static_cast<off_t>(position), SEEK_SET) >= 0;
+    }
+
+    int64_t FileSize(int file)
+    {
+        return lseek(file, 0, SEEK_END);
+    }
+
+    ssize_t ReadSome(int file, void* data, size_t size)
+    {
+        return ::read(file, data, size);
+    }
+
+    ssize_t WriteSome(int file, const void* data, size_t size)
+    {
+        return ::write(file, data, size);
+    }
+
+    bool Sync(int file)
+    {
+        return fsync(file) == 0;
+    }
+
+    bool Truncate(int file, uint64_t size)
+    {
+        return ftruncate(file, static_cast<off_t>(size)) == 0;
+    }
+
+    void CloseFile(int file)
+    {
+        ::close(file);
+    }
+#endif
+
+    bool ReadAll(int file, uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const auto count = ReadSome(file, data, size);
+            if (count <= 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    bool WriteAll(int file, const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const auto count = WriteSome(file, data, size);
+            if (count <= 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+}
+
+void SyncFile(const std::string& path)
+{
+    const int file = OpenFile(path);
+    if (file < 0)
+    {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    const bool synced = Sync(file);
+    CloseFile(file);
+    if (!synced)
+    {
+        throw std::runtime_error("Cannot sync " + path);
+    }
+}
+
+void SyncDirectory(const std::string& path)
+{
+#ifndef _WIN32
+    const size_t separator = path.find_last_of('/');
+    const std::string directory = (separator == std::string::npos) ? "." :
+        (separator == 0) ? "/" : path.substr(0, separator);
+    const int file = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (file < 0)
+    {
+        throw std::runtime_error("Cannot open " + directory);
+    }
+    const bool synced = Sync(file);
+    CloseFile(file);
+    if (!synced)
+    {
+        throw std::runtime_error("Cannot sync " + directory);
+    }
+#else
+    (void)path;
+#endif
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path, uint64_t generation, const WalOptions& options)
+    : m_path(path), m_options(options), m_generation(generation)
+{
+    m_file = OpenFile(path);
+    if (m_file < 0)
+    {
+        throw std::runtime_error("Cannot open " + path);
+    }
+
+    const int64_t size = FileSize(m_file);
+    if (size < 0)
+    {
+        CloseFile(m_file);
+        throw std::runtime_error("Cannot read the size of " + path);
+    }
+    if (static_cast<uint64_t>(size) < LogHeaderSize)
+    {
+        // A new file, or one whose header was being written when the process stopped. Either way it has no record.
+        try
+        {
+            reset(generation);
+        }
+        catch (...)
+        {
+            CloseFile(m_file);
+            throw;
+        }
+        return;
+    }
+
+    uint64_t header[2];
+    if (!SeekTo(m_file, 0) || !ReadAll(m_file, reinterpret_cast<uint8_t*>(header), sizeof(header)))
+    {
+        CloseFile(m_file);
+        throw std::runtime_error("Cannot read " + path);
+    }
+    if (header[0] != LogMagic)
+    {
+        CloseFile(m_file);
+        throw std::runtime_error(path + " is not a log file");
+    }
+    m_generation = header[1];
+    m_size = static_cast<uint64_t>(size);
+    m_needs_replay = (m_size > LogHeaderSize);
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    if (m_flusher.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeup.notify_one();
+        m_flusher.join();
+    }
+    try
+    {
+        commit();
+    }
+    catch (...)
+    {
+    }
+    CloseFile(m_file);
+}
+
+size_t WriteAheadLog::replay(GraphStore& graph)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_needs_replay)
+    {
+        return 0;
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(m_size - LogHeaderSize));
+    if (!SeekTo(m_file, LogHeaderSize) || !ReadAll(m_file, data.data(), data.size()))
+    {
+        throw std::runtime_error("Cannot read " + m_path);
+    }
+
+    std::vector<std::string> labels;
+    RecordReader reader(data.data(), data.size());
+    size_t valid_size = 0;
+    size_t record_count = 0;
+    try
+    {
+        while (!reader.atEnd())
+        {
+            // Each record is decoded and checked in full before it is applied.
+            const size_t start = reader.position();
+            uint8_t type;
+            uint64_t first = 0;
+            uint64_t second = 0;
+            const uint8_t* name = nullptr;
+            if (!reader.readByte(type) || !reader.readVarint(first))
+            {
+                break;
+            }
+            if ((type == CreateEdgeRecord) || (type == AddLabelRecord) || (type == RemoveLabelRecord) ||
+                (type == DefineLabelRecord))
+            {
+                if (!reader.readVarint(second))
+                {
+                    break;
+                }
+            }
+            if ((type == DefineLabelRecord) && ((first != labels.size()) || !reader.readBytes(second, name)))
+            {
+                break;
+            }
+            if (((type == AddLabelRecord) || (type == RemoveLabelRecord)) && (second >= labels.size()))
+            {
+                break;
+            }
+            if ((type < CreateVerticesRecord) || (type > RemoveLabelRecord) || !reader.readChecksum(start))
+            {
+                break;
+            }
+
+            switch (type)
+            {
+            case CreateVerticesRecord:
+                graph.createVertices(static_cast<size_t>(first));
+                break;
+            case CreateEdgeRecord:
+                graph.createEdge(static_cast<VertexId>(first), static_cast<VertexId>(second));
+                break;
+            case DefineLabelRecord:
+                labels.emplace_back(reinterpret_cast<const char*>(name), static_cast<size_t>(second));
+                break;
+            case AddLabelRecord:
+                graph.addLabel(static_cast<VertexId>(first), labels[static_cast<size_t>(second)]);
+                break;
+            case RemoveLabelRecord:
+                graph.removeLabel(static_cast<VertexId>(first), labels[static_cast<size_t>(second)]);
+                break;
+            }
+            valid_size = reader.position();
+            ++record_count;
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // The records were valid when they were logged, so the log was not written on top of this graph.
+        throw std::runtime_error(m_path + " does not apply to the graph it is replayed on");
+    }
+
+    if (valid_size < data.size())
+    {
+        if (!Truncate(m_file, LogHeaderSize + valid_size) || !Sync(m_file))
+        {
+            throw std::runtime_error("Cannot truncate " + m_path);
+        }
+    }
+
+    m_size = LogHeaderSize + valid_size;
+    m_needs_replay = false;
+    m_record_count = record_count;
+    for (size_t i = 0; i < labels.size(); ++i)
+    {
+        m_label_numbers[labels[i]] = static_cast<uint32_t>(i);
+    }
+    return record_count;
+}
+
+void WriteAheadLog::logCreateVertices(size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    beginRecord(CreateVerticesRecord);
+    writeVarint(count);
+    endRecord();
+}
+
+void WriteAheadLog::logCreateEdge(VertexId from, VertexId to)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    beginRecord(CreateEdgeRecord);
+    writeVarint(from);
+    writeVarint(to);
+    endRecord();
+}
+
+void WriteAheadLog::logAddLabel(VertexId vertex, const std::string& label)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint32_t number = labelNumber(label);
+    beginRecord(AddLabelRecord);
+    writeVarint(vertex);
+    writeVarint(number);
+    endRecord();
+}
+
+void WriteAheadLog::logRemoveLabel(VertexId vertex, const std::string& label)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint32_t number = labelNumber(label);
+    beginRecord(RemoveLabelRecord);
+    writeVarint(vertex);
+    writeVarint(number);
+    endRecord();
+}
+
+void WriteAheadLog::commit()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    commitLocked();
+}
+
+void WriteAheadLog::commitLocked()
+{
+    if (m_buffer.empty())
+    {
+        return;
+    }
+
+    // A failed write may leave part of the group in the file. The next commit writes the group again from the same
+    // position, and replay() cuts whatever a crash leaves after the last complete record.
+    if (!SeekTo(m_file, m_size) || !WriteAll(m_file, m_buffer.data(), m_buffer.size()) || !Sync(m_file))
+    {
+        throw std::runtime_error("Cannot write " + m_path);
+    }
+    m_size += m_buffer.size();
+    m_buffer.clear();
+    m_pending_count = 0;
+    ++m_sync_count;
+}
+
+void WriteAheadLog::reset(uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint64_t header[2] = { LogMagic, generation };
+    if (!Truncate(m_file, 0) || !SeekTo(m_file, 0) ||
+        !WriteAll(m_file, reinterpret_cast<const uint8_t*>(header), sizeof(header)) || !Sync(m_file))
+    {
+        throw std::runtime_error("Cannot write " + m_path);
+    }
+    m_generation = generation;
+    m_size = LogHeaderSize;
+    m_needs_replay = false;
+    m_buffer.clear();
+    m_pending_count = 0;
+    m_record_count = 0;
+    ++m_sync_count;
+    m_label_numbers.clear();
+}
+
+void WriteAheadLog::beginRecord(uint8_t type)
+{
+    if (m_needs_replay)
+    {
+        throw std::runtime_error(m_path + " must be replayed before new records are logged");
+    }
+    m_record_start = m_buffer.size();
+    m_buffer.push_back(type);
+}
+
+void WriteAheadLog::endRecord()
+{
+    const uint32_t checksum = RecordChecksum(m_buffer.data() + m_record_start, m_buffer.size() - m_record_start);
+    for (int i = 0; i < 4; ++i)
+    {
+        m_buffer.push_back(static_cast<uint8_t>(checksum >> (8 * i)));
+    }
+    ++m_record_count;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (m_pending_count++ == 0)
+    {
+        m_oldest_pending = now;
+        if (m_options.group_window.count() > 0)
+        {
+            if (!m_flusher.joinable())
+            {
+                m_flusher = std::thread(&WriteAheadLog::flushOnTimeout, this);
+            }
+            m_wakeup.notify_one();
+        }
+    }
+    if ((m_pending_count >= m_options.group_size) || ((now - m_oldest_pending) >= m_options.group_window))
+    {
+        commitLocked();
+    }
+}
+
+void WriteAheadLog::flushOnTimeout()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        if (m_pending_count == 0)
+        {
+            m_wakeup.wait(lock);
+            continue;
+        }
+        const auto deadline = m_oldest_pending + m_options.group_window;
+        if (std::chrono::steady_clock::now() < deadline)
+        {
+            m_wakeup.wait_until(lock, deadline);
+            continue;
+        }
+        try
+        {
+            commitLocked();
+        }
+        catch (const std::runtime_error&)
+        {
+            // The group stays pending. It is tried again after another window, and the writer sees the error when
+            // it syncs the group itself.
+            m_oldest_pending = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+void WriteAheadLog::writeVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    m_buffer.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t WriteAheadLog::labelNumber(const std::string& label)
+{
+    auto found = m_label_numbers.find(label);
+    if (found != m_label_numbers.end())
+    {
+        return found->second;
+    }
+
+    // The first record that uses a label is preceded by a record that gives it its number.
+    const uint32_t number = static_cast<uint32_t>(m_label_numbers.size());
+    beginRecord(DefineLabelRecord);
+    writeVarint(number);
+    writeVarint(label.size());
+    m_buffer.insert(m_buffer.end(), label.begin(), label.end());
+    endRecord();
+    m_label_numbers.emplace(label, number);
+    return number;
+}
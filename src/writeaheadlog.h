@@ -0,0 +1,136 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include "types.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class GraphStore;
+
+/// Options of a write-ahead log.
+struct WalOptions
+{
+    /// The pending records are written and synced to disk as soon as there are this many of them...
+    size_t group_size = 1024;
+    /// ...or as soon as the oldest of them has waited this long, whichever comes first. The window is watched by a
+    /// thread of the log, so the records of a writer that stops logging are synced without waiting for its next one.
+    std::chrono::milliseconds group_window = std::chrono::milliseconds(10);
+    /// DurableGraphStore writes a checkpoint after this many records, or only when asked to if 0.
+    size_t checkpoint_interval = 0;
+};
+
+/// Append-only log of the mutations of a GraphStore.
+/// Each mutation is one compact binary record: a type byte, the vertex IDs as varints and a 32-bit checksum. Label
+/// names are written once per log and then referred to by number. Records are buffered and made durable in groups
+/// (group commit): a single write and a single fsync for many records, so that ingest is not limited by the number of
+/// syncs the disk can do per second. A crash loses at most the records of the group that was not synced yet.
+/// The log has a single writer; the only other thread is the one that syncs a group once its window has passed.
+/// The log starts with a generation number that ties it to the checkpoint it applies on top of, see
+/// DurableGraphStore.
+class WriteAheadLog
+{
+public:
+    /// Open a log, or create an empty one if the file does not exist.
+    /// @param path The path of the log file.
+    /// @param generation The generation of the log if it is created.
+    /// @param options When to sync the records.
+    /// @throws std::runtime_error if the file can't be opened or created or is not a log file.
+    WriteAheadLog(const std::string& path, uint64_t generation, const WalOptions& options);
+
+    /// Stop the thread that syncs the groups, sync the pending records and close the file. Errors are ignored; call
+    /// commit() first to see them.
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /// Returns the generation of the log.
+    uint64_t generation() const { return m_generation; }
+
+    /// Apply the records of the log to a graph, in order. A damaged or incomplete record, left by a crash in the
+    /// middle of a write, ends the log: it is cut from the file with everything after it. This must be called before
+    /// anything new is logged if the file already had records.
+    /// @returns The number of records applied.
+    /// @throws std::runtime_error if a record does not apply to the graph or the file can't be truncated.
+    size_t replay(GraphStore& graph);
+
+    /// Log a mutation. It becomes durable with the group it belongs to, or at the next commit().
+    /// @throws std::runtime_error if the log has records that were not replayed, or if the group can't be synced. A
+    /// group that the window thread could not sync stays pending and is written again by the next sync.
+    void logCreateVertices(size_t count);
+    void logCreateEdge(VertexId from, VertexId to);
+    void logAddLabel(VertexId vertex, const std::string& label);
+    void logRemoveLabel(VertexId vertex, const std::string& label);
+
+    /// Write and sync the pending records. A writer that stops logging for a while calls this so that its last
+    /// records don't wait for the next group.
+    /// @throws std::runtime_error if the file can't be written or synced.
+    void commit();
+
+    /// Replace the log by an empty one of another generation. This drops every record, pending ones included.
+    /// @throws std::runtime_error if the new log can't be written.
+    void reset(uint64_t generation);
+
+    /// Returns the number of records in the log, pending ones included.
+    size_t recordCount() const { return m_record_count; }
+
+    /// Returns the number of records that are not synced yet.
+    size_t pendingCount() const { return m_pending_count; }
+
+    /// Returns the number of times the file was synced since it was opened.
+    size_t syncCount() const { return m_sync_count; }
+
+private:
+    // These expect m_mutex to be held.
+    void commitLocked();
+    void beginRecord(uint8_t type);
+    void endRecord();
+    void writeVarint(uint64_t value);
+    uint32_t labelNumber(const std::string& label);
+
+    // The body of m_flusher: syncs the pending records once the oldest has waited group_window.
+    void flushOnTimeout();
+
+    std::string m_path;
+    WalOptions m_options;
+    int m_file = -1;
+    uint64_t m_generation = 0;
+    // The size of the file up to the last synced record.
+    uint64_t m_size = 0;
+    // Set while the file has records that replay() has not read yet.
+    bool m_needs_replay = false;
+    // The records not written yet, and where the record being encoded starts in it.
+    std::vector<uint8_t> m_buffer;
+    size_t m_record_start = 0;
+    std::atomic<size_t> m_pending_count{0};
+    std::chrono::steady_clock::time_point m_oldest_pending;
+    size_t m_record_count = 0;
+    std::atomic<size_t> m_sync_count{0};
+    // The number each label name was given in this log.
+    std::unordered_map<std::string, uint32_t> m_label_numbers;
+
+    // Guards the buffer and the file against m_flusher, which is started with the first pending record and woken
+    // each time a group starts.
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopping = false;
+    std::thread m_flusher;
+};
+
+/// Flush the data of a file to disk.
+/// @throws std::runtime_error if the file can't be opened or synced.
+void SyncFile(const std::string& path);
+
+/// Flush the directory entries of the directory of a file to disk, so that a file created or renamed there stays
+/// created or renamed after a crash. Does nothing on Windows, where directories can't be synced this way.
+/// @throws std::runtime_error if the directory can't be opened or synced.
+void SyncDirectory(const std::string& path);
+
+#endif